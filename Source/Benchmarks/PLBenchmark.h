@@ -0,0 +1,99 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A single benchmark operation.
+ */
+typedef void (^PLBenchmarkBlock)(void);
+
+@interface PLBenchmarkResult : NSObject {
+@private
+    /** Benchmark name */
+    NSString *_name;
+
+    /** Number of operations timed */
+    uint64_t _iterations;
+
+    /** Total elapsed time, in nanoseconds */
+    uint64_t _elapsedNanoseconds;
+
+    /** Total number of heap allocations performed */
+    uint64_t _allocations;
+
+    /** Number of bytes processed per operation, or 0 if not applicable */
+    uint64_t _bytesPerOperation;
+}
+
+- (id) initWithName: (NSString *) name
+         iterations: (uint64_t) iterations
+ elapsedNanoseconds: (uint64_t) elapsedNanoseconds
+        allocations: (uint64_t) allocations
+  bytesPerOperation: (uint64_t) bytesPerOperation;
+
+- (NSString *) JSONRepresentation;
+
+/** Benchmark name. */
+@property(nonatomic, readonly) NSString *name;
+
+/** Number of operations timed. */
+@property(nonatomic, readonly) uint64_t iterations;
+
+/** Mean wall-clock time per operation, in nanoseconds. */
+@property(nonatomic, readonly) double nanosecondsPerOperation;
+
+/** Throughput, in bytes per second, or 0 if the benchmark does not process a fixed number of bytes. */
+@property(nonatomic, readonly) double bytesPerSecond;
+
+/** Mean number of heap allocations per operation. */
+@property(nonatomic, readonly) double allocationsPerOperation;
+
+@end
+
+@interface PLBenchmark : NSObject {
+@private
+    /** Benchmark name */
+    NSString *_name;
+
+    /** Number of bytes processed per operation */
+    uint64_t _bytesPerOperation;
+
+    /** The operation to be timed */
+    PLBenchmarkBlock _block;
+}
+
++ (id) benchmarkWithName: (NSString *) name bytesPerOperation: (uint64_t) bytes block: (PLBenchmarkBlock) block;
+- (id) initWithName: (NSString *) name bytesPerOperation: (uint64_t) bytes block: (PLBenchmarkBlock) block;
+
+- (PLBenchmarkResult *) runForDuration: (NSTimeInterval) duration;
+
+/** Benchmark name. */
+@property(nonatomic, readonly) NSString *name;
+
+@end
@@ -0,0 +1,328 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLBenchmark.h"
+#import "PLSimulatorStats.h"
+
+#import <mach/mach.h>
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+#import <pthread.h>
+
+/* Value of _allocations if allocation counting is unavailable */
+#define ALLOCATIONS_UNAVAILABLE UINT64_MAX
+
+/* Fraction of the requested duration spent on calibration runs */
+#define CALIBRATION_FRACTION 0.1
+
+/*
+ * Allocation counting.
+ *
+ * The default malloc zone's allocation functions are replaced with wrappers that count allocations made by the
+ * benchmark thread; allocations made by other threads (eg, GCD workers or the runtime) are not counted.
+ */
+static void *(*orig_malloc)(struct _malloc_zone_t *zone, size_t size);
+static void *(*orig_calloc)(struct _malloc_zone_t *zone, size_t num_items, size_t size);
+static void *(*orig_valloc)(struct _malloc_zone_t *zone, size_t size);
+static void *(*orig_realloc)(struct _malloc_zone_t *zone, void *ptr, size_t size);
+
+static bool counters_installed = false;
+static volatile uint32_t counting_enabled = 0;
+static pthread_t counting_thread;
+static volatile int64_t allocation_count = 0;
+
+static inline void count_allocation (void) {
+    if (counting_enabled && pthread_equal(pthread_self(), counting_thread))
+        __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+}
+
+static void *counting_malloc (struct _malloc_zone_t *zone, size_t size) {
+    count_allocation();
+    return orig_malloc(zone, size);
+}
+
+static void *counting_calloc (struct _malloc_zone_t *zone, size_t num_items, size_t size) {
+    count_allocation();
+    return orig_calloc(zone, num_items, size);
+}
+
+static void *counting_valloc (struct _malloc_zone_t *zone, size_t size) {
+    count_allocation();
+    return orig_valloc(zone, size);
+}
+
+static void *counting_realloc (struct _malloc_zone_t *zone, void *ptr, size_t size) {
+    count_allocation();
+    return orig_realloc(zone, ptr, size);
+}
+
+/*
+ * Install the counting wrappers in the default malloc zone. Newer releases of libmalloc map the zone
+ * structure read-only, in which case the page is temporarily made writable.
+ */
+static void install_allocation_counters (void) {
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        malloc_zone_t *zone = malloc_default_zone();
+        vm_address_t page = trunc_page((vm_address_t) zone);
+        vm_size_t size = round_page((vm_address_t) zone + sizeof(*zone)) - page;
+
+        /* Fetch the current protection, so that it may be restored */
+        vm_address_t region = page;
+        vm_size_t regionSize;
+        vm_region_basic_info_data_64_t info;
+        mach_msg_type_number_t infoCount = VM_REGION_BASIC_INFO_COUNT_64;
+        mach_port_t object;
+        kern_return_t kr = vm_region_64(mach_task_self(), &region, &regionSize, VM_REGION_BASIC_INFO_64, (vm_region_info_t) &info, &infoCount, &object);
+        if (kr != KERN_SUCCESS) {
+            NSLog(@"Allocation counting unavailable; could not determine zone protection: %d", kr);
+            return;
+        }
+
+        kr = vm_protect(mach_task_self(), page, size, FALSE, VM_PROT_READ | VM_PROT_WRITE);
+        if (kr != KERN_SUCCESS) {
+            NSLog(@"Allocation counting unavailable; could not make the default zone writable: %d", kr);
+            return;
+        }
+
+        orig_malloc = zone->malloc;
+        orig_calloc = zone->calloc;
+        orig_valloc = zone->valloc;
+        orig_realloc = zone->realloc;
+
+        zone->malloc = counting_malloc;
+        zone->calloc = counting_calloc;
+        zone->valloc = counting_valloc;
+        zone->realloc = counting_realloc;
+
+        vm_protect(mach_task_self(), page, size, FALSE, info.protection);
+        counters_installed = true;
+    });
+}
+
+/**
+ * The result of a PLBenchmark run.
+ */
+@implementation PLBenchmarkResult
+
+@synthesize name = _name;
+@synthesize iterations = _iterations;
+
+/**
+ * Initialize a new result.
+ *
+ * @param name Benchmark name.
+ * @param iterations Number of operations timed.
+ * @param elapsedNanoseconds Total elapsed time, in nanoseconds.
+ * @param allocations Total number of heap allocations performed, or UINT64_MAX if unavailable.
+ * @param bytesPerOperation Number of bytes processed per operation, or 0 if not applicable.
+ */
+- (id) initWithName: (NSString *) name
+         iterations: (uint64_t) iterations
+ elapsedNanoseconds: (uint64_t) elapsedNanoseconds
+        allocations: (uint64_t) allocations
+  bytesPerOperation: (uint64_t) bytesPerOperation
+{
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _name = name;
+    _iterations = iterations;
+    _elapsedNanoseconds = elapsedNanoseconds;
+    _allocations = allocations;
+    _bytesPerOperation = bytesPerOperation;
+
+    return self;
+}
+
+// property getter
+- (double) nanosecondsPerOperation {
+    if (_iterations == 0)
+        return 0;
+
+    return (double) _elapsedNanoseconds / _iterations;
+}
+
+// property getter
+- (double) bytesPerSecond {
+    if (_elapsedNanoseconds == 0)
+        return 0;
+
+    return (double) _bytesPerOperation * _iterations / (_elapsedNanoseconds / (double) NSEC_PER_SEC);
+}
+
+// property getter
+- (double) allocationsPerOperation {
+    if (_iterations == 0 || _allocations == ALLOCATIONS_UNAVAILABLE)
+        return -1;
+
+    return (double) _allocations / _iterations;
+}
+
+/**
+ * Return a single-line JSON object describing the result. Allocation counts are reported as null
+ * if allocation counting was unavailable.
+ */
+- (NSString *) JSONRepresentation {
+    NSString *name = [_name stringByReplacingOccurrencesOfString: @"\\" withString: @"\\\\"];
+    name = [name stringByReplacingOccurrencesOfString: @"\"" withString: @"\\\""];
+
+    NSString *allocs = @"null";
+    if (_allocations != ALLOCATIONS_UNAVAILABLE)
+        allocs = [NSString stringWithFormat: @"%.2f", self.allocationsPerOperation];
+
+    return [NSString stringWithFormat: @"{\"name\": \"%@\", \"iterations\": %llu, \"ns_per_op\": %.1f, \"bytes_per_sec\": %.0f, \"allocs_per_op\": %@}",
+            name, (unsigned long long) _iterations, self.nanosecondsPerOperation, self.bytesPerSecond, allocs];
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [self JSONRepresentation];
+}
+
+@end
+
+@interface PLBenchmark (PrivateMethods)
+- (uint64_t) runIterations: (uint64_t) iterations allocations: (uint64_t *) allocations;
+@end
+
+/**
+ * A timed micro-benchmark.
+ *
+ * Each operation runs within its own autorelease pool, so that autoreleased objects are released -- and their
+ * deallocation timed -- within the operation that created them.
+ *
+ * @par Thread Safety
+ * Benchmarks must be run from a single thread at a time.
+ */
+@implementation PLBenchmark
+
+@synthesize name = _name;
+
+/**
+ * Create and initialize a new benchmark.
+ *
+ * @param name Benchmark name.
+ * @param bytes Number of bytes processed per operation, or 0 if not applicable.
+ * @param block The operation to be timed.
+ */
++ (id) benchmarkWithName: (NSString *) name bytesPerOperation: (uint64_t) bytes block: (PLBenchmarkBlock) block {
+    return [[self alloc] initWithName: name bytesPerOperation: bytes block: block];
+}
+
+/**
+ * Initialize a new benchmark.
+ *
+ * @param name Benchmark name.
+ * @param bytes Number of bytes processed per operation, or 0 if not applicable.
+ * @param block The operation to be timed.
+ */
+- (id) initWithName: (NSString *) name bytesPerOperation: (uint64_t) bytes block: (PLBenchmarkBlock) block {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _name = name;
+    _bytesPerOperation = bytes;
+    _block = [block copy];
+
+    return self;
+}
+
+/**
+ * Run the benchmark for approximately @a duration seconds.
+ *
+ * The iteration count is calibrated by timing successively larger batches, after which a single batch
+ * sized to fill the requested duration is timed and reported.
+ *
+ * @param duration Target duration, in seconds.
+ */
+- (PLBenchmarkResult *) runForDuration: (NSTimeInterval) duration {
+    install_allocation_counters();
+
+    uint64_t target = (uint64_t) (duration * NSEC_PER_SEC);
+    uint64_t iterations = 1;
+    uint64_t elapsed;
+
+    /* Calibrate (and warm up) */
+    while ((elapsed = [self runIterations: iterations allocations: NULL]) < target * CALIBRATION_FRACTION && iterations < (1ULL << 32))
+        iterations *= 2;
+
+    /* Run the final batch */
+    if (elapsed > 0)
+        iterations = MAX(1, iterations * target / elapsed);
+
+    uint64_t allocations;
+    elapsed = [self runIterations: iterations allocations: &allocations];
+
+    return [[PLBenchmarkResult alloc] initWithName: _name
+                                        iterations: iterations
+                                elapsedNanoseconds: elapsed
+                                       allocations: allocations
+                                 bytesPerOperation: _bytesPerOperation];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLBenchmark (PrivateMethods)
+
+/**
+ * Time @a iterations operations.
+ *
+ * @param iterations Number of operations to run.
+ * @param allocations If non-NULL, will be set to the total number of heap allocations performed, or UINT64_MAX
+ * if allocation counting is unavailable.
+ *
+ * @return Returns the elapsed time, in nanoseconds.
+ */
+- (uint64_t) runIterations: (uint64_t) iterations allocations: (uint64_t *) allocations {
+    if (allocations != NULL && counters_installed) {
+        counting_thread = pthread_self();
+        allocation_count = 0;
+        __atomic_store_n(&counting_enabled, 1, __ATOMIC_SEQ_CST);
+    }
+
+    uint64_t start = mach_absolute_time();
+    for (uint64_t i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            _block();
+        }
+    }
+    uint64_t end = mach_absolute_time();
+
+    if (allocations != NULL) {
+        __atomic_store_n(&counting_enabled, 0, __ATOMIC_SEQ_CST);
+        *allocations = counters_installed ? (uint64_t) allocation_count : ALLOCATIONS_UNAVAILABLE;
+    }
+
+    return plsimulator_stats_abs_to_ns(end - start);
+}
+
+@end
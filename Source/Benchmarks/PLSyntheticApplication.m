@@ -0,0 +1,99 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSyntheticApplication.h"
+
+/**
+ * Generates synthetic simulator application bundles, for exercising the launch path without a
+ * built application.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation PLSyntheticApplication
+
+/**
+ * Return an Info.plist dictionary for a simulator application.
+ *
+ * @param name The application name, used for the executable, display, and bundle names.
+ * @param canonicalSDKName The canonical name of the SDK the application was built with (eg, iphonesimulator6.0).
+ * @param deviceFamilies The supported device family codes, as NSNumbers.
+ */
++ (NSDictionary *) infoWithName: (NSString *) name canonicalSDKName: (NSString *) canonicalSDKName deviceFamilies: (NSArray *) deviceFamilies {
+    NSMutableDictionary *info = [NSMutableDictionary dictionary];
+    [info setObject: name forKey: @"CFBundleName"];
+    [info setObject: name forKey: @"CFBundleDisplayName"];
+    [info setObject: name forKey: @"CFBundleExecutable"];
+    [info setObject: [@"coop.plausible.synthetic." stringByAppendingString: name] forKey: @"CFBundleIdentifier"];
+    [info setObject: @"6.0" forKey: @"CFBundleInfoDictionaryVersion"];
+    [info setObject: @"1.0" forKey: @"CFBundleVersion"];
+    [info setObject: @"APPL" forKey: @"CFBundlePackageType"];
+    [info setObject: [NSArray arrayWithObject: @"iPhoneSimulator"] forKey: @"CFBundleSupportedPlatforms"];
+    [info setObject: @"iphonesimulator" forKey: @"DTPlatformName"];
+    [info setObject: canonicalSDKName forKey: @"DTSDKName"];
+    [info setObject: deviceFamilies forKey: @"UIDeviceFamily"];
+    [info setObject: [NSNumber numberWithBool: YES] forKey: @"LSRequiresIPhoneOS"];
+
+    return info;
+}
+
+/**
+ * Create an application bundle at @a path with the given Info.plist and an empty executable.
+ *
+ * @param path The application bundle path to create.
+ * @param info The Info.plist dictionary.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
++ (BOOL) writeApplicationAtPath: (NSString *) path info: (NSDictionary *) info error: (NSError **) outError {
+    return [self writeApplicationAtPath: path info: info executable: [NSData data] error: outError];
+}
+
+/**
+ * Create an application bundle at @a path with the given Info.plist and executable.
+ *
+ * @param path The application bundle path to create.
+ * @param info The Info.plist dictionary.
+ * @param executable The executable's contents (eg, as returned by PLSyntheticMachO).
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
++ (BOOL) writeApplicationAtPath: (NSString *) path info: (NSDictionary *) info executable: (NSData *) executable error: (NSError **) outError {
+    NSFileManager *fm = [NSFileManager new];
+    if (![fm createDirectoryAtPath: path withIntermediateDirectories: YES attributes: nil error: outError])
+        return NO;
+
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: info format: NSPropertyListBinaryFormat_v1_0 errorDescription: NULL];
+    if (data == nil || ![data writeToFile: [path stringByAppendingPathComponent: @"Info.plist"] options: NSDataWritingAtomic error: outError])
+        return NO;
+
+    NSString *executablePath = [path stringByAppendingPathComponent: [info objectForKey: @"CFBundleExecutable"]];
+    return [executable writeToFile: executablePath options: NSDataWritingAtomic error: outError];
+}
+
+@end
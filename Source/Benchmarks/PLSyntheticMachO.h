@@ -0,0 +1,83 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import <mach/machine.h>
+
+/**
+ * Synthetic image generation options.
+ */
+enum {
+    /** Generate a 64-bit (mach_header_64) image. */
+    PLSyntheticMachO64Bit = 1 << 0,
+
+    /** Generate the image in the opposite of the host byte order. */
+    PLSyntheticMachOByteSwapped = 1 << 1,
+
+    /** Pad the image with PLSyntheticMachOSignedPageCount pages of filler, and append an embedded code
+     * signature containing SHA-256 hashes of each page. */
+    PLSyntheticMachOCodeSigned = 1 << 2,
+
+    /** Declare PLSyntheticMachOMinimumOSVersion and PLSyntheticMachOSDKVersion via LC_VERSION_MIN_IPHONEOS. */
+    PLSyntheticMachOVersionMin = 1 << 3,
+
+    /** Declare PLSyntheticMachOMinimumOSVersion and PLSyntheticMachOSDKVersion via LC_BUILD_VERSION, with a
+     * platform of PLATFORM_IOSSIMULATOR. */
+    PLSyntheticMachOBuildVersion = 1 << 4,
+
+    /** Declare an SDK version of 0 in any version commands, as written by older linkers. */
+    PLSyntheticMachOUnsetSDKVersion = 1 << 5,
+
+    /** Declare a platform of PLATFORM_MACOS in any LC_BUILD_VERSION command. */
+    PLSyntheticMachOMacOSPlatform = 1 << 6
+};
+typedef uint32_t PLSyntheticMachOOptions;
+
+/** Number of code pages in a PLSyntheticMachOCodeSigned image. */
+#define PLSyntheticMachOSignedPageCount 16
+
+/** Code page size of a PLSyntheticMachOCodeSigned image. */
+#define PLSyntheticMachOSignedPageSize 4096
+
+/** Nibble-encoded minimum OS version (4.3) declared by PLSyntheticMachOVersionMin and PLSyntheticMachOBuildVersion images. */
+#define PLSyntheticMachOMinimumOSVersion 0x00040300
+
+/** Nibble-encoded SDK version (6.1) declared by PLSyntheticMachOVersionMin and PLSyntheticMachOBuildVersion images. */
+#define PLSyntheticMachOSDKVersion 0x00060100
+
+@interface PLSyntheticMachO : NSObject
+
++ (NSData *) imageWithCPUType: (cpu_type_t) cpuType
+                   cpuSubtype: (cpu_subtype_t) cpuSubtype
+                      options: (PLSyntheticMachOOptions) options
+             loadCommandCount: (NSUInteger) loadCommandCount;
+
++ (NSData *) universalBinaryWithImages: (NSArray *) images;
+
+@end
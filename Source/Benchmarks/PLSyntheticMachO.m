@@ -0,0 +1,314 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSyntheticMachO.h"
+#import "PLCodeSignature.h"
+#import "PLMachO.h"
+
+#import <mach-o/loader.h>
+#import <mach-o/fat.h>
+
+#import <libkern/OSByteOrder.h>
+#import <CommonCrypto/CommonDigest.h>
+
+/* Alignment (as a power of two) of universal binary slices. Matches the page alignment used by lipo. */
+#define FAT_SLICE_ALIGN 12
+
+/* Signing identifier of code signed images */
+#define SIGNING_IDENTIFIER "coop.plausible.synthetic"
+
+/**
+ * Generates synthetic Mach-O images and universal binaries for benchmarking the binary parsers.
+ *
+ * Images contain only a Mach-O header and load commands; they are suitable for parsing, but not for
+ * loading. Load commands cycle through LC_RPATH, LC_LOAD_DYLIB and LC_UUID, exercising both the handled
+ * and the skipped command paths. Version commands, if requested, follow the generated load commands. Code signed images additionally contain filler pages and an embedded
+ * code signature with valid page hashes, but no CMS signature.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation PLSyntheticMachO
+
+/* Return the load command string for @a index. Variants are chosen to exercise absoluteRpaths. */
+static NSString *rpath_string (NSUInteger index) {
+    switch (index % 3) {
+        case 0:
+            return @"@loader_path/../Frameworks";
+        case 1:
+            return [NSString stringWithFormat: @"@executable_path/../../Library/PrivateFrameworks/Synthetic%lu", (unsigned long) index];
+        default:
+            return [NSString stringWithFormat: @"/Developer/Library/./Frameworks/Synthetic%lu.framework/..", (unsigned long) index];
+    }
+}
+
+/* Return the size of the embedded code signature generated for @a pageCount pages. */
+static size_t code_signature_size (size_t pageCount) {
+    return sizeof(pl_cs_super_blob_t) + sizeof(pl_cs_blob_index_t) + sizeof(pl_cs_code_directory_t) +
+        sizeof(SIGNING_IDENTIFIER) + (pageCount * CC_SHA256_DIGEST_LENGTH);
+}
+
+/* Return an embedded code signature containing the SHA-256 page hashes of @a code, which must be a multiple
+ * of PLSyntheticMachOSignedPageSize in length. */
+static NSData *code_signature (NSData *code) {
+    size_t pageCount = [code length] / PLSyntheticMachOSignedPageSize;
+    uint32_t cdOffset = sizeof(pl_cs_super_blob_t) + sizeof(pl_cs_blob_index_t);
+    uint32_t hashOffset = sizeof(pl_cs_code_directory_t) + sizeof(SIGNING_IDENTIFIER);
+
+    pl_cs_super_blob_t superBlob;
+    superBlob.magic = OSSwapHostToBigInt32(PL_CSMAGIC_EMBEDDED_SIGNATURE);
+    superBlob.length = OSSwapHostToBigInt32((uint32_t) code_signature_size(pageCount));
+    superBlob.count = OSSwapHostToBigInt32(1);
+
+    pl_cs_blob_index_t index;
+    index.type = OSSwapHostToBigInt32(PL_CSSLOT_CODEDIRECTORY);
+    index.offset = OSSwapHostToBigInt32(cdOffset);
+
+    pl_cs_code_directory_t cd;
+    memset(&cd, 0, sizeof(cd));
+    cd.magic = OSSwapHostToBigInt32(PL_CSMAGIC_CODEDIRECTORY);
+    cd.length = OSSwapHostToBigInt32((uint32_t) (hashOffset + (pageCount * CC_SHA256_DIGEST_LENGTH)));
+    cd.version = OSSwapHostToBigInt32(0x20001);
+    cd.hashOffset = OSSwapHostToBigInt32(hashOffset);
+    cd.identOffset = OSSwapHostToBigInt32(sizeof(cd));
+    cd.nCodeSlots = OSSwapHostToBigInt32((uint32_t) pageCount);
+    cd.codeLimit = OSSwapHostToBigInt32((uint32_t) [code length]);
+    cd.hashSize = CC_SHA256_DIGEST_LENGTH;
+    cd.hashType = PL_CS_HASHTYPE_SHA256;
+    cd.pageSize = __builtin_ctz(PLSyntheticMachOSignedPageSize);
+
+    NSMutableData *signature = [NSMutableData data];
+    [signature appendBytes: &superBlob length: sizeof(superBlob)];
+    [signature appendBytes: &index length: sizeof(index)];
+    [signature appendBytes: &cd length: sizeof(cd)];
+    [signature appendBytes: SIGNING_IDENTIFIER length: sizeof(SIGNING_IDENTIFIER)];
+
+    for (size_t i = 0; i < pageCount; i++) {
+        uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+        CC_SHA256((const uint8_t *) [code bytes] + (i * PLSyntheticMachOSignedPageSize), PLSyntheticMachOSignedPageSize, digest);
+        [signature appendBytes: digest length: sizeof(digest)];
+    }
+
+    return signature;
+}
+
+/**
+ * Generate a non-universal Mach-O image.
+ *
+ * @param cpuType The image's CPU type.
+ * @param cpuSubtype The image's CPU subtype.
+ * @param options Image generation options.
+ * @param loadCommandCount The number of load commands to generate.
+ */
++ (NSData *) imageWithCPUType: (cpu_type_t) cpuType
+                   cpuSubtype: (cpu_subtype_t) cpuSubtype
+                      options: (PLSyntheticMachOOptions) options
+             loadCommandCount: (NSUInteger) loadCommandCount
+{
+    BOOL m64 = (options & PLSyntheticMachO64Bit) != 0;
+    BOOL swapped = (options & PLSyntheticMachOByteSwapped) != 0;
+    BOOL sign = (options & PLSyntheticMachOCodeSigned) != 0;
+    uint32_t (^S32)(uint32_t) = ^(uint32_t value) {
+        return swapped ? OSSwapInt32(value) : value;
+    };
+
+    /* Load commands are padded to the pointer size */
+    size_t align = m64 ? 8 : 4;
+    size_t headerSize = m64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+
+    NSMutableData *commands = [NSMutableData data];
+    for (NSUInteger i = 0; i < loadCommandCount; i++) {
+        NSMutableData *cmd;
+        NSData *string = nil;
+
+        switch (i % 4) {
+            case 0: {
+                struct rpath_command rpath;
+                memset(&rpath, 0, sizeof(rpath));
+                rpath.cmd = S32(LC_RPATH);
+                rpath.path.offset = S32(sizeof(rpath));
+
+                cmd = [NSMutableData dataWithBytes: &rpath length: sizeof(rpath)];
+                string = [rpath_string(i / 4) dataUsingEncoding: NSUTF8StringEncoding];
+                break;
+            }
+
+            case 1:
+            case 2: {
+                struct dylib_command dylib;
+                memset(&dylib, 0, sizeof(dylib));
+                dylib.cmd = S32(LC_LOAD_DYLIB);
+                dylib.dylib.name.offset = S32(sizeof(dylib));
+                dylib.dylib.current_version = S32(0x10000);
+                dylib.dylib.compatibility_version = S32(0x10000);
+
+                cmd = [NSMutableData dataWithBytes: &dylib length: sizeof(dylib)];
+                NSString *name = [NSString stringWithFormat: @"@rpath/Synthetic%1$lu.framework/Versions/A/Synthetic%1$lu", (unsigned long) i];
+                string = [name dataUsingEncoding: NSUTF8StringEncoding];
+                break;
+            }
+
+            default: {
+                struct uuid_command uuid;
+                memset(&uuid, 0, sizeof(uuid));
+                uuid.cmd = S32(LC_UUID);
+                memcpy(uuid.uuid, &i, MIN(sizeof(i), sizeof(uuid.uuid)));
+
+                cmd = [NSMutableData dataWithBytes: &uuid length: sizeof(uuid)];
+                break;
+            }
+        }
+
+        /* Append the NUL-terminated string, and pad */
+        if (string != nil) {
+            [cmd appendData: string];
+            [cmd increaseLengthBy: 1];
+        }
+        [cmd increaseLengthBy: (align - ([cmd length] % align)) % align];
+
+        /* cmdsize directly follows cmd in all load commands */
+        struct load_command *lc = [cmd mutableBytes];
+        lc->cmdsize = S32((uint32_t) [cmd length]);
+
+        [commands appendData: cmd];
+    }
+
+    /* Append the requested version commands */
+    uint32_t versionCommandCount = 0;
+    if (options & PLSyntheticMachOVersionMin) {
+        struct version_min_command version;
+        memset(&version, 0, sizeof(version));
+        version.cmd = S32(LC_VERSION_MIN_IPHONEOS);
+        version.cmdsize = S32(sizeof(version));
+        version.version = S32(PLSyntheticMachOMinimumOSVersion);
+        version.sdk = (options & PLSyntheticMachOUnsetSDKVersion) ? 0 : S32(PLSyntheticMachOSDKVersion);
+        [commands appendBytes: &version length: sizeof(version)];
+        versionCommandCount++;
+    }
+
+    if (options & PLSyntheticMachOBuildVersion) {
+        struct build_version_command build;
+        memset(&build, 0, sizeof(build));
+        build.cmd = S32(LC_BUILD_VERSION);
+        build.cmdsize = S32(sizeof(build));
+        build.platform = S32((options & PLSyntheticMachOMacOSPlatform) ? PLATFORM_MACOS : PLATFORM_IOSSIMULATOR);
+        build.minos = S32(PLSyntheticMachOMinimumOSVersion);
+        build.sdk = (options & PLSyntheticMachOUnsetSDKVersion) ? 0 : S32(PLSyntheticMachOSDKVersion);
+        [commands appendBytes: &build length: sizeof(build)];
+        versionCommandCount++;
+    }
+
+    /* The signature location is populated once the image has been laid out */
+    size_t signatureCommandOffset = headerSize + [commands length];
+    if (sign) {
+        struct linkedit_data_command sig;
+        memset(&sig, 0, sizeof(sig));
+        sig.cmd = S32(LC_CODE_SIGNATURE);
+        sig.cmdsize = S32(sizeof(sig));
+        [commands appendBytes: &sig length: sizeof(sig)];
+    }
+
+    /* Populate the header. The 64-bit header is a direct superset of the 32-bit header. */
+    struct mach_header_64 header;
+    memset(&header, 0, sizeof(header));
+    header.magic = m64 ? MH_MAGIC_64 : MH_MAGIC;
+    if (swapped)
+        header.magic = OSSwapInt32(header.magic);
+    header.cputype = S32(cpuType);
+    header.cpusubtype = S32(cpuSubtype);
+    header.filetype = S32(MH_DYLIB);
+    header.ncmds = S32((uint32_t) loadCommandCount + versionCommandCount + (sign ? 1 : 0));
+    header.sizeofcmds = S32((uint32_t) [commands length]);
+
+    NSMutableData *image = [NSMutableData dataWithBytes: &header length: headerSize];
+    [image appendData: commands];
+
+    if (sign) {
+        /* Fill the remaining code pages with a non-repeating pattern */
+        size_t codeSize = PLSyntheticMachOSignedPageCount * PLSyntheticMachOSignedPageSize;
+        assert([image length] <= codeSize);
+
+        size_t headerLength = [image length];
+        [image setLength: codeSize];
+        uint8_t *bytes = [image mutableBytes];
+        for (size_t i = headerLength; i < codeSize; i++)
+            bytes[i] = (uint8_t) ((i * 7) ^ (i >> 12));
+
+        struct linkedit_data_command *sig = (struct linkedit_data_command *) (bytes + signatureCommandOffset);
+        sig->dataoff = S32((uint32_t) codeSize);
+        sig->datasize = S32((uint32_t) code_signature_size(PLSyntheticMachOSignedPageCount));
+
+        [image appendData: code_signature(image)];
+    }
+
+    return image;
+}
+
+/**
+ * Generate a universal binary from a set of images, as returned by PLSyntheticMachO::imageWithCPUType:cpuSubtype:options:loadCommandCount:.
+ * The CPU type of each slice is read from the image's header.
+ *
+ * @param images The NSData images to include, in order.
+ */
++ (NSData *) universalBinaryWithImages: (NSArray *) images {
+    NSMutableData *output = [NSMutableData data];
+
+    struct fat_header header;
+    header.magic = OSSwapHostToBigInt32(FAT_MAGIC);
+    header.nfat_arch = OSSwapHostToBigInt32((uint32_t) [images count]);
+    [output appendBytes: &header length: sizeof(header)];
+
+    /* Lay out the slices after the fat_arch table */
+    uint32_t offset = (uint32_t) (sizeof(struct fat_header) + sizeof(struct fat_arch) * [images count]);
+    NSMutableData *slices = [NSMutableData data];
+    for (NSData *image in images) {
+        const struct mach_header *mh = [image bytes];
+        BOOL swapped = (mh->magic == MH_CIGAM || mh->magic == MH_CIGAM_64);
+
+        uint32_t alignment = 1 << FAT_SLICE_ALIGN;
+        uint32_t padding = (alignment - (offset % alignment)) % alignment;
+        offset += padding;
+        [slices increaseLengthBy: padding];
+
+        struct fat_arch arch;
+        arch.cputype = OSSwapHostToBigInt32(swapped ? OSSwapInt32(mh->cputype) : mh->cputype);
+        arch.cpusubtype = OSSwapHostToBigInt32(swapped ? OSSwapInt32(mh->cpusubtype) : mh->cpusubtype);
+        arch.offset = OSSwapHostToBigInt32(offset);
+        arch.size = OSSwapHostToBigInt32((uint32_t) [image length]);
+        arch.align = OSSwapHostToBigInt32(FAT_SLICE_ALIGN);
+        [output appendBytes: &arch length: sizeof(arch)];
+
+        [slices appendData: image];
+        offset += (uint32_t) [image length];
+    }
+
+    [output appendData: slices];
+    return output;
+}
+
+@end
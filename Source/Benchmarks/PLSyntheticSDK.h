@@ -0,0 +1,58 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * SDKSettings.plist schema generations.
+ */
+typedef enum {
+    /** Pre-3.2 SDKs, with no device family information. */
+    PLSyntheticSDKSchemaLegacy = 0,
+
+    /** 3.2 SDKs, declaring a top-level UIDeviceFamily array. */
+    PLSyntheticSDKSchemaDeviceFamily = 1,
+
+    /** 4.0+ SDKs, declaring SUPPORTED_DEVICE_FAMILIES within a populated DefaultProperties dictionary. */
+    PLSyntheticSDKSchemaDefaultProperties = 2
+} PLSyntheticSDKSchema;
+
+@interface PLSyntheticSDK : NSObject
+
++ (NSDictionary *) settingsWithVersion: (NSString *) version schema: (PLSyntheticSDKSchema) schema;
+
++ (BOOL) writeSDKAtPath: (NSString *) path
+               settings: (NSDictionary *) settings
+                 format: (NSPropertyListFormat) format
+                  error: (NSError **) outError;
+
++ (BOOL) writePlatformAtPath: (NSString *) path sdkVersions: (NSArray *) versions error: (NSError **) outError;
+
++ (BOOL) writeXcodeAtPath: (NSString *) path sdkVersions: (NSArray *) versions error: (NSError **) outError;
+
+@end
@@ -0,0 +1,203 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSyntheticSDK.h"
+
+/* Relative path to the setting plist */
+#define SDK_SETTINGS_PLIST @"SDKSettings.plist"
+
+/* Relative path to the set of platform sub-SDKs */
+#define PLATFORM_SUBSDK_PATH @"Developer/SDKs"
+
+/* Relative path to the bundle Info.plist */
+#define INFO_PLIST @"Info.plist"
+
+/* The Xcode.app bundle identifier */
+#define XCODE_BUNDLE_ID @"com.apple.dt.Xcode"
+
+/* The path to the iPhoneSimulator platform bundle within the Xcode.app bundle */
+#define XCODE_BUNDLE_PLATFORM_PATH @"Contents/Developer/Platforms/iPhoneSimulator.platform"
+
+/**
+ * Generates synthetic Simulator SDK meta-data for benchmarking PLSimulatorSDK.
+ *
+ * The generated SDKSettings.plist dictionaries mirror the shape of those shipped with the corresponding
+ * SDK generations, including the build setting defaults that PLSimulatorSDK must skip over.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation PLSyntheticSDK
+
+/**
+ * Return an SDKSettings dictionary for the given SDK @a version.
+ *
+ * @param version The SDK version (eg, 4.3).
+ * @param schema The SDKSettings schema generation to emulate.
+ */
++ (NSDictionary *) settingsWithVersion: (NSString *) version schema: (PLSyntheticSDKSchema) schema {
+    NSMutableDictionary *settings = [NSMutableDictionary dictionary];
+    [settings setObject: version forKey: @"Version"];
+    [settings setObject: [@"iphonesimulator" stringByAppendingString: version] forKey: @"CanonicalName"];
+    [settings setObject: [@"Simulator - " stringByAppendingString: version] forKey: @"MinimalDisplayName"];
+    [settings setObject: [@"Simulator - iOS " stringByAppendingString: version] forKey: @"DisplayName"];
+    [settings setObject: @"YES" forKey: @"isBaseSDK"];
+
+    NSArray *families = [NSArray arrayWithObjects: @"1", @"2", nil];
+    switch (schema) {
+        case PLSyntheticSDKSchemaLegacy:
+            break;
+
+        case PLSyntheticSDKSchemaDeviceFamily:
+            [settings setObject: families forKey: @"UIDeviceFamily"];
+            break;
+
+        case PLSyntheticSDKSchemaDefaultProperties: {
+            NSMutableDictionary *defaults = [NSMutableDictionary dictionary];
+            [defaults setObject: families forKey: @"SUPPORTED_DEVICE_FAMILIES"];
+            [defaults setObject: @"iphonesimulator" forKey: @"PLATFORM_NAME"];
+            [defaults setObject: @"iphonesimulator" forKey: @"EFFECTIVE_PLATFORM_NAME"];
+            [defaults setObject: version forKey: @"IPHONEOS_DEPLOYMENT_TARGET"];
+            [defaults setObject: @"com.apple.compilers.llvm.clang.1_0" forKey: @"GCC_VERSION"];
+            [defaults setObject: @"YES" forKey: @"GCC_OBJC_LEGACY_DISPATCH"];
+            [defaults setObject: @"YES" forKey: @"GCC_THUMB_SUPPORT"];
+            [defaults setObject: @"NO" forKey: @"ENTITLEMENTS_REQUIRED"];
+            [defaults setObject: @"NO" forKey: @"AD_HOC_CODE_SIGNING_ALLOWED"];
+            [defaults setObject: @"YES" forKey: @"CODE_SIGNING_REQUIRED"];
+            [defaults setObject: @"$(inherited) -D__IPHONE_OS_VERSION_MIN_REQUIRED=$(IPHONEOS_DEPLOYMENT_TARGET:identifier)" forKey: @"GCC_PREPROCESSOR_DEFINITIONS"];
+            [defaults setObject: @"i386" forKey: @"NATIVE_ARCH"];
+            [defaults setObject: @"armv7" forKey: @"ARCHS_STANDARD_32_BIT"];
+            [defaults setObject: @"$(DEVELOPER_DIR)/usr/bin/clang" forKey: @"CC"];
+            [settings setObject: defaults forKey: @"DefaultProperties"];
+
+            NSMutableArray *targets = [NSMutableArray array];
+            for (int major = 3; major <= [version intValue]; major++)
+                [targets addObject: [NSString stringWithFormat: @"%d.0", major]];
+            [settings setObject: targets forKey: @"DeploymentTargetSettingValues"];
+            [settings setObject: version forKey: @"MaximumDeploymentTarget"];
+            [settings setObject: [NSDictionary dictionaryWithObject: @"iphonesimulator" forKey: @"PLATFORM_NAME"] forKey: @"CustomProperties"];
+            break;
+        }
+    }
+
+    return settings;
+}
+
+/**
+ * Create an SDK directory at @a path containing an SDKSettings.plist populated from @a settings.
+ *
+ * @param path The SDK path to create.
+ * @param settings The SDKSettings property list.
+ * @param format The property list format to write.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
++ (BOOL) writeSDKAtPath: (NSString *) path
+               settings: (NSDictionary *) settings
+                 format: (NSPropertyListFormat) format
+                  error: (NSError **) outError
+{
+    NSFileManager *fm = [NSFileManager new];
+    if (![fm createDirectoryAtPath: path withIntermediateDirectories: YES attributes: nil error: outError])
+        return NO;
+
+    NSString *errorDesc;
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: settings format: format errorDescription: &errorDesc];
+    if (data == nil) {
+        NSLog(@"Failed to serialize SDK settings: %@", errorDesc);
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSCocoaErrorDomain code: NSPropertyListWriteInvalidError userInfo: nil];
+        return NO;
+    }
+
+    return [data writeToFile: [path stringByAppendingPathComponent: SDK_SETTINGS_PLIST] options: NSDataWritingAtomic error: outError];
+}
+
+/* Write @a plist to @a path as an XML property list, creating any intermediate directories */
+static BOOL write_plist (NSDictionary *plist, NSString *path, NSError **outError) {
+    if (![[NSFileManager new] createDirectoryAtPath: [path stringByDeletingLastPathComponent] withIntermediateDirectories: YES attributes: nil error: outError])
+        return NO;
+
+    NSString *errorDesc;
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: plist format: NSPropertyListXMLFormat_v1_0 errorDescription: &errorDesc];
+    if (data == nil) {
+        NSLog(@"Failed to serialize property list: %@", errorDesc);
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSCocoaErrorDomain code: NSPropertyListWriteInvalidError userInfo: nil];
+        return NO;
+    }
+
+    return [data writeToFile: path options: NSDataWritingAtomic error: outError];
+}
+
+/**
+ * Create a simulator platform directory at @a path, containing an SDK for each of @a versions.
+ *
+ * @param path The platform path to create (eg, iPhoneSimulator.platform).
+ * @param versions The SDK versions to include (eg, 6.0).
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
++ (BOOL) writePlatformAtPath: (NSString *) path sdkVersions: (NSArray *) versions error: (NSError **) outError {
+    if (!write_plist([NSDictionary dictionary], [path stringByAppendingPathComponent: INFO_PLIST], outError))
+        return NO;
+
+    NSString *sdkDir = [path stringByAppendingPathComponent: PLATFORM_SUBSDK_PATH];
+    for (NSString *version in versions) {
+        NSString *sdkPath = [sdkDir stringByAppendingPathComponent: [NSString stringWithFormat: @"iPhoneSimulator%@.sdk", version]];
+        NSDictionary *settings = [self settingsWithVersion: version schema: PLSyntheticSDKSchemaDefaultProperties];
+        if (![self writeSDKAtPath: sdkPath settings: settings format: NSPropertyListBinaryFormat_v1_0 error: outError])
+            return NO;
+    }
+
+    return YES;
+}
+
+/**
+ * Create an Xcode.app bundle at @a path, bundling a simulator platform containing an SDK for each of @a versions,
+ * as shipped with Xcode 4.3 and later.
+ *
+ * @param path The bundle path to create (eg, Xcode.app).
+ * @param versions The SDK versions to include (eg, 6.0).
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
++ (BOOL) writeXcodeAtPath: (NSString *) path sdkVersions: (NSArray *) versions error: (NSError **) outError {
+    NSMutableDictionary *info = [NSMutableDictionary dictionary];
+    [info setObject: XCODE_BUNDLE_ID forKey: @"CFBundleIdentifier"];
+    [info setObject: @"Xcode" forKey: @"CFBundleName"];
+    [info setObject: @"APPL" forKey: @"CFBundlePackageType"];
+    [info setObject: @"Xcode" forKey: @"CFBundleExecutable"];
+
+    if (!write_plist(info, [path stringByAppendingPathComponent: @"Contents/" INFO_PLIST], outError))
+        return NO;
+
+    return [self writePlatformAtPath: [path stringByAppendingPathComponent: XCODE_BUNDLE_PLATFORM_PATH] sdkVersions: versions error: outError];
+}
+
+@end
@@ -0,0 +1,685 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLBenchmark.h"
+#import "PLSyntheticMachO.h"
+#import "PLSyntheticSDK.h"
+#import "PLSyntheticApplication.h"
+
+#import "PLUniversalBinary.h"
+#import "PLExecutableBinary.h"
+#import "PLSimulatorSDK.h"
+#import "PLSimulatorPlatform.h"
+#import "PLSimulatorPlatformMatcher.h"
+#import "PLSimulatorDeviceFamily.h"
+#import "PLSimulatorStats.h"
+#import "rpm-vercomp.h"
+#import "PLMachO.h"
+#import "PLArena.h"
+#import "PLDylibGraph.h"
+#import "PLDylibPrefetcher.h"
+
+#import "LauncherAgentServer.h"
+#import "LauncherAgentClient.h"
+#import "LauncherMockAgentBackend.h"
+#import "LauncherSimClient.h"
+#import "LauncherStubSessionBackend.h"
+
+#import <mach/machine.h>
+#import <mach/mach_time.h>
+
+#import <fcntl.h>
+#import <unistd.h>
+
+/* Default per-benchmark duration, in seconds */
+#define DEFAULT_DURATION 1.0
+
+/* Number of load commands in each synthetic image */
+#define LOAD_COMMAND_COUNT 4096
+
+/* Number of cold-cache load rounds */
+#define COLD_LOAD_ROUNDS 3
+
+/* Flushes the unified buffer cache; see purge(8) */
+#define PURGE_COMMAND "/usr/sbin/purge"
+
+/* Number of discovery scaling rounds for each buffer cache state */
+#define DISCOVERY_ROUNDS 3
+
+/* Number of unrelated files per directory in the synthetic discovery tree */
+#define UNRELATED_FILES_PER_DIR 64
+
+/* The path to the iPhoneSimulator platform bundle within the Xcode.app bundle */
+#define XCODE_BUNDLE_PLATFORM_PATH @"Contents/Developer/Platforms/iPhoneSimulator.platform"
+
+/*
+ * Register the Mach-O parser benchmarks. Synthetic binaries are written to @a scratch, and the generated
+ * thin images are appended to @a images.
+ */
+static BOOL add_macho_benchmarks (NSMutableArray *benchmarks, NSString *scratch, NSMutableArray *images) {
+    /* Thin images in every supported layout */
+    struct {
+        const char *name;
+        cpu_type_t cpuType;
+        cpu_subtype_t cpuSubtype;
+        PLSyntheticMachOOptions options;
+    } layouts[] = {
+        { "i386",         CPU_TYPE_X86,     CPU_SUBTYPE_X86_ALL,    0 },
+        { "x86_64",       CPU_TYPE_X86_64,  CPU_SUBTYPE_X86_64_ALL, PLSyntheticMachO64Bit },
+        { "ppc",          CPU_TYPE_POWERPC, CPU_SUBTYPE_POWERPC_ALL, PLSyntheticMachOByteSwapped },
+        { "ppc64",        CPU_TYPE_POWERPC64, CPU_SUBTYPE_POWERPC_ALL, PLSyntheticMachO64Bit | PLSyntheticMachOByteSwapped },
+    };
+
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        NSData *image = [PLSyntheticMachO imageWithCPUType: layouts[i].cpuType
+                                                cpuSubtype: layouts[i].cpuSubtype
+                                                   options: layouts[i].options
+                                          loadCommandCount: LOAD_COMMAND_COUNT];
+        [images addObject: image];
+
+        NSString *path = [scratch stringByAppendingPathComponent: [NSString stringWithUTF8String: layouts[i].name]];
+        NSString *name = [NSString stringWithFormat: @"PLExecutableBinary/parse/%s", layouts[i].name];
+        [benchmarks addObject: [PLBenchmark benchmarkWithName: name bytesPerOperation: [image length] block: ^{
+            NSError *error;
+            if ([PLExecutableBinary binaryWithPath: path data: image error: &error] == nil)
+                NSLog(@"Failed to parse synthetic image: %@", error);
+        }]];
+    }
+
+    /* rpath resolution */
+    PLExecutableBinary *exec = [PLExecutableBinary binaryWithPath: [scratch stringByAppendingPathComponent: @"Contents/MacOS/x86_64"]
+                                                             data: [images objectAtIndex: 1]
+                                                            error: NULL];
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"PLExecutableBinary/absoluteRpaths" bytesPerOperation: 0 block: ^{
+        [exec absoluteRpaths];
+    }]];
+
+    /* Thin and universal files */
+    NSDictionary *files = [NSDictionary dictionaryWithObjectsAndKeys:
+                           [images objectAtIndex: 1], @"thin",
+                           [PLSyntheticMachO universalBinaryWithImages: images], @"universal",
+                           nil];
+
+    for (NSString *variant in files) {
+        NSData *data = [files objectForKey: variant];
+        NSString *path = [scratch stringByAppendingPathComponent: [@"binary-" stringByAppendingString: variant]];
+
+        NSError *error;
+        if (![data writeToFile: path options: NSDataWritingAtomic error: &error]) {
+            NSLog(@"Could not write synthetic binary: %@", error);
+            return NO;
+        }
+
+        NSString *name = [@"PLUniversalBinary/parse/" stringByAppendingString: variant];
+        [benchmarks addObject: [PLBenchmark benchmarkWithName: name bytesPerOperation: [data length] block: ^{
+            NSError *error;
+            if ([PLUniversalBinary binaryWithPath: path error: &error] == nil)
+                NSLog(@"Failed to parse synthetic binary: %@", error);
+        }]];
+    }
+
+    return YES;
+}
+
+/*
+ * Register the version comparison benchmarks.
+ */
+static void add_vercomp_benchmarks (NSMutableArray *benchmarks) {
+    static const char *versions[][2] = {
+        { "3.1", "3.1" },
+        { "4.3", "4.3.2" },
+        { "4.3.10", "4.3.9" },
+        { "5.0b2", "5.0" },
+        { "iphonesimulator6.1", "iphonesimulator7.0" },
+        { "10.0.1.12345", "10.0.1.12346" },
+    };
+
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"rpm_vercomp" bytesPerOperation: 0 block: ^{
+        for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++)
+            rpm_vercomp(versions[i][0], versions[i][1]);
+    }]];
+}
+
+/*
+ * Register the SDK loading benchmarks. Synthetic SDKs are written to @a scratch, and their paths are
+ * appended to @a sdkPaths.
+ */
+static BOOL add_sdk_benchmarks (NSMutableArray *benchmarks, NSString *scratch, NSMutableArray *sdkPaths) {
+    NSDictionary *schemas = [NSDictionary dictionaryWithObjectsAndKeys:
+                             [NSNumber numberWithInt: PLSyntheticSDKSchemaLegacy], @"legacy",
+                             [NSNumber numberWithInt: PLSyntheticSDKSchemaDeviceFamily], @"devicefamily",
+                             [NSNumber numberWithInt: PLSyntheticSDKSchemaDefaultProperties], @"defaultproperties",
+                             nil];
+
+    NSDictionary *formats = [NSDictionary dictionaryWithObjectsAndKeys:
+                             [NSNumber numberWithInt: NSPropertyListXMLFormat_v1_0], @"xml",
+                             [NSNumber numberWithInt: NSPropertyListBinaryFormat_v1_0], @"binary",
+                             nil];
+
+    for (NSString *schemaName in schemas) {
+        for (NSString *formatName in formats) {
+            NSString *path = [scratch stringByAppendingPathComponent: [NSString stringWithFormat: @"%@-%@.sdk", schemaName, formatName]];
+            NSDictionary *settings = [PLSyntheticSDK settingsWithVersion: @"6.1" schema: [[schemas objectForKey: schemaName] intValue]];
+
+            NSError *error;
+            if (![PLSyntheticSDK writeSDKAtPath: path settings: settings format: [[formats objectForKey: formatName] intValue] error: &error]) {
+                NSLog(@"Could not write synthetic SDK: %@", error);
+                return NO;
+            }
+            [sdkPaths addObject: path];
+
+            NSDictionary *attrs = [[NSFileManager defaultManager] attributesOfItemAtPath: [path stringByAppendingPathComponent: @"SDKSettings.plist"] error: NULL];
+            NSString *name = [NSString stringWithFormat: @"PLSimulatorSDK/load/%@/%@", schemaName, formatName];
+            [benchmarks addObject: [PLBenchmark benchmarkWithName: name bytesPerOperation: [attrs fileSize] block: ^{
+                NSError *error;
+                if ([[PLSimulatorSDK alloc] initWithPath: path error: &error] == nil)
+                    NSLog(@"Failed to load synthetic SDK: %@", error);
+            }]];
+        }
+    }
+
+    return YES;
+}
+
+/*
+ * Register benchmarks comparing the object-based parsers against the arena-backed C parsers, parsing
+ * a batch of @a images and @a sdkPaths per operation.
+ */
+static void add_arena_benchmarks (NSMutableArray *benchmarks, NSArray *images, NSArray *sdkPaths) {
+    uint64_t imageBytes = 0;
+    for (NSData *image in images)
+        imageBytes += [image length];
+
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"batch/macho/objects" bytesPerOperation: imageBytes block: ^{
+        for (NSData *image in images)
+            [PLExecutableBinary binaryWithPath: @"/synthetic" data: image error: NULL];
+    }]];
+
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"batch/macho/arena" bytesPerOperation: imageBytes block: ^{
+        pl_arena_t arena;
+        pl_arena_init(&arena, 0);
+
+        for (NSData *image in images) {
+            pl_macho_image_t result;
+            if (pl_macho_parse_image(&arena, [image bytes], [image length], &result) != PL_MACHO_SUCCESS)
+                NSLog(@"Failed to parse synthetic image");
+        }
+
+        pl_arena_free(&arena);
+    }]];
+
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"batch/sdk/objects" bytesPerOperation: 0 block: ^{
+        for (NSString *path in sdkPaths)
+            (void) [[PLSimulatorSDK alloc] initWithPath: path error: NULL];
+    }]];
+
+    /* Resolve the C paths up-front; the arena parser does not accept NSStrings */
+    NSMutableData *pathStorage = [NSMutableData data];
+    for (NSString *path in sdkPaths) {
+        const char *fsPath = [path fileSystemRepresentation];
+        [pathStorage appendBytes: fsPath length: strlen(fsPath) + 1];
+    }
+    NSUInteger sdkCount = [sdkPaths count];
+
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"batch/sdk/arena" bytesPerOperation: 0 block: ^{
+        pl_arena_t arena;
+        pl_arena_init(&arena, 0);
+
+        const char *path = [pathStorage bytes];
+        for (NSUInteger i = 0; i < sdkCount; i++) {
+            pl_sdk_settings_t settings;
+            if (!pl_sdk_settings_parse(&arena, path, &settings))
+                NSLog(@"Failed to parse synthetic SDK %s", path);
+            path += strlen(path) + 1;
+        }
+
+        pl_arena_free(&arena);
+    }]];
+}
+
+/*
+ * Register the launcher agent round-trip benchmark. The agent uses the mock backend, so only the socket
+ * round-trip and message coding are measured.
+ */
+static BOOL add_agent_benchmarks (NSMutableArray *benchmarks) {
+    /* sockaddr_un paths are limited to 104 bytes; avoid the (long) scratch path */
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: [NSString stringWithFormat: @"bench-agent-%d.sock", getpid()]];
+    LauncherAgentServer *server = [[LauncherAgentServer alloc] initWithPath: path
+                                                                    backend: [LauncherMockAgentBackend new]
+                                                              callbackQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)];
+
+    NSError *error;
+    if (![server start: &error]) {
+        NSLog(@"Could not start launcher agent: %@", error);
+        return NO;
+    }
+
+    LauncherAgentClient *client = [LauncherAgentClient clientWithPath: path];
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"LauncherAgent/roundtrip/mock" bytesPerOperation: 0 block: ^{
+        NSError *error;
+        if (![client launchApplicationAtPath: @"/Benchmark.app" deviceFamilyCode: nil error: &error] || server == nil)
+            NSLog(@"Agent launch failed: %@", error);
+    }]];
+
+    return YES;
+}
+
+/*
+ * Register the launch pipeline benchmark: from reading the application's Info.plist to the session starting,
+ * using a synthetic platform and application in @a scratch and the stand-in session backend.
+ */
+static BOOL add_launch_benchmarks (NSMutableArray *benchmarks, NSString *scratch) {
+    NSError *error;
+    NSString *platformPath = [scratch stringByAppendingPathComponent: @"iPhoneSimulator.platform"];
+    NSArray *versions = [NSArray arrayWithObjects: @"5.0", @"5.1", @"6.0", @"6.1", nil];
+    if (![PLSyntheticSDK writePlatformAtPath: platformPath sdkVersions: versions error: &error]) {
+        NSLog(@"Could not write synthetic platform: %@", error);
+        return NO;
+    }
+
+    NSString *appPath = [scratch stringByAppendingPathComponent: @"Benchmark.app"];
+    NSArray *families = [NSArray arrayWithObjects: [NSNumber numberWithInt: 1], [NSNumber numberWithInt: 2], nil];
+    NSDictionary *info = [PLSyntheticApplication infoWithName: @"Benchmark" canonicalSDKName: @"iphonesimulator6.1" deviceFamilies: families];
+    if (![PLSyntheticApplication writeApplicationAtPath: appPath info: info error: &error]) {
+        NSLog(@"Could not write synthetic application: %@", error);
+        return NO;
+    }
+
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    [benchmarks addObject: [PLBenchmark benchmarkWithName: @"LauncherSimClient/pipeline/stub" bytesPerOperation: 0 block: ^{
+        NSError *error;
+        PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: appPath error: &error];
+        PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: platformPath xcodePath: nil error: &error];
+        if (app == nil || platform == nil) {
+            NSLog(@"Could not load synthetic launch inputs: %@", error);
+            return;
+        }
+
+        LauncherStubSessionBackend *backend = [[LauncherStubSessionBackend alloc] initWithCallbackQueue: queue];
+        LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: platform app: app defaultDeviceFamily: nil backend: backend];
+
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        [client launchWithCompletionBlock: ^(BOOL started, NSError *error) {
+            if (!started)
+                NSLog(@"Launch failed: %@", error);
+            dispatch_semaphore_signal(done);
+        }];
+
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+        dispatch_release(done);
+    }]];
+
+    return YES;
+}
+
+/*
+ * Read every file in @a paths in full, serially, in order. This approximates the page-ins incurred by
+ * loading each library. Returns the total number of bytes read.
+ */
+static uint64_t read_serially (NSArray *paths) {
+    static char buffer[1024 * 1024];
+    uint64_t total = 0;
+
+    for (NSString *path in paths) {
+        int fd = open([path fileSystemRepresentation], O_RDONLY);
+        if (fd < 0)
+            continue;
+
+        ssize_t nread;
+        while ((nread = read(fd, buffer, sizeof(buffer))) > 0)
+            total += nread;
+
+        close(fd);
+    }
+
+    return total;
+}
+
+/*
+ * Measure cold-cache reads of the dependency closure of @a binary, with and without readahead prefetch.
+ * The buffer cache is purged before each run, which requires root.
+ */
+static int run_cold_load (NSString *binary) {
+    NSError *error;
+    PLDylibGraph *graph = [PLDylibGraph graphWithBinaryPath: binary rpaths: nil error: &error];
+    if (graph == nil) {
+        fprintf(stderr, "Could not determine the dependency closure of %s: %s\n", [binary fileSystemRepresentation], [[error description] UTF8String]);
+        return 1;
+    }
+
+    NSMutableArray *closure = [NSMutableArray array];
+    for (PLDylibGraphNode *node in graph.nodes) {
+        if (node.resolved)
+            [closure addObject: node.path];
+    }
+
+    for (int round = 0; round < COLD_LOAD_ROUNDS; round++) {
+        for (int prefetch = 0; prefetch <= 1; prefetch++) {
+            if (system(PURGE_COMMAND) != 0) {
+                fprintf(stderr, "Could not purge the buffer cache; %s must be run as root\n", PURGE_COMMAND);
+                return 1;
+            }
+
+            uint64_t start = mach_absolute_time();
+
+            /* The prefetcher is not persistent; readahead is issued for the already-known closure */
+            PLDylibPrefetcher *prefetcher = nil;
+            if (prefetch) {
+                prefetcher = [[PLDylibPrefetcher alloc] initWithCachePath: nil];
+                [prefetcher prefetchPaths: closure];
+            }
+
+            uint64_t bytes = read_serially(closure);
+            uint64_t elapsed = plsimulator_stats_abs_to_ns(mach_absolute_time() - start);
+            [prefetcher waitUntilFinished];
+
+            printf("{\"name\": \"coldload/%s\", \"round\": %d, \"files\": %lu, \"bytes\": %llu, \"ms\": %.3f}\n",
+                   prefetch ? "prefetch" : "serial", round, (unsigned long) [closure count], (unsigned long long) bytes, elapsed / 1e6);
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Write a synthetic developer tools tree to @a root: @a xcodeCount Xcode.app bundles, each bundling a simulator
+ * platform with @a sdkCount SDKs, a symlink to the newest bundle, and @a unrelatedCount unrelated files.
+ */
+static BOOL write_discovery_tree (NSString *root, NSUInteger xcodeCount, NSUInteger sdkCount, NSUInteger unrelatedCount) {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSError *error;
+
+    for (NSUInteger i = 0; i < xcodeCount; i++) {
+        /* Each release ships newer SDKs than its predecessor, overlapping with it */
+        NSMutableArray *versions = [NSMutableArray arrayWithCapacity: sdkCount];
+        for (NSUInteger j = 0; j < sdkCount; j++) {
+            NSUInteger release = i + j;
+            [versions addObject: [NSString stringWithFormat: @"%lu.%lu", (unsigned long) (3 + release / 4), (unsigned long) (release % 4)]];
+        }
+
+        NSString *path = [root stringByAppendingPathComponent: [NSString stringWithFormat: @"Xcode-%lu.app", (unsigned long) i]];
+        if (![PLSyntheticSDK writeXcodeAtPath: path sdkVersions: versions error: &error]) {
+            NSLog(@"Could not write synthetic Xcode bundle: %@", error);
+            return NO;
+        }
+    }
+
+    /* As with xcode-select links and stale copies, a second path to an existing installation */
+    if (xcodeCount > 0) {
+        NSString *latest = [NSString stringWithFormat: @"Xcode-%lu.app", (unsigned long) (xcodeCount - 1)];
+        if (![fm createSymbolicLinkAtPath: [root stringByAppendingPathComponent: @"Xcode-latest.app"] withDestinationPath: latest error: &error]) {
+            NSLog(@"Could not create Xcode symlink: %@", error);
+            return NO;
+        }
+    }
+
+    NSData *contents = [NSMutableData dataWithLength: 512];
+    for (NSUInteger i = 0; i < unrelatedCount; i++) {
+        NSString *dir = [root stringByAppendingPathComponent: [NSString stringWithFormat: @"Unrelated/%lu", (unsigned long) (i / UNRELATED_FILES_PER_DIR)]];
+        if (i % UNRELATED_FILES_PER_DIR == 0 && ![fm createDirectoryAtPath: dir withIntermediateDirectories: YES attributes: nil error: &error]) {
+            NSLog(@"Could not create directory: %@", error);
+            return NO;
+        }
+
+        if (![contents writeToFile: [dir stringByAppendingPathComponent: [NSString stringWithFormat: @"file-%lu", (unsigned long) i]] options: 0 error: &error]) {
+            NSLog(@"Could not write unrelated file: %@", error);
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+/*
+ * Return the resolved, de-duplicated paths of all candidate platforms within @a root: iPhoneSimulator.platform
+ * directories, and the platforms bundled within Xcode.app bundles. This stands in for discovery's probes and
+ * Spotlight query, which can not be directed at the synthetic tree.
+ */
+static NSArray *find_discovery_candidates (NSString *root) {
+    NSMutableArray *candidates = [NSMutableArray array];
+    NSMutableSet *seen = [NSMutableSet set];
+
+    NSDirectoryEnumerator *dirEnum = [[NSFileManager defaultManager] enumeratorAtPath: root];
+    for (NSString *relativePath in dirEnum) {
+        NSString *path = [root stringByAppendingPathComponent: relativePath];
+        NSString *name = [relativePath lastPathComponent];
+
+        NSString *platformPath = nil;
+        if ([name isEqualToString: @"iPhoneSimulator.platform"]) {
+            platformPath = path;
+        } else if ([[name pathExtension] isEqualToString: @"app"]) {
+            NSDictionary *info = [NSDictionary dictionaryWithContentsOfFile: [path stringByAppendingPathComponent: @"Contents/Info.plist"]];
+            if ([[info objectForKey: @"CFBundleIdentifier"] isEqual: @"com.apple.dt.Xcode"])
+                platformPath = [path stringByAppendingPathComponent: XCODE_BUNDLE_PLATFORM_PATH];
+        } else {
+            continue;
+        }
+
+        /* Bundles are not searched for nested platforms */
+        [dirEnum skipDescendants];
+        if (platformPath == nil)
+            continue;
+
+        platformPath = [platformPath stringByResolvingSymlinksInPath];
+        if ([seen containsObject: platformPath])
+            continue;
+
+        [seen addObject: platformPath];
+        [candidates addObject: platformPath];
+    }
+
+    return candidates;
+}
+
+/*
+ * Run a single discovery scaling round over the tree at @a root, timing each phase separately. The result is
+ * written to stdout, labelled with @a cache and @a round; if @a cache is NULL, the result is discarded.
+ */
+static void run_discovery_round (NSString *root, PLSimulatorPlatformMatcher *matcher, const char *cache, int round) {
+    @autoreleasepool {
+        uint64_t start = mach_absolute_time();
+        NSArray *candidates = find_discovery_candidates(root);
+        uint64_t found = mach_absolute_time();
+
+        NSMutableArray *platforms = [NSMutableArray arrayWithCapacity: [candidates count]];
+        for (NSString *path in candidates) {
+            NSError *error;
+            PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: nil error: &error];
+            if (platform == nil) {
+                NSLog(@"Failed to load synthetic platform: %@", error);
+                continue;
+            }
+            [platforms addObject: platform];
+        }
+        uint64_t constructed = mach_absolute_time();
+
+        /* SDKs are parsed on demand, and so are loaded here */
+        NSMutableArray *matches = [NSMutableArray array];
+        for (PLSimulatorPlatform *platform in platforms) {
+            if ([matcher matchesPlatform: platform])
+                [matches addObject: platform];
+        }
+        uint64_t filtered = mach_absolute_time();
+
+        /* As per PLSimulatorDiscovery, order by path before ranking */
+        NSArray *sorted = [matches sortedArrayUsingComparator: ^(PLSimulatorPlatform *platform1, PLSimulatorPlatform *platform2) {
+            return [platform1.path compare: platform2.path];
+        }];
+        sorted = [matcher rankedPlatformsMatchingPlatforms: sorted];
+        uint64_t ranked = mach_absolute_time();
+
+        if (cache == NULL)
+            return;
+
+        printf("{\"name\": \"discovery/scaling\", \"cache\": \"%s\", \"round\": %d, \"candidates\": %lu, \"matches\": %lu, "
+               "\"find_ms\": %.3f, \"construct_ms\": %.3f, \"filter_ms\": %.3f, \"sort_ms\": %.3f}\n",
+               cache, round, (unsigned long) [candidates count], (unsigned long) [sorted count],
+               plsimulator_stats_abs_to_ns(found - start) / 1e6, plsimulator_stats_abs_to_ns(constructed - found) / 1e6,
+               plsimulator_stats_abs_to_ns(filtered - constructed) / 1e6, plsimulator_stats_abs_to_ns(ranked - filtered) / 1e6);
+        fflush(stdout);
+    }
+}
+
+/*
+ * Measure discovery over a synthetic tree of @a xcodeCount Xcode.app bundles with @a sdkCount SDKs each, alongside
+ * @a unrelatedCount unrelated files. Rounds are run with a warm buffer cache, and then with a cold one; purging
+ * the buffer cache requires root, and the cold rounds are skipped if it fails.
+ */
+static int run_discovery_scaling (NSUInteger xcodeCount, NSUInteger sdkCount, NSUInteger unrelatedCount) {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *root = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    if (![fm createDirectoryAtPath: root withIntermediateDirectories: YES attributes: nil error: NULL]) {
+        fprintf(stderr, "Could not create scratch directory %s\n", [root fileSystemRepresentation]);
+        return 1;
+    }
+
+    if (!write_discovery_tree(root, xcodeCount, sdkCount, unrelatedCount)) {
+        [fm removeItemAtPath: root error: NULL];
+        return 1;
+    }
+
+    printf("{\"name\": \"discovery/tree\", \"xcodes\": %lu, \"sdks\": %lu, \"unrelated\": %lu}\n",
+           (unsigned long) xcodeCount, (unsigned long) sdkCount, (unsigned long) unrelatedCount);
+
+    PLSimulatorPlatformMatcher *matcher = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: @"4.0"
+                                                                                    canonicalSDKName: nil
+                                                                                      deviceFamilies: [NSSet setWithObject: [PLSimulatorDeviceFamily iphoneFamily]]];
+
+    /* Populate the cache before the warm rounds */
+    run_discovery_round(root, matcher, NULL, 0);
+    for (int round = 0; round < DISCOVERY_ROUNDS; round++)
+        run_discovery_round(root, matcher, "warm", round);
+
+    for (int round = 0; round < DISCOVERY_ROUNDS; round++) {
+        if (system(PURGE_COMMAND) != 0) {
+            fprintf(stderr, "Could not purge the buffer cache; skipping cold-cache rounds. %s must be run as root\n", PURGE_COMMAND);
+            break;
+        }
+        run_discovery_round(root, matcher, "cold", round);
+    }
+
+    [fm removeItemAtPath: root error: NULL];
+    return 0;
+}
+
+static void print_usage (const char *progname) {
+    fprintf(stderr, "Usage: %s [-d <seconds>] [filter ...]\n", progname);
+    fprintf(stderr, "       %s -c <binary>\n", progname);
+    fprintf(stderr, "       %s -s <xcodes>,<sdks>,<unrelated files>\n", progname);
+    fprintf(stderr, "Runs all benchmarks whose name contains one of the given filters, writing one JSON object per result to stdout.\n");
+    fprintf(stderr, "With -c, measures cold-cache reads of the binary's dylib closure with and without prefetch (requires root).\n");
+    fprintf(stderr, "With -s, measures platform discovery over a synthetic tree of the given scale, with a warm and cold cache\n"
+                    "(cold-cache rounds require root).\n");
+}
+
+int main (int argc, char *argv[]) {
+    @autoreleasepool {
+        NSTimeInterval duration = DEFAULT_DURATION;
+        int ch;
+        NSString *coldLoadBinary = nil;
+        unsigned long xcodeCount = 0, sdkCount = 0, unrelatedCount = 0;
+        BOOL discoveryScaling = NO;
+        while ((ch = getopt(argc, argv, "c:d:hs:")) != -1) {
+            switch (ch) {
+                case 'c':
+                    coldLoadBinary = [NSString stringWithUTF8String: optarg];
+                    break;
+                case 's':
+                    if (sscanf(optarg, "%lu,%lu,%lu", &xcodeCount, &sdkCount, &unrelatedCount) != 3) {
+                        print_usage(argv[0]);
+                        return 1;
+                    }
+                    discoveryScaling = YES;
+                    break;
+                case 'd':
+                    duration = atof(optarg);
+                    break;
+                case 'h':
+                default:
+                    print_usage(argv[0]);
+                    return ch == 'h' ? 0 : 1;
+            }
+        }
+
+        if (coldLoadBinary != nil)
+            return run_cold_load(coldLoadBinary);
+
+        if (discoveryScaling)
+            return run_discovery_scaling(xcodeCount, sdkCount, unrelatedCount);
+
+        NSMutableArray *filters = [NSMutableArray array];
+        for (int i = optind; i < argc; i++)
+            [filters addObject: [NSString stringWithUTF8String: argv[i]]];
+
+        /* Generate the synthetic inputs */
+        NSFileManager *fm = [NSFileManager defaultManager];
+        NSString *scratch = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+        if (![fm createDirectoryAtPath: scratch withIntermediateDirectories: YES attributes: nil error: NULL]) {
+            fprintf(stderr, "Could not create scratch directory %s\n", [scratch fileSystemRepresentation]);
+            return 1;
+        }
+
+        NSMutableArray *benchmarks = [NSMutableArray array];
+        NSMutableArray *images = [NSMutableArray array];
+        NSMutableArray *sdkPaths = [NSMutableArray array];
+        if (!add_macho_benchmarks(benchmarks, scratch, images) || !add_sdk_benchmarks(benchmarks, scratch, sdkPaths)) {
+            [fm removeItemAtPath: scratch error: NULL];
+            return 1;
+        }
+        add_vercomp_benchmarks(benchmarks);
+        add_arena_benchmarks(benchmarks, images, sdkPaths);
+        if (!add_agent_benchmarks(benchmarks) || !add_launch_benchmarks(benchmarks, scratch)) {
+            [fm removeItemAtPath: scratch error: NULL];
+            return 1;
+        }
+
+        /* Run */
+        for (PLBenchmark *benchmark in benchmarks) {
+            BOOL matched = ([filters count] == 0);
+            for (NSString *filter in filters) {
+                if ([benchmark.name rangeOfString: filter].location != NSNotFound)
+                    matched = YES;
+            }
+
+            if (!matched)
+                continue;
+
+            @autoreleasepool {
+                PLBenchmarkResult *result = [benchmark runForDuration: duration];
+                printf("%s\n", [[result JSONRepresentation] UTF8String]);
+                fflush(stdout);
+            }
+        }
+
+        [fm removeItemAtPath: scratch error: NULL];
+        return 0;
+    }
+}
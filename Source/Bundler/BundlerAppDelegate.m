@@ -29,6 +29,8 @@
 #import "BundlerAppDelegate.h"
 #import "PLSimulator.h"
 
+/* User default enabling thinning of the embedded app's universal binaries to the host architecture */
+#define ThinArchitecturesKey @"PLBundlerThinArchitectures"
 
 
 @interface BundlerAppDelegate (PrivateMethods)
@@ -48,6 +50,7 @@
 - (void) awakeFromNib {
     _appConfigControllers = [NSMutableSet set];
     _tool = [BundlerTool new];
+    _tool.thinArchitectures = [[NSUserDefaults standardUserDefaults] boolForKey: ThinArchitecturesKey];
 }
 
 // from NSApplicationDelegate protocol
@@ -0,0 +1,154 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "BundlerArchitectureThinner.h"
+
+#import "PLSimulator.h"
+#import "PLUniversalBinary.h"
+#import "PLMachOSliceWriter.h"
+#import "PLSimulatorStats.h"
+
+#import <mach-o/fat.h>
+
+@interface BundlerArchitectureThinner (PrivateMethods)
+- (BOOL) isUniversalBinaryAtPath: (NSString *) path;
+@end
+
+/**
+ * Rewrites every universal binary within an application bundle -- including nested frameworks and plugins -- down
+ * to the slice that will be used by the launcher host, as selected by -[PLUniversalBinary executableMatchingCurrentArchitecture].
+ *
+ * Binaries that do not contain a slice matching the current architecture are left untouched.
+ *
+ * @warning Thinning modifies the bundle's binaries, and will invalidate any bundle-level code signature.
+ */
+@implementation BundlerArchitectureThinner
+
+@synthesize bytesSaved = _bytesSaved;
+
+/**
+ * Initialize a new thinner.
+ *
+ * @param path Path to the application bundle to be thinned in-place.
+ */
+- (id) initWithApplicationPath: (NSString *) path {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _path = path;
+    _bytesSaved = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+/**
+ * Thin all universal binaries in the application bundle.
+ *
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) thin: (NSError **) outError {
+    NSFileManager *fm = [NSFileManager new];
+    NSDirectoryEnumerator *files = [fm enumeratorAtPath: _path];
+
+    for (NSString *relativePath in files) {
+        /* Only regular files may be binaries; symlinks are skipped to avoid thinning a binary twice. */
+        if (![[[files fileAttributes] fileType] isEqual: NSFileTypeRegular])
+            continue;
+
+        NSString *path = [_path stringByAppendingPathComponent: relativePath];
+        if (![self isUniversalBinaryAtPath: path])
+            continue;
+
+        NSError *error;
+        PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: path error: &error];
+        if (binary == nil) {
+            NSLog(@"Skipping unparsable binary %@: %@", relativePath, error);
+            continue;
+        }
+
+        PLExecutableBinary *exec = [binary executableMatchingCurrentArchitecture];
+        if (exec == nil) {
+            NSLog(@"Skipping %@, no slice matches the current architecture", relativePath);
+            continue;
+        }
+
+        int64_t saved;
+        PLMachOSliceWriter *writer = [PLMachOSliceWriter writerWithBinary: binary executables: [NSArray arrayWithObject: exec]];
+        if (![writer writeToPath: path bytesSaved: &saved error: outError])
+            return NO;
+
+        NSLog(@"Thinned %@, saved %lld bytes", relativePath, (long long) saved);
+        plsimulator_stats_add(PLSimulatorCounterBundlerBinariesThinned, 1);
+        plsimulator_stats_add(PLSimulatorCounterBundlerBytesSaved, saved > 0 ? saved : 0);
+        [_bytesSaved setObject: [NSNumber numberWithLongLong: saved] forKey: path];
+    }
+
+    return YES;
+}
+
+// property getter
+- (uint64_t) totalBytesSaved {
+    uint64_t total = 0;
+    for (NSNumber *saved in [_bytesSaved objectEnumerator])
+        total += [saved unsignedLongLongValue];
+
+    return total;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation BundlerArchitectureThinner (PrivateMethods)
+
+/**
+ * Cheaply determine whether the file at @a path is a universal binary by reading its magic number,
+ * avoiding a full parse of every resource in the bundle.
+ *
+ * @param path File to check.
+ */
+- (BOOL) isUniversalBinaryAtPath: (NSString *) path {
+    NSFileHandle *fh = [NSFileHandle fileHandleForReadingAtPath: path];
+    if (fh == nil)
+        return NO;
+
+    NSData *data = [fh readDataOfLength: sizeof(uint32_t)];
+    [fh closeFile];
+
+    if ([data length] < sizeof(uint32_t))
+        return NO;
+
+    uint32_t magic;
+    [data getBytes: &magic length: sizeof(magic)];
+
+    return (magic == FAT_MAGIC || magic == FAT_CIGAM);
+}
+
+@end
@@ -42,8 +42,24 @@ typedef void (^BundlerToolCompletedBlock)(BOOL success);
 @private
     /** Maps NSTask instances to BundlerToolCompletedBlocks */
     NSMapTable *_taskBlocks;
+
+    /** Maps NSTask standard output file handles to their NSTask instances */
+    NSMapTable *_outputHandles;
+
+    /** Maps NSTask instances to their complete standard output, once read */
+    NSMapTable *_taskOutput;
+
+    /** Maps NSTask instances to their PLMemoryProfiler, if memory profiling is enabled */
+    NSMapTable *_taskProfilers;
+
+    /** If YES, universal binaries in the embedded application will be thinned to the host architecture. */
+    BOOL _thinArchitectures;
 }
 
 - (void) executeWithSimulatorApp: (PLSimulatorApplication *) app deviceFamily: (PLSimulatorDeviceFamily *) deviceFamily block: (BundlerToolCompletedBlock) block;
 
+/** If YES, universal binaries in the embedded application will be thinned to the host architecture
+ * once the bundle has been created. Defaults to NO. */
+@property(nonatomic) BOOL thinArchitectures;
+
 @end
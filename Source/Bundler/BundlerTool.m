@@ -27,6 +27,12 @@
  */
 
 #import "BundlerTool.h"
+#import "BundlerArchitectureThinner.h"
+#import "PLBundleManifest.h"
+#import "PLSimulatorStats.h"
+#import "PLMemoryProfiler.h"
+
+#import <sys/resource.h>
 
 /* Resource-relative launcher template path. */
 #define TEMPLATE_APP @"Launcher.app"
@@ -34,8 +40,21 @@
 /* Resource-relative script to execute. */
 #define BUNDLE_TOOL @"bundle-tool.sh"
 
+/* Prefix of the bundle tool output line reporting the created bundle's path */
+#define DESTINATION_PREFIX @"Destination: "
+
+/* Relative path to the embedded application directory within the created bundle */
+#define EMBED_DIR @"Contents/Resources/EmbeddedApp"
+
+/* Memory profiler phase names */
+#define PHASE_BUNDLE @"bundle"
+#define PHASE_THIN @"thin"
+#define PHASE_MANIFEST @"manifest"
+
 @interface BundlerTool (PrivateMethods)
 - (void) taskCompleted: (NSNotification *) notification;
+- (void) taskOutputCompleted: (NSNotification *) notification;
+- (void) finishTaskIfComplete: (NSTask *) task;
 @end
 
 /**
@@ -43,11 +62,16 @@
  */
 @implementation BundlerTool
 
+@synthesize thinArchitectures = _thinArchitectures;
+
 - (id) init {
     if ((self = [super init]) == nil)
         return nil;
     
     _taskBlocks = [NSMapTable mapTableWithStrongToStrongObjects];
+    _outputHandles = [NSMapTable mapTableWithStrongToStrongObjects];
+    _taskOutput = [NSMapTable mapTableWithStrongToStrongObjects];
+    _taskProfilers = [NSMapTable mapTableWithStrongToStrongObjects];
 
     return self;
 }
@@ -90,6 +114,12 @@
     [task setLaunchPath: tool];
     [task setArguments: args];
 
+    /* Capture the tool's output; it reports the path of the created bundle */
+    NSPipe *pipe = [NSPipe pipe];
+    NSFileHandle *output = [pipe fileHandleForReading];
+    [task setStandardOutput: pipe];
+    [_outputHandles setObject: task forKey: output];
+
     /* Watch for completion */
     NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
     [nc addObserver: self 
@@ -97,9 +127,22 @@
                name: NSTaskDidTerminateNotification 
              object: task];
 
+    [nc addObserver: self
+           selector: @selector(taskOutputCompleted:)
+               name: NSFileHandleReadToEndOfFileCompletionNotification
+             object: output];
+
     [_taskBlocks setObject: [block copy] forKey: task];
 
+    /* The bundle is created and copied by the tool process; only the bundler's own growth is attributed to this phase */
+    PLMemoryProfiler *profiler = [PLMemoryProfiler profilerFromEnvironmentWithName: @"bundler"];
+    if (profiler != nil) {
+        [_taskProfilers setObject: profiler forKey: task];
+        [profiler beginPhase: PHASE_BUNDLE];
+    }
+
     /* Execute */
+    [output readToEndOfFileInBackgroundAndNotify];
     [task launch];
 }
 
@@ -115,17 +158,119 @@
     /* Disable listening */
     NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
     [nc removeObserver: self name: NSTaskDidTerminateNotification object: task];
-    
+
+    [self finishTaskIfComplete: task];
+}
+
+// NSFileHandleReadToEndOfFileCompletionNotification
+- (void) taskOutputCompleted: (NSNotification *) notification {
+    NSFileHandle *output = [notification object];
+    NSTask *task = [_outputHandles objectForKey: output];
+    assert(task != nil);
+
+    /* Disable listening */
+    NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+    [nc removeObserver: self name: NSFileHandleReadToEndOfFileCompletionNotification object: output];
+    [_outputHandles removeObjectForKey: output];
+
+    NSData *data = [[notification userInfo] objectForKey: NSFileHandleNotificationDataItem];
+    [_taskOutput setObject: (data != nil ? data : [NSData data]) forKey: task];
+
+    [self finishTaskIfComplete: task];
+}
+
+/**
+ * Once the task has both terminated and its output has been read, run any post-processing stages
+ * and execute the task's completion block.
+ *
+ * @param task The bundle tool task.
+ */
+- (void) finishTaskIfComplete: (NSTask *) task {
+    NSData *outputData = [_taskOutput objectForKey: task];
+    BundlerToolCompletedBlock block = [_taskBlocks objectForKey: task];
+    if ([task isRunning] || outputData == nil || block == nil)
+        return;
+
+    [_taskOutput removeObjectForKey: task];
+    [_taskBlocks removeObjectForKey: task];
+
+    PLMemoryProfiler *profiler = [_taskProfilers objectForKey: task];
+    [_taskProfilers removeObjectForKey: task];
+    if (profiler != nil) {
+        [profiler endPhase: PHASE_BUNDLE];
+
+        /* ru_maxrss is reported in bytes on Mac OS X */
+        struct rusage usage;
+        if (getrusage(RUSAGE_CHILDREN, &usage) == 0)
+            NSLog(@"Bundle tool peak resident size: %.1fMB", (double) usage.ru_maxrss / (1024.0 * 1024.0));
+    }
+
     /* Check for error */
     // TODO - Improve error reporting by defining additional error codes.
     BOOL succeeded = YES;
     if ([task terminationStatus] != 0)
         succeeded = NO;
 
-    /* Fetch and execute callback */
-    BundlerToolCompletedBlock block = [_taskBlocks objectForKey: task];
-    assert(block != NULL);
-    block(succeeded);
+    /* Forward the tool's output to the log, and find the created bundle */
+    NSString *destination = nil;
+    NSString *output = [[NSString alloc] initWithData: outputData encoding: NSUTF8StringEncoding];
+    for (NSString *line in [output componentsSeparatedByString: @"\n"]) {
+        if ([line length] == 0)
+            continue;
+
+        NSLog(@"%@", line);
+        if ([line hasPrefix: DESTINATION_PREFIX])
+            destination = [line substringFromIndex: [DESTINATION_PREFIX length]];
+    }
+
+    if (!succeeded || destination == nil) {
+        block(succeeded);
+        return;
+    }
+
+    /* Post-process the created bundle off the main thread */
+    BOOL thinArchitectures = _thinArchitectures;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *error;
+
+        /* Thin the embedded application */
+        if (thinArchitectures) {
+            [profiler beginPhase: PHASE_THIN];
+            NSString *embedPath = [destination stringByAppendingPathComponent: EMBED_DIR];
+            BundlerArchitectureThinner *thinner = [[BundlerArchitectureThinner alloc] initWithApplicationPath: embedPath];
+            BOOL thinned = [thinner thin: &error];
+            [profiler endPhase: PHASE_THIN];
+
+            if (!thinned) {
+                NSLog(@"Architecture thinning failed: %@", error);
+                dispatch_async(dispatch_get_main_queue(), ^{ block(NO); });
+                return;
+            }
+
+            NSLog(@"Architecture thinning saved %llu bytes", (unsigned long long) thinner.totalBytesSaved);
+        }
+
+        /* Record the final bundle contents, allowing the bundle to be verified after distribution */
+        BOOL manifestWritten = NO;
+        [profiler beginPhase: PHASE_MANIFEST];
+        PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: destination error: &error];
+        if (manifest != nil)
+            manifestWritten = [manifest writeToFile: [destination stringByAppendingPathComponent: PLBundleManifestDefaultPath] error: &error];
+        [profiler endPhase: PHASE_MANIFEST];
+
+        if (manifestWritten)
+            NSLog(@"Wrote bundle manifest for %lu files", (unsigned long) [manifest.digests count]);
+        else
+            NSLog(@"Could not write bundle manifest: %@", error);
+
+        NSLog(@"Bundler statistics: %@", [[PLSimulatorStats snapshot] JSONRepresentation]);
+        if (profiler != nil)
+            NSLog(@"%@", [profiler report]);
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            block(manifestWritten);
+        });
+    });
 }
 
 @end
\ No newline at end of file
@@ -28,7 +28,167 @@
 
 #import <Cocoa/Cocoa.h>
 
+#import "PLBundleManifest.h"
+#import "PLBundleDelta.h"
+#import "PLUniversalBinary.h"
+
+#import <mach-o/arch.h>
+
+/*
+ * Validate the code signature page hashes of every signed Mach-O executable among the bundle-relative
+ * @a files of the bundle at @a path, reporting invalid signatures on stderr. Unsigned binaries are skipped.
+ * Returns the number of binaries with invalid signatures.
+ */
+static NSUInteger verify_code_signatures (NSString *path, NSArray *files) {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSUInteger failures = 0;
+
+    for (NSString *file in [files sortedArrayUsingSelector: @selector(compare:)]) {
+        NSString *filePath = [path stringByAppendingPathComponent: file];
+        if (![fm isExecutableFileAtPath: filePath])
+            continue;
+
+        /* Non-Mach-O executables (eg, scripts) are not an error */
+        PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: filePath error: NULL];
+        for (PLExecutableBinary *executable in binary.executables) {
+            if (!executable.codeSigned)
+                continue;
+
+            NSError *error;
+            NSUInteger page = NSNotFound;
+            if ([executable verifyCodeSignature: &page error: &error])
+                continue;
+
+            const NXArchInfo *arch = NXGetArchInfoFromCpuType(executable.cpu_type, executable.cpu_subtype);
+            fprintf(stderr, "Invalid signature: %s (%s): %s\n", [file UTF8String], arch != NULL ? arch->name : "unknown",
+                    [[error localizedDescription] UTF8String]);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/*
+ * Verify the bundle at @a path against its embedded manifest, and validate the code signatures of its
+ * executables, reporting the results on stderr. Returns the process exit status.
+ */
+static int verify_bundle (NSString *path) {
+    @autoreleasepool {
+        NSError *error;
+        NSString *manifestPath = [path stringByAppendingPathComponent: PLBundleManifestDefaultPath];
+        PLBundleManifest *manifest = [PLBundleManifest manifestWithContentsOfFile: manifestPath error: &error];
+        if (manifest == nil) {
+            fprintf(stderr, "Could not read manifest %s: %s\n", [manifestPath UTF8String], [[error localizedDescription] UTF8String]);
+            return 2;
+        }
+
+        PLBundleVerificationResult *result = [manifest verifyBundleAtPath: path error: &error];
+        if (result == nil) {
+            fprintf(stderr, "Could not verify %s: %s\n", [path UTF8String], [[error localizedDescription] UTF8String]);
+            return 2;
+        }
+
+        for (NSString *file in result.mismatchedPaths)
+            fprintf(stderr, "Modified: %s\n", [file UTF8String]);
+
+        for (NSString *file in result.missingPaths)
+            fprintf(stderr, "Missing: %s\n", [file UTF8String]);
+
+        for (NSString *file in result.unexpectedPaths)
+            fprintf(stderr, "Unexpected: %s\n", [file UTF8String]);
+
+        NSUInteger invalidSignatures = verify_code_signatures(path, [manifest.digests allKeys]);
+        BOOL valid = result.valid && invalidSignatures == 0;
+
+        fprintf(stderr, "%s: %lu files, %llu bytes in %.3fs (%.1f MB/s)\n", valid ? "OK" : "FAILED",
+                (unsigned long) result.fileCount, (unsigned long long) result.byteCount, result.duration,
+                result.throughput / (1024.0 * 1024.0));
+
+        return valid ? 0 : 1;
+    }
+}
+
+/* Return the size of the file at @a path, or 0 if it can not be determined. */
+static unsigned long long file_size (NSString *path) {
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath: path error: NULL] fileSize];
+}
+
+/*
+ * Write a delta from the bundle at @a oldPath to the bundle at @a newPath to @a deltaPath, reporting the
+ * delta's size and the time taken on stderr. Returns the process exit status.
+ */
+static int create_delta (NSString *oldPath, NSString *newPath, NSString *deltaPath) {
+    @autoreleasepool {
+        NSError *error;
+        NSDate *start = [NSDate date];
+        PLBundleDelta *delta = [[PLBundleDelta alloc] initWithBundlePath: oldPath newBundlePath: newPath error: &error];
+        if (delta == nil || ![delta writeToFile: deltaPath error: &error]) {
+            fprintf(stderr, "Could not create delta %s: %s\n", [deltaPath UTF8String], [[error localizedDescription] UTF8String]);
+            return 2;
+        }
+        NSTimeInterval duration = -[start timeIntervalSinceNow];
+
+        fprintf(stderr, "%lu files: %lu copied, %lu patched, %lu stored; %llu bytes reused, %llu bytes stored\n",
+                (unsigned long) delta.fileCount, (unsigned long) delta.copiedFileCount, (unsigned long) delta.patchedFileCount,
+                (unsigned long) delta.literalFileCount, (unsigned long long) delta.reusedByteCount,
+                (unsigned long long) delta.literalByteCount);
+        fprintf(stderr, "Wrote %llu byte delta in %.3fs\n", file_size(deltaPath), duration);
+
+        return 0;
+    }
+}
+
+/*
+ * Reconstruct a bundle at @a destinationPath by applying the delta at @a deltaPath to the bundle at @a oldPath,
+ * and verify the result, reporting on stderr. Returns the process exit status.
+ */
+static int apply_delta (NSString *oldPath, NSString *deltaPath, NSString *destinationPath) {
+    @autoreleasepool {
+        NSError *error;
+        NSDate *start = [NSDate date];
+        PLBundleDelta *delta = [PLBundleDelta deltaWithContentsOfFile: deltaPath error: &error];
+        if (delta == nil) {
+            fprintf(stderr, "Could not read delta %s: %s\n", [deltaPath UTF8String], [[error localizedDescription] UTF8String]);
+            return 2;
+        }
+
+        PLBundleVerificationResult *result = [delta applyToBundleAtPath: oldPath destinationPath: destinationPath error: &error];
+        if (result == nil) {
+            fprintf(stderr, "Could not apply delta %s: %s\n", [deltaPath UTF8String], [[error localizedDescription] UTF8String]);
+            return 2;
+        }
+        NSTimeInterval duration = -[start timeIntervalSinceNow];
+
+        for (NSString *file in result.mismatchedPaths)
+            fprintf(stderr, "Modified: %s\n", [file UTF8String]);
+
+        for (NSString *file in result.missingPaths)
+            fprintf(stderr, "Missing: %s\n", [file UTF8String]);
+
+        fprintf(stderr, "%s: applied %llu byte delta to %lu files in %.3fs (verified in %.3fs)\n", result.valid ? "OK" : "FAILED",
+                file_size(deltaPath), (unsigned long) result.fileCount, duration, result.duration);
+
+        return result.valid ? 0 : 1;
+    }
+}
+
 int main(int argc, char *argv[])
 {
+    /* Headless verification of a previously created bundle */
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0)
+        return verify_bundle([NSString stringWithUTF8String: argv[2]]);
+
+    /* Headless delta generation and application */
+    if (argc == 5 && strcmp(argv[1], "--delta") == 0) {
+        return create_delta([NSString stringWithUTF8String: argv[2]], [NSString stringWithUTF8String: argv[3]],
+                            [NSString stringWithUTF8String: argv[4]]);
+    }
+
+    if (argc == 5 && strcmp(argv[1], "--apply-delta") == 0) {
+        return apply_delta([NSString stringWithUTF8String: argv[2]], [NSString stringWithUTF8String: argv[3]],
+                           [NSString stringWithUTF8String: argv[4]]);
+    }
+
     return NSApplicationMain(argc,  (const char **) argv);
 }
@@ -0,0 +1,119 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLCatalogScanner.h"
+
+#import <libkern/OSByteOrder.h>
+#import <getopt.h>
+
+/* Binary table magic and version. Each table entry is a big-endian uint32 length, followed by a binary plist record. */
+#define TABLE_MAGIC "PLCT"
+#define TABLE_VERSION 1
+
+/* Write a single binary table entry for @a record to @a output */
+static BOOL write_table_entry (FILE *output, PLCatalogRecord *record) {
+    NSString *errorDesc;
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: [record propertyListRepresentation]
+                                                              format: NSPropertyListBinaryFormat_v1_0
+                                                    errorDescription: &errorDesc];
+    if (data == nil) {
+        fprintf(stderr, "Could not serialize %s: %s\n", [record.path fileSystemRepresentation], [errorDesc UTF8String]);
+        return NO;
+    }
+
+    uint32_t length = OSSwapHostToBigInt32((uint32_t) [data length]);
+    return fwrite(&length, sizeof(length), 1, output) == 1 && fwrite([data bytes], [data length], 1, output) == 1;
+}
+
+static void print_usage (const char *progname) {
+    fprintf(stderr, "Usage: %s [-t] [-j <max in flight>] <directory>\n", progname);
+    fprintf(stderr, "Scans the directory tree for Simulator applications, writing one JSON object per application to stdout.\n");
+    fprintf(stderr, "With -t, writes a binary table of length-prefixed binary plist records instead.\n");
+}
+
+int main (int argc, char *argv[]) {
+    @autoreleasepool {
+        BOOL table = NO;
+        NSUInteger maxInFlight = 0;
+        int ch;
+        while ((ch = getopt(argc, argv, "tj:h")) != -1) {
+            switch (ch) {
+                case 't':
+                    table = YES;
+                    break;
+                case 'j':
+                    maxInFlight = (NSUInteger) strtoul(optarg, NULL, 10);
+                    break;
+                case 'h':
+                default:
+                    print_usage(argv[0]);
+                    return ch == 'h' ? 0 : 1;
+            }
+        }
+
+        if (optind != argc - 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        NSString *root = [[NSFileManager defaultManager] stringWithFileSystemRepresentation: argv[optind] length: strlen(argv[optind])];
+        PLCatalogScanner *scanner = [[PLCatalogScanner alloc] initWithRootPath: root maxInFlight: maxInFlight];
+
+        if (table) {
+            uint32_t version = OSSwapHostToBigInt32(TABLE_VERSION);
+            fwrite(TABLE_MAGIC, strlen(TABLE_MAGIC), 1, stdout);
+            fwrite(&version, sizeof(version), 1, stdout);
+        }
+
+        __block BOOL writeFailed = NO;
+        NSError *error;
+        BOOL result = [scanner scanWithRecordBlock: ^(PLCatalogRecord *record) {
+            if (table) {
+                if (!write_table_entry(stdout, record))
+                    writeFailed = YES;
+            } else {
+                printf("%s\n", [[record JSONRepresentation] UTF8String]);
+            }
+        } errorBlock: ^(NSString *path, NSError *error) {
+            fprintf(stderr, "Skipping %s: %s\n", [path fileSystemRepresentation], [[error localizedDescription] UTF8String]);
+        } error: &error];
+
+        fflush(stdout);
+        if (!result) {
+            fprintf(stderr, "%s\n", [[error localizedDescription] UTF8String]);
+            return 1;
+        }
+
+        fprintf(stderr, "Scanned %lu applications (%lu failed) in %.3f s: %.1f apps/sec\n",
+                (unsigned long) scanner.applicationCount, (unsigned long) scanner.failureCount, scanner.elapsedTime, scanner.applicationsPerSecond);
+
+        return writeFailed ? 1 : 0;
+    }
+}
@@ -0,0 +1,139 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherAgentClient.h"
+#import "LauncherAgentProtocol.h"
+
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <unistd.h>
+
+/* Default response timeout, in seconds. This must cover the agent's simulator session start timeout. */
+#define DEFAULT_TIMEOUT 60.0
+
+/**
+ * Submits launch requests to a resident LauncherAgentServer.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation LauncherAgentClient
+
+@synthesize path = _path;
+@synthesize timeout = _timeout;
+
+/**
+ * Create a new client for the agent listening at @a path.
+ *
+ * @param path The agent's socket path.
+ */
++ (id) clientWithPath: (NSString *) path {
+    return [[self alloc] initWithPath: path];
+}
+
+/**
+ * Initialize a new client for the agent listening at @a path.
+ *
+ * @param path The agent's socket path.
+ */
+- (id) initWithPath: (NSString *) path {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _path = path;
+    _timeout = DEFAULT_TIMEOUT;
+
+    return self;
+}
+
+/**
+ * Request that the agent launch the application at @a appPath, blocking until the simulator session has started
+ * or failed.
+ *
+ * @param appPath Absolute path to the application bundle.
+ * @param deviceFamilyCode The default device family code, or nil.
+ * @param outError If an error occurs, upon return contains an NSError object in the LauncherAgentErrorDomain that
+ * describes the problem. If the error code is LauncherAgentErrorUnavailable, no agent is running.
+ *
+ * @return Returns YES if the session started, or NO on failure.
+ */
+- (BOOL) launchApplicationAtPath: (NSString *) appPath deviceFamilyCode: (NSNumber *) deviceFamilyCode error: (NSError **) outError {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, [_path fileSystemRepresentation], sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        if (fd >= 0)
+            close(fd);
+
+        if (outError != NULL)
+            *outError = launcher_agent_error(LauncherAgentErrorUnavailable, @"The launcher agent is not running.");
+        return NO;
+    }
+
+    int on = 1;
+    struct timeval timeout = { .tv_sec = (time_t) _timeout, .tv_usec = (suseconds_t) ((_timeout - (time_t) _timeout) * USEC_PER_SEC) };
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    /* Send the request */
+    NSMutableDictionary *request = [NSMutableDictionary dictionary];
+    [request setObject: [NSNumber numberWithInt: LAUNCHER_AGENT_PROTOCOL_VERSION] forKey: LauncherAgentVersionKey];
+    [request setObject: appPath forKey: LauncherAgentApplicationPathKey];
+    if (deviceFamilyCode != nil)
+        [request setObject: deviceFamilyCode forKey: LauncherAgentDeviceFamilyKey];
+
+    NSDictionary *response = nil;
+    if (launcher_agent_write_message(fd, request))
+        response = launcher_agent_read_message(fd);
+    close(fd);
+
+    if (response == nil) {
+        if (outError != NULL)
+            *outError = launcher_agent_error(LauncherAgentErrorProtocol, @"The launcher agent did not respond.");
+        return NO;
+    }
+
+    /* Check the result */
+    if (![[response objectForKey: LauncherAgentStartedKey] boolValue]) {
+        if (outError != NULL) {
+            NSString *desc = [response objectForKey: LauncherAgentErrorKey];
+            if (![desc isKindOfClass: [NSString class]])
+                desc = @"The launcher agent could not start the simulator session.";
+
+            *outError = launcher_agent_error(LauncherAgentErrorLaunchFailed, desc);
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
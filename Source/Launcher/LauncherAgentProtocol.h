@@ -0,0 +1,67 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Version of the launcher agent wire protocol. */
+#define LAUNCHER_AGENT_PROTOCOL_VERSION 1
+
+/** Maximum size of a single encoded agent message. */
+#define LAUNCHER_AGENT_MAX_MESSAGE_SIZE (64 * 1024)
+
+extern NSString *LauncherAgentErrorDomain;
+
+/**
+ * Launcher agent error codes.
+ */
+typedef enum {
+    /** No agent is listening at the requested socket path. */
+    LauncherAgentErrorUnavailable = 1,
+
+    /** The agent or client sent a malformed message, or the connection failed mid-message. */
+    LauncherAgentErrorProtocol = 2,
+
+    /** The agent was reached, but could not launch the application. */
+    LauncherAgentErrorLaunchFailed = 3
+} LauncherAgentError;
+
+/* Request keys */
+extern NSString *LauncherAgentVersionKey;
+extern NSString *LauncherAgentApplicationPathKey;
+extern NSString *LauncherAgentDeviceFamilyKey;
+
+/* Response keys */
+extern NSString *LauncherAgentStartedKey;
+extern NSString *LauncherAgentErrorKey;
+
+NSString *launcher_agent_default_socket_path (void);
+
+BOOL launcher_agent_write_message (int fd, NSDictionary *message);
+NSDictionary *launcher_agent_read_message (int fd);
+
+NSError *launcher_agent_error (LauncherAgentError code, NSString *description);
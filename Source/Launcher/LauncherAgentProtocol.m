@@ -0,0 +1,156 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherAgentProtocol.h"
+
+#import <unistd.h>
+#import <errno.h>
+#import <libkern/OSByteOrder.h>
+
+/*
+ * Launcher agent wire protocol.
+ *
+ * Thin launchers connect to the agent's UNIX domain socket, write a single request message, and block for a
+ * single response message. Each message is a binary property list dictionary, preceded by its length as a
+ * 32-bit big-endian integer.
+ */
+
+/** Launcher agent error domain */
+NSString *LauncherAgentErrorDomain = @"LauncherAgentErrorDomain";
+
+/** Protocol version (NSNumber) */
+NSString *LauncherAgentVersionKey = @"version";
+
+/** Absolute path to the application to be launched (NSString) */
+NSString *LauncherAgentApplicationPathKey = @"app_path";
+
+/** Default device family code, if any (NSNumber) */
+NSString *LauncherAgentDeviceFamilyKey = @"device_family";
+
+/** YES if the simulator session started (NSNumber) */
+NSString *LauncherAgentStartedKey = @"started";
+
+/** Localized failure description, if the session did not start (NSString) */
+NSString *LauncherAgentErrorKey = @"error";
+
+/**
+ * Return the per-user agent socket path.
+ */
+NSString *launcher_agent_default_socket_path (void) {
+    return [NSTemporaryDirectory() stringByAppendingPathComponent: @"coop.plausible.simlaunch-agent.sock"];
+}
+
+/* Write exactly @a length bytes, retrying on EINTR. */
+static BOOL write_fully (int fd, const void *buffer, size_t length) {
+    const uint8_t *p = buffer;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return NO;
+
+        p += written;
+        length -= written;
+    }
+
+    return YES;
+}
+
+/* Read exactly @a length bytes, retrying on EINTR. */
+static BOOL read_fully (int fd, void *buffer, size_t length) {
+    uint8_t *p = buffer;
+    while (length > 0) {
+        ssize_t nread = read(fd, p, length);
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread <= 0)
+            return NO;
+
+        p += nread;
+        length -= nread;
+    }
+
+    return YES;
+}
+
+/**
+ * Write @a message to @a fd.
+ *
+ * @param fd Connected socket.
+ * @param message A property list dictionary.
+ * @return Returns YES on success, or NO if the message could not be encoded or written.
+ */
+BOOL launcher_agent_write_message (int fd, NSDictionary *message) {
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: message format: NSPropertyListBinaryFormat_v1_0 errorDescription: NULL];
+    if (data == nil || [data length] > LAUNCHER_AGENT_MAX_MESSAGE_SIZE)
+        return NO;
+
+    uint32_t length = OSSwapHostToBigInt32((uint32_t) [data length]);
+    if (!write_fully(fd, &length, sizeof(length)))
+        return NO;
+
+    return write_fully(fd, [data bytes], [data length]);
+}
+
+/**
+ * Read a single message from @a fd.
+ *
+ * @param fd Connected socket.
+ * @return Returns the decoded dictionary, or nil if the connection failed or the message was malformed.
+ */
+NSDictionary *launcher_agent_read_message (int fd) {
+    uint32_t length;
+    if (!read_fully(fd, &length, sizeof(length)))
+        return nil;
+
+    length = OSSwapBigToHostInt32(length);
+    if (length == 0 || length > LAUNCHER_AGENT_MAX_MESSAGE_SIZE)
+        return nil;
+
+    NSMutableData *data = [NSMutableData dataWithLength: length];
+    if (!read_fully(fd, [data mutableBytes], length))
+        return nil;
+
+    id message = [NSPropertyListSerialization propertyListFromData: data mutabilityOption: NSPropertyListImmutable format: NULL errorDescription: NULL];
+    if (![message isKindOfClass: [NSDictionary class]])
+        return nil;
+
+    if (![[message objectForKey: LauncherAgentVersionKey] isEqual: [NSNumber numberWithInt: LAUNCHER_AGENT_PROTOCOL_VERSION]])
+        return nil;
+
+    return message;
+}
+
+/**
+ * Return a new error in the LauncherAgentErrorDomain.
+ */
+NSError *launcher_agent_error (LauncherAgentError code, NSString *description) {
+    NSDictionary *userInfo = [NSDictionary dictionaryWithObject: description forKey: NSLocalizedDescriptionKey];
+    return [NSError errorWithDomain: LauncherAgentErrorDomain code: code userInfo: userInfo];
+}
@@ -0,0 +1,96 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@class LauncherAgentServer;
+
+/**
+ * Completion block for a launch request.
+ *
+ * @param started YES if the simulator session started.
+ * @param error If the session did not start, an error describing the failure.
+ */
+typedef void (^LauncherAgentCompletionBlock)(BOOL started, NSError *error);
+
+/**
+ * Performs launches on behalf of a LauncherAgentServer.
+ */
+@protocol LauncherAgentBackend <NSObject>
+
+/**
+ * Launch the application at @a path. The backend must call @a completion exactly once, from any thread.
+ *
+ * @param server The requesting server.
+ * @param path Absolute path to the application bundle.
+ * @param deviceFamilyCode The requested default device family code, or nil.
+ * @param completion Block to be called once the launch has completed or failed.
+ */
+- (void) agentServer: (LauncherAgentServer *) server
+    launchApplicationAtPath: (NSString *) path
+           deviceFamilyCode: (NSNumber *) deviceFamilyCode
+                 completion: (LauncherAgentCompletionBlock) completion;
+
+@end
+
+@interface LauncherAgentServer : NSObject {
+@private
+    /** The socket path. */
+    NSString *_path;
+
+    /** The launch backend. */
+    id<LauncherAgentBackend> _backend;
+
+    /** Queue on which the backend is called. */
+    dispatch_queue_t _callbackQueue;
+
+    /** Serial queue on which connections are accepted. */
+    dispatch_queue_t _queue;
+
+    /** Listening socket source, or NULL if not running. */
+    dispatch_source_t _source;
+
+    /** Signaled once the listening socket has been closed and removed. */
+    dispatch_semaphore_t _cancelled;
+
+    /** Number of requests received. */
+    volatile int32_t _requestCount;
+}
+
+- (id) initWithPath: (NSString *) path backend: (id<LauncherAgentBackend>) backend callbackQueue: (dispatch_queue_t) callbackQueue;
+
+- (BOOL) start: (NSError **) outError;
+- (void) stop;
+
+/** The socket path. */
+@property(nonatomic, readonly) NSString *path;
+
+/** Number of launch requests received since the server was started. */
+@property(nonatomic, readonly) NSUInteger requestCount;
+
+@end
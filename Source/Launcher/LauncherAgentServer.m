@@ -0,0 +1,243 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherAgentServer.h"
+#import "LauncherAgentProtocol.h"
+
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <errno.h>
+
+/* Maximum time to wait for a client's request, in seconds */
+#define REQUEST_TIMEOUT 5
+
+@interface LauncherAgentServer (PrivateMethods)
+- (void) acceptConnections: (int) listenfd;
+- (void) handleConnection: (int) fd;
+@end
+
+/**
+ * Listens on a UNIX domain socket for launch requests from thin launcher processes, and forwards them to a
+ * LauncherAgentBackend.
+ *
+ * The backend is responsible for keeping expensive state -- discovered platforms, loaded private frameworks -- warm
+ * across requests, such that each launcher process only pays for a socket round-trip.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation LauncherAgentServer
+
+@synthesize path = _path;
+
+/**
+ * Initialize a new server.
+ *
+ * @param path The socket path.
+ * @param backend The backend to which launch requests will be forwarded.
+ * @param callbackQueue The queue on which @a backend will be called. If NULL, the main queue is used.
+ */
+- (id) initWithPath: (NSString *) path backend: (id<LauncherAgentBackend>) backend callbackQueue: (dispatch_queue_t) callbackQueue {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _path = path;
+    _backend = backend;
+
+    _callbackQueue = (callbackQueue != NULL) ? callbackQueue : dispatch_get_main_queue();
+    dispatch_retain(_callbackQueue);
+
+    _queue = dispatch_queue_create("coop.plausible.LauncherAgentServer", NULL);
+
+    return self;
+}
+
+- (void) dealloc {
+    [self stop];
+
+    dispatch_release(_callbackQueue);
+    dispatch_release(_queue);
+}
+
+/**
+ * Bind the socket and start accepting requests. If a stale socket exists at the receiver's path, it will be replaced.
+ *
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO if the socket could not be bound, or another agent is already listening.
+ */
+- (BOOL) start: (NSError **) outError {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    const char *fsPath = [_path fileSystemRepresentation];
+    if (strlen(fsPath) >= sizeof(addr.sun_path)) {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: ENAMETOOLONG userInfo: nil];
+        return NO;
+    }
+    strlcpy(addr.sun_path, fsPath, sizeof(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+        return NO;
+    }
+
+    /* If another agent is accepting connections, leave it be; otherwise, remove the stale socket */
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+        close(fd);
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: EADDRINUSE userInfo: nil];
+        return NO;
+    }
+    close(fd);
+    unlink(fsPath);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 ||
+        bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        chmod(fsPath, S_IRUSR | S_IWUSR) != 0 ||
+        listen(fd, SOMAXCONN) != 0 ||
+        fcntl(fd, F_SETFL, O_NONBLOCK) != 0)
+    {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+        if (fd >= 0)
+            close(fd);
+        return NO;
+    }
+
+    _source = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, _queue);
+    _cancelled = dispatch_semaphore_create(0);
+
+    __unsafe_unretained LauncherAgentServer *server = self;
+    NSString *path = _path;
+    dispatch_semaphore_t cancelled = _cancelled;
+    dispatch_source_set_event_handler(_source, ^{
+        [server acceptConnections: fd];
+    });
+    dispatch_source_set_cancel_handler(_source, ^{
+        close(fd);
+        unlink([path fileSystemRepresentation]);
+        dispatch_semaphore_signal(cancelled);
+    });
+
+    dispatch_resume(_source);
+    return YES;
+}
+
+/**
+ * Stop accepting requests, and remove the socket. Requests already being handled will run to completion.
+ * Once this method returns, new connections to the socket path will fail.
+ */
+- (void) stop {
+    if (_source == NULL)
+        return;
+
+    dispatch_source_cancel(_source);
+    dispatch_semaphore_wait(_cancelled, DISPATCH_TIME_FOREVER);
+
+    dispatch_release(_source);
+    dispatch_release(_cancelled);
+    _source = NULL;
+    _cancelled = NULL;
+}
+
+// property getter
+- (NSUInteger) requestCount {
+    return (NSUInteger) _requestCount;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherAgentServer (PrivateMethods)
+
+/**
+ * Accept all pending connections on @a listenfd.
+ */
+- (void) acceptConnections: (int) listenfd {
+    int fd;
+    while ((fd = accept(listenfd, NULL, NULL)) >= 0) {
+        /* Request handling blocks on client I/O; keep it off of the accept queue */
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [self handleConnection: fd];
+        });
+    }
+}
+
+/**
+ * Read a single request from @a fd, dispatch it to the backend, and write the response.
+ */
+- (void) handleConnection: (int) fd {
+    int on = 1;
+    struct timeval timeout = { .tv_sec = REQUEST_TIMEOUT, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    /* The listening socket is non-blocking; the accepted socket may inherit that state */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+    NSDictionary *request = launcher_agent_read_message(fd);
+    NSString *appPath = [request objectForKey: LauncherAgentApplicationPathKey];
+    NSNumber *deviceFamily = [request objectForKey: LauncherAgentDeviceFamilyKey];
+
+    if (![appPath isKindOfClass: [NSString class]] || (deviceFamily != nil && ![deviceFamily isKindOfClass: [NSNumber class]])) {
+        NSLog(@"Discarding malformed launcher agent request");
+        close(fd);
+        return;
+    }
+
+    __atomic_add_fetch(&_requestCount, 1, __ATOMIC_SEQ_CST);
+
+    LauncherAgentCompletionBlock completion = ^(BOOL started, NSError *error) {
+        NSMutableDictionary *response = [NSMutableDictionary dictionary];
+        [response setObject: [NSNumber numberWithInt: LAUNCHER_AGENT_PROTOCOL_VERSION] forKey: LauncherAgentVersionKey];
+        [response setObject: [NSNumber numberWithBool: started] forKey: LauncherAgentStartedKey];
+        if (!started && error != nil)
+            [response setObject: [error localizedDescription] forKey: LauncherAgentErrorKey];
+
+        if (!launcher_agent_write_message(fd, response))
+            NSLog(@"Could not write launcher agent response for %@", appPath);
+
+        close(fd);
+    };
+
+    dispatch_async(_callbackQueue, ^{
+        [_backend agentServer: self launchApplicationAtPath: appPath deviceFamilyCode: deviceFamily completion: completion];
+    });
+}
+
+@end
@@ -0,0 +1,110 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "LauncherAgentServer.h"
+#import "LauncherAgentClient.h"
+#import "LauncherAgentProtocol.h"
+#import "LauncherMockAgentBackend.h"
+
+@interface LauncherAgentTests : PLTestCase {
+@private
+    /** Socket path */
+    NSString *_path;
+
+    /** Mock backend */
+    LauncherMockAgentBackend *_backend;
+
+    /** Server under test */
+    LauncherAgentServer *_server;
+}
+@end
+
+@implementation LauncherAgentTests
+
+- (void) setUp {
+    /* sockaddr_un paths are limited to 104 bytes; avoid long unique names */
+    _path = [NSTemporaryDirectory() stringByAppendingPathComponent: [NSString stringWithFormat: @"agent-test-%d.sock", getpid()]];
+    _backend = [LauncherMockAgentBackend new];
+    _server = [[LauncherAgentServer alloc] initWithPath: _path
+                                                backend: _backend
+                                          callbackQueue: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)];
+
+    NSError *error;
+    STAssertTrue([_server start: &error], @"Failed to start server: %@", error);
+}
+
+- (void) tearDown {
+    [_server stop];
+    [super tearDown];
+}
+
+- (void) testLaunch {
+    NSError *error;
+    LauncherAgentClient *client = [LauncherAgentClient clientWithPath: _path];
+    STAssertTrue([client launchApplicationAtPath: @"/Example.app" deviceFamilyCode: [NSNumber numberWithInt: 1] error: &error], @"Launch failed: %@", error);
+    STAssertTrue([client launchApplicationAtPath: @"/Example.app" deviceFamilyCode: nil error: &error], @"Launch failed: %@", error);
+
+    STAssertEquals(_backend.launchCount, (NSUInteger) 2, @"Incorrect launch count");
+    STAssertEquals(_server.requestCount, (NSUInteger) 2, @"Incorrect request count");
+}
+
+- (void) testLaunchFailure {
+    _backend.failLaunches = YES;
+
+    NSError *error;
+    STAssertFalse([[LauncherAgentClient clientWithPath: _path] launchApplicationAtPath: @"/Example.app" deviceFamilyCode: nil error: &error], @"Launch should fail");
+    STAssertEquals([error code], (NSInteger) LauncherAgentErrorLaunchFailed, @"Incorrect error code");
+}
+
+- (void) testTimeout {
+    _backend.latency = 2.0;
+
+    NSError *error;
+    LauncherAgentClient *client = [LauncherAgentClient clientWithPath: _path];
+    client.timeout = 0.1;
+    STAssertFalse([client launchApplicationAtPath: @"/Example.app" deviceFamilyCode: nil error: &error], @"Launch should time out");
+    STAssertEquals([error code], (NSInteger) LauncherAgentErrorProtocol, @"Incorrect error code");
+}
+
+- (void) testUnavailable {
+    [_server stop];
+
+    NSError *error;
+    STAssertFalse([[LauncherAgentClient clientWithPath: _path] launchApplicationAtPath: @"/Example.app" deviceFamilyCode: nil error: &error], @"Launch should fail");
+    STAssertEquals([error code], (NSInteger) LauncherAgentErrorUnavailable, @"Incorrect error code");
+}
+
+/* A second server must not displace a running agent */
+- (void) testExclusive {
+    LauncherAgentServer *second = [[LauncherAgentServer alloc] initWithPath: _path backend: _backend callbackQueue: NULL];
+    STAssertFalse([second start: NULL], @"Second server should not start");
+}
+
+@end
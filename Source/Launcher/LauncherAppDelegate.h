@@ -29,17 +29,29 @@
 #import <Cocoa/Cocoa.h>
 
 #import "PLSimulator.h"
+#import "LauncherAgentServer.h"
+#import "LauncherStartupPipeline.h"
+#import "LauncherMatrixScheduler.h"
 
-@interface LauncherAppDelegate : NSObject <PLSimulatorDiscoveryDelegate> {
+@interface LauncherAppDelegate : NSObject <LauncherStartupPipelineDelegate, PLSimulatorDiscoveryDelegate> {
 @private
-    /** Instance used to find the required simulator platform SDK */
+    /** Default device family, or nil if none. */
+    PLSimulatorDeviceFamily *_defaultDeviceFamily;
+
+    /** The startup pipeline, once started. */
+    LauncherStartupPipeline *_pipeline;
+
+    /** Instance used to find the simulator platform SDKs for a launch matrix. */
     PLSimulatorDiscovery *_discovery;
 
-    /** Embedded app meta-data */
-    PLSimulatorApplication *_app;
+    /** Applications to be launched by the launch matrix. */
+    NSArray *_matrixApps;
 
-    /** Default device family, or nil if none. */
-    PLSimulatorDeviceFamily *_defaultDeviceFamily;
+    /** The launch matrix scheduler, if running a launch matrix. */
+    LauncherMatrixScheduler *_scheduler;
+
+    /** The launcher agent server, if running as an agent. */
+    LauncherAgentServer *_agentServer;
 }
 
 @end
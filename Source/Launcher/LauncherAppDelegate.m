@@ -27,7 +27,16 @@
  */
 
 #import "LauncherAppDelegate.h"
-#import "LauncherSimClient.h"
+#import "LauncherStartupPipeline.h"
+#import "LauncherDTSessionBackend.h"
+
+#import "LauncherAgentProtocol.h"
+#import "LauncherAgentClient.h"
+#import "LauncherSimAgentBackend.h"
+#import "LauncherMockAgentBackend.h"
+#import "LauncherMatrixScheduler.h"
+
+#import "PLDylibPrefetcher.h"
 
 /* Resource subdirectory for the embedded application */
 #define APP_DIR @"EmbeddedApp"
@@ -38,11 +47,45 @@
 /* Default device family to use */
 #define DefaultDeviceKey @"PLDefaultUIDeviceFamily"
 
+/* Run as a resident launcher agent */
+#define AGENT_ARGUMENT @"--agent"
+
+/* Run as a resident launcher agent, using the mock backend */
+#define MOCK_AGENT_ARGUMENT @"--agent-mock"
+
+/* Launch every embedded application across all device families and SDK versions */
+#define MATRIX_ARGUMENT @"--matrix"
+
+/* Remain running, and stream the application's output to the following file or socket path */
+#define OUTPUT_ARGUMENT @"--output"
+
+@interface LauncherAppDelegate (PrivateMethods)
+- (void) runAgentWithBackend: (id<LauncherAgentBackend>) backend;
+- (void) runMatrixWithApplicationPaths: (NSArray *) paths;
+@end
+
 @implementation LauncherAppDelegate
 
 - (void) applicationDidFinishLaunching: (NSNotification *) aNotification {
     NSError *error;
 
+    /* Run as an agent, if requested */
+    NSArray *arguments = [[NSProcessInfo processInfo] arguments];
+    if ([arguments containsObject: AGENT_ARGUMENT]) {
+        LauncherSimAgentBackend *backend = [LauncherSimAgentBackend new];
+        [backend start];
+        [self runAgentWithBackend: backend];
+        return;
+    } else if ([arguments containsObject: MOCK_AGENT_ARGUMENT]) {
+        [self runAgentWithBackend: [LauncherMockAgentBackend new]];
+        return;
+    }
+
+    /* Start reading in the simulator frameworks recalled from previous launches; this overlaps
+     * with application parsing and platform discovery. */
+    if ([PLDylibPrefetcher isEnabled])
+        [[PLDylibPrefetcher sharedPrefetcher] prefetchCachedClosures];
+
     /* Display a fatal configuration error modaly */
     void (^ConfigError)(NSString *) = ^(NSString *text) {
         NSAlert *alert = [NSAlert alertWithMessageText: @"The launcher has not been correctly configured." 
@@ -77,52 +120,181 @@
     } else if ([appPaths count] == 0) {
         ConfigError(@"No applications found in " FULL_APP_DIR ".");
         return;
+    } else if ([arguments containsObject: MATRIX_ARGUMENT]) {
+        NSMutableArray *paths = [NSMutableArray arrayWithCapacity: [appPaths count]];
+        for (NSString *name in appPaths)
+            [paths addObject: [appContainer stringByAppendingPathComponent: name]];
+
+        [self runMatrixWithApplicationPaths: paths];
+        return;
     } else if ([appPaths count] > 1) {
         ConfigError(@"More than one application found in " FULL_APP_DIR ".");
         return;
     }
 
-    /* Load the app meta-data */
+    /* Open the output stream, if requested */
+    LauncherOutputStream *outputStream = nil;
+    NSUInteger outputIndex = [arguments indexOfObject: OUTPUT_ARGUMENT];
+    if (outputIndex != NSNotFound) {
+        if (outputIndex + 1 >= [arguments count]) {
+            ConfigError(@"The " OUTPUT_ARGUMENT " option requires a destination path.");
+            return;
+        }
+
+        NSString *outputPath = [arguments objectAtIndex: outputIndex + 1];
+        outputStream = [LauncherOutputStream streamWithDestinationPath: outputPath error: &error];
+        if (outputStream == nil) {
+            ConfigError([NSString stringWithFormat: @"The output destination %@ could not be opened: %@", outputPath, [error localizedDescription]]);
+            return;
+        }
+    }
+
+    /* Hand the launch off to a resident agent, if one is running. On failure, fall back to launching in-process.
+     * The agent can not stream output back to us. */
     NSString *appPath = [appContainer stringByAppendingPathComponent: [appPaths objectAtIndex: 0]];
-    _app = [[PLSimulatorApplication alloc] initWithPath: appPath error: &error];
-    if (_app == nil) {
-        [[NSAlert alertWithError: error] runModal];
-        [[NSApplication sharedApplication] terminate: self];
-        return;
+    NSString *agentPath = launcher_agent_default_socket_path();
+    if (outputStream == nil && [[NSFileManager defaultManager] fileExistsAtPath: agentPath]) {
+        NSNumber *deviceCode = nil;
+        if (_defaultDeviceFamily != nil)
+            deviceCode = [NSNumber numberWithInteger: _defaultDeviceFamily.deviceFamilyCode];
+
+        if ([[LauncherAgentClient clientWithPath: agentPath] launchApplicationAtPath: appPath deviceFamilyCode: deviceCode error: &error]) {
+            [[NSApplication sharedApplication] terminate: self];
+            return;
+        }
+
+        NSLog(@"Launcher agent could not launch %@, launching directly: %@", appPath, error);
     }
 
-    /* Find the matching platform SDKs. We don't care about version, but do care about the SDK the 
-     * app was built with and the device families it requires/supports */
-    _discovery = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: nil
-                                                     canonicalSDKName: _app.canonicalSDKName
-                                                       deviceFamilies: _app.deviceFamilies];
-    _discovery.delegate = self;
-    [_discovery startQuery];
-    
+    /* Load the application and find a matching platform SDK, overlapping the independent phases */
+    _pipeline = [[LauncherStartupPipeline alloc] initWithApplicationPath: appPath
+                                                     defaultDeviceFamily: _defaultDeviceFamily
+                                                                 backend: [LauncherDTSessionBackend new]];
+    _pipeline.delegate = self;
+    _pipeline.memoryProfiler = [PLMemoryProfiler profilerFromEnvironmentWithName: @"launcher"];
+    _pipeline.outputStream = outputStream;
+    [_pipeline start];
+}
+
+// from LauncherStartupPipelineDelegate protocol
+- (void) startupPipeline: (LauncherStartupPipeline *) pipeline didFailWithError: (NSError *) error {
+    NSAlert *alert;
+
+    if ([error code] == LauncherStartupErrorNoPlatform) {
+        /* No platforms found */
+        alert = [NSAlert alertWithMessageText: NSLocalizedString(@"Required iPhone SDK not found.", @"SDK not found")
+                                defaultButton: NSLocalizedString(@"Quit", @"Quit button")
+                              alternateButton: nil
+                                  otherButton: nil
+                    informativeTextWithFormat: @"%@", [error localizedDescription]];
+    } else if ([error code] == LauncherStartupErrorInvalidApplication && [[error userInfo] objectForKey: NSUnderlyingErrorKey] != nil) {
+        alert = [NSAlert alertWithError: [[error userInfo] objectForKey: NSUnderlyingErrorKey]];
+    } else {
+        alert = [NSAlert alertWithError: error];
+    }
+
+    [alert runModal];
+    [[NSApplication sharedApplication] terminate: self];
 }
 
 // from PLSimulatorDiscoveryDelegate protocol
 - (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindMatchingSimulatorPlatforms: (NSArray *) platforms {
-    /* No platforms found */
     if ([platforms count] == 0) {
-        NSString *infoFmt = NSLocalizedString(@"The iPhone SDK required by the application could not be found. Please install the %@ SDK and try again.", 
-                                              @"App SDK not found");
-    
-        NSAlert *alert = [NSAlert alertWithMessageText: NSLocalizedString(@"Required iPhone SDK not found.", @"SDK not found")
-                                         defaultButton: NSLocalizedString(@"Quit", @"Quit button")
-                                       alternateButton: nil
-                                           otherButton: nil
-                             informativeTextWithFormat: infoFmt, _app.canonicalSDKName];
-        [alert runModal];
+        NSLog(@"No iPhone Simulator platform SDKs found; can not run the launch matrix");
         [[NSApplication sharedApplication] terminate: self];
         return;
     }
 
-    /* Launch with the discovery-preferred platform */
-    LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: [platforms objectAtIndex: 0] 
-                                                                        app: _app
-                                                        defaultDeviceFamily: _defaultDeviceFamily];
-    [client launch];
+    /* Only one version of the simulator's private frameworks may be loaded; run the matrix against
+     * every SDK provided by the preferred platform. */
+    PLSimulatorPlatform *platform = [platforms objectAtIndex: 0];
+    NSMutableArray *versions = [NSMutableArray array];
+    for (PLSimulatorSDK *sdk in platform.sdks) {
+        if (![versions containsObject: sdk.version])
+            [versions addObject: sdk.version];
+    }
+
+    NSArray *jobs = [LauncherMatrixScheduler jobsForApplications: _matrixApps deviceFamilies: nil sdkVersions: versions];
+    NSLog(@"Running %lu launches from %@", (unsigned long) [jobs count], platform.path);
+
+    /* The simulator runs a single session at a time */
+    _scheduler = [[LauncherMatrixScheduler alloc] initWithPlatforms: [NSArray arrayWithObject: platform] backendFactory: ^{
+        return (id<LauncherSessionBackend>) [LauncherDTSessionBackend new];
+    } maxConcurrentSessions: 1];
+
+    [_scheduler runJobs: jobs completionBlock: ^(NSArray *completed) {
+        NSLog(@"Launch matrix results:\n%@", [_scheduler report]);
+        [[NSApplication sharedApplication] terminate: self];
+    }];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherAppDelegate (PrivateMethods)
+
+/**
+ * Run as a resident launcher agent, serving launch requests with @a backend until terminated.
+ */
+- (void) runAgentWithBackend: (id<LauncherAgentBackend>) backend {
+    NSError *error;
+
+    /* The agent has no UI */
+    [[NSApplication sharedApplication] setActivationPolicy: NSApplicationActivationPolicyProhibited];
+
+    _agentServer = [[LauncherAgentServer alloc] initWithPath: launcher_agent_default_socket_path() backend: backend callbackQueue: NULL];
+    if (![_agentServer start: &error]) {
+        NSLog(@"Could not start launcher agent at %@: %@", _agentServer.path, error);
+        [[NSApplication sharedApplication] terminate: self];
+        return;
+    }
+
+    NSLog(@"Launcher agent listening at %@", _agentServer.path);
+}
+
+/**
+ * Launch each application at @a paths with every device family it supports, and every SDK version provided by
+ * the preferred platform, logging the results and terminating once all launches have completed.
+ */
+- (void) runMatrixWithApplicationPaths: (NSArray *) paths {
+    NSMutableArray *apps = [NSMutableArray arrayWithCapacity: [paths count]];
+    for (NSString *path in paths) {
+        NSError *error;
+        PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: path error: &error];
+        if (app == nil) {
+            NSLog(@"Skipping %@: %@", path, error);
+            continue;
+        }
+
+        [apps addObject: app];
+    }
+
+    if ([apps count] == 0) {
+        NSLog(@"No valid applications found; can not run the launch matrix");
+        [[NSApplication sharedApplication] terminate: self];
+        return;
+    }
+
+    /* A platform is only useful if it provides an SDK that at least one application can run on; requiring the
+     * oldest of the applications' minimum SDK versions allows discovery to finish from the well-known locations
+     * without a volume-wide search. */
+    NSString *minimumVersion = nil;
+    for (PLSimulatorApplication *app in apps) {
+        NSString *version = app.minimumSDKVersion;
+        if (version == nil)
+            continue;
+
+        if (minimumVersion == nil || [version compare: minimumVersion options: NSNumericSearch] == NSOrderedAscending)
+            minimumVersion = version;
+    }
+
+    /* Find all platforms; the discovery results are shared by every launch */
+    _matrixApps = apps;
+    _discovery = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: minimumVersion canonicalSDKName: nil deviceFamilies: nil];
+    _discovery.delegate = self;
+    [_discovery startQuery];
 }
 
 @end
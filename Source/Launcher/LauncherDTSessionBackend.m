@@ -0,0 +1,219 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherDTSessionBackend.h"
+
+#import <ScriptingBridge/ScriptingBridge.h>
+
+/* App bundle ID. Used to request that the simulator be brought to the foreground */
+#define SIM_APP_BUNDLE_ID @"com.apple.iphonesimulator"
+
+/* Load a class from the runtime-loaded iPhoneSimulatorRemoteClient framework */
+#define C(name) NSClassFromString(@"" #name)
+
+/* Return an error with the given localized description */
+static NSError *session_error (NSString *description, NSError *cause) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject: description forKey: NSLocalizedDescriptionKey];
+    if (cause != nil)
+        [userInfo setObject: cause forKey: NSUnderlyingErrorKey];
+
+    return [NSError errorWithDomain: LauncherSessionErrorDomain code: 1 userInfo: userInfo];
+}
+
+/**
+ * Starts simulator sessions using the private iPhoneSimulatorRemoteClient framework.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads. Must be used from the main thread.
+ */
+@implementation LauncherDTSessionBackend
+
+@synthesize delegate = _delegate;
+
+- (void) dealloc {
+    /* The session does not retain its delegate */
+    [_session setDelegate: nil];
+}
+
+// from LauncherSessionBackend protocol
+- (BOOL) loadPlatform: (PLSimulatorPlatform *) platform error: (NSError **) outError {
+    NSError *error;
+
+    /* Load the framework */
+    if (![platform loadPrivateFrameworks: &error]) {
+        NSLog(@"Failed to load private Simulator frameworks: %@", error);
+        if (outError != NULL)
+            *outError = session_error(NSLocalizedString(@"A failure occured loading the Simulator's private frameworks.",
+                                                        @"Failed to load private framework alert text"), error);
+        return NO;
+    }
+
+    /* Find and load all Xcode platform SDKs; without this, the iPhoneSimulatorRemoteClient API will be unable to locate
+     * SDK roots via DTiPhoneSimulatorSystemRoot. */
+    if (!_platformsLoaded) {
+        if (![C(DVTPlatform) loadAllPlatformsReturningError: &error]) {
+            NSLog(@"Failed to load platform SDKs: %@", error);
+            if (outError != NULL)
+                *outError = session_error(NSLocalizedString(@"The Simulator's platform SDKs could not be loaded.",
+                                                            @"Failed to load platform SDKs alert text"), error);
+            return NO;
+        }
+
+        _platformsLoaded = YES;
+    }
+
+    return YES;
+}
+
+// from LauncherSessionBackend protocol
+- (BOOL) startSessionWithConfig: (LauncherSessionConfig *) sessionConfig timeout: (NSTimeInterval) timeout error: (NSError **) outError {
+    DTiPhoneSimulatorApplicationSpecifier *appSpec;
+    DTiPhoneSimulatorSystemRoot *sdkRoot;
+    DTiPhoneSimulatorSessionConfig *config;
+    NSError *error;
+
+    /* Create the app specifier */
+    appSpec = [C(DTiPhoneSimulatorApplicationSpecifier) specifierWithApplicationPath: sessionConfig.applicationPath];
+    if (appSpec == nil) {
+        NSLog(@"Could not load application specification for %@\n", sessionConfig.applicationPath);
+    
+        NSString *text = NSLocalizedString(@"The iPhone application specification could not be loaded. This launcher may be misconfigured.", 
+                                           @"App load failure");
+        if (outError != NULL)
+            *outError = session_error(text, nil);
+        return NO;
+    }
+
+    NSLog(@"App Spec: %@\n", appSpec);
+
+    /* Load the SDK root */
+    if (sessionConfig.sdkVersion != nil) {
+        sdkRoot = [C(DTiPhoneSimulatorSystemRoot) rootWithSDKVersion: sessionConfig.sdkVersion];
+        if (sdkRoot == nil) {
+            NSString *fmt = NSLocalizedString(@"The iPhoneSimulator %@ SDK was not found. Please install the SDK and try again.",
+                                              @"SDK load failure alert info");
+            NSLog(@"Can't find SDK system root for version %@\n", sessionConfig.sdkVersion);
+            if (outError != NULL)
+                *outError = session_error([NSString stringWithFormat: fmt, sessionConfig.sdkVersion], nil);
+            return NO;
+        }
+    } else {
+        sdkRoot = [C(DTiPhoneSimulatorSystemRoot) defaultRoot];
+    }
+    
+    NSLog(@"SDK Root: %@\n", sdkRoot);
+    
+    /* Set up the session configuration */
+    config = [[C(DTiPhoneSimulatorSessionConfig) alloc] init];
+    [config setApplicationToSimulateOnStart: appSpec];
+    [config setSimulatedSystemRoot: sdkRoot];
+    [config setSimulatedApplicationShouldWaitForDebugger: NO];
+    
+    [config setSimulatedApplicationLaunchArgs: sessionConfig.launchArguments];
+    [config setSimulatedApplicationLaunchEnvironment: sessionConfig.launchEnvironment];
+
+    if (sessionConfig.stdoutPath != nil)
+        [config setSimulatedApplicationStdOutPath: sessionConfig.stdoutPath];
+    if (sessionConfig.stderrPath != nil)
+        [config setSimulatedApplicationStdErrPath: sessionConfig.stderrPath];
+
+    /* Configure the target device info */
+    {
+        ISHDeviceVersions *deviceVersions = [C(ISHDeviceVersions) sharedInstance];
+        PLSimulatorDeviceFamily *family = sessionConfig.deviceFamily;
+        DTiPhoneSimulatorFamily productType;
+
+        /*
+         * Determine best available product type. The ISHDeviceVersions product type seems to be based on,
+         * and use the same constant values as, the DTiPhoneSimulatorFamily constants
+         */
+        NSArray *productTypes = [deviceVersions productTypes];
+        if (family != nil && [productTypes containsObject: @(family.deviceFamilyCode)]) {
+            productType = family.deviceFamilyCode;
+        } else {
+            productType = DTiPhoneSimulatoriPhoneFamily;
+        }
+        
+        /*
+         * Map to a device info instance.
+         * TODO: This is where we could properly support 1x, 2x, 32-bit, and 64-bit, but doing so requires that we have a way
+         * to pass these configuration items to the launcher. For now, we hard code the device info selection.
+         */
+        NSString *deviceInfo;
+        switch (productType) {
+            case DTiPhoneSimulatoriPadFamily:
+                deviceInfo = [deviceVersions deviceInfoForProductType: productType displayScale: 1.0 displayHeight: 1024 wordSize: 4];
+                break;
+            case DTiPhoneSimulatoriPhoneFamily:
+                deviceInfo = [deviceVersions deviceInfoForProductType: productType displayScale: 2.0 displayHeight: 568 wordSize: 4];
+                break;
+        }
+
+        [config setSimulatedDeviceInfoName: deviceInfo];
+    }
+
+    [config setLocalizedClientName: @"SimLauncher"];
+
+    /* Start the session */
+    _session = [[C(DTiPhoneSimulatorSession) alloc] init];
+    [_session setDelegate: self];
+    [_session setSimulatedApplicationPID: [NSNumber numberWithInt: 35]];
+    
+    if (![_session requestStartWithConfig: config timeout: timeout error: &error]) {
+        NSLog(@"Could not start simulator session: %@", error);
+        _session = nil;
+
+        NSString *text = NSLocalizedString(@"The iPhone Simulator could not be started. If another Simulator application "
+                                           "is currently running, please close the Simulator and try again.", 
+                                           @"Simulator error alert info");
+        if (outError != NULL)
+            *outError = session_error(text, error);
+        return NO;
+    }
+
+    return YES;
+}
+
+// from DTiPhoneSimulatorSessionDelegate protocol
+- (void) session: (DTiPhoneSimulatorSession *) session didEndWithError: (NSError *) error {
+    if (session == _session)
+        _session = nil;
+
+    [_delegate sessionBackend: self didEndWithError: error];
+}
+
+// from DTiPhoneSimulatorSessionDelegate protocol
+- (void) session: (DTiPhoneSimulatorSession *) session didStart: (BOOL) started withError: (NSError *) error {
+    /* Bring simulator to foreground */
+    if (started)
+        [[SBApplication applicationWithBundleIdentifier: SIM_APP_BUNDLE_ID] activate];
+
+    [_delegate sessionBackend: self didStart: started withError: error];
+}
+
+@end
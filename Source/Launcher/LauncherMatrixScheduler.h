@@ -0,0 +1,170 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLSimulator.h"
+#import "LauncherSessionBackend.h"
+
+extern NSString *LauncherMatrixErrorDomain;
+
+/**
+ * A single (application, device family, SDK version) launch within a launch matrix.
+ */
+@interface LauncherMatrixJob : NSObject {
+@private
+    /** Application to be launched. */
+    PLSimulatorApplication *_app;
+
+    /** Device family to launch with. */
+    PLSimulatorDeviceFamily *_deviceFamily;
+
+    /** SDK version to launch with. */
+    NSString *_sdkVersion;
+
+    /** YES if the session started. */
+    BOOL _started;
+
+    /** YES once the job has completed. */
+    BOOL _completed;
+
+    /** The launch error, the error that ended the session, or nil. */
+    NSError *_error;
+
+    /** Start, session start and end offsets from the start of the matrix run, in seconds. */
+    NSTimeInterval _startTime;
+    NSTimeInterval _launchTime;
+    NSTimeInterval _endTime;
+}
+
++ (id) jobWithApplication: (PLSimulatorApplication *) app deviceFamily: (PLSimulatorDeviceFamily *) deviceFamily sdkVersion: (NSString *) sdkVersion;
+- (id) initWithApplication: (PLSimulatorApplication *) app deviceFamily: (PLSimulatorDeviceFamily *) deviceFamily sdkVersion: (NSString *) sdkVersion;
+
+/** Application to be launched. */
+@property(nonatomic, readonly) PLSimulatorApplication *application;
+
+/** Device family to launch with. */
+@property(nonatomic, readonly) PLSimulatorDeviceFamily *deviceFamily;
+
+/** SDK version to launch with. */
+@property(nonatomic, readonly) NSString *sdkVersion;
+
+/** YES if the session started. Valid once the job has completed. */
+@property(nonatomic, readonly) BOOL started;
+
+/**
+ * The launch error if the session did not start, the error that ended the session if it did, or nil. Valid once
+ * the job has completed.
+ */
+@property(nonatomic, readonly) NSError *error;
+
+/** Time from the start of the matrix run to the start of this job, in seconds. */
+@property(nonatomic, readonly) NSTimeInterval startTime;
+
+/**
+ * Time from the start of the matrix run to the completion of this job, in seconds. A job whose session started
+ * completes when the session ends.
+ */
+@property(nonatomic, readonly) NSTimeInterval endTime;
+
+/** Time from the start of this job to the start of its session, in seconds, or to its failure if the session did not start. */
+@property(nonatomic, readonly) NSTimeInterval latency;
+
+/** Time from the start of this job's session to its end, in seconds, or 0 if the session did not start. */
+@property(nonatomic, readonly) NSTimeInterval sessionDuration;
+
+@end
+
+@interface LauncherMatrixScheduler : NSObject {
+@private
+    /** Candidate platforms, in order of preference. */
+    NSArray *_platforms;
+
+    /** Returns a new session backend. */
+    id<LauncherSessionBackend> (^_backendFactory)(void);
+
+    /** Maximum number of concurrent sessions. */
+    NSUInteger _maxConcurrentSessions;
+
+    /** Idle session backends, available for reuse. */
+    NSMutableArray *_idleBackends;
+
+    /** Number of session backends created. */
+    NSUInteger _backendCount;
+
+    /** Launch clients for the running jobs, retained until their sessions end. */
+    NSMutableSet *_clients;
+
+    /** Jobs that have not yet been started. */
+    NSMutableArray *_pending;
+
+    /** All jobs in the current run. */
+    NSArray *_jobs;
+
+    /** Number of jobs completed in the current run. */
+    NSUInteger _completedCount;
+
+    /** Number of jobs currently running. */
+    NSUInteger _runningCount;
+
+    /** Greatest number of jobs run concurrently. */
+    NSUInteger _peakConcurrency;
+
+    /** Absolute start time of the current run. */
+    CFAbsoluteTime _runStartTime;
+
+    /** Total elapsed time of the last completed run, in seconds. */
+    NSTimeInterval _elapsedTime;
+
+    /** Block called on completion of the current run. */
+    void (^_completionBlock)(NSArray *jobs);
+}
+
++ (NSArray *) jobsForApplications: (NSArray *) apps deviceFamilies: (NSArray *) deviceFamilies sdkVersions: (NSArray *) sdkVersions;
+
+- (id) initWithPlatforms: (NSArray *) platforms
+          backendFactory: (id<LauncherSessionBackend> (^)(void)) backendFactory
+   maxConcurrentSessions: (NSUInteger) maxConcurrentSessions;
+
+- (void) runJobs: (NSArray *) jobs completionBlock: (void (^)(NSArray *jobs)) block;
+
+- (NSString *) report;
+
+/** Greatest number of sessions run concurrently during the last run. */
+@property(nonatomic, readonly) NSUInteger peakConcurrency;
+
+/** Total elapsed time of the last completed run, in seconds. */
+@property(nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/** Completed jobs per second over the last completed run. */
+@property(nonatomic, readonly) double throughput;
+
+/** Number of session backends created; backends are reused between jobs. */
+@property(nonatomic, readonly) NSUInteger backendCount;
+
+@end
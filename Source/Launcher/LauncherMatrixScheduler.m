@@ -0,0 +1,415 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherMatrixScheduler.h"
+#import "LauncherSimClient.h"
+
+/** Launch matrix error domain */
+NSString *LauncherMatrixErrorDomain = @"LauncherMatrixErrorDomain";
+
+@interface LauncherMatrixJob (PrivateMethods)
+- (void) beginAtTime: (NSTimeInterval) time;
+- (void) launchAtTime: (NSTimeInterval) time;
+- (BOOL) completeAtTime: (NSTimeInterval) time started: (BOOL) started error: (NSError *) error;
+@end
+
+/**
+ * A single launch within a launch matrix.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads.
+ */
+@implementation LauncherMatrixJob
+
+@synthesize application = _app;
+@synthesize deviceFamily = _deviceFamily;
+@synthesize sdkVersion = _sdkVersion;
+@synthesize started = _started;
+@synthesize error = _error;
+@synthesize startTime = _startTime;
+@synthesize endTime = _endTime;
+
+/**
+ * Return a new job.
+ *
+ * @param app Application to be launched.
+ * @param deviceFamily Device family to launch with.
+ * @param sdkVersion SDK version to launch with (eg, 6.0).
+ */
++ (id) jobWithApplication: (PLSimulatorApplication *) app deviceFamily: (PLSimulatorDeviceFamily *) deviceFamily sdkVersion: (NSString *) sdkVersion {
+    return [[self alloc] initWithApplication: app deviceFamily: deviceFamily sdkVersion: sdkVersion];
+}
+
+/**
+ * Initialize a new job.
+ *
+ * @param app Application to be launched.
+ * @param deviceFamily Device family to launch with.
+ * @param sdkVersion SDK version to launch with (eg, 6.0).
+ */
+- (id) initWithApplication: (PLSimulatorApplication *) app deviceFamily: (PLSimulatorDeviceFamily *) deviceFamily sdkVersion: (NSString *) sdkVersion {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _app = app;
+    _deviceFamily = deviceFamily;
+    _sdkVersion = [sdkVersion copy];
+
+    return self;
+}
+
+// property getter
+- (NSTimeInterval) latency {
+    if (_started)
+        return _launchTime - _startTime;
+
+    return _endTime - _startTime;
+}
+
+// property getter
+- (NSTimeInterval) sessionDuration {
+    if (!_started)
+        return 0;
+
+    return _endTime - _launchTime;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"%@ (%@, %@)", [_app.path lastPathComponent], _deviceFamily.localizedName, _sdkVersion];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherMatrixJob (PrivateMethods)
+
+/**
+ * Mark the job as started at @a time, relative to the start of the matrix run.
+ */
+- (void) beginAtTime: (NSTimeInterval) time {
+    _startTime = time;
+}
+
+/**
+ * Mark the job's session as started at @a time, relative to the start of the matrix run.
+ */
+- (void) launchAtTime: (NSTimeInterval) time {
+    _launchTime = time;
+}
+
+/**
+ * Mark the job as completed at @a time, relative to the start of the matrix run. Returns NO, leaving the job
+ * unmodified, if the job has already completed.
+ */
+- (BOOL) completeAtTime: (NSTimeInterval) time started: (BOOL) started error: (NSError *) error {
+    if (_completed)
+        return NO;
+
+    _completed = YES;
+    _endTime = time;
+    _started = started;
+    _error = error;
+    return YES;
+}
+
+@end
+
+@interface LauncherMatrixScheduler (PrivateMethods)
+- (PLSimulatorPlatform *) platformForJob: (LauncherMatrixJob *) job;
+- (void) startJob: (LauncherMatrixJob *) job backend: (id<LauncherSessionBackend>) backend;
+- (void) completeJob: (LauncherMatrixJob *) job backend: (id<LauncherSessionBackend>) backend started: (BOOL) started error: (NSError *) error;
+- (void) pump;
+@end
+
+/**
+ * Runs a matrix of application launches across device families and SDK versions, with a bounded number of
+ * concurrent sessions.
+ *
+ * A job runs from its launch until its simulator session ends. Session backends are created on demand, up to
+ * the concurrency limit, and reused between jobs; a backend's loaded platform frameworks are retained across the
+ * jobs it runs. The candidate platforms are supplied once,
+ * and each job is run on the most preferred platform providing its SDK version and device family.
+ *
+ * @warning Only one version of the simulator's private frameworks may be loaded in a process. When using
+ * LauncherDTSessionBackend, all jobs should be satisfiable by a single platform.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads. Must be used from the main thread.
+ */
+@implementation LauncherMatrixScheduler
+
+@synthesize peakConcurrency = _peakConcurrency;
+@synthesize elapsedTime = _elapsedTime;
+@synthesize backendCount = _backendCount;
+
+/**
+ * Return the jobs for every combination of @a apps, @a deviceFamilies and @a sdkVersions, in that order. Device
+ * families not supported by an application are skipped.
+ *
+ * @param apps The PLSimulatorApplication instances to be launched.
+ * @param deviceFamilies The PLSimulatorDeviceFamily instances to launch with, or nil to use every family
+ * supported by each application.
+ * @param sdkVersions The SDK versions to launch with.
+ */
++ (NSArray *) jobsForApplications: (NSArray *) apps deviceFamilies: (NSArray *) deviceFamilies sdkVersions: (NSArray *) sdkVersions {
+    NSMutableArray *jobs = [NSMutableArray array];
+    NSSortDescriptor *byCode = [NSSortDescriptor sortDescriptorWithKey: @"deviceFamilyCode" ascending: YES];
+
+    for (PLSimulatorApplication *app in apps) {
+        NSArray *families = deviceFamilies;
+        if (families == nil)
+            families = [[app.deviceFamilies allObjects] sortedArrayUsingDescriptors: [NSArray arrayWithObject: byCode]];
+
+        for (PLSimulatorDeviceFamily *family in families) {
+            if (![app.deviceFamilies containsObject: family])
+                continue;
+
+            for (NSString *version in sdkVersions)
+                [jobs addObject: [LauncherMatrixJob jobWithApplication: app deviceFamily: family sdkVersion: version]];
+        }
+    }
+
+    return jobs;
+}
+
+/**
+ * Initialize a new scheduler.
+ *
+ * @param platforms Candidate PLSimulatorPlatform instances, in order of preference; eg, as returned by PLSimulatorDiscovery.
+ * @param backendFactory Block returning a new session backend. Called at most @a maxConcurrentSessions times per run.
+ * @param maxConcurrentSessions The maximum number of sessions to run concurrently. Must be at least 1.
+ */
+- (id) initWithPlatforms: (NSArray *) platforms
+          backendFactory: (id<LauncherSessionBackend> (^)(void)) backendFactory
+   maxConcurrentSessions: (NSUInteger) maxConcurrentSessions
+{
+    assert(maxConcurrentSessions > 0);
+
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _platforms = platforms;
+    _backendFactory = [backendFactory copy];
+    _maxConcurrentSessions = maxConcurrentSessions;
+    _idleBackends = [NSMutableArray array];
+    _clients = [NSMutableSet set];
+
+    return self;
+}
+
+/**
+ * Run @a jobs, calling @a block on the main thread once all jobs have completed. A run can't be started if one
+ * is already in progress.
+ *
+ * @param jobs The LauncherMatrixJob instances to run. Jobs are started in order.
+ * @param block Block to be called with @a jobs on completion.
+ */
+- (void) runJobs: (NSArray *) jobs completionBlock: (void (^)(NSArray *jobs)) block {
+    assert(_completionBlock == nil);
+
+    _jobs = [jobs copy];
+    _pending = [jobs mutableCopy];
+    _completionBlock = [block copy];
+    _completedCount = 0;
+    _runningCount = 0;
+    _peakConcurrency = 0;
+    _elapsedTime = 0;
+    _runStartTime = CFAbsoluteTimeGetCurrent();
+
+    /* Start from the run loop, so that the completion block is never called from within this method */
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self pump];
+    });
+}
+
+// property getter
+- (double) throughput {
+    if (_elapsedTime <= 0)
+        return 0;
+
+    return _completedCount / _elapsedTime;
+}
+
+/**
+ * Return a human-readable report of the last run, including the latency of each job, and the throughput
+ * of the matrix as a whole.
+ */
+- (NSString *) report {
+    NSMutableString *report = [NSMutableString string];
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity: [_jobs count]];
+    NSUInteger failed = 0;
+
+    for (LauncherMatrixJob *job in _jobs) {
+        if (job.started) {
+            [report appendFormat: @"%@: started in %.1fms, ran for %.1fms\n", job, job.latency * 1000.0, job.sessionDuration * 1000.0];
+        } else {
+            [report appendFormat: @"%@: failed after %.1fms: %@\n", job, job.latency * 1000.0, [job.error localizedDescription]];
+            failed++;
+        }
+
+        [latencies addObject: [NSNumber numberWithDouble: job.latency]];
+    }
+
+    [latencies sortUsingSelector: @selector(compare:)];
+    double median = [latencies count] > 0 ? [[latencies objectAtIndex: [latencies count] / 2] doubleValue] : 0;
+    double max = [latencies count] > 0 ? [[latencies lastObject] doubleValue] : 0;
+
+    [report appendFormat: @"%lu jobs (%lu failed) in %.1fms: %.2f jobs/sec, median latency %.1fms, max latency %.1fms, peak concurrency %lu, %lu backend(s)",
+        (unsigned long) [_jobs count], (unsigned long) failed, _elapsedTime * 1000.0, self.throughput, median * 1000.0, max * 1000.0,
+        (unsigned long) _peakConcurrency, (unsigned long) _backendCount];
+
+    return report;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherMatrixScheduler (PrivateMethods)
+
+/**
+ * Return the most preferred platform providing @a job's SDK version and device family, or nil if none.
+ */
+- (PLSimulatorPlatform *) platformForJob: (LauncherMatrixJob *) job {
+    for (PLSimulatorPlatform *platform in _platforms) {
+        for (PLSimulatorSDK *sdk in platform.sdks) {
+            if ([sdk.version isEqualToString: job.sdkVersion] && [sdk.deviceFamilies containsObject: job.deviceFamily])
+                return platform;
+        }
+    }
+
+    return nil;
+}
+
+/**
+ * Start @a job using @a backend.
+ */
+- (void) startJob: (LauncherMatrixJob *) job backend: (id<LauncherSessionBackend>) backend {
+    [job beginAtTime: CFAbsoluteTimeGetCurrent() - _runStartTime];
+
+    _runningCount++;
+    _peakConcurrency = MAX(_peakConcurrency, _runningCount);
+
+    PLSimulatorPlatform *platform = [self platformForJob: job];
+    if (platform == nil) {
+        NSString *fmt = NSLocalizedString(@"No platform provides the iPhone %@ SDK for the %@ device family.", @"Matrix SDK not found");
+        NSString *desc = [NSString stringWithFormat: fmt, job.sdkVersion, job.deviceFamily.localizedName];
+        NSDictionary *userInfo = [NSDictionary dictionaryWithObject: desc forKey: NSLocalizedDescriptionKey];
+
+        [self completeJob: job backend: backend started: NO error: [NSError errorWithDomain: LauncherMatrixErrorDomain code: 1 userInfo: userInfo]];
+        return;
+    }
+
+    LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: platform
+                                                                        app: job.application
+                                                        defaultDeviceFamily: job.deviceFamily
+                                                                    backend: backend];
+    client.sdkVersion = job.sdkVersion;
+
+    /* The client must be retained until its session ends; the backend is not reusable until then */
+    [_clients addObject: client];
+    __weak LauncherSimClient *weakClient = client;
+    client.sessionEndBlock = ^(NSError *error) {
+        if (weakClient != nil)
+            [_clients removeObject: weakClient];
+
+        [self completeJob: job backend: backend started: YES error: error];
+    };
+
+    [client launchWithCompletionBlock: ^(BOOL started, NSError *error) {
+        if (started) {
+            [job launchAtTime: CFAbsoluteTimeGetCurrent() - _runStartTime];
+            return;
+        }
+
+        /* No session will end; ignore any late end callback, and release the client once it has returned */
+        LauncherSimClient *failedClient = weakClient;
+        failedClient.sessionEndBlock = nil;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (failedClient != nil)
+                [_clients removeObject: failedClient];
+        });
+
+        [self completeJob: job backend: backend started: NO error: error];
+    }];
+}
+
+/**
+ * Record the completion of @a job, and return @a backend to the idle pool. Has no effect if @a job has
+ * already completed.
+ */
+- (void) completeJob: (LauncherMatrixJob *) job backend: (id<LauncherSessionBackend>) backend started: (BOOL) started error: (NSError *) error {
+    if (![job completeAtTime: CFAbsoluteTimeGetCurrent() - _runStartTime started: started error: error])
+        return;
+
+    _runningCount--;
+    _completedCount++;
+    [_idleBackends addObject: backend];
+
+    /* Start further jobs from the run loop, rather than from within the completed session's callback */
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self pump];
+    });
+}
+
+/**
+ * Start pending jobs, up to the concurrency limit, and call the completion block once all jobs have completed.
+ */
+- (void) pump {
+    while ([_pending count] > 0) {
+        id<LauncherSessionBackend> backend = nil;
+        if ([_idleBackends count] > 0) {
+            backend = [_idleBackends lastObject];
+            [_idleBackends removeLastObject];
+        } else if (_runningCount < _maxConcurrentSessions) {
+            backend = _backendFactory();
+            _backendCount++;
+        } else {
+            break;
+        }
+
+        LauncherMatrixJob *job = [_pending objectAtIndex: 0];
+        [_pending removeObjectAtIndex: 0];
+        [self startJob: job backend: backend];
+    }
+
+    /* Report completion */
+    if ([_pending count] == 0 && _runningCount == 0 && _completionBlock != nil) {
+        _elapsedTime = CFAbsoluteTimeGetCurrent() - _runStartTime;
+
+        void (^block)(NSArray *) = _completionBlock;
+        _completionBlock = nil;
+        block(_jobs);
+    }
+}
+
+@end
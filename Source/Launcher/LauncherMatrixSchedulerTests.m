@@ -0,0 +1,100 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+#import "PLSyntheticFixtures.h"
+
+#import "LauncherMatrixScheduler.h"
+#import "LauncherStubSessionBackend.h"
+
+@interface LauncherMatrixSchedulerTests : PLTestCase {
+@private
+    /** Synthetic platform */
+    PLSimulatorPlatform *_platform;
+
+    /** Synthetic application, supporting both iPhone and iPad */
+    PLSimulatorApplication *_app;
+}
+@end
+
+@implementation LauncherMatrixSchedulerTests
+
+- (void) setUp {
+    NSArray *families = [NSArray arrayWithObjects: [NSNumber numberWithInt: 1], [NSNumber numberWithInt: 2], nil];
+    _platform = [self platformWithName: @"Xcode" sdkVersions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    _app = [self applicationWithName: @"Test" canonicalSDKName: @"iphonesimulator6.0" deviceFamilies: families];
+}
+
+- (void) testMatrix {
+    NSMutableArray *backends = [NSMutableArray array];
+    LauncherMatrixScheduler *scheduler = [[LauncherMatrixScheduler alloc] initWithPlatforms: [NSArray arrayWithObject: _platform] backendFactory: ^{
+        LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+        backend.startLatency = 0.05;
+        backend.sessionDuration = 0.05;
+        [backends addObject: backend];
+        return (id<LauncherSessionBackend>) backend;
+    } maxConcurrentSessions: 2];
+
+    /* 2 families x 3 SDKs; the 7.0 SDK is unavailable */
+    NSArray *versions = [NSArray arrayWithObjects: @"5.1", @"6.0", @"7.0", nil];
+    NSArray *jobs = [LauncherMatrixScheduler jobsForApplications: [NSArray arrayWithObject: _app] deviceFamilies: nil sdkVersions: versions];
+    STAssertEquals([jobs count], (NSUInteger) 6, @"Incorrect number of jobs");
+
+    __block NSArray *completed = nil;
+    [scheduler runJobs: jobs completionBlock: ^(NSArray *result) {
+        completed = result;
+    }];
+
+    [self spinRunloopWithTimeout: 5.0 predicate: ^BOOL{ return completed != nil; }];
+    STAssertNotNil(completed, @"Matrix did not complete");
+
+    /* Only the unavailable SDK should fail */
+    for (LauncherMatrixJob *job in completed) {
+        BOOL available = ![job.sdkVersion isEqualToString: @"7.0"];
+        STAssertEquals(job.started, available, @"Unexpected result for %@: %@", job, job.error);
+        if (available) {
+            STAssertTrue(job.latency >= 0.05, @"Latency of %@ was not recorded", job);
+            STAssertTrue(job.sessionDuration >= 0.05, @"%@ completed before its session ended", job);
+        }
+    }
+
+    /* Concurrency must be bounded, and backends reused */
+    STAssertTrue(scheduler.peakConcurrency <= 2, @"Concurrency limit exceeded");
+    STAssertEquals(scheduler.backendCount, [backends count], @"Backend count mismatch");
+    STAssertTrue([backends count] <= 2, @"Backends were not reused");
+
+    NSUInteger sessions = 0;
+    for (LauncherStubSessionBackend *backend in backends)
+        sessions += backend.sessionCount;
+    STAssertEquals(sessions, (NSUInteger) 4, @"Incorrect number of sessions started");
+
+    STAssertTrue(scheduler.throughput > 0, @"Throughput was not recorded");
+    STAssertNotNil([scheduler report], @"No report");
+}
+
+@end
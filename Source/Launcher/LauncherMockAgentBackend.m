@@ -0,0 +1,74 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherMockAgentBackend.h"
+#import "LauncherAgentProtocol.h"
+
+/**
+ * A launcher agent backend that does not start a simulator session, and instead reports success (or failure) after
+ * a configurable delay. Used to test and benchmark the agent round-trip on hosts without the simulator.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation LauncherMockAgentBackend
+
+@synthesize latency = _latency;
+@synthesize failLaunches = _failLaunches;
+
+// from LauncherAgentBackend protocol
+- (void) agentServer: (LauncherAgentServer *) server
+    launchApplicationAtPath: (NSString *) path
+           deviceFamilyCode: (NSNumber *) deviceFamilyCode
+                 completion: (LauncherAgentCompletionBlock) completion
+{
+    __atomic_add_fetch(&_launchCount, 1, __ATOMIC_SEQ_CST);
+
+    BOOL fail = _failLaunches;
+    void (^finish)(void) = ^{
+        if (fail)
+            completion(NO, launcher_agent_error(LauncherAgentErrorLaunchFailed, @"Simulated launch failure."));
+        else
+            completion(YES, nil);
+    };
+
+    if (_latency <= 0) {
+        finish();
+        return;
+    }
+
+    dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (_latency * NSEC_PER_SEC));
+    dispatch_after(when, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), finish);
+}
+
+// property getter
+- (NSUInteger) launchCount {
+    return (NSUInteger) _launchCount;
+}
+
+@end
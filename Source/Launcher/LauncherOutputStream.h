@@ -0,0 +1,111 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** Maximum number of sources that may be added to a LauncherOutputStream. */
+#define LAUNCHER_OUTPUT_STREAM_MAX_SOURCES 4
+
+/** Default per-source ring buffer capacity, in bytes. */
+#define LAUNCHER_OUTPUT_STREAM_DEFAULT_CAPACITY (256 * 1024)
+
+struct launcher_output_source;
+
+@interface LauncherOutputStream : NSObject {
+@private
+    /** Destination file descriptor, or -1 once closed. */
+    int _destination;
+
+    /** Per-source ring buffer capacity, in bytes. Always a power of two. */
+    size_t _capacity;
+
+    /** Source state; the first _sourceCount entries are valid. */
+    struct launcher_output_source *_sources;
+
+    /** Number of added sources. */
+    NSUInteger _sourceCount;
+
+    /** Maximum time a source will wait for buffer space before dropping output, or a negative value to wait indefinitely. */
+    NSTimeInterval _backpressureTimeout;
+
+    /** Signaled by the readers when output is available, or a source has finished. */
+    dispatch_semaphore_t _dataAvailable;
+
+    /** Group containing the reader and writer tasks. */
+    dispatch_group_t _group;
+
+    /** YES once started. */
+    BOOL _started;
+
+    /** YES once stopped. */
+    BOOL _stopped;
+
+    /** Number of bytes written to the destination, excluding drop reports. */
+    volatile int64_t _bytesWritten;
+
+    /** Number of writes issued to the destination. */
+    volatile int64_t _writeCount;
+
+    /** Number of bytes discarded after a destination write failed. */
+    volatile int64_t _discardedByteCount;
+
+    /** The errno value of the first failed destination write, or 0. */
+    volatile int32_t _destinationError;
+}
+
++ (id) streamWithDestinationPath: (NSString *) path error: (NSError **) outError;
+
+- (id) initWithFileDescriptor: (int) fd capacity: (size_t) capacity;
+
+- (BOOL) addSourceWithFileDescriptor: (int) fd;
+- (BOOL) addFIFOSourceAtPath: (NSString *) path error: (NSError **) outError;
+
+- (void) start;
+- (void) stop;
+
+/**
+ * Maximum time, in seconds, that a source will stop reading from its producer while waiting for buffer space.
+ * While a source is not read, a producer writing to it will block. Once the timeout elapses, output is read and
+ * dropped until space is available. A negative value waits indefinitely, and never drops output. Defaults to 0.5.
+ * Must be set before the stream is started.
+ */
+@property(nonatomic, assign) NSTimeInterval backpressureTimeout;
+
+/** Number of bytes written to the destination, excluding drop reports. */
+@property(nonatomic, readonly) uint64_t bytesWritten;
+
+/** Number of writes issued to the destination. */
+@property(nonatomic, readonly) uint64_t writeCount;
+
+/** Number of bytes of output dropped, either due to backpressure or a failed destination. */
+@property(nonatomic, readonly) uint64_t droppedByteCount;
+
+/** The errno value of the first failed destination write, or 0 if no write has failed. */
+@property(nonatomic, readonly) int destinationError;
+
+@end
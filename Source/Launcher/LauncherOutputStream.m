@@ -0,0 +1,527 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherOutputStream.h"
+
+#import <sys/socket.h>
+#import <sys/stat.h>
+#import <sys/uio.h>
+#import <sys/un.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <errno.h>
+
+/* Size of the buffer used to read and discard output while dropping */
+#define DROP_BUFFER_SIZE 16384
+
+/* Format of the report written to the destination when output is dropped */
+#define DROP_REPORT_FORMAT "\n[launcher: %llu bytes of output dropped]\n"
+
+/**
+ * @internal
+ *
+ * A single output source, and its single-producer, single-consumer ring buffer.
+ *
+ * The reader is the sole producer, and only advances @a head; the writer is the sole consumer, and only
+ * advances @a tail. Both counters increase monotonically; the buffer offset of a counter is its value modulo
+ * the (power of two) capacity.
+ */
+typedef struct launcher_output_source {
+    /** Source file descriptor. Closed by the reader on end-of-file. */
+    int fd;
+
+    /** FIFO write end held open until the stream is stopped, or -1. */
+    int keepaliveFD;
+
+    /** Ring buffer. */
+    uint8_t *buffer;
+
+    /** Ring buffer capacity, in bytes. A power of two. */
+    size_t capacity;
+
+    /** Total bytes produced. Written only by the reader. */
+    volatile int64_t head;
+
+    /** Total bytes consumed. Written only by the writer. */
+    volatile int64_t tail;
+
+    /** Total bytes dropped. Written only by the reader. */
+    volatile int64_t dropped;
+
+    /** Total dropped bytes reported to the destination. Accessed only by the writer. */
+    int64_t reportedDrops;
+
+    /** Non-zero once the reader has reached end-of-file. */
+    volatile uint32_t finished;
+
+    /** Signaled by the writer when buffer space has been freed. */
+    dispatch_semaphore_t spaceAvailable;
+} launcher_output_source_t;
+
+@interface LauncherOutputStream (PrivateMethods)
+- (void) readSource: (launcher_output_source_t *) source;
+- (BOOL) writeBuffers: (struct iovec *) iov count: (int) iovcnt;
+- (void) runWriter;
+@end
+
+/* Write all of @a iovcnt buffers to @a fd, handling short writes. Returns 0 on success, or an errno value. */
+static int output_write_fully (int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+
+        /* Skip the fully written buffers, and advance into the partially written buffer */
+        while (iovcnt > 0 && (size_t) written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+/* Return @a value rounded up to the next power of two */
+static size_t output_round_pow2 (size_t value) {
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+/**
+ * Streams output from one or more file descriptors -- such as the pipes or FIFOs connected to a simulated
+ * application's stdout and stderr -- to a destination file or socket.
+ *
+ * Each source is read on its own thread into a lock-free ring buffer, and a single writer thread drains all
+ * buffers to the destination. The writer issues one write per source for all output available at the time,
+ * so that a high volume of small writes by the producer results in a small number of large destination writes.
+ *
+ * If the destination can not keep up, the ring buffers fill, and the sources stop reading from their producers
+ * for up to backpressureTimeout; producers writing to a full pipe will block. Output that can not be buffered
+ * after the timeout is dropped, and the number of dropped bytes is reported inline in the destination.
+ *
+ * Output from different sources is interleaved at write boundaries.
+ *
+ * @par Thread Safety
+ * Configuration, start and stop must be serialized. The statistics properties may be read from any thread.
+ */
+@implementation LauncherOutputStream
+
+@synthesize backpressureTimeout = _backpressureTimeout;
+
+/**
+ * Return a new stream writing to @a path. If @a path names a UNIX domain socket, the stream connects to it;
+ * otherwise, a file is created (or truncated) at @a path.
+ *
+ * @param path The destination path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
++ (id) streamWithDestinationPath: (NSString *) path error: (NSError **) outError {
+    const char *fsPath = [path fileSystemRepresentation];
+    struct stat sb;
+    int fd;
+
+    if (stat(fsPath, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        if (strlen(fsPath) >= sizeof(addr.sun_path)) {
+            if (outError != NULL)
+                *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: ENAMETOOLONG userInfo: nil];
+            return nil;
+        }
+        strlcpy(addr.sun_path, fsPath, sizeof(addr.sun_path));
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+            if (outError != NULL)
+                *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+            if (fd >= 0)
+                close(fd);
+            return nil;
+        }
+
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    } else {
+        fd = open(fsPath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (fd < 0) {
+            if (outError != NULL)
+                *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+            return nil;
+        }
+    }
+
+    return [[self alloc] initWithFileDescriptor: fd capacity: LAUNCHER_OUTPUT_STREAM_DEFAULT_CAPACITY];
+}
+
+/**
+ * Initialize a new stream.
+ *
+ * @param fd The destination file descriptor. The stream takes ownership of the descriptor, and closes it when stopped.
+ * @param capacity The ring buffer capacity of each source, in bytes. Rounded up to a power of two.
+ */
+- (id) initWithFileDescriptor: (int) fd capacity: (size_t) capacity {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _destination = fd;
+    _capacity = output_round_pow2(MAX(capacity, (size_t) 1024));
+    _backpressureTimeout = 0.5;
+
+    _sources = calloc(LAUNCHER_OUTPUT_STREAM_MAX_SOURCES, sizeof(launcher_output_source_t));
+    _dataAvailable = dispatch_semaphore_create(0);
+    _group = dispatch_group_create();
+
+    return self;
+}
+
+- (void) dealloc {
+    /* A started stream must be drained; one that was never started only needs its descriptors closed */
+    if (_started) {
+        [self stop];
+    } else {
+        for (NSUInteger i = 0; i < _sourceCount; i++) {
+            close(_sources[i].fd);
+            if (_sources[i].keepaliveFD >= 0)
+                close(_sources[i].keepaliveFD);
+        }
+
+        if (_destination >= 0)
+            close(_destination);
+    }
+
+    for (NSUInteger i = 0; i < _sourceCount; i++) {
+        free(_sources[i].buffer);
+        dispatch_release(_sources[i].spaceAvailable);
+    }
+    free(_sources);
+
+    dispatch_release(_dataAvailable);
+    dispatch_release(_group);
+}
+
+/**
+ * Add a source. Must be called before the stream is started.
+ *
+ * @param fd The source file descriptor. The stream takes ownership of the descriptor, and closes it on end-of-file.
+ * @return Returns YES on success, or NO if the stream has been started or the maximum number of sources has been added.
+ */
+- (BOOL) addSourceWithFileDescriptor: (int) fd {
+    if (_started || _sourceCount == LAUNCHER_OUTPUT_STREAM_MAX_SOURCES)
+        return NO;
+
+    launcher_output_source_t *source = &_sources[_sourceCount++];
+    source->fd = fd;
+    source->keepaliveFD = -1;
+    source->capacity = _capacity;
+    source->buffer = malloc(_capacity);
+    source->spaceAvailable = dispatch_semaphore_create(0);
+
+    return YES;
+}
+
+/**
+ * Create a FIFO at @a path, and add it as a source. Must be called before the stream is started.
+ *
+ * The FIFO is held open for writing until the stream is stopped, such that producers may open and close it
+ * at any time without the source reaching end-of-file; eg, a simulated application's stdout path.
+ *
+ * @param path The FIFO path. If a FIFO already exists at this path, it will be used.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (BOOL) addFIFOSourceAtPath: (NSString *) path error: (NSError **) outError {
+    const char *fsPath = [path fileSystemRepresentation];
+
+    if (_started || _sourceCount == LAUNCHER_OUTPUT_STREAM_MAX_SOURCES) {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: EINVAL userInfo: nil];
+        return NO;
+    }
+
+    if (mkfifo(fsPath, S_IRUSR | S_IWUSR) != 0 && errno != EEXIST) {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+        return NO;
+    }
+
+    /* Opening the read end blocks until a writer is available; open it non-blocking, and then supply our own writer */
+    int fd = open(fsPath, O_RDONLY | O_NONBLOCK);
+    int keepalive = (fd >= 0) ? open(fsPath, O_WRONLY | O_NONBLOCK) : -1;
+    if (fd < 0 || keepalive < 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) != 0) {
+        if (outError != NULL)
+            *outError = [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil];
+        if (fd >= 0)
+            close(fd);
+        if (keepalive >= 0)
+            close(keepalive);
+        return NO;
+    }
+
+    [self addSourceWithFileDescriptor: fd];
+    _sources[_sourceCount - 1].keepaliveFD = keepalive;
+
+    return YES;
+}
+
+/**
+ * Start reading from all sources, and writing to the destination. This is a single-shot operation.
+ */
+- (void) start {
+    if (_started)
+        return;
+    _started = YES;
+
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    /* Reads block on the producers; each source requires its own thread */
+    for (NSUInteger i = 0; i < _sourceCount; i++) {
+        launcher_output_source_t *source = &_sources[i];
+        dispatch_group_async(_group, queue, ^{
+            [self readSource: source];
+        });
+    }
+
+    dispatch_group_async(_group, queue, ^{
+        [self runWriter];
+    });
+}
+
+/**
+ * Wait for all sources to reach end-of-file and for all buffered output to be written, and then close the
+ * destination. Any FIFO sources are closed for writing, such that they will reach end-of-file once all other
+ * writers have closed them.
+ */
+- (void) stop {
+    if (!_started || _stopped)
+        return;
+    _stopped = YES;
+
+    for (NSUInteger i = 0; i < _sourceCount; i++) {
+        if (_sources[i].keepaliveFD >= 0) {
+            close(_sources[i].keepaliveFD);
+            _sources[i].keepaliveFD = -1;
+        }
+    }
+
+    dispatch_group_wait(_group, DISPATCH_TIME_FOREVER);
+
+    close(_destination);
+    _destination = -1;
+}
+
+// property getter
+- (uint64_t) bytesWritten {
+    return (uint64_t) __atomic_load_n(&_bytesWritten, __ATOMIC_SEQ_CST);
+}
+
+// property getter
+- (uint64_t) writeCount {
+    return (uint64_t) __atomic_load_n(&_writeCount, __ATOMIC_SEQ_CST);
+}
+
+// property getter
+- (uint64_t) droppedByteCount {
+    int64_t total = __atomic_load_n(&_discardedByteCount, __ATOMIC_SEQ_CST);
+    for (NSUInteger i = 0; i < _sourceCount; i++)
+        total += __atomic_load_n(&_sources[i].dropped, __ATOMIC_SEQ_CST);
+
+    return (uint64_t) total;
+}
+
+// property getter
+- (int) destinationError {
+    return __atomic_load_n(&_destinationError, __ATOMIC_SEQ_CST);
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherOutputStream (PrivateMethods)
+
+/**
+ * Read @a source until end-of-file, appending its output to the source's ring buffer.
+ */
+- (void) readSource: (launcher_output_source_t *) source {
+    uint8_t *discard = malloc(DROP_BUFFER_SIZE);
+    size_t mask = source->capacity - 1;
+    BOOL dropping = NO;
+
+    dispatch_time_t (^Deadline)(void) = ^dispatch_time_t {
+        if (_backpressureTimeout < 0)
+            return DISPATCH_TIME_FOREVER;
+        return dispatch_time(DISPATCH_TIME_NOW, (int64_t) (_backpressureTimeout * NSEC_PER_SEC));
+    };
+
+    for (;;) {
+        int64_t head = source->head;
+        size_t used = (size_t) (head - __atomic_load_n(&source->tail, __ATOMIC_SEQ_CST));
+        size_t available = source->capacity - used;
+        ssize_t nread;
+
+        if (available == 0) {
+            /* Apply backpressure by not reading, until space is freed or the timeout elapses */
+            if (!dropping) {
+                if (dispatch_semaphore_wait(source->spaceAvailable, Deadline()) != 0)
+                    dropping = YES;
+                continue;
+            }
+
+            /* Drop output until space is available */
+            nread = read(source->fd, discard, DROP_BUFFER_SIZE);
+            if (nread > 0) {
+                __atomic_add_fetch(&source->dropped, nread, __ATOMIC_SEQ_CST);
+                dispatch_semaphore_signal(_dataAvailable);
+                continue;
+            }
+        } else {
+            /* Read directly into the contiguous free space following the head */
+            size_t offset = (size_t) head & mask;
+            dropping = NO;
+
+            nread = read(source->fd, source->buffer + offset, MIN(available, source->capacity - offset));
+            if (nread > 0) {
+                __atomic_add_fetch(&source->head, nread, __ATOMIC_SEQ_CST);
+                dispatch_semaphore_signal(_dataAvailable);
+                continue;
+            }
+        }
+
+        if (nread < 0 && errno == EINTR)
+            continue;
+
+        if (nread < 0)
+            NSLog(@"Output stream source read failed: %s", strerror(errno));
+        break;
+    }
+
+    close(source->fd);
+    free(discard);
+
+    __atomic_store_n(&source->finished, 1, __ATOMIC_SEQ_CST);
+    dispatch_semaphore_signal(_dataAvailable);
+}
+
+/**
+ * Write @a iovcnt buffers to the destination. Returns NO if the write fails, or a previous write has failed.
+ */
+- (BOOL) writeBuffers: (struct iovec *) iov count: (int) iovcnt {
+    if (_destinationError != 0)
+        return NO;
+
+    int err = output_write_fully(_destination, iov, iovcnt);
+    if (err != 0) {
+        NSLog(@"Output stream destination write failed, discarding further output: %s", strerror(err));
+        int32_t noError = 0;
+        __atomic_compare_exchange_n(&_destinationError, &noError, err, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        return NO;
+    }
+
+    __atomic_add_fetch(&_writeCount, 1, __ATOMIC_SEQ_CST);
+    return YES;
+}
+
+/**
+ * Drain all sources to the destination until every source has finished.
+ */
+- (void) runWriter {
+    for (;;) {
+        BOOL progress = NO;
+        BOOL finished = YES;
+
+        for (NSUInteger i = 0; i < _sourceCount; i++) {
+            launcher_output_source_t *source = &_sources[i];
+
+            /* The finished flag must be read before the head; once set, the head is final */
+            BOOL sourceFinished = __atomic_load_n(&source->finished, __ATOMIC_SEQ_CST) != 0;
+            int64_t head = __atomic_load_n(&source->head, __ATOMIC_SEQ_CST);
+            int64_t tail = source->tail;
+
+            /* Write everything available in a single batch; the readable region may wrap */
+            if (head > tail) {
+                size_t mask = source->capacity - 1;
+                size_t offset = (size_t) tail & mask;
+                size_t length = (size_t) (head - tail);
+                size_t first = MIN(length, source->capacity - offset);
+
+                struct iovec iov[2];
+                iov[0].iov_base = source->buffer + offset;
+                iov[0].iov_len = first;
+                iov[1].iov_base = source->buffer;
+                iov[1].iov_len = length - first;
+
+                if ([self writeBuffers: iov count: (length > first) ? 2 : 1])
+                    __atomic_add_fetch(&_bytesWritten, length, __ATOMIC_SEQ_CST);
+                else
+                    __atomic_add_fetch(&_discardedByteCount, length, __ATOMIC_SEQ_CST);
+
+                __atomic_add_fetch(&source->tail, length, __ATOMIC_SEQ_CST);
+                dispatch_semaphore_signal(source->spaceAvailable);
+                progress = YES;
+            }
+
+            /* Report any newly dropped output */
+            int64_t dropped = __atomic_load_n(&source->dropped, __ATOMIC_SEQ_CST);
+            if (dropped > source->reportedDrops) {
+                char report[128];
+                int len = snprintf(report, sizeof(report), DROP_REPORT_FORMAT, (unsigned long long) (dropped - source->reportedDrops));
+                struct iovec iov = { .iov_base = report, .iov_len = (size_t) len };
+
+                /* Reports are not output; if they can not be written, they are not counted as dropped */
+                [self writeBuffers: &iov count: 1];
+
+                source->reportedDrops = dropped;
+                progress = YES;
+            }
+
+            if (!sourceFinished || source->reportedDrops != __atomic_load_n(&source->dropped, __ATOMIC_SEQ_CST))
+                finished = NO;
+        }
+
+        if (finished && !progress)
+            break;
+
+        if (!progress)
+            dispatch_semaphore_wait(_dataAvailable, DISPATCH_TIME_FOREVER);
+    }
+}
+
+@end
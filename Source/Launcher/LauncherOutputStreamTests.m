@@ -0,0 +1,134 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "LauncherOutputStream.h"
+
+/* Number of lines written by the producer process */
+#define PRODUCER_LINE_COUNT 200000
+
+@interface LauncherOutputStreamTests : PLTestCase
+@end
+
+@implementation LauncherOutputStreamTests
+
+/* Return the output expected from the producer process */
+- (NSData *) expectedOutput {
+    NSMutableString *expected = [NSMutableString string];
+    for (int i = 1; i <= PRODUCER_LINE_COUNT; i++)
+        [expected appendFormat: @"%d\n", i];
+
+    return [expected dataUsingEncoding: NSUTF8StringEncoding];
+}
+
+/* Return a stand-in process that writes PRODUCER_LINE_COUNT lines as quickly as possible */
+- (NSTask *) producer {
+    NSTask *task = [NSTask new];
+    [task setLaunchPath: @"/usr/bin/jot"];
+    [task setArguments: [NSArray arrayWithObject: [NSString stringWithFormat: @"%d", PRODUCER_LINE_COUNT]]];
+    return task;
+}
+
+/* With unbounded backpressure, no output may be lost, even through a buffer far smaller than the output */
+- (void) testLossless {
+    NSError *error;
+    NSString *destPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"output.log"];
+    LauncherOutputStream *stream = [LauncherOutputStream streamWithDestinationPath: destPath error: &error];
+    STAssertNotNil(stream, @"Could not create stream: %@", error);
+    stream.backpressureTimeout = -1;
+
+    /* Feed the stream via a FIFO, as with a simulated application's stdout */
+    NSString *fifoPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"stdout"];
+    STAssertTrue([stream addFIFOSourceAtPath: fifoPath error: &error], @"Could not add FIFO source: %@", error);
+    [stream start];
+
+    NSFileHandle *fifo = [NSFileHandle fileHandleForWritingAtPath: fifoPath];
+    NSTask *task = [self producer];
+    [task setStandardOutput: fifo];
+    [task launch];
+    [fifo closeFile];
+    [task waitUntilExit];
+
+    [stream stop];
+
+    NSData *expected = [self expectedOutput];
+    STAssertEquals(stream.droppedByteCount, (uint64_t) 0, @"Output was dropped");
+    STAssertEquals(stream.bytesWritten, (uint64_t) [expected length], @"Incorrect byte count");
+    STAssertTrue([[NSData dataWithContentsOfFile: destPath] isEqualToData: expected], @"Output was not preserved");
+
+    /* Writes must be batched */
+    STAssertTrue(stream.writeCount < PRODUCER_LINE_COUNT / 10, @"Writes were not batched: %llu writes", stream.writeCount);
+}
+
+/* If the destination stalls, output must be dropped rather than blocking the producer indefinitely, and the drops reported */
+- (void) testDrops {
+    int dest[2];
+    STAssertEquals(pipe(dest), 0, @"Could not create destination pipe");
+
+    LauncherOutputStream *stream = [[LauncherOutputStream alloc] initWithFileDescriptor: dest[1] capacity: 4096];
+    stream.backpressureTimeout = 0.01;
+
+    NSPipe *pipe = [NSPipe pipe];
+    STAssertTrue([stream addSourceWithFileDescriptor: dup([[pipe fileHandleForReading] fileDescriptor])], @"Could not add source");
+    [[pipe fileHandleForReading] closeFile];
+    [stream start];
+
+    /* The destination is not read until the producer has finished */
+    NSTask *task = [self producer];
+    [task setStandardOutput: [pipe fileHandleForWriting]];
+    [task launch];
+    [[pipe fileHandleForWriting] closeFile];
+    [task waitUntilExit];
+
+    NSMutableData *output = [NSMutableData data];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        uint8_t buffer[16384];
+        ssize_t nread;
+        while ((nread = read(dest[0], buffer, sizeof(buffer))) > 0)
+            [output appendBytes: buffer length: nread];
+    });
+
+    [stream stop];
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    dispatch_release(group);
+    close(dest[0]);
+
+    /* Everything produced was either written or dropped */
+    uint64_t expectedLength = [[self expectedOutput] length];
+    STAssertTrue(stream.droppedByteCount > 0, @"No output was dropped");
+    STAssertEquals(stream.bytesWritten + stream.droppedByteCount, expectedLength, @"Output was lost without being reported");
+
+    /* The drops must be reported inline */
+    NSString *text = [[NSString alloc] initWithData: output encoding: NSUTF8StringEncoding];
+    STAssertTrue([text rangeOfString: @"bytes of output dropped]"].location != NSNotFound, @"Drops were not reported");
+    STAssertTrue([output length] > stream.bytesWritten, @"Drop reports were not written");
+}
+
+@end
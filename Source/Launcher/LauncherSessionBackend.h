@@ -0,0 +1,141 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLSimulator.h"
+
+@protocol LauncherSessionBackend;
+
+extern NSString *LauncherSessionErrorDomain;
+
+/**
+ * Simulator session configuration.
+ */
+@interface LauncherSessionConfig : NSObject {
+@private
+    /** Absolute path to the application to be launched. */
+    NSString *_applicationPath;
+
+    /** The SDK version to use, or nil to use the default SDK root. */
+    NSString *_sdkVersion;
+
+    /** The device family to simulate, or nil to use the default. */
+    PLSimulatorDeviceFamily *_deviceFamily;
+
+    /** Application launch arguments. */
+    NSArray *_launchArguments;
+
+    /** Application launch environment. */
+    NSDictionary *_launchEnvironment;
+
+    /** Path to which the application's stdout is written, or nil. */
+    NSString *_stdoutPath;
+
+    /** Path to which the application's stderr is written, or nil. */
+    NSString *_stderrPath;
+}
+
+/** Absolute path to the application to be launched. */
+@property(nonatomic, copy) NSString *applicationPath;
+
+/** The SDK version to use, or nil to use the default SDK root. */
+@property(nonatomic, copy) NSString *sdkVersion;
+
+/** The device family to simulate, or nil to use the default. */
+@property(nonatomic, strong) PLSimulatorDeviceFamily *deviceFamily;
+
+/** Application launch arguments. Defaults to an empty array. */
+@property(nonatomic, copy) NSArray *launchArguments;
+
+/** Application launch environment. Defaults to an empty dictionary. */
+@property(nonatomic, copy) NSDictionary *launchEnvironment;
+
+/** Path to which the application's stdout is written (eg, a FIFO), or nil to discard it. Defaults to nil. */
+@property(nonatomic, copy) NSString *stdoutPath;
+
+/** Path to which the application's stderr is written (eg, a FIFO), or nil to discard it. Defaults to nil. */
+@property(nonatomic, copy) NSString *stderrPath;
+
+@end
+
+/**
+ * Receives simulator session state changes from a LauncherSessionBackend.
+ */
+@protocol LauncherSessionBackendDelegate <NSObject>
+
+/**
+ * Sent once a requested session has started, or failed to start.
+ *
+ * @param backend The sending backend.
+ * @param started YES if the session started.
+ * @param error If the session did not start, an error describing the failure.
+ */
+- (void) sessionBackend: (id<LauncherSessionBackend>) backend didStart: (BOOL) started withError: (NSError *) error;
+
+/**
+ * Sent when a started session ends.
+ *
+ * @param backend The sending backend.
+ * @param error The error that ended the session, if any.
+ */
+- (void) sessionBackend: (id<LauncherSessionBackend>) backend didEndWithError: (NSError *) error;
+
+@end
+
+/**
+ * Starts simulator sessions on behalf of a LauncherSimClient.
+ */
+@protocol LauncherSessionBackend <NSObject>
+
+/**
+ * Prepare the backend to start sessions using @a platform. This may be called multiple times; once a platform
+ * has been loaded, subsequent calls should return immediately.
+ *
+ * @param platform The simulator platform.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) loadPlatform: (PLSimulatorPlatform *) platform error: (NSError **) outError;
+
+/**
+ * Request that a session be started with @a config. On success, the delegate will be sent
+ * LauncherSessionBackendDelegate::sessionBackend:didStart:withError: once the session has started or failed.
+ *
+ * @param config The session configuration.
+ * @param timeout Maximum time to wait for the session to start, in seconds.
+ * @param outError If an error occurs, upon return contains an NSError object with a localized description
+ * suitable for display.
+ * @return Returns YES if the session start was requested, or NO on failure.
+ */
+- (BOOL) startSessionWithConfig: (LauncherSessionConfig *) config timeout: (NSTimeInterval) timeout error: (NSError **) outError;
+
+/** Session delegate. */
+@property(weak) id<LauncherSessionBackendDelegate> delegate;
+
+@end
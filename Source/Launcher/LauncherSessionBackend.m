@@ -0,0 +1,66 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherSessionBackend.h"
+
+/** Session backend error domain */
+NSString *LauncherSessionErrorDomain = @"LauncherSessionErrorDomain";
+
+/**
+ * Simulator session configuration, as passed to a LauncherSessionBackend.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads.
+ */
+@implementation LauncherSessionConfig
+
+@synthesize applicationPath = _applicationPath;
+@synthesize sdkVersion = _sdkVersion;
+@synthesize deviceFamily = _deviceFamily;
+@synthesize launchArguments = _launchArguments;
+@synthesize launchEnvironment = _launchEnvironment;
+@synthesize stdoutPath = _stdoutPath;
+@synthesize stderrPath = _stderrPath;
+
+- (id) init {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _launchArguments = [NSArray array];
+    _launchEnvironment = [NSDictionary dictionary];
+
+    return self;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"<%@: %@ sdk=%@ family=%@>", [self class], _applicationPath,
+            _sdkVersion != nil ? _sdkVersion : @"default", _deviceFamily != nil ? _deviceFamily.localizedName : @"default"];
+}
+
+@end
@@ -0,0 +1,173 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherSimAgentBackend.h"
+#import "LauncherAgentProtocol.h"
+#import "LauncherSimClient.h"
+#import "LauncherDTSessionBackend.h"
+
+@interface LauncherSimAgentBackend (PrivateMethods)
+- (PLSimulatorPlatform *) platformForApplication: (PLSimulatorApplication *) app;
+@end
+
+/**
+ * A launcher agent backend that discovers the available simulator platforms once, loads the preferred platform's
+ * private frameworks ahead of the first request, and serves subsequent launches using the warm state.
+ *
+ * Private frameworks may only be loaded once per process. Requests for applications that require a different
+ * platform than the one already loaded are refused, and the requesting launcher falls back to launching
+ * in-process.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads. Must be used from the main thread.
+ */
+@implementation LauncherSimAgentBackend
+
+/**
+ * Begin platform discovery. Launch requests received before discovery has completed are deferred.
+ */
+- (void) start {
+    _pendingLaunches = [NSMutableArray array];
+    _activeClients = [NSMutableSet set];
+
+    /* Find all platforms. No application is known until the first request arrives, and the results are shared by
+     * every request, so requirements are matched per-request; discovery always includes the volume-wide search. */
+    NSSet *families = [NSSet setWithObjects: [PLSimulatorDeviceFamily iphoneFamily], [PLSimulatorDeviceFamily ipadFamily], nil];
+    _discovery = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: nil canonicalSDKName: nil deviceFamilies: families];
+    _discovery.delegate = self;
+    [_discovery startQuery];
+}
+
+// from PLSimulatorDiscoveryDelegate protocol
+- (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindMatchingSimulatorPlatforms: (NSArray *) platforms {
+    _platforms = platforms;
+    _discovery = nil;
+    NSLog(@"Launcher agent found %lu simulator platforms", (unsigned long) [platforms count]);
+
+    /* Warm up the preferred platform */
+    if ([_platforms count] > 0) {
+        NSError *error;
+        PLSimulatorPlatform *platform = [_platforms objectAtIndex: 0];
+        if ([platform loadPrivateFrameworks: &error]) {
+            _loadedPlatform = platform;
+        } else {
+            NSLog(@"Launcher agent could not preload private frameworks from %@: %@", platform.path, error);
+        }
+    }
+
+    /* Run any deferred launches */
+    NSArray *pending = _pendingLaunches;
+    _pendingLaunches = nil;
+    for (void (^launch)(void) in pending)
+        launch();
+}
+
+// from LauncherAgentBackend protocol
+- (void) agentServer: (LauncherAgentServer *) server
+    launchApplicationAtPath: (NSString *) path
+           deviceFamilyCode: (NSNumber *) deviceFamilyCode
+                 completion: (LauncherAgentCompletionBlock) completion
+{
+    /* Defer until discovery completes */
+    if (_platforms == nil) {
+        [_pendingLaunches addObject: [^{
+            [self agentServer: server launchApplicationAtPath: path deviceFamilyCode: deviceFamilyCode completion: completion];
+        } copy]];
+        return;
+    }
+
+    NSError *error;
+    PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: path error: &error];
+    if (app == nil) {
+        completion(NO, error);
+        return;
+    }
+
+    PLSimulatorPlatform *platform = [self platformForApplication: app];
+    if (platform == nil) {
+        completion(NO, launcher_agent_error(LauncherAgentErrorLaunchFailed, @"The iPhone SDK required by the application could not be found."));
+        return;
+    }
+
+    PLSimulatorDeviceFamily *family = nil;
+    if (deviceFamilyCode != nil)
+        family = [PLSimulatorDeviceFamily deviceFamilyForDeviceCode: [deviceFamilyCode intValue]];
+
+    LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: platform
+                                                                        app: app
+                                                        defaultDeviceFamily: family
+                                                                    backend: [LauncherDTSessionBackend new]];
+    [_activeClients addObject: client];
+
+    /* The client owns the session backend, which is the simulator session's (unretained) delegate; the client must
+     * be retained until its session ends */
+    __weak LauncherSimClient *weakClient = client;
+    client.sessionEndBlock = ^(NSError *error) {
+        if (weakClient != nil)
+            [_activeClients removeObject: weakClient];
+    };
+
+    [client launchWithCompletionBlock: ^(BOOL started, NSError *error) {
+        if (started) {
+            _loadedPlatform = platform;
+        } else {
+            /* No session will end; ignore any late end callback, and release the client once it has returned */
+            LauncherSimClient *failedClient = weakClient;
+            failedClient.sessionEndBlock = nil;
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (failedClient != nil)
+                    [_activeClients removeObject: failedClient];
+            });
+        }
+
+        completion(started, error);
+    }];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherSimAgentBackend (PrivateMethods)
+
+/**
+ * Return the preferred discovered platform that supports @a app, or nil if none is available. Platforms that
+ * include the application's own SDK are preferred over those with only a compatible newer SDK. Once private
+ * frameworks have been loaded, only the loaded platform is considered.
+ */
+- (PLSimulatorPlatform *) platformForApplication: (PLSimulatorApplication *) app {
+    NSArray *candidates = (_loadedPlatform != nil) ? [NSArray arrayWithObject: _loadedPlatform] : _platforms;
+    NSArray *matches = [PLSimulatorDiscovery platformsCompatibleWithApplication: app fromPlatforms: candidates];
+    if ([matches count] == 0)
+        return nil;
+
+    return [matches objectAtIndex: 0];
+}
+
+@end
@@ -1,7 +1,7 @@
 /*
  * Author: Landon Fuller <landonf@plausiblelabs.com>
  *
- * Copyright (c) 2010 Plausible Labs Cooperative, Inc.
+ * Copyright (c) 2008-2010 Plausible Labs Cooperative, Inc.
  * All rights reserved.
  *
  * Permission is hereby granted, free of charge, to any person
@@ -29,10 +29,12 @@
 #import <Cocoa/Cocoa.h>
 #import "PLSimulator.h"
 
-#import "iPhoneSimulatorRemoteClient.h"
-#import "SimulatorHost.h"
+#import "LauncherSessionBackend.h"
+#import "LauncherOutputStream.h"
 
-@interface LauncherSimClient : NSObject <DTiPhoneSimulatorSessionDelegate> {
+extern NSString *LauncherSimClientErrorDomain;
+
+@interface LauncherSimClient : NSObject <LauncherSessionBackendDelegate> {
 @private
     /** Platform to use for launching. */
     PLSimulatorPlatform *_platform;
@@ -42,12 +44,55 @@
 
     /** The device family to use by default, or nil if none specified. */
     PLSimulatorDeviceFamily *_defaultDeviceFamily;
+
+    /** The SDK version to launch with, or nil to use the SDK the application was built with. */
+    NSString *_sdkVersion;
+
+    /** The session backend. */
+    id<LauncherSessionBackend> _backend;
+
+    /** Block to be called on completion, or nil if the launcher should terminate on completion. */
+    void (^_completionBlock)(BOOL started, NSError *error);
+
+    /** Stream to which the application's output is written, or nil. */
+    LauncherOutputStream *_outputStream;
+
+    /** Temporary directory containing the output FIFOs, or nil. */
+    NSString *_outputDirectory;
+
+    /** If YES, the launcher will terminate once the simulator session ends. */
+    BOOL _terminatesOnSessionEnd;
+
+    /** Block to be called once a started session ends, or nil. */
+    void (^_sessionEndBlock)(NSError *error);
 }
 
 - (id) initWithPlatform: (PLSimulatorPlatform *) platform
                     app: (PLSimulatorApplication *) app 
-    defaultDeviceFamily: (PLSimulatorDeviceFamily *) defaultDeviceFamily;
+    defaultDeviceFamily: (PLSimulatorDeviceFamily *) defaultDeviceFamily
+                backend: (id<LauncherSessionBackend>) backend;
 
 - (void) launch;
+- (void) launchWithCompletionBlock: (void (^)(BOOL started, NSError *error)) block;
+
+/**
+ * The platform SDK version to launch with (eg, 6.0), or nil to use the SDK the application was built with.
+ * Defaults to nil.
+ */
+@property(nonatomic, copy) NSString *sdkVersion;
+
+/**
+ * A stream to which the application's stdout and stderr will be written, or nil to discard the application's output.
+ * If set, and no completion block was provided, the launcher remains running until the simulator session ends.
+ * The stream must not have been started. Defaults to nil.
+ */
+@property(nonatomic, strong) LauncherOutputStream *outputStream;
+
+/**
+ * A block to be called once a successfully started simulator session ends, or nil. The block is called after the
+ * session backend has finished with the session; the receiver may be released from within the block.
+ * Defaults to nil.
+ */
+@property(nonatomic, copy) void (^sessionEndBlock)(NSError *error);
 
 @end
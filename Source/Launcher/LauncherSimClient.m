@@ -28,30 +28,34 @@
 
 #import "LauncherSimClient.h"
 
-#import <ScriptingBridge/ScriptingBridge.h>
+/* Maximum time to wait for the simulator session to start, in seconds */
+#define SESSION_START_TIMEOUT 30.0
 
-/* App bundle ID. Used to request that the simulator be brought to the foreground */
-#define SIM_APP_BUNDLE_ID @"com.apple.iphonesimulator"
-
-/* Load a class from the runtime-loaded iPhoneSimulatorRemoteClient framework */
-#define C(name) NSClassFromString(@"" #name)
+/** Launcher simulator client error domain */
+NSString *LauncherSimClientErrorDomain = @"LauncherSimClientErrorDomain";
 
 /**
- * Implements loading of the iPhoneSimulatorRemoteClient framework and attempts
- * to launch a given simulator application.
+ * Implements launching of a given simulator application, using a LauncherSessionBackend to
+ * start the simulator session.
  */
 @implementation LauncherSimClient
 
+@synthesize sdkVersion = _sdkVersion;
+@synthesize outputStream = _outputStream;
+@synthesize sessionEndBlock = _sessionEndBlock;
+
 /**
  * Initialize with the given simulator platform and application.
  *
  * @param platform Platform to use for launching.
  * @param app Application to be launched.
  * @param defaultDeviceFamily The device family to use by default, or nil if none specified.
+ * @param backend The backend used to start the simulator session; eg, LauncherDTSessionBackend.
  */
 - (id) initWithPlatform: (PLSimulatorPlatform *) platform
                     app: (PLSimulatorApplication *) app 
     defaultDeviceFamily: (PLSimulatorDeviceFamily *) defaultDeviceFamily
+                backend: (id<LauncherSessionBackend>) backend
 {
     if ((self = [super init]) == nil)
         return nil;
@@ -59,16 +63,27 @@
     _platform = platform;
     _app = app;
     _defaultDeviceFamily = defaultDeviceFamily;
+    _backend = backend;
 
     return self;
 }
 
 /**
- * Display a launch error alert and request program termination.
+ * Report a launch failure. If a completion block was provided, it is called with an error containing
+ * @a text; otherwise, a launch error alert is displayed and program termination is requested.
  * 
  * @param text Informative text.
  */
 - (void) displayLaunchError: (NSString *) text {
+    if (_completionBlock != nil) {
+        NSDictionary *userInfo = [NSDictionary dictionaryWithObject: text forKey: NSLocalizedDescriptionKey];
+        void (^block)(BOOL, NSError *) = _completionBlock;
+        _completionBlock = nil;
+
+        block(NO, [NSError errorWithDomain: LauncherSimClientErrorDomain code: 1 userInfo: userInfo]);
+        return;
+    }
+
     NSAlert *alert = [NSAlert new];
     [alert setMessageText: NSLocalizedString(@"Could not launch the iPad/iPhone application.", @"Launch failure alert title")];
     [alert setInformativeText: text];
@@ -77,145 +92,154 @@
     [[NSApplication sharedApplication] terminate: self];
 }
 
+/**
+ * Create FIFOs for the application's stdout and stderr, and start streaming them to the output stream.
+ *
+ * @param config The session configuration to be populated with the FIFO paths.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (BOOL) startOutputStreamWithConfig: (LauncherSessionConfig *) config error: (NSError **) outError {
+    _outputDirectory = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    if (![[NSFileManager defaultManager] createDirectoryAtPath: _outputDirectory withIntermediateDirectories: YES attributes: nil error: outError])
+        return NO;
+
+    config.stdoutPath = [_outputDirectory stringByAppendingPathComponent: @"stdout"];
+    config.stderrPath = [_outputDirectory stringByAppendingPathComponent: @"stderr"];
+
+    if (![_outputStream addFIFOSourceAtPath: config.stdoutPath error: outError])
+        return NO;
+
+    if (![_outputStream addFIFOSourceAtPath: config.stderrPath error: outError])
+        return NO;
+
+    [_outputStream start];
+    return YES;
+}
+
+/**
+ * Wait for all of the application's output to be written, and remove the output FIFOs.
+ */
+- (void) finishOutputStream {
+    if (_outputDirectory == nil)
+        return;
+
+    [_outputStream stop];
+    if (_outputStream.droppedByteCount > 0)
+        NSLog(@"Dropped %llu bytes of application output", _outputStream.droppedByteCount);
+
+    [[NSFileManager defaultManager] removeItemAtPath: _outputDirectory error: NULL];
+    _outputDirectory = nil;
+}
+
 /**
  * Attempt to launch the application. This is a single-shot operation, and the application
  * will terminate on error.
  */
 - (void) launch {
-    DTiPhoneSimulatorApplicationSpecifier *appSpec;
-    DTiPhoneSimulatorSystemRoot *sdkRoot;
-    DTiPhoneSimulatorSessionConfig *config;
-    DTiPhoneSimulatorSession *session;
+    [self launchWithCompletionBlock: nil];
+}
+
+/**
+ * Attempt to launch the application. This is a single-shot operation.
+ *
+ * @param block If non-nil, called on completion instead of terminating the application. Errors are
+ * reported to the block rather than displayed.
+ */
+- (void) launchWithCompletionBlock: (void (^)(BOOL started, NSError *error)) block {
     NSError *error;
-    
-    /* Load the framework */
-    if (![_platform loadPrivateFrameworks: &error]) {
-        NSLog(@"Failed to load private Simulator frameworks: %@", error);
-        [self displayLaunchError: NSLocalizedString(@"A failure occured loading the Simulator's private frameworks.",
-                                                    @"Failed to load private framework alert text")];
-    }
-    
-    
-    /* Find and load all Xcode platform SDKs; without this, the iPhoneSimulatorRemoteClient API will be unable to locate
-     * SDK roots via DTiPhoneSimulatorSystemRoot. */
-    if (![C(DVTPlatform) loadAllPlatformsReturningError: &error]) {
-        NSLog(@"Failed to load platform SDKs: %@", error);
-        return;
-    }
 
-    /* Create the app specifier */
-    appSpec = [C(DTiPhoneSimulatorApplicationSpecifier) specifierWithApplicationPath: _app.path];
-    if (appSpec == nil) {
-        NSLog(@"Could not load application specification for %@\n", _app.path);
-    
-        NSString *text = NSLocalizedString(@"The iPhone application specification could not be loaded. This launcher may be misconfigured.", 
-                                           @"App load failure");
-        [self displayLaunchError: text];
+    _completionBlock = [block copy];
+    _backend.delegate = self;
+
+    /* Prepare the backend */
+    if (![_backend loadPlatform: _platform error: &error]) {
+        [self displayLaunchError: [error localizedDescription]];
         return;
     }
 
-    NSLog(@"App Spec: %@\n", appSpec);
-
-    /* Fetch the SDK to be used */
+    /* Fetch the SDK to be used. If no version was explicitly requested, prefer the application's own SDK, falling
+     * back on a compatible newer SDK. */
     PLSimulatorSDK *sdk = nil;
-    for (PLSimulatorSDK *anSDK in _platform.sdks) {
-        if ([anSDK.canonicalName isEqual: _app.canonicalSDKName]) {
-            sdk = anSDK;
-            break;
+    if (_sdkVersion != nil) {
+        for (PLSimulatorSDK *anSDK in _platform.sdks) {
+            if ([anSDK.version isEqual: _sdkVersion]) {
+                sdk = anSDK;
+                break;
+            }
         }
+    } else {
+        sdk = [_app preferredSDKFromPlatform: _platform];
     }
 
-    /* Load the SDK root */
-    if (sdk != nil) {
-        sdkRoot = [C(DTiPhoneSimulatorSystemRoot) rootWithSDKVersion: sdk.version];
-        if (sdkRoot == nil) {
-            NSString *fmt = NSLocalizedString(@"The iPhoneSimulator %@ SDK was not found. Please install the SDK and try again.",
-                                              @"SDK load failure alert info");
-            NSLog(@"Can't find SDK system root for version %@\n", sdk.version);
-            [self displayLaunchError: [NSString stringWithFormat: fmt, sdk.version]];
-            return;
-        }
-    } else {
-        sdkRoot = [C(DTiPhoneSimulatorSystemRoot) defaultRoot];
+    /* An explicitly requested SDK must be available */
+    if (_sdkVersion != nil && sdk == nil) {
+        NSString *fmt = NSLocalizedString(@"The iPhone %@ SDK could not be found.", @"Requested SDK not found");
+        [self displayLaunchError: [NSString stringWithFormat: fmt, _sdkVersion]];
+        return;
     }
-    
-    NSLog(@"SDK Root: %@\n", sdkRoot);
-    
+
     /* Set up the session configuration */
-    config = [[C(DTiPhoneSimulatorSessionConfig) alloc] init];
-    [config setApplicationToSimulateOnStart: appSpec];
-    [config setSimulatedSystemRoot: sdkRoot];
-    [config setSimulatedApplicationShouldWaitForDebugger: NO];
-    
-    [config setSimulatedApplicationLaunchArgs: [NSArray array]];
-    [config setSimulatedApplicationLaunchEnvironment: [NSDictionary dictionary]];
-
-    /* Configure the target device info */
-    {
-        ISHDeviceVersions *deviceVersions = [C(ISHDeviceVersions) sharedInstance];
-        DTiPhoneSimulatorFamily productType;
-
-        /*
-         * Determine best available product type. The ISHDeviceVersions product type seems to be based on,
-         * and use the same constant values as, the DTiPhoneSimulatorFamily constants
-         */
-        NSArray *productTypes = [deviceVersions productTypes];
-        if (_defaultDeviceFamily != nil && [productTypes containsObject: @(_defaultDeviceFamily.deviceFamilyCode)]) {
-            productType = _defaultDeviceFamily.deviceFamilyCode;
-        } else {
-            productType = DTiPhoneSimulatoriPhoneFamily;
-        }
-        
-        /*
-         * Map to a device info instance.
-         * TODO: This is where we could properly support 1x, 2x, 32-bit, and 64-bit, but doing so requires that we have a way
-         * to pass these configuration items to the launcher. For now, we hard code the device info selection.
-         */
-        NSString *deviceInfo;
-        switch (productType) {
-            case DTiPhoneSimulatoriPadFamily:
-                deviceInfo = [deviceVersions deviceInfoForProductType: productType displayScale: 1.0 displayHeight: 1024 wordSize: 4];
-                break;
-            case DTiPhoneSimulatoriPhoneFamily:
-                deviceInfo = [deviceVersions deviceInfoForProductType: productType displayScale: 2.0 displayHeight: 568 wordSize: 4];
-                break;
-        }
+    LauncherSessionConfig *config = [LauncherSessionConfig new];
+    config.applicationPath = _app.path;
+    config.sdkVersion = sdk.version;
+    config.deviceFamily = _defaultDeviceFamily;
 
-        [config setSimulatedDeviceInfoName: deviceInfo];
+    /* Stream the application's output, if requested */
+    if (_outputStream != nil && ![self startOutputStreamWithConfig: config error: &error]) {
+        [self finishOutputStream];
+        [self displayLaunchError: [error localizedDescription]];
+        return;
     }
 
-    [config setLocalizedClientName: @"SimLauncher"];
-
     /* Start the session */
-    session = [[C(DTiPhoneSimulatorSession) alloc] init];
-    [session setDelegate: self];
-    [session setSimulatedApplicationPID: [NSNumber numberWithInt: 35]];
-    
-    if (![session requestStartWithConfig: config timeout: 30.0 error: &error]) {
-        NSLog(@"Could not start simulator session: %@", error);
-
-        NSString *text = NSLocalizedString(@"The iPhone Simulator could not be started. If another Simulator application "
-                                           "is currently running, please close the Simulator and try again.", 
-                                           @"Simulator error alert info");
-        [self displayLaunchError: text];
+    if (![_backend startSessionWithConfig: config timeout: SESSION_START_TIMEOUT error: &error]) {
+        [self finishOutputStream];
+        [self displayLaunchError: [error localizedDescription]];
     }
 }
 
 
-// from DTiPhoneSimulatorSessionDelegate protocol
-- (void) session: (DTiPhoneSimulatorSession *) session didEndWithError: (NSError *) error {
+// from LauncherSessionBackendDelegate protocol
+- (void) sessionBackend: (id<LauncherSessionBackend>) backend didEndWithError: (NSError *) error {
     // Do we care about this?
     NSLog(@"Did end with error: %@", error);
+
+    /* If we remained running to stream the application's output, we can now exit */
+    [self finishOutputStream];
+    if (_terminatesOnSessionEnd)
+        [[NSApplication sharedApplication] terminate: self];
+
+    /* The block may release the receiver, along with the backend that is still sending this message; defer it until
+     * the backend has returned */
+    void (^block)(NSError *) = _sessionEndBlock;
+    _sessionEndBlock = nil;
+    if (block != nil) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            block(error);
+        });
+    }
 }
 
-// from DTiPhoneSimulatorSessionDelegate protocol
-- (void) session: (DTiPhoneSimulatorSession *) session didStart: (BOOL) started withError: (NSError *) error {
+// from LauncherSessionBackendDelegate protocol
+- (void) sessionBackend: (id<LauncherSessionBackend>) backend didStart: (BOOL) started withError: (NSError *) error {
     /* If the application starts successfully, we can exit */
     if (started) {
-        NSLog(@"Did start app %@ successfully, exiting", _app.path);
+        NSLog(@"Did start app %@ successfully", _app.path);
+
+        /* Report completion, if requested */
+        if (_completionBlock != nil) {
+            void (^block)(BOOL, NSError *) = _completionBlock;
+            _completionBlock = nil;
+
+            block(YES, nil);
+            return;
+        }
 
-        /* Bring simulator to foreground */
-        [[SBApplication applicationWithBundleIdentifier: SIM_APP_BUNDLE_ID] activate];
+        /* Remain running until the session ends, if streaming the application's output */
+        if (_outputStream != nil) {
+            _terminatesOnSessionEnd = YES;
+            return;
+        }
 
         /* Exit */
         [[NSApplication sharedApplication] terminate: self];
@@ -224,6 +248,7 @@
 
     /* Otherwise, an error occured. Inform the user. */
     NSLog(@"Simulator session did not start: %@", error);
+    [self finishOutputStream];
     NSString *text = NSLocalizedString(@"The iPhone Simulator could not be started. If another Simulator application "
                                        "is currently running, please close the Simulator and try again.", 
                                        @"Simulator error alert info");
@@ -0,0 +1,131 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+#import "PLSyntheticFixtures.h"
+
+#import "LauncherSimClient.h"
+#import "LauncherStubSessionBackend.h"
+
+@interface LauncherSimClientTests : PLTestCase {
+@private
+    /** Synthetic platform */
+    PLSimulatorPlatform *_platform;
+
+    /** Synthetic application */
+    PLSimulatorApplication *_app;
+}
+@end
+
+@implementation LauncherSimClientTests
+
+- (void) setUp {
+    _platform = [self platformWithName: @"Xcode" sdkVersions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    _app = [self applicationWithName: @"Test" canonicalSDKName: @"iphonesimulator6.0" deviceFamilies: [NSArray arrayWithObject: [NSNumber numberWithInt: 1]]];
+}
+
+/* Launch with @a backend, returning the completion error (or nil on success) */
+- (NSError *) launchWithBackend: (LauncherStubSessionBackend *) backend {
+    LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: _platform
+                                                                        app: _app
+                                                        defaultDeviceFamily: [PLSimulatorDeviceFamily ipadFamily]
+                                                                    backend: backend];
+
+    __block BOOL finished = NO;
+    __block NSError *result = nil;
+    [client launchWithCompletionBlock: ^(BOOL started, NSError *error) {
+        STAssertTrue(started == (error == nil), @"Completion should report an error iff the launch failed");
+        result = error;
+        finished = YES;
+    }];
+
+    [self spinRunloopWithTimeout: 5.0 predicate: ^BOOL{ return finished; }];
+    STAssertTrue(finished, @"Launch did not complete");
+
+    return result;
+}
+
+- (void) testLaunch {
+    LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+    backend.startLatency = 0.05;
+
+    NSError *error = [self launchWithBackend: backend];
+    STAssertNil(error, @"Launch failed: %@", error);
+    STAssertEquals(backend.sessionCount, (NSUInteger) 1, @"Session was not started");
+
+    /* The session must be configured from the application's requirements */
+    LauncherSessionConfig *config = backend.lastConfig;
+    STAssertEqualObjects(config.applicationPath, _app.path, @"Incorrect application path");
+    STAssertEqualObjects(config.sdkVersion, @"6.0", @"Incorrect SDK version");
+    STAssertEqualObjects(config.deviceFamily, [PLSimulatorDeviceFamily ipadFamily], @"Incorrect device family");
+}
+
+- (void) testInjectedFailures {
+    LauncherStubFailurePoint points[] = { LauncherStubFailureLoad, LauncherStubFailureStartRequest, LauncherStubFailureDidStart };
+
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+        LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+        backend.failurePoint = points[i];
+
+        STAssertNotNil([self launchWithBackend: backend], @"Launch should fail at stage %d", points[i]);
+        STAssertEquals(backend.sessionCount, (NSUInteger) 0, @"No session should have started");
+    }
+
+    /* A session that ends after starting is still a successful launch */
+    LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+    backend.failurePoint = LauncherStubFailureDidEnd;
+    STAssertNil([self launchWithBackend: backend], @"Launch should succeed");
+}
+
+- (void) testSessionEndBlock {
+    LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+    backend.failurePoint = LauncherStubFailureDidEnd;
+
+    LauncherSimClient *client = [[LauncherSimClient alloc] initWithPlatform: _platform
+                                                                        app: _app
+                                                        defaultDeviceFamily: [PLSimulatorDeviceFamily ipadFamily]
+                                                                    backend: backend];
+
+    __block BOOL started = NO;
+    __block BOOL ended = NO;
+    __block NSError *endError = nil;
+    client.sessionEndBlock = ^(NSError *error) {
+        STAssertTrue(started, @"Session ended before the launch completed");
+        endError = error;
+        ended = YES;
+    };
+    [client launchWithCompletionBlock: ^(BOOL success, NSError *error) {
+        started = success;
+    }];
+
+    [self spinRunloopWithTimeout: 5.0 predicate: ^BOOL{ return ended; }];
+    STAssertTrue(ended, @"Session end was not reported");
+    STAssertNotNil(endError, @"The injected session error was not reported");
+}
+
+@end
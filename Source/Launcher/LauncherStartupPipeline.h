@@ -0,0 +1,168 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLSimulator.h"
+#import "PLMemoryProfiler.h"
+#import "LauncherSessionBackend.h"
+#import "LauncherSimClient.h"
+
+@class LauncherStartupPipeline;
+
+extern NSString *LauncherStartupErrorDomain;
+
+/**
+ * Startup pipeline error codes.
+ */
+typedef enum {
+    /** The embedded application could not be loaded. */
+    LauncherStartupErrorInvalidApplication = 1,
+
+    /** No installed platform SDK satisfies the application's requirements. */
+    LauncherStartupErrorNoPlatform = 2,
+
+    /** The selected platform SDK could not be loaded by the session backend. */
+    LauncherStartupErrorPlatformLoad = 3
+} LauncherStartupErrorCode;
+
+/** Startup phase names, as used by LauncherStartupPipeline::phaseTimings. */
+extern NSString *LauncherStartupPhaseApplication;
+extern NSString *LauncherStartupPhaseDiscovery;
+extern NSString *LauncherStartupPhaseResolve;
+extern NSString *LauncherStartupPhaseSelect;
+extern NSString *LauncherStartupPhaseLaunch;
+
+/**
+ * Receives startup failures from a LauncherStartupPipeline. Messages are delivered on the main thread.
+ */
+@protocol LauncherStartupPipelineDelegate <NSObject>
+
+/**
+ * Called if startup fails before the launch client has been started. Once the launch client has
+ * been started, errors are reported by the client.
+ *
+ * @param pipeline The sender.
+ * @param error An error in the LauncherStartupErrorDomain describing the failure.
+ */
+- (void) startupPipeline: (LauncherStartupPipeline *) pipeline didFailWithError: (NSError *) error;
+
+@end
+
+@interface LauncherStartupPipeline : NSObject {
+@private
+    /** Path to the application to be launched. */
+    NSString *_appPath;
+
+    /** The device family to use by default, or nil if none specified. */
+    PLSimulatorDeviceFamily *_defaultDeviceFamily;
+
+    /** The session backend. */
+    id<LauncherSessionBackend> _backend;
+
+    /** Candidate platforms to use in place of discovery, or nil. */
+    NSArray *_candidatePlatforms;
+
+    /** Queue on which off-main phases are run. */
+    NSOperationQueue *_queue;
+
+    /** The loaded application, or nil. */
+    PLSimulatorApplication *_app;
+
+    /** Error from loading the application, or nil. */
+    NSError *_appError;
+
+    /** All discovered platforms, in order of preference, or nil. */
+    NSArray *_platforms;
+
+    /** The platform speculatively loaded during resolution, or nil. */
+    PLSimulatorPlatform *_resolvedPlatform;
+
+    /** Error from speculatively loading the resolved platform, or nil. */
+    NSError *_resolveError;
+
+    /** The selected platform, or nil. */
+    PLSimulatorPlatform *_platform;
+
+    /** The launch client, once started. */
+    LauncherSimClient *_client;
+
+    /** Pipeline start time. */
+    CFAbsoluteTime _startTime;
+
+    /** Phase name -> [start, end] offsets from the pipeline start, in seconds. Guarded by itself. */
+    NSMutableDictionary *_phases;
+
+    /** Memory profiler notified of each phase, or nil. */
+    PLMemoryProfiler *_memoryProfiler;
+
+    /** Stream to which the application's output is written, or nil. */
+    LauncherOutputStream *_outputStream;
+
+    /** Delegate. */
+    id<LauncherStartupPipelineDelegate> __weak _delegate;
+}
+
+- (id) initWithApplicationPath: (NSString *) path
+           defaultDeviceFamily: (PLSimulatorDeviceFamily *) defaultDeviceFamily
+                       backend: (id<LauncherSessionBackend>) backend;
+
+- (void) start;
+- (void) startWithCompletionBlock: (void (^)(BOOL started, NSError *error)) block;
+
+- (NSDictionary *) phaseTimings;
+- (NSString *) timingReport;
+
+/**
+ * Candidate platforms, in order of preference, to be used in place of Spotlight discovery; eg, for
+ * testing. Defaults to nil.
+ */
+@property(nonatomic, copy) NSArray *candidatePlatforms;
+
+/**
+ * If non-nil, the profiler is notified at the start and end of each phase, and its report is logged
+ * once the launch client has been started. Defaults to nil. Must be set before the pipeline is started.
+ */
+@property(nonatomic, strong) PLMemoryProfiler *memoryProfiler;
+
+/**
+ * If non-nil, the launched application's output is written to this stream; see LauncherSimClient::outputStream.
+ * Defaults to nil. Must be set before the pipeline is started.
+ */
+@property(nonatomic, strong) LauncherOutputStream *outputStream;
+
+/** The loaded application, or nil if not yet loaded. */
+@property(readonly) PLSimulatorApplication *application;
+
+/** The selected platform, or nil if not yet selected. */
+@property(readonly) PLSimulatorPlatform *platform;
+
+/** Pipeline delegate. */
+@property(weak) id<LauncherStartupPipelineDelegate> delegate;
+
+@end
@@ -0,0 +1,530 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherStartupPipeline.h"
+
+#import "PLSimulatorDiscovery.h"
+#import "PLSimulatorStats.h"
+
+/** Launcher startup error domain */
+NSString *LauncherStartupErrorDomain = @"LauncherStartupErrorDomain";
+
+NSString *LauncherStartupPhaseApplication = @"application";
+NSString *LauncherStartupPhaseDiscovery = @"discovery";
+NSString *LauncherStartupPhaseResolve = @"resolve";
+NSString *LauncherStartupPhaseSelect = @"select";
+NSString *LauncherStartupPhaseLaunch = @"launch";
+
+/* Return an error with the given code and localized description */
+static NSError *startup_error (LauncherStartupErrorCode code, NSString *description, NSError *cause) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithObject: description forKey: NSLocalizedDescriptionKey];
+    if (cause != nil)
+        [userInfo setObject: cause forKey: NSUnderlyingErrorKey];
+
+    return [NSError errorWithDomain: LauncherStartupErrorDomain code: code userInfo: userInfo];
+}
+
+/**
+ * @internal
+ *
+ * Runs an unfiltered platform discovery query from the main thread, finishing once the results are
+ * available. If candidate platforms are supplied, they are returned without querying.
+ */
+@interface LauncherDiscoveryOperation : NSOperation <PLSimulatorDiscoveryDelegate> {
+@private
+    /** Candidate platforms to return in place of querying, or nil. */
+    NSArray *_candidates;
+
+    /** The discovery query, or nil if candidate platforms were supplied. */
+    PLSimulatorDiscovery *_discovery;
+
+    /** Discovered platforms, in order of preference. */
+    NSArray *_platforms;
+
+    /** Platforms found so far, in the order they were reported. */
+    NSMutableArray *_foundPlatforms;
+
+    /** If non-nil, called with each platform as it is found. */
+    void (^_foundBlock)(PLSimulatorPlatform *platform);
+
+    /** If non-nil, called with each platform as it is found; returning YES stops the query. */
+    BOOL (^_acceptBlock)(PLSimulatorPlatform *platform);
+
+    /** Start and end times of the query. */
+    CFAbsoluteTime _startTime;
+    CFAbsoluteTime _endTime;
+
+    /** Memory profiler notified of the start and end of the query, or nil. */
+    PLMemoryProfiler *_memoryProfiler;
+
+    /** NSOperation state. */
+    BOOL _executing;
+    BOOL _finished;
+}
+
+- (id) initWithCandidatePlatforms: (NSArray *) candidates;
+
+- (void) reconsiderFoundPlatforms;
+
+/** Discovered platforms, in order of preference. Valid once the operation has finished. */
+@property(readonly) NSArray *platforms;
+
+/**
+ * If non-nil, called on the main thread with each platform as it is found, including each of the supplied
+ * candidate platforms. Called before the operation finishes.
+ */
+@property(copy) void (^foundBlock)(PLSimulatorPlatform *platform);
+
+/**
+ * If non-nil, called on the main thread with each platform as it is found. If the block returns YES,
+ * the query is stopped without waiting for the full result set.
+ */
+@property(copy) BOOL (^acceptBlock)(PLSimulatorPlatform *platform);
+
+/** Memory profiler notified of the start and end of the query, or nil. Must be set before the operation is started. */
+@property(strong) PLMemoryProfiler *memoryProfiler;
+
+/** Query start time. */
+@property(readonly) CFAbsoluteTime startTime;
+
+/** Query end time. */
+@property(readonly) CFAbsoluteTime endTime;
+
+@end
+
+@implementation LauncherDiscoveryOperation
+
+@synthesize platforms = _platforms;
+@synthesize foundBlock = _foundBlock;
+@synthesize acceptBlock = _acceptBlock;
+@synthesize startTime = _startTime;
+@synthesize endTime = _endTime;
+@synthesize memoryProfiler = _memoryProfiler;
+
+/**
+ * Initialize a new discovery operation.
+ *
+ * @param candidates Platforms to return in place of querying, or nil to perform a Spotlight query.
+ */
+- (id) initWithCandidatePlatforms: (NSArray *) candidates {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _candidates = candidates;
+    _foundPlatforms = [NSMutableArray array];
+
+    return self;
+}
+
+/**
+ * Pass each platform found so far to the accept block, stopping the query if one is accepted. This may be
+ * used once the state consulted by the accept block has changed. Must be called on the main thread.
+ */
+- (void) reconsiderFoundPlatforms {
+    if (_discovery == nil || _finished || _acceptBlock == nil)
+        return;
+
+    for (PLSimulatorPlatform *platform in [_foundPlatforms copy]) {
+        if (_acceptBlock(platform)) {
+            [_discovery stopQuery];
+            return;
+        }
+    }
+}
+
+/* Mark the operation as finished with @a platforms */
+- (void) finishWithPlatforms: (NSArray *) platforms {
+    /* No further platforms will be reported; release the blocks, and anything they reference */
+    _foundBlock = nil;
+    _acceptBlock = nil;
+
+    _platforms = platforms;
+    _endTime = CFAbsoluteTimeGetCurrent();
+    [_memoryProfiler endPhase: LauncherStartupPhaseDiscovery];
+
+    [self willChangeValueForKey: @"isExecuting"];
+    [self willChangeValueForKey: @"isFinished"];
+    _executing = NO;
+    _finished = YES;
+    [self didChangeValueForKey: @"isFinished"];
+    [self didChangeValueForKey: @"isExecuting"];
+}
+
+// from NSOperation
+- (void) start {
+    /* NSMetadataQuery requires a run loop; the query is always run from the main thread */
+    if (![NSThread isMainThread]) {
+        [self performSelectorOnMainThread: @selector(start) withObject: nil waitUntilDone: NO];
+        return;
+    }
+
+    _startTime = CFAbsoluteTimeGetCurrent();
+    [_memoryProfiler beginPhase: LauncherStartupPhaseDiscovery];
+
+    [self willChangeValueForKey: @"isExecuting"];
+    _executing = YES;
+    [self didChangeValueForKey: @"isExecuting"];
+
+    if ([self isCancelled]) {
+        [self finishWithPlatforms: [NSArray array]];
+        return;
+    }
+
+    if (_candidates != nil) {
+        for (PLSimulatorPlatform *platform in _candidates) {
+            if (_foundBlock != nil)
+                _foundBlock(platform);
+        }
+
+        [self finishWithPlatforms: _candidates];
+        return;
+    }
+
+    /* The query starts before the application has been loaded, so its requirements are not yet known. They are
+     * applied through the accept block instead, which stops the query once a found platform satisfies them. */
+    _discovery = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: nil canonicalSDKName: nil deviceFamilies: nil];
+    _discovery.delegate = self;
+    [_discovery startQuery];
+}
+
+// from NSOperation
+- (BOOL) isConcurrent {
+    return YES;
+}
+
+// from NSOperation
+- (BOOL) isExecuting {
+    return _executing;
+}
+
+// from NSOperation
+- (BOOL) isFinished {
+    return _finished;
+}
+
+// from PLSimulatorDiscoveryDelegate protocol
+- (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindSimulatorPlatform: (PLSimulatorPlatform *) platform {
+    [_foundPlatforms addObject: platform];
+
+    if (_foundBlock != nil)
+        _foundBlock(platform);
+
+    if (_acceptBlock != nil && _acceptBlock(platform))
+        [discovery stopQuery];
+}
+
+// from PLSimulatorDiscoveryDelegate protocol
+- (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindMatchingSimulatorPlatforms: (NSArray *) platforms {
+    [self finishWithPlatforms: platforms];
+}
+
+@end
+
+@interface LauncherStartupPipeline (PrivateMethods)
+- (void) recordPhase: (NSString *) phase start: (CFAbsoluteTime) start end: (CFAbsoluteTime) end;
+- (NSOperation *) operationForPhase: (NSString *) phase block: (void (^)(void)) block;
+@end
+
+/**
+ * Performs launcher startup as a graph of dependent phases, running independent phases concurrently.
+ *
+ * The phases are:
+ * - application: Load the embedded application's meta-data, off the main thread.
+ * - discovery: Find all installed platform SDKs, without regard to the application's requirements. Once the
+ *   application has been loaded and a platform satisfying its requirements has been found, in either order,
+ *   discovery stops early.
+ * - resolve: As soon as the first candidate platform is found, begin resolving its private frameworks. If
+ *   discovery has already finished with that as the only candidate, it is loaded; otherwise, its dylib closure
+ *   is prefetched.
+ * - select: Once both the application and the candidate platforms are available, select the preferred
+ *   platform matching the application's requirements.
+ * - launch: Start the simulator session via LauncherSimClient.
+ *
+ * The application and discovery phases run concurrently. The resolve phase begins during discovery, and overlaps
+ * the application and select phases.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads. Must be used from the main thread.
+ */
+@implementation LauncherStartupPipeline
+
+@synthesize candidatePlatforms = _candidatePlatforms;
+@synthesize memoryProfiler = _memoryProfiler;
+@synthesize outputStream = _outputStream;
+@synthesize application = _app;
+@synthesize platform = _platform;
+@synthesize delegate = _delegate;
+
+/**
+ * Initialize a new pipeline.
+ *
+ * @param path Path to the application to be launched.
+ * @param defaultDeviceFamily The device family to use by default, or nil if none specified.
+ * @param backend The backend used to load the platform and start the simulator session.
+ */
+- (id) initWithApplicationPath: (NSString *) path
+           defaultDeviceFamily: (PLSimulatorDeviceFamily *) defaultDeviceFamily
+                       backend: (id<LauncherSessionBackend>) backend
+{
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _appPath = [path copy];
+    _defaultDeviceFamily = defaultDeviceFamily;
+    _backend = backend;
+    _phases = [NSMutableDictionary dictionary];
+
+    _queue = [NSOperationQueue new];
+    [_queue setName: @"coop.plausible.simlaunch.startup"];
+
+    return self;
+}
+
+/**
+ * Start the pipeline. This is a single-shot operation, and the application will terminate once the
+ * launch completes, as per LauncherSimClient::launch.
+ */
+- (void) start {
+    [self startWithCompletionBlock: nil];
+}
+
+/**
+ * Start the pipeline. This is a single-shot operation.
+ *
+ * @param block If non-nil, passed to LauncherSimClient::launchWithCompletionBlock: once the launch client
+ * has been started. Failures prior to that point are reported to the delegate.
+ */
+- (void) startWithCompletionBlock: (void (^)(BOOL started, NSError *error)) block {
+    void (^completion)(BOOL, NSError *) = [block copy];
+    NSOperationQueue *mainQueue = [NSOperationQueue mainQueue];
+
+    _startTime = CFAbsoluteTimeGetCurrent();
+
+    /* Set once the application phase has completed. Main thread only. */
+    __block BOOL appLoaded = NO;
+
+    /* Find the candidate platforms. Once the application has been loaded and a platform satisfying its
+     * requirements has been found, in either order, the search is stopped early. */
+    LauncherDiscoveryOperation *discoveryOp = [[LauncherDiscoveryOperation alloc] initWithCandidatePlatforms: _candidatePlatforms];
+    discoveryOp.memoryProfiler = _memoryProfiler;
+    discoveryOp.acceptBlock = ^BOOL (PLSimulatorPlatform *platform) {
+        if (!appLoaded || _app == nil)
+            return NO;
+
+        NSArray *match = [PLSimulatorDiscovery platformsMatchingMinimumVersion: nil
+                                                              canonicalSDKName: _app.canonicalSDKName
+                                                                deviceFamilies: _app.deviceFamilies
+                                                                 fromPlatforms: [NSArray arrayWithObject: platform]];
+        return [match count] > 0;
+    };
+
+    /* Load the application meta-data, and then check the platforms found in the meantime */
+    NSOperation *appOp = [self operationForPhase: LauncherStartupPhaseApplication block: ^{
+        NSError *error;
+        _app = [[PLSimulatorApplication alloc] initWithPath: _appPath error: &error];
+        if (_app == nil)
+            _appError = error;
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            appLoaded = YES;
+            [discoveryOp reconsiderFoundPlatforms];
+        });
+    }];
+
+    /* Select the preferred platform matching the application's requirements, falling back on a platform with a
+     * compatible newer SDK */
+    NSOperation *selectOp = [self operationForPhase: LauncherStartupPhaseSelect block: ^{
+        _platforms = discoveryOp.platforms;
+        [self recordPhase: LauncherStartupPhaseDiscovery start: discoveryOp.startTime end: discoveryOp.endTime];
+
+        if (_app == nil)
+            return;
+
+        NSArray *matches = [PLSimulatorDiscovery platformsCompatibleWithApplication: _app fromPlatforms: _platforms];
+        if ([matches count] > 0)
+            _platform = [matches objectAtIndex: 0];
+    }];
+    [selectOp addDependency: appOp];
+    [selectOp addDependency: discoveryOp];
+
+    /* Launch */
+    NSOperation *launchOp = [NSBlockOperation blockOperationWithBlock: ^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        NSError *error = nil;
+
+        [_memoryProfiler beginPhase: LauncherStartupPhaseLaunch];
+
+        if (_app == nil) {
+            error = startup_error(LauncherStartupErrorInvalidApplication, [_appError localizedDescription], _appError);
+        } else if (_platform == nil) {
+            NSString *fmt = NSLocalizedString(@"The iPhone SDK required by the application could not be found. Please install the %@ SDK, or a newer compatible SDK, and try again.",
+                                              @"App SDK not found");
+            error = startup_error(LauncherStartupErrorNoPlatform, [NSString stringWithFormat: fmt, _app.canonicalSDKName], nil);
+        } else if (_platform == _resolvedPlatform && _resolveError != nil) {
+            error = startup_error(LauncherStartupErrorPlatformLoad, [_resolveError localizedDescription], _resolveError);
+        }
+
+        if (error != nil) {
+            [_memoryProfiler endPhase: LauncherStartupPhaseLaunch];
+            [_delegate startupPipeline: self didFailWithError: error];
+            return;
+        }
+
+        /* If the platform was loaded during resolution, the client's load is a no-op */
+        _client = [[LauncherSimClient alloc] initWithPlatform: _platform
+                                                          app: _app
+                                          defaultDeviceFamily: _defaultDeviceFamily
+                                                      backend: _backend];
+        _client.outputStream = _outputStream;
+        [_client launchWithCompletionBlock: completion];
+
+        [self recordPhase: LauncherStartupPhaseLaunch start: start end: CFAbsoluteTimeGetCurrent()];
+        [_memoryProfiler endPhase: LauncherStartupPhaseLaunch];
+
+        NSLog(@"%@", [self timingReport]);
+        NSLog(@"Startup statistics: %@", [[PLSimulatorStats snapshot] JSONRepresentation]);
+        if (_memoryProfiler != nil)
+            NSLog(@"%@", [_memoryProfiler report]);
+    }];
+    [launchOp addDependency: selectOp];
+
+    /* Begin resolving the first candidate's frameworks as soon as it is found, without waiting for discovery to
+     * finish. This must run on the main thread, as the session backend may not be shared across threads. The
+     * found block is always called before discovery finishes, and so before the launch can start. */
+    __block BOOL resolving = NO;
+    discoveryOp.foundBlock = ^(PLSimulatorPlatform *candidate) {
+        if (resolving)
+            return;
+        resolving = YES;
+
+        NSOperation *resolveOp = [self operationForPhase: LauncherStartupPhaseResolve block: ^{
+            /* If discovery has finished with this as the only candidate, no other platform can be selected, and it's
+             * safe to load it immediately. Otherwise, loading the wrong platform's frameworks would preclude loading
+             * the correct one, so we only prefetch. */
+            if ([discoveryOp isFinished] && [discoveryOp.platforms count] == 1 && [discoveryOp.platforms objectAtIndex: 0] == candidate) {
+                NSError *error;
+                _resolvedPlatform = candidate;
+                if (![_backend loadPlatform: candidate error: &error])
+                    _resolveError = error;
+            } else {
+                [candidate prefetchPrivateFrameworks];
+            }
+        }];
+
+        [launchOp addDependency: resolveOp];
+        [mainQueue addOperation: resolveOp];
+    };
+
+    [_queue addOperation: appOp];
+    [_queue addOperation: selectOp];
+    [mainQueue addOperation: discoveryOp];
+    [mainQueue addOperation: launchOp];
+}
+
+/**
+ * Return the elapsed time of each completed phase, in seconds, keyed by phase name (eg, LauncherStartupPhaseDiscovery).
+ */
+- (NSDictionary *) phaseTimings {
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+
+    @synchronized (_phases) {
+        for (NSString *phase in _phases) {
+            NSArray *range = [_phases objectForKey: phase];
+            double elapsed = [[range objectAtIndex: 1] doubleValue] - [[range objectAtIndex: 0] doubleValue];
+            [result setObject: [NSNumber numberWithDouble: elapsed] forKey: phase];
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Return a human-readable report of the completed phases, including the start and end offset of each,
+ * the total wall-clock time, and the time that would have been spent had the phases run sequentially.
+ */
+- (NSString *) timingReport {
+    NSMutableString *report = [NSMutableString stringWithString: @"Startup phases:"];
+    double serial = 0;
+    double wall = 0;
+
+    NSArray *order = [NSArray arrayWithObjects: LauncherStartupPhaseApplication, LauncherStartupPhaseDiscovery, LauncherStartupPhaseResolve,
+                      LauncherStartupPhaseSelect, LauncherStartupPhaseLaunch, nil];
+
+    @synchronized (_phases) {
+        for (NSString *phase in order) {
+            NSArray *range = [_phases objectForKey: phase];
+            if (range == nil)
+                continue;
+
+            double start = [[range objectAtIndex: 0] doubleValue];
+            double end = [[range objectAtIndex: 1] doubleValue];
+            [report appendFormat: @" %@ %.1fms [%.1f-%.1f]", phase, (end - start) * 1000.0, start * 1000.0, end * 1000.0];
+
+            serial += end - start;
+            wall = MAX(wall, end);
+        }
+    }
+
+    [report appendFormat: @"; wall %.1fms, sequential %.1fms", wall * 1000.0, serial * 1000.0];
+    return report;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherStartupPipeline (PrivateMethods)
+
+/**
+ * Record the absolute @a start and @a end times of @a phase.
+ */
+- (void) recordPhase: (NSString *) phase start: (CFAbsoluteTime) start end: (CFAbsoluteTime) end {
+    NSArray *range = [NSArray arrayWithObjects: [NSNumber numberWithDouble: start - _startTime], [NSNumber numberWithDouble: end - _startTime], nil];
+
+    @synchronized (_phases) {
+        [_phases setObject: range forKey: phase];
+    }
+}
+
+/**
+ * Return an operation that executes @a block, recording its timing and memory growth as @a phase.
+ */
+- (NSOperation *) operationForPhase: (NSString *) phase block: (void (^)(void)) block {
+    return [NSBlockOperation blockOperationWithBlock: ^{
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [_memoryProfiler beginPhase: phase];
+
+        block();
+
+        [_memoryProfiler endPhase: phase];
+        [self recordPhase: phase start: start end: CFAbsoluteTimeGetCurrent()];
+    }];
+}
+
+@end
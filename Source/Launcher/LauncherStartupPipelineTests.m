@@ -0,0 +1,110 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+#import "PLSyntheticFixtures.h"
+
+#import "LauncherStartupPipeline.h"
+#import "LauncherStubSessionBackend.h"
+
+@interface LauncherStartupPipelineTests : PLTestCase <LauncherStartupPipelineDelegate> {
+@private
+    /** Synthetic application path */
+    NSString *_appPath;
+
+    /** Synthetic platforms, supporting iphonesimulator5.1 and iphonesimulator6.0 respectively */
+    PLSimulatorPlatform *_platform51;
+    PLSimulatorPlatform *_platform60;
+
+    /** Error reported to the pipeline delegate, if any */
+    NSError *_error;
+}
+@end
+
+@implementation LauncherStartupPipelineTests
+
+- (void) setUp {
+    _error = nil;
+
+    _platform51 = [self platformWithName: @"Xcode-5.1" sdkVersions: [NSArray arrayWithObject: @"5.1"]];
+    _platform60 = [self platformWithName: @"Xcode-6.0" sdkVersions: [NSArray arrayWithObject: @"6.0"]];
+
+    _appPath = [[self applicationWithName: @"Test" canonicalSDKName: @"iphonesimulator6.0" deviceFamilies: [NSArray arrayWithObject: [NSNumber numberWithInt: 1]]] path];
+}
+
+/* Run @a pipeline, returning YES if the launch completed successfully */
+- (BOOL) runPipeline: (LauncherStartupPipeline *) pipeline {
+    __block BOOL finished = NO;
+    __block BOOL result = NO;
+
+    pipeline.delegate = self;
+    [pipeline startWithCompletionBlock: ^(BOOL started, NSError *error) {
+        result = started;
+        finished = YES;
+    }];
+
+    [self spinRunloopWithTimeout: 5.0 predicate: ^BOOL{ return finished || _error != nil; }];
+    return result;
+}
+
+- (void) testLaunch {
+    LauncherStubSessionBackend *backend = [LauncherStubSessionBackend new];
+    backend.loadLatency = 0.05;
+
+    LauncherStartupPipeline *pipeline = [[LauncherStartupPipeline alloc] initWithApplicationPath: _appPath defaultDeviceFamily: nil backend: backend];
+    pipeline.candidatePlatforms = [NSArray arrayWithObjects: _platform51, _platform60, nil];
+
+    STAssertTrue([self runPipeline: pipeline], @"Launch failed: %@", _error);
+
+    /* The platform must be selected by the application's requirements, rather than the candidate order */
+    STAssertEquals(pipeline.platform, _platform60, @"Incorrect platform selected");
+    STAssertEqualObjects(backend.lastConfig.sdkVersion, @"6.0", @"Incorrect SDK version");
+
+    /* All phases must be timed */
+    NSDictionary *timings = [pipeline phaseTimings];
+    NSArray *phases = [NSArray arrayWithObjects: LauncherStartupPhaseApplication, LauncherStartupPhaseDiscovery, LauncherStartupPhaseResolve,
+                       LauncherStartupPhaseSelect, LauncherStartupPhaseLaunch, nil];
+    for (NSString *phase in phases)
+        STAssertNotNil([timings objectForKey: phase], @"Missing timing for phase %@", phase);
+}
+
+- (void) testNoPlatform {
+    LauncherStartupPipeline *pipeline = [[LauncherStartupPipeline alloc] initWithApplicationPath: _appPath defaultDeviceFamily: nil backend: [LauncherStubSessionBackend new]];
+    pipeline.candidatePlatforms = [NSArray arrayWithObject: _platform51];
+
+    STAssertFalse([self runPipeline: pipeline], @"Launch should not have succeeded");
+    STAssertEqualObjects([_error domain], LauncherStartupErrorDomain, @"Incorrect error domain");
+    STAssertEquals([_error code], (NSInteger) LauncherStartupErrorNoPlatform, @"Incorrect error code");
+}
+
+// from LauncherStartupPipelineDelegate protocol
+- (void) startupPipeline: (LauncherStartupPipeline *) pipeline didFailWithError: (NSError *) error {
+    _error = error;
+}
+
+@end
@@ -0,0 +1,112 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "LauncherSessionBackend.h"
+
+/**
+ * Launch stages at which a LauncherStubSessionBackend may inject a failure.
+ */
+typedef enum {
+    /** No failure is injected. */
+    LauncherStubFailureNone = 0,
+
+    /** LauncherSessionBackend::loadPlatform:error: fails. */
+    LauncherStubFailureLoad = 1,
+
+    /** LauncherSessionBackend::startSessionWithConfig:timeout:error: fails synchronously. */
+    LauncherStubFailureStartRequest = 2,
+
+    /** The start request succeeds, but the session reports that it did not start. */
+    LauncherStubFailureDidStart = 3,
+
+    /** The session starts, and then ends with an error. */
+    LauncherStubFailureDidEnd = 4
+} LauncherStubFailurePoint;
+
+@interface LauncherStubSessionBackend : NSObject <LauncherSessionBackend> {
+@private
+    /** Session delegate. */
+    id<LauncherSessionBackendDelegate> __weak _delegate;
+
+    /** Queue on which delegate messages are sent. */
+    dispatch_queue_t _callbackQueue;
+
+    /** Simulated platform load latency, in seconds. */
+    NSTimeInterval _loadLatency;
+
+    /** Simulated session start latency, in seconds. */
+    NSTimeInterval _startLatency;
+
+    /** Simulated session duration, in seconds. If negative, sessions do not end. */
+    NSTimeInterval _sessionDuration;
+
+    /** Stage at which a failure is injected. */
+    LauncherStubFailurePoint _failurePoint;
+
+    /** Probability that the failure is injected, from 0.0 to 1.0. */
+    double _failureProbability;
+
+    /** The loaded platform, or nil. */
+    PLSimulatorPlatform *_loadedPlatform;
+
+    /** The most recent session configuration. */
+    LauncherSessionConfig *_lastConfig;
+
+    /** Number of sessions started. */
+    NSUInteger _sessionCount;
+}
+
+- (id) initWithCallbackQueue: (dispatch_queue_t) callbackQueue;
+
+/** Simulated platform load latency, in seconds. Paid on the first load only. Defaults to 0. */
+@property(nonatomic, assign) NSTimeInterval loadLatency;
+
+/** Simulated session start latency, in seconds. Defaults to 0. */
+@property(nonatomic, assign) NSTimeInterval startLatency;
+
+/**
+ * Simulated session duration, in seconds, after which a started session ends without error. If negative, sessions
+ * only end when a LauncherStubFailureDidEnd failure is injected. Defaults to -1.
+ */
+@property(nonatomic, assign) NSTimeInterval sessionDuration;
+
+/** Stage at which a failure is injected. Defaults to LauncherStubFailureNone. */
+@property(nonatomic, assign) LauncherStubFailurePoint failurePoint;
+
+/** Probability that the failure is injected, from 0.0 to 1.0. Defaults to 1.0. */
+@property(nonatomic, assign) double failureProbability;
+
+/** The most recent session configuration, or nil. */
+@property(nonatomic, readonly) LauncherSessionConfig *lastConfig;
+
+/** Number of sessions successfully started. */
+@property(nonatomic, readonly) NSUInteger sessionCount;
+
+@end
@@ -0,0 +1,171 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "LauncherStubSessionBackend.h"
+
+#import <stdlib.h>
+#import <unistd.h>
+
+@interface LauncherStubSessionBackend (PrivateMethods)
+- (BOOL) shouldFailAt: (LauncherStubFailurePoint) point;
+- (NSError *) errorForFailureAt: (LauncherStubFailurePoint) point;
+@end
+
+/**
+ * A stand-in session backend that simulates the latency and failure modes of the simulator, without starting a
+ * simulator session. Used to exercise and benchmark the complete launch path on hosts without the simulator.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads.
+ */
+@implementation LauncherStubSessionBackend
+
+@synthesize delegate = _delegate;
+@synthesize loadLatency = _loadLatency;
+@synthesize startLatency = _startLatency;
+@synthesize sessionDuration = _sessionDuration;
+@synthesize failurePoint = _failurePoint;
+@synthesize failureProbability = _failureProbability;
+@synthesize lastConfig = _lastConfig;
+@synthesize sessionCount = _sessionCount;
+
+/**
+ * Initialize a new backend that sends delegate messages on the main queue.
+ */
+- (id) init {
+    return [self initWithCallbackQueue: NULL];
+}
+
+/**
+ * Initialize a new backend.
+ *
+ * @param callbackQueue The queue on which delegate messages will be sent. If NULL, the main queue is used.
+ */
+- (id) initWithCallbackQueue: (dispatch_queue_t) callbackQueue {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _callbackQueue = (callbackQueue != NULL) ? callbackQueue : dispatch_get_main_queue();
+    dispatch_retain(_callbackQueue);
+
+    _failureProbability = 1.0;
+    _sessionDuration = -1;
+
+    return self;
+}
+
+- (void) dealloc {
+    dispatch_release(_callbackQueue);
+}
+
+// from LauncherSessionBackend protocol
+- (BOOL) loadPlatform: (PLSimulatorPlatform *) platform error: (NSError **) outError {
+    /* Loading is only paid once, as with the simulator's private frameworks */
+    if (_loadedPlatform != nil)
+        return YES;
+
+    /* Loading is synchronous */
+    if (_loadLatency > 0)
+        usleep((useconds_t) (_loadLatency * USEC_PER_SEC));
+
+    if ([self shouldFailAt: LauncherStubFailureLoad]) {
+        if (outError != NULL)
+            *outError = [self errorForFailureAt: LauncherStubFailureLoad];
+        return NO;
+    }
+
+    _loadedPlatform = platform;
+    return YES;
+}
+
+// from LauncherSessionBackend protocol
+- (BOOL) startSessionWithConfig: (LauncherSessionConfig *) config timeout: (NSTimeInterval) timeout error: (NSError **) outError {
+    _lastConfig = config;
+
+    if (_loadedPlatform == nil || config.applicationPath == nil || [self shouldFailAt: LauncherStubFailureStartRequest]) {
+        if (outError != NULL)
+            *outError = [self errorForFailureAt: LauncherStubFailureStartRequest];
+        return NO;
+    }
+
+    /* Sessions that take longer than the timeout fail, as they would with the simulator */
+    BOOL timedOut = (_startLatency > timeout);
+    BOOL started = !timedOut && ![self shouldFailAt: LauncherStubFailureDidStart];
+    BOOL ends = started && [self shouldFailAt: LauncherStubFailureDidEnd];
+    NSError *startError = started ? nil : [self errorForFailureAt: LauncherStubFailureDidStart];
+
+    if (started)
+        _sessionCount++;
+
+    dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (MIN(_startLatency, timeout) * NSEC_PER_SEC));
+    dispatch_after(when, _callbackQueue, ^{
+        [_delegate sessionBackend: self didStart: started withError: startError];
+
+        if (ends) {
+            [_delegate sessionBackend: self didEndWithError: [self errorForFailureAt: LauncherStubFailureDidEnd]];
+        } else if (started && _sessionDuration >= 0) {
+            dispatch_time_t end = dispatch_time(DISPATCH_TIME_NOW, (int64_t) (_sessionDuration * NSEC_PER_SEC));
+            dispatch_after(end, _callbackQueue, ^{
+                [_delegate sessionBackend: self didEndWithError: nil];
+            });
+        }
+    });
+
+    return YES;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation LauncherStubSessionBackend (PrivateMethods)
+
+/**
+ * Return YES if a failure should be injected at @a point.
+ */
+- (BOOL) shouldFailAt: (LauncherStubFailurePoint) point {
+    if (_failurePoint != point)
+        return NO;
+
+    if (_failureProbability >= 1.0)
+        return YES;
+
+    return ((double) arc4random() / UINT32_MAX) < _failureProbability;
+}
+
+/**
+ * Return an error describing an injected failure at @a point.
+ */
+- (NSError *) errorForFailureAt: (LauncherStubFailurePoint) point {
+    NSString *desc = [NSString stringWithFormat: @"Simulated session failure (stage %d).", (int) point];
+    NSDictionary *userInfo = [NSDictionary dictionaryWithObject: desc forKey: NSLocalizedDescriptionKey];
+    return [NSError errorWithDomain: LauncherSessionErrorDomain code: point userInfo: userInfo];
+}
+
+@end
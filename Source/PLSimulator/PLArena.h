@@ -0,0 +1,79 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <sys/types.h>
+#import <stdint.h>
+#import <stdbool.h>
+
+/** Default size of arena-allocated chunks. */
+#define PL_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+
+/**
+ * @internal
+ * A single arena chunk.
+ */
+typedef struct pl_arena_chunk {
+    /** The next (previously allocated) chunk, or NULL. */
+    struct pl_arena_chunk *next;
+
+    /** Start of the usable chunk memory. */
+    uint8_t *base;
+
+    /** Number of usable bytes at base. */
+    size_t size;
+
+    /** Number of bytes allocated from base. */
+    size_t used;
+
+    /** If true, this chunk was allocated by the arena and must be freed. */
+    bool owned;
+} pl_arena_chunk_t;
+
+/**
+ * A bump allocator. All memory allocated from an arena is released at once by pl_arena_free().
+ */
+typedef struct pl_arena {
+    /** The current chunk, from which new allocations are made. */
+    pl_arena_chunk_t *chunks;
+
+    /** Size of newly allocated chunks. */
+    size_t chunk_size;
+
+    /** Number of chunks the arena has allocated from the system allocator. */
+    size_t chunk_allocations;
+} pl_arena_t;
+
+void pl_arena_init (pl_arena_t *arena, size_t chunk_size);
+void pl_arena_init_with_buffer (pl_arena_t *arena, void *buffer, size_t length);
+
+void *pl_arena_alloc (pl_arena_t *arena, size_t size);
+char *pl_arena_strndup (pl_arena_t *arena, const char *str, size_t maxlen);
+
+size_t pl_arena_bytes_used (pl_arena_t *arena);
+
+void pl_arena_free (pl_arena_t *arena);
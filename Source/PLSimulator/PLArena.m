@@ -0,0 +1,208 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLArena.h"
+
+#import <stdlib.h>
+#import <string.h>
+
+/* Alignment of all arena allocations; sufficient for any scalar or pointer type. */
+#define PL_ARENA_ALIGN 16
+
+/* Round @a value up to PL_ARENA_ALIGN */
+#define PL_ARENA_ROUND(value) (((value) + (PL_ARENA_ALIGN - 1)) & ~((size_t) PL_ARENA_ALIGN - 1))
+
+/*
+ * Arena allocation.
+ *
+ * Allocations are bumped from the current chunk. Once a chunk is exhausted, a new chunk is allocated
+ * and becomes current; the remainder of the prior chunk is abandoned. Requests larger than the chunk
+ * size are given a dedicated chunk, which is placed behind the current chunk so that the current chunk's
+ * remaining space is not wasted.
+ *
+ * An arena is not thread-safe; callers must either confine an arena to a single thread, or provide
+ * their own locking.
+ */
+
+/* Allocate a new chunk with at least @a size usable bytes. */
+static pl_arena_chunk_t *pl_arena_chunk_new (pl_arena_t *arena, size_t size) {
+    size_t header = PL_ARENA_ROUND(sizeof(pl_arena_chunk_t));
+    pl_arena_chunk_t *chunk = malloc(header + size);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->next = NULL;
+    chunk->base = ((uint8_t *) chunk) + header;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->owned = true;
+
+    arena->chunk_allocations++;
+    return chunk;
+}
+
+/**
+ * Initialize an empty arena. No memory is allocated until the first call to pl_arena_alloc().
+ *
+ * @param arena The arena to initialize.
+ * @param chunk_size The size of chunks allocated by the arena, or 0 to use PL_ARENA_DEFAULT_CHUNK_SIZE.
+ */
+void pl_arena_init (pl_arena_t *arena, size_t chunk_size) {
+    arena->chunks = NULL;
+    arena->chunk_size = (chunk_size > 0) ? chunk_size : PL_ARENA_DEFAULT_CHUNK_SIZE;
+    arena->chunk_allocations = 0;
+}
+
+/**
+ * Initialize an arena that will allocate from the caller-supplied @a buffer. If the buffer is exhausted,
+ * additional chunks of PL_ARENA_DEFAULT_CHUNK_SIZE are allocated.
+ *
+ * The buffer must remain valid until pl_arena_free() is called; it will not be freed by the arena.
+ *
+ * @param arena The arena to initialize.
+ * @param buffer Initial backing buffer (eg, stack storage).
+ * @param length The length of @a buffer, in bytes.
+ */
+void pl_arena_init_with_buffer (pl_arena_t *arena, void *buffer, size_t length) {
+    pl_arena_init(arena, 0);
+
+    /* Place the chunk header at the (aligned) start of the buffer */
+    uintptr_t start = PL_ARENA_ROUND((uintptr_t) buffer);
+    size_t header = PL_ARENA_ROUND(sizeof(pl_arena_chunk_t));
+    if (start + header >= (uintptr_t) buffer + length)
+        return;
+
+    pl_arena_chunk_t *chunk = (pl_arena_chunk_t *) start;
+    chunk->next = NULL;
+    chunk->base = (uint8_t *) (start + header);
+    chunk->size = ((uintptr_t) buffer + length) - (uintptr_t) chunk->base;
+    chunk->used = 0;
+    chunk->owned = false;
+
+    arena->chunks = chunk;
+}
+
+/**
+ * Allocate @a size bytes from @a arena. The returned memory is aligned to 16 bytes, and is not zero-filled.
+ *
+ * @param arena The arena from which the memory will be allocated.
+ * @param size Number of bytes to allocate.
+ *
+ * @return Returns a pointer to the allocated memory, or NULL if the system allocator fails.
+ */
+void *pl_arena_alloc (pl_arena_t *arena, size_t size) {
+    size = PL_ARENA_ROUND(size > 0 ? size : 1);
+
+    /* Fast path */
+    pl_arena_chunk_t *current = arena->chunks;
+    if (current != NULL && current->size - current->used >= size) {
+        void *result = current->base + current->used;
+        current->used += size;
+        return result;
+    }
+
+    /* Oversized allocations are given a dedicated chunk */
+    if (size > arena->chunk_size && current != NULL) {
+        pl_arena_chunk_t *chunk = pl_arena_chunk_new(arena, size);
+        if (chunk == NULL)
+            return NULL;
+
+        chunk->used = size;
+        chunk->next = current->next;
+        current->next = chunk;
+        return chunk->base;
+    }
+
+    /* Start a new chunk */
+    pl_arena_chunk_t *chunk = pl_arena_chunk_new(arena, size > arena->chunk_size ? size : arena->chunk_size);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->next = current;
+    arena->chunks = chunk;
+
+    chunk->used = size;
+    return chunk->base;
+}
+
+/**
+ * Copy at most @a maxlen bytes of the string @a str into @a arena, NUL-terminating the result.
+ *
+ * @param arena The arena from which the copy will be allocated.
+ * @param str The string to copy.
+ * @param maxlen The maximum number of bytes to copy, excluding the NUL terminator.
+ *
+ * @return Returns the copied string, or NULL if the system allocator fails.
+ */
+char *pl_arena_strndup (pl_arena_t *arena, const char *str, size_t maxlen) {
+    size_t len = strnlen(str, maxlen);
+    char *result = pl_arena_alloc(arena, len + 1);
+    if (result == NULL)
+        return NULL;
+
+    memcpy(result, str, len);
+    result[len] = '\0';
+    return result;
+}
+
+/**
+ * Return the total number of bytes allocated from @a arena, including alignment padding.
+ */
+size_t pl_arena_bytes_used (pl_arena_t *arena) {
+    size_t used = 0;
+    for (pl_arena_chunk_t *chunk = arena->chunks; chunk != NULL; chunk = chunk->next)
+        used += chunk->used;
+
+    return used;
+}
+
+/**
+ * Release all memory allocated from @a arena. The arena may be reused after calling pl_arena_free().
+ *
+ * @param arena The arena to free.
+ */
+void pl_arena_free (pl_arena_t *arena) {
+    pl_arena_chunk_t *buffer = NULL;
+    pl_arena_chunk_t *chunk = arena->chunks;
+    while (chunk != NULL) {
+        pl_arena_chunk_t *next = chunk->next;
+
+        /* A caller-supplied buffer is retained for reuse */
+        if (chunk->owned) {
+            free(chunk);
+        } else {
+            chunk->next = NULL;
+            chunk->used = 0;
+            buffer = chunk;
+        }
+
+        chunk = next;
+    }
+
+    arena->chunks = buffer;
+}
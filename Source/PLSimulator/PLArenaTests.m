@@ -0,0 +1,95 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLArena.h"
+
+@interface PLArenaTests : PLTestCase @end
+
+@implementation PLArenaTests
+
+- (void) testAllocation {
+    pl_arena_t arena;
+    pl_arena_init(&arena, 256);
+
+    /* Allocations must be aligned and distinct */
+    uint8_t *a = pl_arena_alloc(&arena, 3);
+    uint8_t *b = pl_arena_alloc(&arena, 5);
+    STAssertTrue(a != NULL && b != NULL, @"Allocation failed");
+    STAssertEquals((uintptr_t) a % 16, (uintptr_t) 0, @"Allocation is not aligned");
+    STAssertEquals((uintptr_t) b % 16, (uintptr_t) 0, @"Allocation is not aligned");
+    STAssertTrue(b >= a + 3, @"Allocations overlap");
+    STAssertEquals(arena.chunk_allocations, (size_t) 1, @"Small allocations should share a chunk");
+
+    /* Exhaust the first chunk */
+    for (int i = 0; i < 32; i++)
+        STAssertTrue(pl_arena_alloc(&arena, 16) != NULL, @"Allocation failed");
+    STAssertTrue(arena.chunk_allocations > 1, @"Arena did not grow");
+
+    /* Oversized allocations are satisfied */
+    size_t chunks = arena.chunk_allocations;
+    uint8_t *large = pl_arena_alloc(&arena, 4096);
+    STAssertTrue(large != NULL, @"Large allocation failed");
+    memset(large, 0xFF, 4096);
+    STAssertEquals(arena.chunk_allocations, chunks + 1, @"Large allocation should use a dedicated chunk");
+
+    pl_arena_free(&arena);
+    STAssertTrue(arena.chunks == NULL, @"Chunks were not released");
+}
+
+- (void) testStrndup {
+    pl_arena_t arena;
+    pl_arena_init(&arena, 0);
+
+    char *str = pl_arena_strndup(&arena, "hello world", 5);
+    STAssertEquals(strcmp(str, "hello"), 0, @"Incorrect copy");
+
+    pl_arena_free(&arena);
+}
+
+- (void) testCallerBuffer {
+    uint8_t buffer[1024];
+    pl_arena_t arena;
+    pl_arena_init_with_buffer(&arena, buffer, sizeof(buffer));
+
+    uint8_t *a = pl_arena_alloc(&arena, 64);
+    STAssertTrue(a >= buffer && a + 64 <= buffer + sizeof(buffer), @"Allocation should be satisfied from the caller's buffer");
+    STAssertEquals(arena.chunk_allocations, (size_t) 0, @"No chunks should have been allocated");
+
+    /* Overflow the buffer */
+    STAssertTrue(pl_arena_alloc(&arena, 2048) != NULL, @"Allocation failed");
+    STAssertEquals(arena.chunk_allocations, (size_t) 1, @"Overflow should allocate a chunk");
+
+    /* The caller's buffer is retained for reuse */
+    pl_arena_free(&arena);
+    STAssertTrue(pl_arena_alloc(&arena, 64) == a, @"Caller's buffer was not reused");
+    pl_arena_free(&arena);
+}
+
+@end
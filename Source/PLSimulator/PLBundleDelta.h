@@ -0,0 +1,89 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLBundleManifest.h"
+
+@interface PLBundleDelta : NSObject {
+@private
+    /** Maps new bundle-relative paths to their reconstruction entries. */
+    NSDictionary *_entries;
+
+    /** Manifest of the new bundle, used to verify the reconstructed bundle. */
+    PLBundleManifest *_manifest;
+
+    /** Number of files copied unmodified from the old bundle. */
+    NSUInteger _copiedFileCount;
+
+    /** Number of files reconstructed by patching a file from the old bundle. */
+    NSUInteger _patchedFileCount;
+
+    /** Number of files stored in their entirety. */
+    NSUInteger _literalFileCount;
+
+    /** Number of new bundle bytes reused from the old bundle. */
+    uint64_t _reusedByteCount;
+
+    /** Number of new bundle bytes stored in the delta. */
+    uint64_t _literalByteCount;
+}
+
++ (id) deltaWithContentsOfFile: (NSString *) path error: (NSError **) outError;
+
+- (id) initWithBundlePath: (NSString *) oldPath newBundlePath: (NSString *) newPath error: (NSError **) outError;
+- (id) initWithContentsOfFile: (NSString *) path error: (NSError **) outError;
+
+- (BOOL) writeToFile: (NSString *) path error: (NSError **) outError;
+
+- (PLBundleVerificationResult *) applyToBundleAtPath: (NSString *) oldPath
+                                     destinationPath: (NSString *) destinationPath
+                                               error: (NSError **) outError;
+
+/** Manifest of the new bundle. */
+@property(nonatomic, readonly) PLBundleManifest *manifest;
+
+/** Number of files in the new bundle. */
+@property(nonatomic, readonly) NSUInteger fileCount;
+
+/** Number of files copied unmodified from the old bundle, including renamed and duplicated files. */
+@property(nonatomic, readonly) NSUInteger copiedFileCount;
+
+/** Number of files reconstructed by patching the file at the same path in the old bundle. */
+@property(nonatomic, readonly) NSUInteger patchedFileCount;
+
+/** Number of files stored in their entirety. */
+@property(nonatomic, readonly) NSUInteger literalFileCount;
+
+/** Number of new bundle bytes reused from the old bundle, either as whole files or as blocks of patched files. */
+@property(nonatomic, readonly) uint64_t reusedByteCount;
+
+/** Number of new bundle bytes stored in the delta. */
+@property(nonatomic, readonly) uint64_t literalByteCount;
+
+@end
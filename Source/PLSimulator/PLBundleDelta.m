@@ -0,0 +1,813 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLBundleDelta.h"
+
+#import "PLSimulator.h"
+
+#import <libkern/OSByteOrder.h>
+#import <copyfile.h>
+#import <sys/stat.h>
+
+/* Delta format version */
+#define DELTA_VERSION 1
+
+/* Delta plist keys */
+#define VersionKey @"Version"
+#define ManifestKey @"Manifest"
+#define FilesKey @"Files"
+#define ModeKey @"Mode"
+#define SourceKey @"Source"
+#define BaseKey @"Base"
+#define OperationsKey @"Operations"
+#define DataKey @"Data"
+
+/* Patch operation codes. A copy is followed by the little-endian 64-bit base offset and length; data is
+ * followed by the little-endian 64-bit length and the literal bytes. */
+#define OP_COPY 'C'
+#define OP_DATA 'D'
+
+/* Size of the blocks matched between the old and new versions of a changed file. */
+#define BLOCK_SIZE 2048
+
+/* Maximum number of old blocks compared against a single checksum match. Bounds the cost of files containing
+ * many identical blocks (eg, zero fill). */
+#define MAX_BLOCK_CANDIDATES 16
+
+/**
+ * @internal
+ *
+ * A checksummed block of the base file.
+ */
+typedef struct plsim_delta_block {
+    /** Rolling checksum of the block */
+    uint32_t checksum;
+
+    /** Offset of the block within the base file */
+    uint64_t offset;
+} plsim_delta_block_t;
+
+/* Sort blocks by checksum, and then by offset. */
+static int plsim_delta_block_compare (const void *a, const void *b) {
+    const plsim_delta_block_t *lhs = a;
+    const plsim_delta_block_t *rhs = b;
+
+    if (lhs->checksum != rhs->checksum)
+        return lhs->checksum < rhs->checksum ? -1 : 1;
+
+    if (lhs->offset != rhs->offset)
+        return lhs->offset < rhs->offset ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * Compute the two halves of the rsync-style rolling checksum of the @a length bytes at @a bytes.
+ */
+static void plsim_delta_checksum (const uint8_t *bytes, size_t length, uint32_t *a, uint32_t *b) {
+    uint32_t sa = 0;
+    uint32_t sb = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        sa += bytes[i];
+        sb += (uint32_t) (length - i) * bytes[i];
+    }
+
+    *a = sa & 0xFFFF;
+    *b = sb & 0xFFFF;
+}
+
+/* Append a copy operation to @a ops. */
+static void plsim_delta_append_copy (NSMutableData *ops, uint64_t offset, uint64_t length) {
+    uint8_t op = OP_COPY;
+    uint64_t fields[2] = { OSSwapHostToLittleInt64(offset), OSSwapHostToLittleInt64(length) };
+
+    [ops appendBytes: &op length: sizeof(op)];
+    [ops appendBytes: fields length: sizeof(fields)];
+}
+
+/* Append a literal data operation to @a ops. Empty literals are omitted. */
+static void plsim_delta_append_data (NSMutableData *ops, const uint8_t *bytes, uint64_t length) {
+    if (length == 0)
+        return;
+
+    uint8_t op = OP_DATA;
+    uint64_t field = OSSwapHostToLittleInt64(length);
+
+    [ops appendBytes: &op length: sizeof(op)];
+    [ops appendBytes: &field length: sizeof(field)];
+    [ops appendBytes: bytes length: length];
+}
+
+/*
+ * Compute the patch operations required to reconstruct @a target from @a base. The base is indexed by the
+ * rolling checksum of each aligned block; the checksum is then rolled across the target a byte at a time, so
+ * that blocks are found regardless of any insertions or deletions that shift their offsets. Matches are
+ * confirmed with memcmp(), as both files are available locally.
+ *
+ * The number of target bytes copied from @a base is returned via @a outReused.
+ */
+static NSData *plsim_delta_diff (NSData *base, NSData *target, uint64_t *outReused) {
+    const uint8_t *src = [base bytes];
+    const uint8_t *dst = [target bytes];
+    size_t srcLength = [base length];
+    size_t dstLength = [target length];
+
+    /* Index the base file's blocks */
+    size_t blockCount = srcLength / BLOCK_SIZE;
+    plsim_delta_block_t *blocks = malloc((blockCount > 0 ? blockCount : 1) * sizeof(plsim_delta_block_t));
+    for (size_t i = 0; i < blockCount; i++) {
+        uint32_t a, b;
+        plsim_delta_checksum(src + (i * BLOCK_SIZE), BLOCK_SIZE, &a, &b);
+        blocks[i].checksum = (b << 16) | a;
+        blocks[i].offset = i * BLOCK_SIZE;
+    }
+    qsort(blocks, blockCount, sizeof(plsim_delta_block_t), plsim_delta_block_compare);
+
+    NSMutableData *ops = [NSMutableData data];
+    uint64_t reused = 0;
+
+    /* The pending copy, which is extended for as long as consecutive target blocks are found consecutively in
+     * the base */
+    uint64_t copyOffset = 0;
+    uint64_t copyLength = 0;
+
+    size_t literalStart = 0;
+    size_t pos = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    BOOL haveChecksum = NO;
+
+    while (blockCount > 0 && pos + BLOCK_SIZE <= dstLength) {
+        if (!haveChecksum) {
+            plsim_delta_checksum(dst + pos, BLOCK_SIZE, &a, &b);
+            haveChecksum = YES;
+        }
+
+        /* Prefer the block following the pending copy, which avoids a checksum lookup for unmodified runs */
+        int64_t match = -1;
+        uint64_t next = copyOffset + copyLength;
+        if (copyLength > 0 && literalStart == pos && next + BLOCK_SIZE <= srcLength && memcmp(src + next, dst + pos, BLOCK_SIZE) == 0)
+            match = next;
+
+        if (match < 0) {
+            uint32_t checksum = (b << 16) | a;
+
+            /* Find the first block with a matching checksum */
+            size_t lo = 0;
+            size_t hi = blockCount;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (blocks[mid].checksum < checksum)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            for (size_t i = lo; i < blockCount && i < lo + MAX_BLOCK_CANDIDATES && blocks[i].checksum == checksum; i++) {
+                if (memcmp(src + blocks[i].offset, dst + pos, BLOCK_SIZE) == 0) {
+                    match = blocks[i].offset;
+                    break;
+                }
+            }
+        }
+
+        if (match < 0) {
+            /* Roll the checksum forward by a single byte */
+            if (pos + BLOCK_SIZE < dstLength) {
+                uint8_t out = dst[pos];
+                uint8_t in = dst[pos + BLOCK_SIZE];
+                a = (a - out + in) & 0xFFFF;
+                b = (b - (BLOCK_SIZE * out) + a) & 0xFFFF;
+            }
+            pos++;
+            continue;
+        }
+
+        /* Flush any literal bytes preceding the match; these also terminate the pending copy */
+        if (literalStart < pos) {
+            if (copyLength > 0)
+                plsim_delta_append_copy(ops, copyOffset, copyLength);
+            copyLength = 0;
+
+            plsim_delta_append_data(ops, dst + literalStart, pos - literalStart);
+        }
+
+        if (copyLength > 0 && (uint64_t) match == copyOffset + copyLength) {
+            copyLength += BLOCK_SIZE;
+        } else {
+            if (copyLength > 0)
+                plsim_delta_append_copy(ops, copyOffset, copyLength);
+
+            copyOffset = match;
+            copyLength = BLOCK_SIZE;
+        }
+
+        reused += BLOCK_SIZE;
+        pos += BLOCK_SIZE;
+        literalStart = pos;
+        haveChecksum = NO;
+    }
+
+    if (copyLength > 0)
+        plsim_delta_append_copy(ops, copyOffset, copyLength);
+    plsim_delta_append_data(ops, dst + literalStart, dstLength - literalStart);
+
+    free(blocks);
+
+    *outReused = reused;
+    return ops;
+}
+
+/*
+ * Apply the patch @a ops to @a base, appending the result to @a output. If @a output is nil, the operations
+ * are only validated; @a base is ignored. The number of bytes copied and stored are returned via @a outReused
+ * and @a outLiteral, if non-NULL.
+ *
+ * Returns NO if the operations are malformed, or reference data beyond the end of @a base.
+ */
+static BOOL plsim_delta_patch (NSData *ops, NSData *base, NSMutableData *output, uint64_t *outReused, uint64_t *outLiteral) {
+    const uint8_t *p = [ops bytes];
+    const uint8_t *end = p + [ops length];
+    uint64_t reused = 0;
+    uint64_t literal = 0;
+
+    while (p < end) {
+        uint8_t op = *p++;
+
+        if (op == OP_COPY) {
+            uint64_t fields[2];
+            if ((size_t) (end - p) < sizeof(fields))
+                return NO;
+
+            memcpy(fields, p, sizeof(fields));
+            p += sizeof(fields);
+
+            uint64_t offset = OSSwapLittleToHostInt64(fields[0]);
+            uint64_t length = OSSwapLittleToHostInt64(fields[1]);
+            if (output != nil) {
+                if (offset > [base length] || length > [base length] - offset)
+                    return NO;
+
+                [output appendBytes: (const uint8_t *) [base bytes] + offset length: length];
+            }
+            reused += length;
+
+        } else if (op == OP_DATA) {
+            uint64_t field;
+            if ((size_t) (end - p) < sizeof(field))
+                return NO;
+
+            memcpy(&field, p, sizeof(field));
+            p += sizeof(field);
+
+            uint64_t length = OSSwapLittleToHostInt64(field);
+            if (length > (uint64_t) (end - p))
+                return NO;
+
+            [output appendBytes: p length: length];
+            p += length;
+            literal += length;
+
+        } else {
+            return NO;
+        }
+    }
+
+    if (outReused != NULL)
+        *outReused = reused;
+
+    if (outLiteral != NULL)
+        *outLiteral = literal;
+
+    return YES;
+}
+
+/* Returns YES if the bundle-relative @a path is relative, and does not reference a parent directory. */
+static BOOL plsim_delta_valid_path (id path) {
+    if (![path isKindOfClass: [NSString class]] || [path length] == 0 || [path isAbsolutePath])
+        return NO;
+
+    return ![[path pathComponents] containsObject: @".."];
+}
+
+/* Returns YES if the bundle-relative symbolic link at @a path is valid, and @a destination resolves within the bundle. */
+static BOOL plsim_delta_valid_link (NSString *path, id destination) {
+    if (!plsim_delta_valid_path(path) || ![destination isKindOfClass: [NSString class]] || [destination length] == 0 || [destination isAbsolutePath])
+        return NO;
+
+    /* Resolve the destination relative to the link's parent directory, without following other links */
+    NSInteger depth = [[path pathComponents] count] - 1;
+    for (NSString *component in [destination pathComponents]) {
+        if ([component isEqualToString: @".."])
+            depth--;
+        else if (![component isEqualToString: @"."] && ![component isEqualToString: @"/"])
+            depth++;
+
+        if (depth < 0)
+            return NO;
+    }
+
+    return YES;
+}
+
+@interface PLBundleDelta (PrivateMethods)
+- (BOOL) loadEntries: (NSDictionary *) entries manifest: (PLBundleManifest *) manifest;
+- (BOOL) reconstructFile: (NSString *) file
+               fromEntry: (NSDictionary *) entry
+            bundleAtPath: (NSString *) oldPath
+         destinationPath: (NSString *) destinationPath
+                   error: (NSError **) outError;
+@end
+
+/**
+ * A compact binary delta between two versions of a bundle, from which the new version may be reconstructed
+ * given only the old version.
+ *
+ * Files present anywhere in the old bundle -- whether unchanged, renamed, or duplicated -- are referenced by
+ * path. Changed files are stored as block-level patches against the file at the same path in the old bundle,
+ * and only added files are stored in their entirety. The new bundle's manifest is embedded in the delta, and
+ * the reconstructed bundle is verified against it; symbolic links are recreated from the manifest.
+ *
+ * Changed files are diffed, and all files are reconstructed, concurrently.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLBundleDelta
+
+@synthesize manifest = _manifest;
+@synthesize copiedFileCount = _copiedFileCount;
+@synthesize patchedFileCount = _patchedFileCount;
+@synthesize literalFileCount = _literalFileCount;
+@synthesize reusedByteCount = _reusedByteCount;
+@synthesize literalByteCount = _literalByteCount;
+
+/**
+ * Read a delta previously written via PLBundleDelta::writeToFile:error:.
+ *
+ * @param path Delta path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
++ (id) deltaWithContentsOfFile: (NSString *) path error: (NSError **) outError {
+    return [[self alloc] initWithContentsOfFile: path error: outError];
+}
+
+/**
+ * Initialize a new delta by comparing the bundle at @a oldPath with the bundle at @a newPath.
+ *
+ * @param oldPath Path to the previous version of the bundle.
+ * @param newPath Path to the new version of the bundle.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (id) initWithBundlePath: (NSString *) oldPath newBundlePath: (NSString *) newPath error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    PLBundleManifest *oldManifest = [[PLBundleManifest alloc] initWithBundlePath: oldPath error: outError];
+    if (oldManifest == nil)
+        return nil;
+
+    PLBundleManifest *newManifest = [[PLBundleManifest alloc] initWithBundlePath: newPath error: outError];
+    if (newManifest == nil)
+        return nil;
+
+    /* Index the old bundle's files by digest. Paths are sorted so that the source chosen for duplicated
+     * files is stable. */
+    NSMutableDictionary *sources = [NSMutableDictionary dictionaryWithCapacity: [oldManifest.digests count]];
+    for (NSString *file in [[oldManifest.digests allKeys] sortedArrayUsingSelector: @selector(compare:)]) {
+        NSData *digest = [oldManifest.digests objectForKey: file];
+        if ([sources objectForKey: digest] == nil)
+            [sources setObject: file forKey: digest];
+    }
+
+    /* The new bundle's manifest file is excluded from its digests, but must still be reconstructed */
+    NSFileManager *fm = [NSFileManager new];
+    NSMutableArray *files = [NSMutableArray arrayWithArray: [newManifest.digests allKeys]];
+    if ([fm fileExistsAtPath: [newPath stringByAppendingPathComponent: PLBundleManifestDefaultPath]])
+        [files addObject: PLBundleManifestDefaultPath];
+
+    NSMutableDictionary *entries = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    NSMutableDictionary *modes = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    NSMutableArray *changed = [NSMutableArray array];
+    for (NSString *file in files) {
+        NSError *error;
+        NSDictionary *attrs = [fm attributesOfItemAtPath: [newPath stringByAppendingPathComponent: file] error: &error];
+        if (attrs == nil) {
+            NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not read %@.", @"Unreadable bundle file"), file];
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+            return nil;
+        }
+
+        NSNumber *mode = [attrs objectForKey: NSFilePosixPermissions];
+        [modes setObject: mode forKey: file];
+
+        /* Prefer the file at the same path; otherwise, any old file with identical contents */
+        NSData *digest = [newManifest.digests objectForKey: file];
+        NSString *source = nil;
+        if (digest != nil && [[oldManifest.digests objectForKey: file] isEqual: digest])
+            source = file;
+        else if (digest != nil)
+            source = [sources objectForKey: digest];
+
+        if (source != nil) {
+            [entries setObject: [NSDictionary dictionaryWithObjectsAndKeys: mode, ModeKey, source, SourceKey, nil] forKey: file];
+        } else {
+            [changed addObject: file];
+        }
+    }
+
+    /* Diff the changed files concurrently; each is an independent unit of work */
+    __block NSError *diffError = nil;
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_apply([changed count], queue, ^(size_t i) {
+        @autoreleasepool {
+            NSString *file = [changed objectAtIndex: i];
+            NSError *error;
+
+            NSData *target = [NSData dataWithContentsOfFile: [newPath stringByAppendingPathComponent: file] options: NSDataReadingMappedIfSafe error: &error];
+            if (target == nil) {
+                NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not read %@.", @"Unreadable bundle file"), file];
+                @synchronized (entries) {
+                    if (diffError == nil)
+                        diffError = plsimulator_nserror(PLSimulatorErrorOperatingSystem, desc, error);
+                }
+                return;
+            }
+
+            /* A missing base file is not an error; the file is simply stored in its entirety */
+            NSData *base = [NSData dataWithContentsOfFile: [oldPath stringByAppendingPathComponent: file] options: NSDataReadingMappedIfSafe error: NULL];
+            NSData *ops = nil;
+            uint64_t reused = 0;
+            if ([base length] > 0)
+                ops = plsim_delta_diff(base, target, &reused);
+
+            NSMutableDictionary *entry = [NSMutableDictionary dictionaryWithObject: [modes objectForKey: file] forKey: ModeKey];
+            if (ops != nil && reused > 0) {
+                [entry setObject: file forKey: BaseKey];
+                [entry setObject: ops forKey: OperationsKey];
+            } else {
+                [entry setObject: target forKey: DataKey];
+            }
+
+            @synchronized (entries) {
+                [entries setObject: entry forKey: file];
+            }
+        }
+    });
+
+    if (diffError != nil) {
+        if (outError != NULL)
+            *outError = diffError;
+        return nil;
+    }
+
+    [self loadEntries: entries manifest: newManifest];
+
+    return self;
+}
+
+/**
+ * Initialize a delta previously written via PLBundleDelta::writeToFile:error:.
+ *
+ * @param path Delta path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (id) initWithContentsOfFile: (NSString *) path error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    NSData *data = [NSData dataWithContentsOfMappedFile: path];
+    NSString *errorDesc;
+    id plist = nil;
+    if (data != nil) {
+        plist = [NSPropertyListSerialization propertyListFromData: data
+                                                 mutabilityOption: NSPropertyListImmutable
+                                                           format: NULL
+                                                 errorDescription: &errorDesc];
+    }
+
+    NSString *desc = NSLocalizedString(@"The bundle delta is missing or uses an unsupported format.", @"Invalid delta");
+    if (![plist isKindOfClass: [NSDictionary class]] ||
+        [[plist objectForKey: VersionKey] intValue] != DELTA_VERSION ||
+        ![[plist objectForKey: FilesKey] isKindOfClass: [NSDictionary class]])
+    {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithPropertyList: [plist objectForKey: ManifestKey] error: outError];
+    if (manifest == nil)
+        return nil;
+
+    if (![self loadEntries: [plist objectForKey: FilesKey] manifest: manifest]) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    return self;
+}
+
+/**
+ * Write the delta to @a path as a binary property list.
+ *
+ * @param path Destination path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) writeToFile: (NSString *) path error: (NSError **) outError {
+    NSDictionary *plist = [NSDictionary dictionaryWithObjectsAndKeys:
+                           [NSNumber numberWithInt: DELTA_VERSION], VersionKey,
+                           [_manifest propertyListRepresentation], ManifestKey,
+                           _entries, FilesKey,
+                           nil];
+
+    NSString *errorDesc;
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: plist
+                                                               format: NSPropertyListBinaryFormat_v1_0
+                                                     errorDescription: &errorDesc];
+    if (data == nil) {
+        NSLog(@"Failed to serialize bundle delta: %@", errorDesc);
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return NO;
+    }
+
+    NSError *error;
+    if (![data writeToFile: path options: NSDataWritingAtomic error: &error]) {
+        NSString *desc = NSLocalizedString(@"Could not write the bundle delta.", @"Write failure");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+        return NO;
+    }
+
+    return YES;
+}
+
+/**
+ * Reconstruct the new bundle at @a destinationPath from the old bundle at @a oldPath, and verify the result
+ * against the new bundle's manifest.
+ *
+ * @param oldPath Path to the previous version of the bundle from which the delta was generated.
+ * @param destinationPath Path at which the new bundle will be written. Must not already exist.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns the verification result, or nil if the bundle could not be reconstructed. If reconstruction
+ * fails, any partially written bundle is removed. A reconstructed bundle that does not match the manifest -- for
+ * instance, as the old bundle differs from the one the delta was generated against -- is reported via the
+ * result, not as an error, and is left in place for inspection.
+ */
+- (PLBundleVerificationResult *) applyToBundleAtPath: (NSString *) oldPath
+                                     destinationPath: (NSString *) destinationPath
+                                               error: (NSError **) outError
+{
+    NSFileManager *fm = [NSFileManager new];
+    if ([fm fileExistsAtPath: destinationPath]) {
+        NSString *desc = NSLocalizedString(@"The destination bundle path already exists.", @"Delta destination exists");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    /* Create all directories up-front, so that the workers need not race to create shared parents */
+    NSMutableSet *directories = [NSMutableSet setWithObject: destinationPath];
+    for (NSString *file in _entries)
+        [directories addObject: [[destinationPath stringByAppendingPathComponent: file] stringByDeletingLastPathComponent]];
+
+    NSDictionary *links = _manifest.symbolicLinks;
+    for (NSString *link in links)
+        [directories addObject: [[destinationPath stringByAppendingPathComponent: link] stringByDeletingLastPathComponent]];
+
+    for (NSString *directory in directories) {
+        NSError *error;
+        if (![fm createDirectoryAtPath: directory withIntermediateDirectories: YES attributes: nil error: &error]) {
+            [fm removeItemAtPath: destinationPath error: NULL];
+
+            NSString *desc = NSLocalizedString(@"Could not create the destination bundle.", @"Delta destination failure");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+            return nil;
+        }
+    }
+
+    /* Each file is reconstructed independently */
+    NSArray *files = [_entries allKeys];
+    __block NSError *applyError = nil;
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_apply([files count], queue, ^(size_t i) {
+        @autoreleasepool {
+            NSString *file = [files objectAtIndex: i];
+            NSError *error;
+            if (![self reconstructFile: file fromEntry: [_entries objectForKey: file] bundleAtPath: oldPath destinationPath: destinationPath error: &error]) {
+                @synchronized (files) {
+                    if (applyError == nil)
+                        applyError = error;
+                }
+            }
+        }
+    });
+
+    if (applyError != nil) {
+        [fm removeItemAtPath: destinationPath error: NULL];
+
+        if (outError != NULL)
+            *outError = applyError;
+        return nil;
+    }
+
+    /* Symbolic links are recreated from the manifest once all files have been written, so that no file is written
+     * through a link; links removed from the new bundle are simply not created */
+    for (NSString *link in links) {
+        NSError *error;
+        NSString *linkPath = [destinationPath stringByAppendingPathComponent: link];
+        if (![fm createSymbolicLinkAtPath: linkPath withDestinationPath: [links objectForKey: link] error: &error]) {
+            [fm removeItemAtPath: destinationPath error: NULL];
+
+            NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not create the symbolic link %@.", @"Delta link failure"), link];
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+            return nil;
+        }
+    }
+
+    return [_manifest verifyBundleAtPath: destinationPath error: outError];
+}
+
+// property getter
+- (NSUInteger) fileCount {
+    return [_entries count];
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"%@ - %lu files (%lu copied, %lu patched, %lu stored); %llu bytes reused, %llu bytes stored",
+            [self class], (unsigned long) self.fileCount, (unsigned long) _copiedFileCount, (unsigned long) _patchedFileCount,
+            (unsigned long) _literalFileCount, (unsigned long long) _reusedByteCount, (unsigned long long) _literalByteCount];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLBundleDelta (PrivateMethods)
+
+/**
+ * Validate and adopt @a entries and @a manifest, computing the delta's statistics.
+ *
+ * @param entries Maps new bundle-relative paths to their reconstruction entries.
+ * @param manifest Manifest of the new bundle.
+ *
+ * @return Returns NO if any entry or symbolic link is malformed.
+ */
+- (BOOL) loadEntries: (NSDictionary *) entries manifest: (PLBundleManifest *) manifest {
+    NSUInteger copied = 0;
+    NSUInteger patched = 0;
+    NSUInteger stored = 0;
+    uint64_t reusedBytes = 0;
+    uint64_t literalBytes = 0;
+
+    for (NSString *file in entries) {
+        NSDictionary *entry = [entries objectForKey: file];
+        if (!plsim_delta_valid_path(file) || ![entry isKindOfClass: [NSDictionary class]] || ![[entry objectForKey: ModeKey] isKindOfClass: [NSNumber class]])
+            return NO;
+
+        id source = [entry objectForKey: SourceKey];
+        id base = [entry objectForKey: BaseKey];
+        id ops = [entry objectForKey: OperationsKey];
+        id data = [entry objectForKey: DataKey];
+
+        if (source != nil) {
+            if (!plsim_delta_valid_path(source))
+                return NO;
+
+            copied++;
+            reusedBytes += [[manifest.sizes objectForKey: file] unsignedLongLongValue];
+
+        } else if (base != nil) {
+            uint64_t reused;
+            uint64_t literal;
+            if (!plsim_delta_valid_path(base) || ![ops isKindOfClass: [NSData class]] || !plsim_delta_patch(ops, nil, nil, &reused, &literal))
+                return NO;
+
+            patched++;
+            reusedBytes += reused;
+            literalBytes += literal;
+
+        } else if ([data isKindOfClass: [NSData class]]) {
+            stored++;
+            literalBytes += [data length];
+
+        } else {
+            return NO;
+        }
+    }
+
+    NSDictionary *links = manifest.symbolicLinks;
+    for (NSString *link in links) {
+        if (!plsim_delta_valid_link(link, [links objectForKey: link]))
+            return NO;
+    }
+
+    _entries = entries;
+    _manifest = manifest;
+    _copiedFileCount = copied;
+    _patchedFileCount = patched;
+    _literalFileCount = stored;
+    _reusedByteCount = reusedBytes;
+    _literalByteCount = literalBytes;
+
+    return YES;
+}
+
+/**
+ * Reconstruct a single file.
+ *
+ * @param file New bundle-relative path of the file.
+ * @param entry The file's reconstruction entry.
+ * @param oldPath Path to the previous version of the bundle.
+ * @param destinationPath Path to the bundle being reconstructed.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (BOOL) reconstructFile: (NSString *) file
+               fromEntry: (NSDictionary *) entry
+            bundleAtPath: (NSString *) oldPath
+         destinationPath: (NSString *) destinationPath
+                   error: (NSError **) outError
+{
+    NSString *target = [destinationPath stringByAppendingPathComponent: file];
+    NSString *source = [entry objectForKey: SourceKey];
+    NSString *base = [entry objectForKey: BaseKey];
+    NSError *error;
+
+    if (source != nil) {
+        NSString *sourcePath = [oldPath stringByAppendingPathComponent: source];
+        if (copyfile([sourcePath fileSystemRepresentation], [target fileSystemRepresentation], NULL, COPYFILE_DATA) != 0) {
+            NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not copy %@ from the original bundle.", @"Delta copy failure"), source];
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil]);
+            return NO;
+        }
+    } else {
+        NSData *contents = [entry objectForKey: DataKey];
+
+        if (base != nil) {
+            NSData *baseData = [NSData dataWithContentsOfFile: [oldPath stringByAppendingPathComponent: base] options: NSDataReadingMappedIfSafe error: &error];
+            if (baseData == nil) {
+                NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not read %@ from the original bundle.", @"Delta base failure"), base];
+                plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+                return NO;
+            }
+
+            NSMutableData *output = [NSMutableData data];
+            if (!plsim_delta_patch([entry objectForKey: OperationsKey], baseData, output, NULL, NULL)) {
+                NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not patch %@; the original bundle does not match the delta.", @"Delta patch failure"), base];
+                plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+                return NO;
+            }
+
+            contents = output;
+        }
+
+        if (![contents writeToFile: target options: 0 error: &error]) {
+            NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not write %@.", @"Delta write failure"), file];
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+            return NO;
+        }
+    }
+
+    if (chmod([target fileSystemRepresentation], [[entry objectForKey: ModeKey] unsignedShortValue]) != 0) {
+        NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not set the permissions of %@.", @"Delta chmod failure"), file];
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, [NSError errorWithDomain: NSPOSIXErrorDomain code: errno userInfo: nil]);
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
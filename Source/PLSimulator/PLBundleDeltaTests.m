@@ -0,0 +1,206 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulator.h"
+#import "PLBundleDelta.h"
+
+#import "PLSyntheticFixtures.h"
+
+#import <sys/stat.h>
+
+@interface PLBundleDeltaTests : PLTestCase {
+@private
+    /** Temporary directory containing the old and new bundles */
+    NSString *_root;
+
+    /** Old bundle path */
+    NSString *_oldPath;
+
+    /** New bundle path */
+    NSString *_newPath;
+
+    /** Reconstructed bundle path */
+    NSString *_destinationPath;
+}
+@end
+
+@implementation PLBundleDeltaTests
+
+/* Return @a length bytes of deterministic pseudo-random data */
+static NSMutableData *random_data (NSUInteger length, uint32_t seed) {
+    NSMutableData *data = [NSMutableData dataWithLength: length];
+    uint8_t *bytes = [data mutableBytes];
+    for (NSUInteger i = 0; i < length; i++) {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = seed >> 16;
+    }
+    return data;
+}
+
+- (void) writeData: (NSData *) data toPath: (NSString *) path {
+    NSError *error;
+    STAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath: [path stringByDeletingLastPathComponent] withIntermediateDirectories: YES attributes: nil error: &error], @"Could not create directory: %@", error);
+    STAssertTrue([data writeToFile: path options: 0 error: &error], @"Could not write file: %@", error);
+}
+
+- (void) setUp {
+    _root = [self temporaryDirectory];
+    _oldPath = [_root stringByAppendingPathComponent: @"Old.app"];
+    _newPath = [_root stringByAppendingPathComponent: @"New.app"];
+    _destinationPath = [_root stringByAppendingPathComponent: @"Reconstructed.app"];
+
+    /* The old bundle: an executable, and a handful of resources */
+    NSMutableData *executable = random_data(256 * 1024, 1);
+    [self writeData: executable toPath: [_oldPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"]];
+    chmod([[_oldPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"] fileSystemRepresentation], 0755);
+
+    for (int i = 0; i < 4; i++)
+        [self writeData: random_data(8192, 100 + i) toPath: [_oldPath stringByAppendingPathComponent: [NSString stringWithFormat: @"Contents/Resources/resource-%d", i]]];
+
+    /* The new bundle: the executable has bytes inserted and modified, one resource is renamed, one removed,
+     * and one added */
+    NSMutableData *newExecutable = [executable mutableCopy];
+    [newExecutable replaceBytesInRange: NSMakeRange(100 * 1024, 0) withBytes: [random_data(100, 2) bytes] length: 100];
+    [newExecutable replaceBytesInRange: NSMakeRange(200 * 1024, 16) withBytes: [random_data(16, 3) bytes]];
+    [self writeData: newExecutable toPath: [_newPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"]];
+    chmod([[_newPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"] fileSystemRepresentation], 0755);
+
+    [self writeData: random_data(8192, 100) toPath: [_newPath stringByAppendingPathComponent: @"Contents/Resources/resource-0"]];
+    [self writeData: random_data(8192, 101) toPath: [_newPath stringByAppendingPathComponent: @"Contents/Resources/renamed"]];
+    [self writeData: random_data(8192, 103) toPath: [_newPath stringByAppendingPathComponent: @"Contents/Resources/resource-3"]];
+    [self writeData: random_data(1024, 200) toPath: [_newPath stringByAppendingPathComponent: @"Contents/Resources/added"]];
+
+    NSError *error;
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: _newPath error: &error];
+    STAssertNotNil(manifest, @"Could not create manifest: %@", error);
+    STAssertTrue([manifest writeToFile: [_newPath stringByAppendingPathComponent: PLBundleManifestDefaultPath] error: &error], @"Could not write manifest: %@", error);
+}
+
+- (void) testRoundTrip {
+    NSError *error;
+    PLBundleDelta *delta = [[PLBundleDelta alloc] initWithBundlePath: _oldPath newBundlePath: _newPath error: &error];
+    STAssertNotNil(delta, @"Could not create delta: %@", error);
+
+    /* Unchanged and renamed resources are copied; the executable is patched; the added resource and the manifest
+     * are stored */
+    STAssertEquals(delta.fileCount, (NSUInteger) 6, @"Incorrect file count: %@", delta);
+    STAssertEquals(delta.copiedFileCount, (NSUInteger) 3, @"Incorrect copied file count: %@", delta);
+    STAssertEquals(delta.patchedFileCount, (NSUInteger) 1, @"Incorrect patched file count: %@", delta);
+    STAssertEquals(delta.literalFileCount, (NSUInteger) 2, @"Incorrect stored file count: %@", delta);
+
+    /* Only the blocks surrounding the two executable changes should be stored */
+    uint64_t manifestSize = [[[NSFileManager defaultManager] attributesOfItemAtPath: [_newPath stringByAppendingPathComponent: PLBundleManifestDefaultPath] error: NULL] fileSize];
+    STAssertTrue(delta.literalByteCount <= 1024 + manifestSize + (4 * 2048), @"Delta is too large: %@", delta);
+
+    NSString *deltaPath = [_root stringByAppendingPathComponent: @"update.delta"];
+    STAssertTrue([delta writeToFile: deltaPath error: &error], @"Could not write delta: %@", error);
+
+    PLBundleDelta *loaded = [PLBundleDelta deltaWithContentsOfFile: deltaPath error: &error];
+    STAssertNotNil(loaded, @"Could not read delta: %@", error);
+    STAssertEquals(loaded.reusedByteCount, delta.reusedByteCount, @"Statistics not preserved");
+    STAssertEquals(loaded.literalByteCount, delta.literalByteCount, @"Statistics not preserved");
+    STAssertEqualObjects(loaded.manifest.digests, delta.manifest.digests, @"Manifest not preserved");
+
+    PLBundleVerificationResult *result = [loaded applyToBundleAtPath: _oldPath destinationPath: _destinationPath error: &error];
+    STAssertNotNil(result, @"Could not apply delta: %@", error);
+    STAssertTrue(result.valid, @"Reconstructed bundle should verify: %@", result);
+
+    /* Permissions and the manifest file itself must be reconstructed */
+    NSString *executable = [_destinationPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"];
+    NSDictionary *attrs = [[NSFileManager defaultManager] attributesOfItemAtPath: executable error: NULL];
+    STAssertEquals([[attrs objectForKey: NSFilePosixPermissions] unsignedShortValue], (unsigned short) 0755, @"Permissions not preserved");
+
+    NSData *manifest = [NSData dataWithContentsOfFile: [_destinationPath stringByAppendingPathComponent: PLBundleManifestDefaultPath]];
+    STAssertEqualObjects(manifest, [NSData dataWithContentsOfFile: [_newPath stringByAppendingPathComponent: PLBundleManifestDefaultPath]], @"Manifest not reconstructed");
+}
+
+- (void) testMismatchedBase {
+    NSError *error;
+    PLBundleDelta *delta = [[PLBundleDelta alloc] initWithBundlePath: _oldPath newBundlePath: _newPath error: &error];
+    STAssertNotNil(delta, @"Could not create delta: %@", error);
+
+    /* A truncated base can not be patched; the partial bundle must be removed */
+    STAssertTrue([[NSData data] writeToFile: [_oldPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"] atomically: NO], @"Could not truncate file");
+    STAssertNil([delta applyToBundleAtPath: _oldPath destinationPath: _destinationPath error: &error], @"Delta should not apply");
+    STAssertNotNil(error, @"Error was not populated");
+    STAssertFalse([[NSFileManager defaultManager] fileExistsAtPath: _destinationPath], @"Partial bundle was not removed");
+
+    /* A modified copy source is detected by verification */
+    STAssertTrue([[NSData data] writeToFile: [_oldPath stringByAppendingPathComponent: @"Contents/Resources/resource-1"] atomically: NO], @"Could not truncate file");
+    [self writeData: random_data(256 * 1024, 1) toPath: [_oldPath stringByAppendingPathComponent: @"Contents/MacOS/Launcher"]];
+
+    PLBundleVerificationResult *result = [delta applyToBundleAtPath: _oldPath destinationPath: _destinationPath error: &error];
+    STAssertNotNil(result, @"Could not apply delta: %@", error);
+    STAssertFalse(result.valid, @"Reconstructed bundle should not verify");
+    STAssertEqualObjects(result.mismatchedPaths, [NSArray arrayWithObject: @"Contents/Resources/renamed"], @"Incorrect mismatches");
+}
+
+/* Symbolic links must be created and removed to match the new bundle */
+- (void) testSymbolicLinks {
+    NSError *error;
+    NSFileManager *fm = [NSFileManager defaultManager];
+
+    /* The old framework provides version A and a Headers link; the new framework adds version B, makes it current,
+     * and drops the Headers link */
+    NSString *oldFramework = [_oldPath stringByAppendingPathComponent: @"Contents/Frameworks/Test.framework"];
+    [self writeVersionedFrameworkAtPath: oldFramework version: @"A"];
+    STAssertTrue([fm createSymbolicLinkAtPath: [oldFramework stringByAppendingPathComponent: @"Headers"] withDestinationPath: @"Versions/Current/Headers" error: &error], @"Could not create link: %@", error);
+
+    NSString *newFramework = [_newPath stringByAppendingPathComponent: @"Contents/Frameworks/Test.framework"];
+    [self writeVersionedFrameworkAtPath: newFramework version: @"A"];
+    STAssertTrue([fm removeItemAtPath: newFramework error: &error], @"Could not remove framework: %@", error);
+    [self writeVersionedFrameworkAtPath: newFramework version: @"B"];
+
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: _newPath error: &error];
+    STAssertNotNil(manifest, @"Could not create manifest: %@", error);
+    STAssertTrue([manifest writeToFile: [_newPath stringByAppendingPathComponent: PLBundleManifestDefaultPath] error: &error], @"Could not write manifest: %@", error);
+
+    PLBundleDelta *delta = [[PLBundleDelta alloc] initWithBundlePath: _oldPath newBundlePath: _newPath error: &error];
+    STAssertNotNil(delta, @"Could not create delta: %@", error);
+
+    NSString *deltaPath = [_root stringByAppendingPathComponent: @"update.delta"];
+    STAssertTrue([delta writeToFile: deltaPath error: &error], @"Could not write delta: %@", error);
+
+    PLBundleDelta *loaded = [PLBundleDelta deltaWithContentsOfFile: deltaPath error: &error];
+    STAssertNotNil(loaded, @"Could not read delta: %@", error);
+    STAssertEqualObjects(loaded.manifest.symbolicLinks, manifest.symbolicLinks, @"Symbolic links not preserved");
+
+    PLBundleVerificationResult *result = [loaded applyToBundleAtPath: _oldPath destinationPath: _destinationPath error: &error];
+    STAssertNotNil(result, @"Could not apply delta: %@", error);
+    STAssertTrue(result.valid, @"Reconstructed bundle should verify: %@", result);
+
+    NSString *framework = [_destinationPath stringByAppendingPathComponent: @"Contents/Frameworks/Test.framework"];
+    STAssertEqualObjects([fm destinationOfSymbolicLinkAtPath: [framework stringByAppendingPathComponent: @"Versions/Current"] error: NULL], @"B", @"Current version was not linked");
+    STAssertEqualObjects([fm destinationOfSymbolicLinkAtPath: [framework stringByAppendingPathComponent: @"Test"] error: NULL], @"Versions/Current/Test", @"Executable was not linked");
+    STAssertNil([fm attributesOfItemAtPath: [framework stringByAppendingPathComponent: @"Headers"] error: NULL], @"Removed link was created");
+    STAssertNotNil([NSData dataWithContentsOfFile: [framework stringByAppendingPathComponent: @"Test"]], @"Executable can not be read via its link");
+}
+
+@end
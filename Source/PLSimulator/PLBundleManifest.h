@@ -0,0 +1,117 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/** The bundle-relative path at which PLBundleManifest instances are conventionally stored. */
+extern NSString *PLBundleManifestDefaultPath;
+
+@interface PLBundleVerificationResult : NSObject {
+@private
+    /** Paths whose contents or link destinations do not match the manifest. */
+    NSArray *_mismatchedPaths;
+
+    /** Paths listed in the manifest that are missing from the bundle. */
+    NSArray *_missingPaths;
+
+    /** Paths found in the bundle that are not listed in the manifest. */
+    NSArray *_unexpectedPaths;
+
+    /** Number of files hashed. */
+    NSUInteger _fileCount;
+
+    /** Number of bytes hashed. */
+    uint64_t _byteCount;
+
+    /** Wall-clock duration of the verification, in seconds. */
+    NSTimeInterval _duration;
+}
+
+/** Bundle-relative paths whose contents or symbolic link destinations do not match the manifest. */
+@property(nonatomic, readonly) NSArray *mismatchedPaths;
+
+/** Bundle-relative paths listed in the manifest that are missing from the bundle. */
+@property(nonatomic, readonly) NSArray *missingPaths;
+
+/** Bundle-relative paths found in the bundle that are not listed in the manifest. */
+@property(nonatomic, readonly) NSArray *unexpectedPaths;
+
+/** Number of files hashed. */
+@property(nonatomic, readonly) NSUInteger fileCount;
+
+/** Number of bytes hashed. */
+@property(nonatomic, readonly) uint64_t byteCount;
+
+/** Wall-clock duration of the verification, in seconds. */
+@property(nonatomic, readonly) NSTimeInterval duration;
+
+/** Hashing throughput, in bytes per second. */
+@property(nonatomic, readonly) double throughput;
+
+/** YES if the bundle exactly matched the manifest. */
+@property(nonatomic, readonly, getter=isValid) BOOL valid;
+
+@end
+
+@interface PLBundleManifest : NSObject {
+@private
+    /** Maps bundle-relative paths to their SHA-256 digests. */
+    NSDictionary *_digests;
+
+    /** Maps bundle-relative paths to their sizes, as NSNumbers. */
+    NSDictionary *_sizes;
+
+    /** Maps bundle-relative symbolic link paths to their destinations. */
+    NSDictionary *_symbolicLinks;
+}
+
++ (id) manifestWithContentsOfFile: (NSString *) path error: (NSError **) outError;
+
+- (id) initWithBundlePath: (NSString *) path error: (NSError **) outError;
+- (id) initWithContentsOfFile: (NSString *) path error: (NSError **) outError;
+- (id) initWithPropertyList: (id) plist error: (NSError **) outError;
+
+- (NSDictionary *) propertyListRepresentation;
+
+- (BOOL) writeToFile: (NSString *) path error: (NSError **) outError;
+
+- (PLBundleVerificationResult *) verifyBundleAtPath: (NSString *) path error: (NSError **) outError;
+
+/** Maps bundle-relative paths to their SHA-256 digests, as NSData instances. */
+@property(nonatomic, readonly) NSDictionary *digests;
+
+/** Maps bundle-relative paths to their sizes in bytes, as NSNumber instances. */
+@property(nonatomic, readonly) NSDictionary *sizes;
+
+/**
+ * Maps bundle-relative symbolic link paths to their unresolved destinations, as NSString instances. Links are
+ * recorded rather than followed, such as the Versions/Current and top-level links of a versioned framework.
+ */
+@property(nonatomic, readonly) NSDictionary *symbolicLinks;
+
+@end
@@ -0,0 +1,527 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLBundleManifest.h"
+
+#import "PLSimulator.h"
+#import "PLSimulatorStats.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+#import <unistd.h>
+#import <fcntl.h>
+#import <sys/stat.h>
+
+/** Bundle-relative manifest path
+ * @ingroup globals */
+NSString *PLBundleManifestDefaultPath = @"Contents/Resources/PLBundleManifest.plist";
+
+/* Manifest format version */
+#define MANIFEST_VERSION 1
+
+/* Manifest plist keys */
+#define VersionKey @"Version"
+#define AlgorithmKey @"Algorithm"
+#define FilesKey @"Files"
+#define DigestKey @"Digest"
+#define SizeKey @"Size"
+#define SymbolicLinksKey @"SymbolicLinks"
+
+/* The only supported digest algorithm */
+#define SHA256Algorithm @"SHA-256"
+
+/* Size of the per-file read buffer. Allocated on the worker's stack. */
+#define READ_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @internal
+ *
+ * The result of hashing a single file.
+ */
+typedef struct plsim_file_digest {
+    /** YES if the file was successfully hashed */
+    BOOL valid;
+
+    /** Number of bytes hashed */
+    uint64_t size;
+
+    /** SHA-256 digest */
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+} plsim_file_digest_t;
+
+/*
+ * Hash the file at @a path into @a result. CommonCrypto's SHA-256 implementation is vectorized on
+ * all supported hosts.
+ */
+static void plsim_hash_file (const char *path, plsim_file_digest_t *result) {
+    uint8_t buffer[READ_BUFFER_SIZE];
+    CC_SHA256_CTX ctx;
+
+    result->valid = NO;
+    result->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    CC_SHA256_Init(&ctx);
+
+    ssize_t nread;
+    while ((nread = read(fd, buffer, sizeof(buffer))) != 0) {
+        if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+
+            close(fd);
+            return;
+        }
+
+        CC_SHA256_Update(&ctx, buffer, (CC_LONG) nread);
+        result->size += nread;
+    }
+
+    close(fd);
+
+    CC_SHA256_Final(result->digest, &ctx);
+    result->valid = YES;
+
+    plsimulator_stats_add(PLSimulatorCounterManifestFilesDigested, 1);
+    plsimulator_stats_add(PLSimulatorCounterManifestBytesDigested, result->size);
+    plsimulator_stats_record(PLSimulatorHistogramManifestFileSize, result->size);
+}
+
+/*
+ * Find all regular files within @a root, excluding @a excludedPath. Symbolic links are not followed; their
+ * destinations are returned via @a outLinks. Returns nil on failure.
+ */
+static NSArray *plsim_bundle_files (NSString *root, NSString *excludedPath, NSDictionary **outLinks, NSError **outError) {
+    NSFileManager *fm = [NSFileManager new];
+    BOOL isDir;
+    if (![fm fileExistsAtPath: root isDirectory: &isDir] || !isDir) {
+        NSString *desc = NSLocalizedString(@"The provided bundle path does not exist or is not a directory.", @"Missing bundle");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    NSMutableArray *files = [NSMutableArray array];
+    NSMutableDictionary *links = [NSMutableDictionary dictionary];
+    NSDirectoryEnumerator *e = [fm enumeratorAtPath: root];
+    for (NSString *relativePath in e) {
+        NSString *type = [[e fileAttributes] fileType];
+        if ([type isEqual: NSFileTypeSymbolicLink]) {
+            NSError *error;
+            NSString *destination = [fm destinationOfSymbolicLinkAtPath: [root stringByAppendingPathComponent: relativePath] error: &error];
+            if (destination == nil) {
+                NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not read %@.", @"Unreadable bundle file"), relativePath];
+                plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+                return nil;
+            }
+
+            [links setObject: destination forKey: relativePath];
+            continue;
+        }
+
+        if (![type isEqual: NSFileTypeRegular])
+            continue;
+
+        if ([relativePath isEqualToString: excludedPath])
+            continue;
+
+        [files addObject: relativePath];
+    }
+
+    *outLinks = links;
+    return files;
+}
+
+/*
+ * Hash all @a files within @a root concurrently. Returns a malloc'd array of results, in @a files order,
+ * which must be freed by the caller.
+ */
+static plsim_file_digest_t *plsim_hash_files (NSString *root, NSArray *files) {
+    size_t count = [files count];
+    plsim_file_digest_t *results = calloc(count > 0 ? count : 1, sizeof(plsim_file_digest_t));
+
+    /* Resolve all paths up-front; the workers then run without touching any shared Objective-C state */
+    char **paths = calloc(count > 0 ? count : 1, sizeof(char *));
+    for (size_t i = 0; i < count; i++) {
+        NSString *path = [root stringByAppendingPathComponent: [files objectAtIndex: i]];
+        paths[i] = strdup([path fileSystemRepresentation]);
+    }
+
+    /* Each file is an independent unit of work; GCD sizes the worker pool to the host. */
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_apply(count, queue, ^(size_t i) {
+        plsim_hash_file(paths[i], &results[i]);
+    });
+
+    for (size_t i = 0; i < count; i++)
+        free(paths[i]);
+    free(paths);
+
+    return results;
+}
+
+@interface PLBundleVerificationResult ()
+- (id) initWithMismatchedPaths: (NSArray *) mismatched
+                  missingPaths: (NSArray *) missing
+               unexpectedPaths: (NSArray *) unexpected
+                     fileCount: (NSUInteger) fileCount
+                     byteCount: (uint64_t) byteCount
+                      duration: (NSTimeInterval) duration;
+@end
+
+/**
+ * The result of verifying a bundle against a PLBundleManifest.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLBundleVerificationResult
+
+@synthesize mismatchedPaths = _mismatchedPaths;
+@synthesize missingPaths = _missingPaths;
+@synthesize unexpectedPaths = _unexpectedPaths;
+@synthesize fileCount = _fileCount;
+@synthesize byteCount = _byteCount;
+@synthesize duration = _duration;
+
+- (id) initWithMismatchedPaths: (NSArray *) mismatched
+                  missingPaths: (NSArray *) missing
+               unexpectedPaths: (NSArray *) unexpected
+                     fileCount: (NSUInteger) fileCount
+                     byteCount: (uint64_t) byteCount
+                      duration: (NSTimeInterval) duration
+{
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _mismatchedPaths = mismatched;
+    _missingPaths = missing;
+    _unexpectedPaths = unexpected;
+    _fileCount = fileCount;
+    _byteCount = byteCount;
+    _duration = duration;
+
+    return self;
+}
+
+// property getter
+- (double) throughput {
+    if (_duration <= 0)
+        return 0;
+
+    return _byteCount / _duration;
+}
+
+// property getter
+- (BOOL) isValid {
+    return [_mismatchedPaths count] == 0 && [_missingPaths count] == 0 && [_unexpectedPaths count] == 0;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"%@ - %lu mismatched, %lu missing, %lu unexpected; %lu files, %llu bytes in %.3fs (%.1f MB/s)",
+            [self class], (unsigned long) [_mismatchedPaths count], (unsigned long) [_missingPaths count],
+            (unsigned long) [_unexpectedPaths count], (unsigned long) _fileCount, (unsigned long long) _byteCount,
+            _duration, self.throughput / (1024.0 * 1024.0)];
+}
+
+@end
+
+/**
+ * A manifest of per-file SHA-256 digests for a bundle, used to verify that a bundle is intact.
+ *
+ * Files are hashed concurrently, allowing bundles containing tens of thousands of files to be hashed
+ * and verified without serializing all I/O on a single thread.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLBundleManifest
+
+@synthesize digests = _digests;
+@synthesize sizes = _sizes;
+@synthesize symbolicLinks = _symbolicLinks;
+
+/**
+ * Read a manifest previously written via PLBundleManifest::writeToFile:error:.
+ *
+ * @param path Manifest path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
++ (id) manifestWithContentsOfFile: (NSString *) path error: (NSError **) outError {
+    return [[self alloc] initWithContentsOfFile: path error: outError];
+}
+
+/**
+ * Initialize a new manifest by hashing all regular files, and recording all symbolic links, within the bundle at
+ * @a path. The manifest file itself, if present at PLBundleManifestDefaultPath, is excluded.
+ *
+ * @param path Bundle path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (id) initWithBundlePath: (NSString *) path error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    NSDictionary *links;
+    NSArray *files = plsim_bundle_files(path, PLBundleManifestDefaultPath, &links, outError);
+    if (files == nil)
+        return nil;
+
+    plsim_file_digest_t *results = plsim_hash_files(path, files);
+
+    NSMutableDictionary *digests = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    NSMutableDictionary *sizes = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    for (NSUInteger i = 0; i < [files count]; i++) {
+        NSString *file = [files objectAtIndex: i];
+        if (!results[i].valid) {
+            free(results);
+
+            NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Could not read %@.", @"Unreadable bundle file"), file];
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+            return nil;
+        }
+
+        [digests setObject: [NSData dataWithBytes: results[i].digest length: sizeof(results[i].digest)] forKey: file];
+        [sizes setObject: [NSNumber numberWithUnsignedLongLong: results[i].size] forKey: file];
+    }
+    free(results);
+
+    _digests = digests;
+    _sizes = sizes;
+    _symbolicLinks = links;
+
+    return self;
+}
+
+/**
+ * Initialize a manifest previously written via PLBundleManifest::writeToFile:error:.
+ *
+ * @param path Manifest path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (id) initWithContentsOfFile: (NSString *) path error: (NSError **) outError {
+    NSData *data = [NSData dataWithContentsOfMappedFile: path];
+    NSString *errorDesc;
+    id plist = nil;
+    if (data != nil) {
+        plist = [NSPropertyListSerialization propertyListFromData: data
+                                                 mutabilityOption: NSPropertyListImmutable
+                                                           format: NULL
+                                                 errorDescription: &errorDesc];
+    }
+
+    return [self initWithPropertyList: plist error: outError];
+}
+
+/**
+ * Initialize a manifest from a property list previously returned by
+ * PLBundleManifest::propertyListRepresentation.
+ *
+ * @param plist Manifest property list.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
+- (id) initWithPropertyList: (id) plist error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    if (![plist isKindOfClass: [NSDictionary class]] ||
+        [[plist objectForKey: VersionKey] intValue] != MANIFEST_VERSION ||
+        ![[plist objectForKey: AlgorithmKey] isEqual: SHA256Algorithm] ||
+        ![[plist objectForKey: FilesKey] isKindOfClass: [NSDictionary class]])
+    {
+        NSString *desc = NSLocalizedString(@"The bundle manifest is missing or uses an unsupported format.", @"Invalid manifest");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    NSDictionary *files = [plist objectForKey: FilesKey];
+    NSMutableDictionary *digests = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    NSMutableDictionary *sizes = [NSMutableDictionary dictionaryWithCapacity: [files count]];
+    for (NSString *file in files) {
+        NSDictionary *entry = [files objectForKey: file];
+        NSData *digest = [entry objectForKey: DigestKey];
+        NSNumber *size = [entry objectForKey: SizeKey];
+
+        if (![digest isKindOfClass: [NSData class]] || [digest length] != CC_SHA256_DIGEST_LENGTH || ![size isKindOfClass: [NSNumber class]]) {
+            NSString *desc = NSLocalizedString(@"The bundle manifest contains an invalid entry.", @"Invalid manifest");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+            return nil;
+        }
+
+        [digests setObject: digest forKey: file];
+        [sizes setObject: size forKey: file];
+    }
+
+    /* Manifests written prior to symbolic link support do not declare any */
+    NSDictionary *links = [plist objectForKey: SymbolicLinksKey];
+    if (links == nil)
+        links = [NSDictionary dictionary];
+
+    if (![links isKindOfClass: [NSDictionary class]]) {
+        NSString *desc = NSLocalizedString(@"The bundle manifest contains an invalid entry.", @"Invalid manifest");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return nil;
+    }
+
+    for (NSString *link in links) {
+        if (![[links objectForKey: link] isKindOfClass: [NSString class]]) {
+            NSString *desc = NSLocalizedString(@"The bundle manifest contains an invalid entry.", @"Invalid manifest");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+            return nil;
+        }
+    }
+
+    _digests = digests;
+    _sizes = sizes;
+    _symbolicLinks = links;
+
+    return self;
+}
+
+/**
+ * Return a property list representation of the manifest, suitable for embedding in other property lists.
+ * The manifest may be reconstructed via PLBundleManifest::initWithPropertyList:error:.
+ */
+- (NSDictionary *) propertyListRepresentation {
+    NSMutableDictionary *files = [NSMutableDictionary dictionaryWithCapacity: [_digests count]];
+    for (NSString *file in _digests) {
+        [files setObject: [NSDictionary dictionaryWithObjectsAndKeys:
+                           [_digests objectForKey: file], DigestKey,
+                           [_sizes objectForKey: file], SizeKey,
+                           nil] forKey: file];
+    }
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithInt: MANIFEST_VERSION], VersionKey,
+            SHA256Algorithm, AlgorithmKey,
+            files, FilesKey,
+            _symbolicLinks, SymbolicLinksKey,
+            nil];
+}
+
+/**
+ * Write the manifest to @a path as a binary property list.
+ *
+ * @param path Destination path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) writeToFile: (NSString *) path error: (NSError **) outError {
+    NSDictionary *plist = [self propertyListRepresentation];
+
+    NSString *errorDesc;
+    NSData *data = [NSPropertyListSerialization dataFromPropertyList: plist
+                                                               format: NSPropertyListBinaryFormat_v1_0
+                                                     errorDescription: &errorDesc];
+    if (data == nil) {
+        NSLog(@"Failed to serialize bundle manifest: %@", errorDesc);
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return NO;
+    }
+
+    NSError *error;
+    if (![data writeToFile: path options: NSDataWritingAtomic error: &error]) {
+        NSString *desc = NSLocalizedString(@"Could not write the bundle manifest.", @"Write failure");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+        return NO;
+    }
+
+    return YES;
+}
+
+/**
+ * Concurrently rehash the bundle at @a path and compare it against the receiver.
+ *
+ * @param path Bundle path.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns the verification result, or nil if the bundle could not be read. Mismatched, missing, and
+ * unexpected files and symbolic links are reported via the result, not as an error.
+ */
+- (PLBundleVerificationResult *) verifyBundleAtPath: (NSString *) path error: (NSError **) outError {
+    NSDate *start = [NSDate date];
+
+    NSDictionary *links;
+    NSArray *files = plsim_bundle_files(path, PLBundleManifestDefaultPath, &links, outError);
+    if (files == nil)
+        return nil;
+
+    plsim_file_digest_t *results = plsim_hash_files(path, files);
+
+    NSMutableArray *mismatched = [NSMutableArray array];
+    NSMutableArray *unexpected = [NSMutableArray array];
+    NSMutableSet *missing = [NSMutableSet setWithArray: [_digests allKeys]];
+    [missing addObjectsFromArray: [_symbolicLinks allKeys]];
+    uint64_t byteCount = 0;
+
+    for (NSUInteger i = 0; i < [files count]; i++) {
+        NSString *file = [files objectAtIndex: i];
+        NSData *expected = [_digests objectForKey: file];
+        byteCount += results[i].size;
+
+        if (expected == nil) {
+            [unexpected addObject: file];
+            continue;
+        }
+
+        [missing removeObject: file];
+        if (!results[i].valid || memcmp([expected bytes], results[i].digest, sizeof(results[i].digest)) != 0)
+            [mismatched addObject: file];
+    }
+    free(results);
+
+    for (NSString *link in [[links allKeys] sortedArrayUsingSelector: @selector(compare:)]) {
+        NSString *expected = [_symbolicLinks objectForKey: link];
+        if (expected == nil) {
+            [unexpected addObject: link];
+            continue;
+        }
+
+        [missing removeObject: link];
+        if (![expected isEqualToString: [links objectForKey: link]])
+            [mismatched addObject: link];
+    }
+
+    return [[PLBundleVerificationResult alloc] initWithMismatchedPaths: mismatched
+                                                          missingPaths: [[missing allObjects] sortedArrayUsingSelector: @selector(compare:)]
+                                                       unexpectedPaths: unexpected
+                                                             fileCount: [files count]
+                                                             byteCount: byteCount
+                                                              duration: -[start timeIntervalSinceNow]];
+}
+
+@end
@@ -0,0 +1,139 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulator.h"
+#import "PLBundleManifest.h"
+
+#import "PLSyntheticFixtures.h"
+
+@interface PLBundleManifestTests : PLTestCase {
+@private
+    /** Temporary bundle path */
+    NSString *_bundlePath;
+}
+@end
+
+@implementation PLBundleManifestTests
+
+- (void) setUp {
+    _bundlePath = [[self temporaryDirectory] stringByAppendingPathComponent: @"Test.app"];
+
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *resources = [_bundlePath stringByAppendingPathComponent: @"Contents/Resources"];
+    STAssertTrue([fm createDirectoryAtPath: resources withIntermediateDirectories: YES attributes: nil error: NULL], @"Could not create bundle");
+
+    for (int i = 0; i < 100; i++) {
+        NSString *file = [resources stringByAppendingPathComponent: [NSString stringWithFormat: @"file-%d", i]];
+        NSData *data = [[NSString stringWithFormat: @"Contents of file %d", i] dataUsingEncoding: NSUTF8StringEncoding];
+        STAssertTrue([data writeToFile: file atomically: NO], @"Could not write file");
+    }
+}
+
+- (void) testRoundTrip {
+    NSError *error;
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: _bundlePath error: &error];
+    STAssertNotNil(manifest, @"Could not create manifest: %@", error);
+    STAssertEquals([manifest.digests count], (NSUInteger) 100, @"Incorrect file count");
+
+    /* The manifest must exclude itself */
+    NSString *manifestPath = [_bundlePath stringByAppendingPathComponent: PLBundleManifestDefaultPath];
+    STAssertTrue([manifest writeToFile: manifestPath error: &error], @"Could not write manifest: %@", error);
+
+    PLBundleManifest *loaded = [PLBundleManifest manifestWithContentsOfFile: manifestPath error: &error];
+    STAssertNotNil(loaded, @"Could not read manifest: %@", error);
+    STAssertEqualObjects(manifest.digests, loaded.digests, @"Digests not preserved");
+    STAssertEqualObjects(manifest.sizes, loaded.sizes, @"Sizes not preserved");
+
+    PLBundleVerificationResult *result = [loaded verifyBundleAtPath: _bundlePath error: &error];
+    STAssertNotNil(result, @"Verification failed: %@", error);
+    STAssertTrue(result.valid, @"Unmodified bundle should verify: %@", result);
+    STAssertEquals(result.fileCount, (NSUInteger) 100, @"Incorrect file count");
+}
+
+- (void) testDetectsChanges {
+    NSError *error;
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: _bundlePath error: &error];
+    STAssertNotNil(manifest, @"Could not create manifest: %@", error);
+
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *resources = [_bundlePath stringByAppendingPathComponent: @"Contents/Resources"];
+    STAssertTrue([[NSData data] writeToFile: [resources stringByAppendingPathComponent: @"file-1"] atomically: NO], @"Could not truncate file");
+    STAssertTrue([fm removeItemAtPath: [resources stringByAppendingPathComponent: @"file-2"] error: NULL], @"Could not remove file");
+    STAssertTrue([[NSData data] writeToFile: [resources stringByAppendingPathComponent: @"extra"] atomically: NO], @"Could not add file");
+
+    PLBundleVerificationResult *result = [manifest verifyBundleAtPath: _bundlePath error: &error];
+    STAssertNotNil(result, @"Verification failed: %@", error);
+    STAssertFalse(result.valid, @"Modified bundle should not verify");
+    STAssertEqualObjects(result.mismatchedPaths, [NSArray arrayWithObject: @"Contents/Resources/file-1"], @"Incorrect mismatches");
+    STAssertEqualObjects(result.missingPaths, [NSArray arrayWithObject: @"Contents/Resources/file-2"], @"Incorrect missing files");
+    STAssertEqualObjects(result.unexpectedPaths, [NSArray arrayWithObject: @"Contents/Resources/extra"], @"Incorrect unexpected files");
+}
+
+/* Symbolic links, such as those of a versioned framework, must be recorded rather than followed */
+- (void) testSymbolicLinks {
+    NSError *error;
+    NSString *framework = [_bundlePath stringByAppendingPathComponent: @"Contents/Frameworks/Test.framework"];
+    [self writeVersionedFrameworkAtPath: framework version: @"A"];
+
+    PLBundleManifest *manifest = [[PLBundleManifest alloc] initWithBundlePath: _bundlePath error: &error];
+    STAssertNotNil(manifest, @"Could not create manifest: %@", error);
+    STAssertEquals([manifest.digests count], (NSUInteger) 102, @"Linked files should only be hashed once");
+    STAssertNotNil([manifest.digests objectForKey: @"Contents/Frameworks/Test.framework/Versions/A/Test"], @"Framework executable was not hashed");
+
+    NSDictionary *expected = [NSDictionary dictionaryWithObjectsAndKeys:
+                              @"A", @"Contents/Frameworks/Test.framework/Versions/Current",
+                              @"Versions/Current/Test", @"Contents/Frameworks/Test.framework/Test",
+                              @"Versions/Current/Resources", @"Contents/Frameworks/Test.framework/Resources",
+                              nil];
+    STAssertEqualObjects(manifest.symbolicLinks, expected, @"Incorrect symbolic links");
+
+    PLBundleManifest *loaded = [[PLBundleManifest alloc] initWithPropertyList: [manifest propertyListRepresentation] error: &error];
+    STAssertNotNil(loaded, @"Could not read manifest: %@", error);
+    STAssertEqualObjects(loaded.symbolicLinks, expected, @"Symbolic links not preserved");
+
+    PLBundleVerificationResult *result = [loaded verifyBundleAtPath: _bundlePath error: &error];
+    STAssertTrue(result.valid, @"Unmodified bundle should verify: %@", result);
+
+    /* Retargeted, removed, and added links must be detected */
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *current = [framework stringByAppendingPathComponent: @"Versions/Current"];
+    STAssertTrue([fm removeItemAtPath: current error: NULL], @"Could not remove link");
+    STAssertTrue([fm createSymbolicLinkAtPath: current withDestinationPath: @"B" error: &error], @"Could not create link: %@", error);
+    STAssertTrue([fm removeItemAtPath: [framework stringByAppendingPathComponent: @"Resources"] error: NULL], @"Could not remove link");
+    STAssertTrue([fm createSymbolicLinkAtPath: [framework stringByAppendingPathComponent: @"Headers"] withDestinationPath: @"Versions/Current/Headers" error: &error], @"Could not create link: %@", error);
+
+    result = [loaded verifyBundleAtPath: _bundlePath error: &error];
+    STAssertNotNil(result, @"Verification failed: %@", error);
+    STAssertEqualObjects(result.mismatchedPaths, [NSArray arrayWithObject: @"Contents/Frameworks/Test.framework/Versions/Current"], @"Incorrect mismatches");
+    STAssertEqualObjects(result.missingPaths, [NSArray arrayWithObject: @"Contents/Frameworks/Test.framework/Resources"], @"Incorrect missing links");
+    STAssertEqualObjects(result.unexpectedPaths, [NSArray arrayWithObject: @"Contents/Frameworks/Test.framework/Headers"], @"Incorrect unexpected links");
+}
+
+@end
@@ -0,0 +1,125 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLSimulatorApplication.h"
+
+@interface PLCatalogRecord : NSObject {
+@private
+    /** Application path. */
+    NSString *_path;
+
+    /** Application display name. */
+    NSString *_displayName;
+
+    /** Canonical name of the SDK used to build the application. */
+    NSString *_canonicalSDKName;
+
+    /** Supported device family codes, as sorted NSNumber instances. */
+    NSArray *_deviceFamilies;
+
+    /** Executable architecture names, in slice order. */
+    NSArray *_architectures;
+
+    /** Linked dylib install names, in load command order. */
+    NSArray *_dylibPaths;
+
+    /** Executable file size, in bytes. */
+    uint64_t _executableSize;
+}
+
++ (id) recordWithApplication: (PLSimulatorApplication *) app error: (NSError **) outError;
+- (id) initWithApplication: (PLSimulatorApplication *) app error: (NSError **) outError;
+
+- (NSString *) JSONRepresentation;
+- (NSDictionary *) propertyListRepresentation;
+
+/** Application path. */
+@property(nonatomic, readonly) NSString *path;
+
+/** Application display name, or nil if not declared. */
+@property(nonatomic, readonly) NSString *displayName;
+
+/** Canonical name of the SDK used to build the application. */
+@property(nonatomic, readonly) NSString *canonicalSDKName;
+
+/** Supported device family codes, as sorted NSNumber instances. */
+@property(nonatomic, readonly) NSArray *deviceFamilies;
+
+/** Executable architecture names (eg, i386), in slice order. Empty if the application has no executable. */
+@property(nonatomic, readonly) NSArray *architectures;
+
+/** Linked dylib install names of the first executable slice, in load command order. */
+@property(nonatomic, readonly) NSArray *dylibPaths;
+
+/** Executable file size, in bytes, or 0 if the application has no executable. */
+@property(nonatomic, readonly) uint64_t executableSize;
+
+@end
+
+@interface PLCatalogScanner : NSObject {
+@private
+    /** Root of the directory tree to be scanned. */
+    NSString *_rootPath;
+
+    /** Maximum number of applications parsed or awaiting output at any one time. */
+    NSUInteger _maxInFlight;
+
+    /** Number of applications successfully scanned. */
+    NSUInteger _applicationCount;
+
+    /** Number of applications that could not be parsed. */
+    NSUInteger _failureCount;
+
+    /** Elapsed time of the last scan, in seconds. */
+    NSTimeInterval _elapsedTime;
+}
+
+- (id) initWithRootPath: (NSString *) rootPath maxInFlight: (NSUInteger) maxInFlight;
+
+- (BOOL) scanWithRecordBlock: (void (^)(PLCatalogRecord *record)) recordBlock
+                  errorBlock: (void (^)(NSString *path, NSError *error)) errorBlock
+                       error: (NSError **) outError;
+
+/** Root of the directory tree to be scanned. */
+@property(nonatomic, readonly) NSString *rootPath;
+
+/** Number of applications successfully scanned by the last scan. */
+@property(nonatomic, readonly) NSUInteger applicationCount;
+
+/** Number of applications that could not be parsed by the last scan. */
+@property(nonatomic, readonly) NSUInteger failureCount;
+
+/** Elapsed time of the last scan, in seconds. */
+@property(nonatomic, readonly) NSTimeInterval elapsedTime;
+
+/** Applications scanned per second by the last scan, including failures. */
+@property(nonatomic, readonly) double applicationsPerSecond;
+
+@end
@@ -0,0 +1,336 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLCatalogScanner.h"
+
+#import "PLSimulator.h"
+#import "PLSimulatorDeviceFamily.h"
+#import "PLUniversalBinary.h"
+#import "PLExecutableBinary.h"
+
+#import <mach-o/arch.h>
+#import <mach/mach_time.h>
+
+/* Escape @a string for inclusion in a JSON string literal */
+static NSString *catalog_escape_string (NSString *string) {
+    NSMutableString *result = [NSMutableString stringWithCapacity: [string length]];
+    for (NSUInteger i = 0; i < [string length]; i++) {
+        unichar c = [string characterAtIndex: i];
+        if (c == '"' || c == '\\')
+            [result appendFormat: @"\\%C", c];
+        else if (c < 0x20)
+            [result appendFormat: @"\\u%04x", c];
+        else
+            [result appendFormat: @"%C", c];
+    }
+
+    return result;
+}
+
+/* Return a JSON string literal for @a string, or null */
+static NSString *catalog_json_string (NSString *string) {
+    if (string == nil)
+        return @"null";
+
+    return [NSString stringWithFormat: @"\"%@\"", catalog_escape_string(string)];
+}
+
+/* Return a JSON array of string literals for @a strings */
+static NSString *catalog_json_string_array (NSArray *strings) {
+    NSMutableArray *elements = [NSMutableArray arrayWithCapacity: [strings count]];
+    for (NSString *string in strings)
+        [elements addObject: catalog_json_string(string)];
+
+    return [NSString stringWithFormat: @"[%@]", [elements componentsJoinedByString: @","]];
+}
+
+/* Return the architecture name for the given @a executable */
+static NSString *catalog_arch_name (PLExecutableBinary *executable) {
+    const NXArchInfo *info = NXGetArchInfoFromCpuType(executable.cpu_type, executable.cpu_subtype);
+    if (info == NULL)
+        info = NXGetArchInfoFromCpuType(executable.cpu_type, CPU_SUBTYPE_MULTIPLE);
+
+    if (info == NULL)
+        return [NSString stringWithFormat: @"cpu%d", executable.cpu_type];
+
+    return [NSString stringWithUTF8String: info->name];
+}
+
+/**
+ * A compact summary of a single Simulator application, as emitted by PLCatalogScanner.
+ *
+ * Records retain only the extracted strings; the application's property list and mapped executable
+ * are released once the record has been constructed.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLCatalogRecord
+
+@synthesize path = _path;
+@synthesize displayName = _displayName;
+@synthesize canonicalSDKName = _canonicalSDKName;
+@synthesize deviceFamilies = _deviceFamilies;
+@synthesize architectures = _architectures;
+@synthesize dylibPaths = _dylibPaths;
+@synthesize executableSize = _executableSize;
+
+/**
+ * Create and return a record describing @a app.
+ *
+ * @param app The application to be described.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns the record, or nil if the application's executable could not be parsed.
+ */
++ (id) recordWithApplication: (PLSimulatorApplication *) app error: (NSError **) outError {
+    return [[self alloc] initWithApplication: app error: outError];
+}
+
+/**
+ * Initialize a record describing @a app.
+ *
+ * @param app The application to be described.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns the initialized record, or nil if the application's executable could not be parsed.
+ */
+- (id) initWithApplication: (PLSimulatorApplication *) app error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    _path = app.path;
+    _displayName = app.displayName;
+    _canonicalSDKName = app.canonicalSDKName;
+
+    /* Device family codes */
+    NSMutableArray *families = [NSMutableArray arrayWithCapacity: [app.deviceFamilies count]];
+    for (PLSimulatorDeviceFamily *family in app.deviceFamilies)
+        [families addObject: [NSNumber numberWithInteger: family.deviceFamilyCode]];
+    [families sortUsingSelector: @selector(compare:)];
+    _deviceFamilies = families;
+
+    /* Executable summary. The binary is mapped, and released at the end of this scope. */
+    _architectures = [NSArray array];
+    _dylibPaths = [NSArray array];
+    if (app.executablePath != nil) {
+        PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: app.executablePath error: outError];
+        if (binary == nil)
+            return nil;
+
+        NSMutableArray *archs = [NSMutableArray arrayWithCapacity: [binary.executables count]];
+        for (PLExecutableBinary *executable in binary.executables)
+            [archs addObject: catalog_arch_name(executable)];
+        _architectures = archs;
+
+        if ([binary.executables count] > 0)
+            _dylibPaths = [[[binary.executables objectAtIndex: 0] dylibPaths] copy];
+
+        _executableSize = binary.fileSize;
+    }
+
+    return self;
+}
+
+/**
+ * Return a single-line JSON object describing the record.
+ */
+- (NSString *) JSONRepresentation {
+    return [NSString stringWithFormat: @"{\"path\":%@,\"name\":%@,\"sdk\":%@,\"families\":[%@],\"archs\":%@,\"dylibs\":%@,\"size\":%llu}",
+            catalog_json_string(_path), catalog_json_string(_displayName), catalog_json_string(_canonicalSDKName),
+            [_deviceFamilies componentsJoinedByString: @","], catalog_json_string_array(_architectures),
+            catalog_json_string_array(_dylibPaths), (unsigned long long) _executableSize];
+}
+
+/**
+ * Return a property list representation of the record, suitable for binary serialization.
+ */
+- (NSDictionary *) propertyListRepresentation {
+    NSMutableDictionary *plist = [NSMutableDictionary dictionaryWithCapacity: 7];
+    [plist setObject: _path forKey: @"path"];
+    if (_displayName != nil)
+        [plist setObject: _displayName forKey: @"name"];
+    [plist setObject: _canonicalSDKName forKey: @"sdk"];
+    [plist setObject: _deviceFamilies forKey: @"families"];
+    [plist setObject: _architectures forKey: @"archs"];
+    [plist setObject: _dylibPaths forKey: @"dylibs"];
+    [plist setObject: [NSNumber numberWithUnsignedLongLong: _executableSize] forKey: @"size"];
+    return plist;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [self JSONRepresentation];
+}
+
+@end
+
+/**
+ * Scans a directory tree of Simulator applications, such as a build archive, producing one PLCatalogRecord
+ * per application.
+ *
+ * The tree is walked lazily on the calling thread; application bundles are not descended into. Each
+ * application is parsed on a concurrent queue, and the resulting records are delivered serially. The
+ * number of applications being parsed or awaiting delivery is bounded, so memory use is independent of
+ * the size of the tree.
+ *
+ * @par Thread Safety
+ * Mutable and not thread-safe. A scanner must only be used from the thread on which it was created.
+ */
+@implementation PLCatalogScanner
+
+@synthesize rootPath = _rootPath;
+@synthesize applicationCount = _applicationCount;
+@synthesize failureCount = _failureCount;
+@synthesize elapsedTime = _elapsedTime;
+
+/**
+ * Initialize a new scanner.
+ *
+ * @param rootPath The root of the directory tree to be scanned.
+ * @param maxInFlight The maximum number of applications being parsed or awaiting delivery at any one
+ * time. If 0, a limit is derived from the number of active processors.
+ */
+- (id) initWithRootPath: (NSString *) rootPath maxInFlight: (NSUInteger) maxInFlight {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _rootPath = rootPath;
+
+    _maxInFlight = maxInFlight;
+    if (_maxInFlight == 0)
+        _maxInFlight = [[NSProcessInfo processInfo] activeProcessorCount] * 4;
+
+    return self;
+}
+
+/**
+ * Scan the directory tree, blocking until all applications have been delivered.
+ *
+ * Both blocks are called serially on a private queue, in completion order.
+ *
+ * @param recordBlock Block called with the record for each successfully parsed application.
+ * @param errorBlock Block called for each application that could not be parsed. May be nil.
+ * @param outError If the directory tree can not be read, upon return contains an NSError object that
+ * describes the problem.
+ *
+ * @return Returns YES if the tree was scanned, or NO if it could not be read. Individual application
+ * failures are reported via @a errorBlock, and do not cause the scan to fail.
+ */
+- (BOOL) scanWithRecordBlock: (void (^)(PLCatalogRecord *record)) recordBlock
+                  errorBlock: (void (^)(NSString *path, NSError *error)) errorBlock
+                       error: (NSError **) outError
+{
+    BOOL isDir;
+    if (![[NSFileManager defaultManager] fileExistsAtPath: _rootPath isDirectory: &isDir] || !isDir) {
+        NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"The catalog path '%@' does not exist or is not a directory.",
+                                                                       @"Missing/non-directory catalog path"), _rootPath];
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, nil);
+        return NO;
+    }
+
+    _applicationCount = 0;
+    _failureCount = 0;
+
+    dispatch_queue_t parseQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_queue_t outputQueue = dispatch_queue_create("coop.plausible.simulator.catalog.output", DISPATCH_QUEUE_SERIAL);
+    dispatch_semaphore_t inFlight = dispatch_semaphore_create(_maxInFlight);
+    dispatch_group_t group = dispatch_group_create();
+
+    uint64_t start = mach_absolute_time();
+
+    /* The enumerator is lazy; only the current directory chain is held open */
+    NSDirectoryEnumerator *dirEnum = [[NSFileManager defaultManager] enumeratorAtURL: [NSURL fileURLWithPath: _rootPath]
+                                                          includingPropertiesForKeys: [NSArray arrayWithObject: NSURLIsDirectoryKey]
+                                                                             options: 0
+                                                                        errorHandler: nil];
+    for (NSURL *url in dirEnum) {
+        @autoreleasepool {
+            if (![[url pathExtension] isEqualToString: @"app"])
+                continue;
+
+            NSNumber *directory;
+            if (![url getResourceValue: &directory forKey: NSURLIsDirectoryKey error: NULL] || ![directory boolValue])
+                continue;
+
+            /* Applications may contain nested bundles; these are not catalogued */
+            [dirEnum skipDescendants];
+
+            /* The slot is released once the record has been delivered */
+            dispatch_semaphore_wait(inFlight, DISPATCH_TIME_FOREVER);
+
+            NSString *path = [url path];
+            dispatch_group_async(group, parseQueue, ^{
+                @autoreleasepool {
+                    NSError *error;
+                    PLCatalogRecord *record = nil;
+                    PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: path error: &error];
+                    if (app != nil)
+                        record = [PLCatalogRecord recordWithApplication: app error: &error];
+
+                    dispatch_group_async(group, outputQueue, ^{
+                        @autoreleasepool {
+                            if (record != nil) {
+                                _applicationCount++;
+                                recordBlock(record);
+                            } else {
+                                _failureCount++;
+                                if (errorBlock != nil)
+                                    errorBlock(path, error);
+                            }
+                        }
+
+                        dispatch_semaphore_signal(inFlight);
+                    });
+                }
+            });
+        }
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    _elapsedTime = (NSTimeInterval) plsimulator_stats_abs_to_ns(mach_absolute_time() - start) / NSEC_PER_SEC;
+
+    dispatch_release(group);
+    dispatch_release(inFlight);
+    dispatch_release(outputQueue);
+
+    return YES;
+}
+
+// property getter
+- (double) applicationsPerSecond {
+    if (_elapsedTime <= 0)
+        return 0;
+
+    return (_applicationCount + _failureCount) / _elapsedTime;
+}
+
+@end
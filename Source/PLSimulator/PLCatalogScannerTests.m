@@ -0,0 +1,116 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLCatalogScanner.h"
+
+#import "PLSyntheticApplication.h"
+#import "PLSyntheticMachO.h"
+
+@interface PLCatalogScannerTests : PLTestCase {
+@private
+    /** Temporary catalog root */
+    NSString *_root;
+}
+@end
+
+@implementation PLCatalogScannerTests
+
+/* Write a synthetic application at @a path, with an i386/x86_64 executable if @a valid, or an empty executable otherwise */
+- (void) writeApplicationAtPath: (NSString *) path valid: (BOOL) valid {
+    NSError *error;
+    NSString *name = [[path lastPathComponent] stringByDeletingPathExtension];
+    NSDictionary *info = [PLSyntheticApplication infoWithName: name canonicalSDKName: @"iphonesimulator6.0"
+                                               deviceFamilies: [NSArray arrayWithObjects: [NSNumber numberWithInt: 2], [NSNumber numberWithInt: 1], nil]];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: path info: info error: &error], @"Could not write application: %@", error);
+    if (!valid)
+        return;
+
+    NSArray *images = [NSArray arrayWithObjects:
+                       [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: 0 loadCommandCount: 4],
+                       [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86_64 cpuSubtype: CPU_SUBTYPE_X86_64_ALL options: PLSyntheticMachO64Bit loadCommandCount: 4],
+                       nil];
+    NSData *binary = [PLSyntheticMachO universalBinaryWithImages: images];
+    STAssertTrue([binary writeToFile: [path stringByAppendingPathComponent: name] options: NSDataWritingAtomic error: &error], @"Could not write executable: %@", error);
+}
+
+- (void) setUp {
+    _root = [self temporaryDirectory];
+
+    [self writeApplicationAtPath: [_root stringByAppendingPathComponent: @"a/One.app"] valid: YES];
+    [self writeApplicationAtPath: [_root stringByAppendingPathComponent: @"b/c/Two.app"] valid: YES];
+    [self writeApplicationAtPath: [_root stringByAppendingPathComponent: @"b/c/Two.app/PlugIns/Nested.app"] valid: YES];
+    [self writeApplicationAtPath: [_root stringByAppendingPathComponent: @"Broken.app"] valid: NO];
+}
+
+- (void) testScan {
+    NSError *error;
+    NSMutableArray *records = [NSMutableArray array];
+    NSMutableArray *failures = [NSMutableArray array];
+
+    PLCatalogScanner *scanner = [[PLCatalogScanner alloc] initWithRootPath: _root maxInFlight: 1];
+    BOOL result = [scanner scanWithRecordBlock: ^(PLCatalogRecord *record) {
+        [records addObject: record];
+    } errorBlock: ^(NSString *path, NSError *error) {
+        [failures addObject: [path lastPathComponent]];
+    } error: &error];
+    STAssertTrue(result, @"Scan failed: %@", error);
+
+    /* Nested bundles must not be catalogued; the broken application must be reported */
+    STAssertEquals([records count], (NSUInteger) 2, @"Incorrect number of records: %@", records);
+    STAssertEqualObjects(failures, [NSArray arrayWithObject: @"Broken.app"], @"Incorrect failures");
+    STAssertEquals(scanner.applicationCount, (NSUInteger) 2, @"Incorrect application count");
+    STAssertEquals(scanner.failureCount, (NSUInteger) 1, @"Incorrect failure count");
+    STAssertTrue(scanner.applicationsPerSecond > 0, @"Throughput was not recorded");
+
+    for (PLCatalogRecord *record in records) {
+        STAssertEqualObjects(record.canonicalSDKName, @"iphonesimulator6.0", @"Incorrect SDK");
+        STAssertEqualObjects(record.deviceFamilies, ([NSArray arrayWithObjects: [NSNumber numberWithInt: 1], [NSNumber numberWithInt: 2], nil]), @"Incorrect families");
+        STAssertEqualObjects(record.architectures, ([NSArray arrayWithObjects: @"i386", @"x86_64", nil]), @"Incorrect architectures");
+        STAssertEquals([record.dylibPaths count], (NSUInteger) 2, @"Incorrect dylibs");
+        STAssertTrue(record.executableSize > 0, @"Missing executable size");
+
+        NSData *json = [[record JSONRepresentation] dataUsingEncoding: NSUTF8StringEncoding];
+        Class serialization = NSClassFromString(@"NSJSONSerialization");
+        if (serialization != nil) {
+            NSDictionary *dict = [serialization JSONObjectWithData: json options: 0 error: &error];
+            STAssertNotNil(dict, @"Invalid JSON output: %@", error);
+            STAssertEqualObjects([dict objectForKey: @"path"], record.path, @"Incorrect path");
+        }
+    }
+}
+
+- (void) testMissingRoot {
+    NSError *error;
+    PLCatalogScanner *scanner = [[PLCatalogScanner alloc] initWithRootPath: @"/nonexistent" maxInFlight: 0];
+    STAssertFalse([scanner scanWithRecordBlock: ^(PLCatalogRecord *record) {} errorBlock: nil error: &error], @"Scan should fail");
+    STAssertNotNil(error, @"Error was not populated");
+}
+
+@end
@@ -0,0 +1,152 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <stdint.h>
+
+/*
+ * Embedded code signature structures, as defined by the kernel's cs_blobs.h. The SDK does not publicly
+ * define these, so they are reproduced here. All code signature fields are big-endian, regardless of
+ * the byte order of the enclosing Mach-O image.
+ */
+
+/** Embedded signature super blob magic. */
+#define PL_CSMAGIC_EMBEDDED_SIGNATURE 0xfade0cc0
+
+/** Code directory blob magic. */
+#define PL_CSMAGIC_CODEDIRECTORY 0xfade0c02
+
+/** Super blob slot of the primary code directory. */
+#define PL_CSSLOT_CODEDIRECTORY 0
+
+/** First super blob slot used for alternate code directories. */
+#define PL_CSSLOT_ALTERNATE_CODEDIRECTORIES 0x1000
+
+/** Maximum number of alternate code directories. */
+#define PL_CSSLOT_ALTERNATE_CODEDIRECTORY_MAX 5
+
+/** Code directory hash types. */
+#define PL_CS_HASHTYPE_SHA1 1
+#define PL_CS_HASHTYPE_SHA256 2
+#define PL_CS_HASHTYPE_SHA256_TRUNCATED 3
+#define PL_CS_HASHTYPE_SHA384 4
+
+/** First code directory version that includes the 64-bit code limit. */
+#define PL_CS_SUPPORTSCODELIMIT64 0x20300
+
+/**
+ * A super blob index entry.
+ */
+typedef struct pl_cs_blob_index {
+    /** Slot type. */
+    uint32_t type;
+
+    /** Offset of the blob from the start of the super blob. */
+    uint32_t offset;
+} pl_cs_blob_index_t;
+
+/**
+ * The embedded signature super blob header, followed by @a count pl_cs_blob_index_t entries.
+ */
+typedef struct pl_cs_super_blob {
+    /** PL_CSMAGIC_EMBEDDED_SIGNATURE */
+    uint32_t magic;
+
+    /** Total length of the super blob. */
+    uint32_t length;
+
+    /** Number of index entries. */
+    uint32_t count;
+} pl_cs_super_blob_t;
+
+/**
+ * The fixed code directory header common to all code directory versions. Later versions append
+ * additional fields; see pl_cs_code_directory_64_t.
+ */
+typedef struct pl_cs_code_directory {
+    /** PL_CSMAGIC_CODEDIRECTORY */
+    uint32_t magic;
+
+    /** Total length of the code directory blob. */
+    uint32_t length;
+
+    /** Code directory version. */
+    uint32_t version;
+
+    /** Code signing flags. */
+    uint32_t flags;
+
+    /** Offset of code slot zero's hash. Special slot hashes precede it. */
+    uint32_t hashOffset;
+
+    /** Offset of the NUL-terminated signing identifier. */
+    uint32_t identOffset;
+
+    /** Number of special (negative index) hash slots. */
+    uint32_t nSpecialSlots;
+
+    /** Number of code page hash slots. */
+    uint32_t nCodeSlots;
+
+    /** Length of the signed code, in bytes. */
+    uint32_t codeLimit;
+
+    /** Size of each hash, in bytes. */
+    uint8_t hashSize;
+
+    /** Hash type; one of the PL_CS_HASHTYPE values. */
+    uint8_t hashType;
+
+    /** Platform identifier. */
+    uint8_t platform;
+
+    /** Code page size, as a power of two, or 0 if the code is hashed as a single page. */
+    uint8_t pageSize;
+
+    /** Unused; must be zero. */
+    uint32_t spare2;
+} pl_cs_code_directory_t;
+
+/**
+ * The code directory header, extended with the fields available from PL_CS_SUPPORTSCODELIMIT64.
+ */
+typedef struct pl_cs_code_directory_64 {
+    /** Common code directory fields. */
+    pl_cs_code_directory_t base;
+
+    /** Offset of the optional scatter vector. */
+    uint32_t scatterOffset;
+
+    /** Offset of the optional team identifier. */
+    uint32_t teamOffset;
+
+    /** Unused; must be zero. */
+    uint32_t spare3;
+
+    /** Length of the signed code, in bytes, if larger than 4GB. */
+    uint64_t codeLimit64;
+} pl_cs_code_directory_64_t;
@@ -0,0 +1,110 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * The per-library cost by which a critical path is weighted.
+ */
+typedef enum {
+    /** Time spent mapping and parsing each library. */
+    PLDylibGraphCostParseTime = 0,
+
+    /** File size of each library, approximating the I/O cost of reading it from a cold cache. */
+    PLDylibGraphCostFileSize
+} PLDylibGraphCost;
+
+@interface PLDylibGraphNode : NSObject {
+@private
+    /** The resolved path, or the unresolved install name if the library could not be found. */
+    NSString *_path;
+
+    /** YES if the library was found and parsed. */
+    BOOL _resolved;
+
+    /** File size, in bytes. */
+    uint64_t _fileSize;
+
+    /** Time spent mapping and parsing the binary, in seconds. */
+    NSTimeInterval _parseTime;
+
+    /** Shortest distance from the root node. */
+    NSUInteger _depth;
+
+    /** Direct dependencies, as PLDylibGraphNode instances. */
+    NSMutableArray *_dependencies;
+}
+
+/** The resolved path, or the unresolved install name if the library could not be found. */
+@property(nonatomic, readonly) NSString *path;
+
+/** YES if the library was found and parsed. */
+@property(nonatomic, readonly, getter=isResolved) BOOL resolved;
+
+/** File size, in bytes, or 0 if unresolved. */
+@property(nonatomic, readonly) uint64_t fileSize;
+
+/** Time spent mapping and parsing the binary, in seconds. */
+@property(nonatomic, readonly) NSTimeInterval parseTime;
+
+/** Shortest distance from the root node; the root node has a depth of 0. */
+@property(nonatomic, readonly) NSUInteger depth;
+
+/** Direct dependencies, as PLDylibGraphNode instances, in load command order. */
+@property(nonatomic, readonly) NSArray *dependencies;
+
+@end
+
+@interface PLDylibGraph : NSObject {
+@private
+    /** The root node. */
+    PLDylibGraphNode *_root;
+
+    /** All nodes, in breadth-first discovery order. */
+    NSArray *_nodes;
+}
+
++ (id) graphWithBinaryPath: (NSString *) path rpaths: (NSArray *) rpaths error: (NSError **) outError;
+- (id) initWithBinaryPath: (NSString *) path rpaths: (NSArray *) rpaths error: (NSError **) outError;
+
+- (NSArray *) criticalPath;
+- (NSArray *) criticalPathByCost: (PLDylibGraphCost) cost;
+- (NSString *) criticalPathReport;
+
+- (NSString *) DOTRepresentation;
+- (NSString *) JSONRepresentation;
+
+- (BOOL) writeToDirectory: (NSString *) directory baseName: (NSString *) baseName error: (NSError **) outError;
+
+/** The root node. */
+@property(nonatomic, readonly) PLDylibGraphNode *root;
+
+/** All nodes, in breadth-first discovery order. */
+@property(nonatomic, readonly) NSArray *nodes;
+
+@end
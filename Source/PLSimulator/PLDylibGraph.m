@@ -0,0 +1,479 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLDylibGraph.h"
+
+#import "PLSimulator.h"
+#import "PLUniversalBinary.h"
+
+#import <mach/mach_time.h>
+
+/* Install name prefixes handled by the resolver */
+#define RPATH_PREFIX @"@rpath/"
+#define LOADER_PATH_PREFIX @"@loader_path/"
+#define EXECUTABLE_PATH_PREFIX @"@executable_path/"
+
+@interface PLDylibGraphNode (PrivateMethods)
+- (id) initWithPath: (NSString *) path depth: (NSUInteger) depth;
+- (PLExecutableBinary *) parse;
+- (void) addDependency: (PLDylibGraphNode *) node;
+@end
+
+@interface PLDylibGraph (PrivateMethods)
+- (double) criticalPathFrom: (PLDylibGraphNode *) node
+                     costType: (PLDylibGraphCost) costType
+                        costs: (NSMapTable *) costs
+                        nexts: (NSMapTable *) nexts
+                       active: (NSMutableSet *) active;
+- (void) appendCriticalPath: (NSArray *) path title: (NSString *) title toReport: (NSMutableString *) report;
+@end
+
+/* Escape @a string for inclusion in a JSON or DOT string literal */
+static NSString *plsim_escape_string (NSString *string) {
+    NSMutableString *result = [NSMutableString stringWithCapacity: [string length]];
+    for (NSUInteger i = 0; i < [string length]; i++) {
+        unichar c = [string characterAtIndex: i];
+        if (c == '"' || c == '\\')
+            [result appendFormat: @"\\%C", c];
+        else if (c < 0x20)
+            [result appendFormat: @"\\u%04x", c];
+        else
+            [result appendFormat: @"%C", c];
+    }
+
+    return result;
+}
+
+/*
+ * Resolve @a name, as referenced by the binary at @a loaderPath, to an existing file. Returns nil if the
+ * library can not be found.
+ */
+static NSString *plsim_resolve_install_name (NSFileManager *fm, NSString *name, NSString *loaderPath, NSString *executablePath, NSArray *rpaths) {
+    NSString *candidate = name;
+
+    if ([name hasPrefix: RPATH_PREFIX]) {
+        /* Search the accumulated @rpath list, in order */
+        NSString *relative = [name substringFromIndex: [RPATH_PREFIX length]];
+        candidate = nil;
+        for (NSString *rpath in rpaths) {
+            NSString *path = [rpath stringByAppendingPathComponent: relative];
+            if ([fm fileExistsAtPath: path]) {
+                candidate = path;
+                break;
+            }
+        }
+    } else if ([name hasPrefix: LOADER_PATH_PREFIX]) {
+        candidate = [[loaderPath stringByDeletingLastPathComponent] stringByAppendingPathComponent: [name substringFromIndex: [LOADER_PATH_PREFIX length]]];
+    } else if ([name hasPrefix: EXECUTABLE_PATH_PREFIX]) {
+        candidate = [[executablePath stringByDeletingLastPathComponent] stringByAppendingPathComponent: [name substringFromIndex: [EXECUTABLE_PATH_PREFIX length]]];
+    }
+
+    if (candidate == nil || ![fm fileExistsAtPath: candidate])
+        return nil;
+
+    /* Resolve framework version symlinks, so that each library is represented by a single node */
+    return [candidate stringByResolvingSymlinksInPath];
+}
+
+/**
+ * A single library within a PLDylibGraph.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe once the enclosing graph has been constructed.
+ */
+@implementation PLDylibGraphNode
+
+@synthesize path = _path;
+@synthesize resolved = _resolved;
+@synthesize fileSize = _fileSize;
+@synthesize parseTime = _parseTime;
+@synthesize depth = _depth;
+@synthesize dependencies = _dependencies;
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"<%@: %@ depth=%lu size=%llu parse=%.3fms>", [self class], _path,
+            (unsigned long) _depth, (unsigned long long) _fileSize, _parseTime * 1000.0];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLDylibGraphNode (PrivateMethods)
+
+/**
+ * Initialize an unresolved node.
+ *
+ * @param path The resolved path, or the install name if the library could not be found.
+ * @param depth Shortest distance from the root node.
+ */
+- (id) initWithPath: (NSString *) path depth: (NSUInteger) depth {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _path = path;
+    _depth = depth;
+    _dependencies = [NSMutableArray array];
+
+    return self;
+}
+
+/**
+ * Map and parse the receiver's binary, recording the parse time and file size. Returns the executable matching
+ * the current architecture, or nil if the binary could not be parsed.
+ */
+- (PLExecutableBinary *) parse {
+    NSError *error;
+    uint64_t start = mach_absolute_time();
+    PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: _path error: &error];
+    PLExecutableBinary *exec = [binary executableMatchingCurrentArchitecture];
+    _parseTime = (NSTimeInterval) plsimulator_stats_abs_to_ns(mach_absolute_time() - start) / NSEC_PER_SEC;
+
+    if (binary == nil) {
+        NSLog(@"Could not parse dependency %@: %@", _path, error);
+        return nil;
+    }
+
+    _fileSize = binary.fileSize;
+    _resolved = (exec != nil);
+    return exec;
+}
+
+/**
+ * Append a direct dependency.
+ */
+- (void) addDependency: (PLDylibGraphNode *) node {
+    [_dependencies addObject: node];
+}
+
+@end
+
+/**
+ * The transitive dylib dependency graph of a binary.
+ *
+ * Install names are resolved using the same rules as PLUniversalBinary::loadLibraryWithRPaths:error:, extended
+ * to the full dependency closure: @rpath references are searched against the caller's rpaths, followed by the
+ * absolute LC_RPATH values of each binary in the load chain. Each library is parsed once, and is annotated with
+ * its file size, parse time, and shortest depth from the root.
+ *
+ * The graph may be exported in DOT or JSON form, and provides critical paths -- the chains of libraries with the
+ * greatest cumulative parse time, and the greatest cumulative file size -- to guide prefetching and caching.
+ * Parse time measures only CPU cost once a library is in the page cache, so the file size path approximates
+ * the I/O cost of a cold load.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLDylibGraph
+
+@synthesize root = _root;
+@synthesize nodes = _nodes;
+
+/**
+ * Build the dependency graph of the binary at @a path.
+ *
+ * @param path The root binary.
+ * @param rpaths Additional absolute @rpath search paths, or nil.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ */
++ (id) graphWithBinaryPath: (NSString *) path rpaths: (NSArray *) rpaths error: (NSError **) outError {
+    return [[self alloc] initWithBinaryPath: path rpaths: rpaths error: outError];
+}
+
+/**
+ * Initialize with the dependency graph of the binary at @a path.
+ *
+ * @param path The root binary.
+ * @param rpaths Additional absolute @rpath search paths, or nil.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns an initialized graph, or nil if the root binary could not be parsed. Dependencies that can
+ * not be found or parsed are included in the graph as unresolved nodes.
+ */
+- (id) initWithBinaryPath: (NSString *) path rpaths: (NSArray *) rpaths error: (NSError **) outError {
+    if ((self = [super init]) == nil) {
+        // Shouldn't happen
+        plsimulator_populate_nserror(outError, PLSimulatorErrorUnknown, @"Unexpected error", nil);
+        return nil;
+    }
+
+    NSFileManager *fm = [NSFileManager new];
+
+    _root = [[PLDylibGraphNode alloc] initWithPath: [path stringByResolvingSymlinksInPath] depth: 0];
+    PLExecutableBinary *rootExec = [_root parse];
+    if (rootExec == nil) {
+        NSString *desc = NSLocalizedString(@"The binary could not be parsed, or is not supported by the current architecture.", @"Invalid binary");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+        return nil;
+    }
+
+    NSMutableArray *nodes = [NSMutableArray arrayWithObject: _root];
+    NSMutableDictionary *nodesByPath = [NSMutableDictionary dictionaryWithObject: _root forKey: _root.path];
+    NSMapTable *executables = [NSMapTable mapTableWithStrongToStrongObjects];
+    NSMapTable *searchPaths = [NSMapTable mapTableWithStrongToStrongObjects];
+
+    [executables setObject: rootExec forKey: _root];
+    [searchPaths setObject: [(rpaths != nil ? rpaths : [NSArray array]) arrayByAddingObjectsFromArray: [rootExec absoluteRpaths]] forKey: _root];
+
+    /* Breadth-first, so that each node's depth is its shortest distance from the root */
+    for (NSUInteger i = 0; i < [nodes count]; i++) {
+        PLDylibGraphNode *node = [nodes objectAtIndex: i];
+        PLExecutableBinary *exec = [executables objectForKey: node];
+        NSArray *search = [searchPaths objectForKey: node];
+
+        for (NSString *name in exec.dylibPaths) {
+            NSString *resolved = plsim_resolve_install_name(fm, name, node.path, _root.path, search);
+            NSString *key = (resolved != nil) ? resolved : name;
+
+            PLDylibGraphNode *child = [nodesByPath objectForKey: key];
+            if (child == nil) {
+                child = [[PLDylibGraphNode alloc] initWithPath: key depth: node.depth + 1];
+                [nodesByPath setObject: child forKey: key];
+                [nodes addObject: child];
+
+                PLExecutableBinary *childExec = (resolved != nil) ? [child parse] : nil;
+                if (childExec != nil) {
+                    [executables setObject: childExec forKey: child];
+                    [searchPaths setObject: [search arrayByAddingObjectsFromArray: [childExec absoluteRpaths]] forKey: child];
+                }
+            }
+
+            [node addDependency: child];
+        }
+    }
+
+    _nodes = nodes;
+    return self;
+}
+
+/**
+ * Return the chain of nodes, starting at the root, with the greatest cumulative parse time. Equivalent to
+ * PLDylibGraph::criticalPathByCost: with PLDylibGraphCostParseTime.
+ */
+- (NSArray *) criticalPath {
+    return [self criticalPathByCost: PLDylibGraphCostParseTime];
+}
+
+/**
+ * Return the chain of nodes, starting at the root, with the greatest cumulative @a cost.
+ *
+ * @param cost The per-library cost by which the path is weighted.
+ */
+- (NSArray *) criticalPathByCost: (PLDylibGraphCost) cost {
+    NSMapTable *costs = [NSMapTable mapTableWithStrongToStrongObjects];
+    NSMapTable *nexts = [NSMapTable mapTableWithStrongToStrongObjects];
+    [self criticalPathFrom: _root costType: cost costs: costs nexts: nexts active: [NSMutableSet set]];
+
+    NSMutableArray *path = [NSMutableArray array];
+    for (PLDylibGraphNode *node = _root; node != nil; node = [nexts objectForKey: node])
+        [path addObject: node];
+
+    return path;
+}
+
+/**
+ * Return a human-readable summary of both critical paths: the path weighted by parse time, followed by the path
+ * weighted by file size. Each path's summary line reports its total parse time and size.
+ */
+- (NSString *) criticalPathReport {
+    NSMutableString *report = [NSMutableString string];
+    [self appendCriticalPath: [self criticalPathByCost: PLDylibGraphCostParseTime] title: @"Critical path by parse time" toReport: report];
+    [self appendCriticalPath: [self criticalPathByCost: PLDylibGraphCostFileSize] title: @"Critical path by file size" toReport: report];
+    return report;
+}
+
+/**
+ * Return a Graphviz DOT representation of the graph. The critical path by parse time is highlighted, and
+ * unresolved libraries are drawn dashed.
+ */
+- (NSString *) DOTRepresentation {
+    NSSet *critical = [NSSet setWithArray: [self criticalPath]];
+    NSMapTable *ids = [NSMapTable mapTableWithStrongToStrongObjects];
+    for (NSUInteger i = 0; i < [_nodes count]; i++)
+        [ids setObject: [NSNumber numberWithUnsignedInteger: i] forKey: [_nodes objectAtIndex: i]];
+
+    NSMutableString *dot = [NSMutableString stringWithString: @"digraph dylibs {\n    node [shape=box, fontsize=10];\n"];
+    for (PLDylibGraphNode *node in _nodes) {
+        NSString *label = [NSString stringWithFormat: @"%@\\n%.1f KB, %.3f ms, depth %lu", plsim_escape_string([node.path lastPathComponent]),
+                           node.fileSize / 1024.0, node.parseTime * 1000.0, (unsigned long) node.depth];
+
+        NSMutableString *attrs = [NSMutableString stringWithFormat: @"label=\"%@\", tooltip=\"%@\"", label, plsim_escape_string(node.path)];
+        if (!node.resolved)
+            [attrs appendString: @", style=dashed"];
+        if ([critical containsObject: node])
+            [attrs appendString: @", color=red, penwidth=2"];
+
+        [dot appendFormat: @"    n%@ [%@];\n", [ids objectForKey: node], attrs];
+    }
+
+    for (PLDylibGraphNode *node in _nodes) {
+        for (PLDylibGraphNode *dep in node.dependencies)
+            [dot appendFormat: @"    n%@ -> n%@;\n", [ids objectForKey: node], [ids objectForKey: dep]];
+    }
+
+    [dot appendString: @"}\n"];
+    return dot;
+}
+
+/**
+ * Return a JSON representation of the graph. Nodes are identified by their index within the "nodes" array.
+ */
+- (NSString *) JSONRepresentation {
+    NSMapTable *ids = [NSMapTable mapTableWithStrongToStrongObjects];
+    for (NSUInteger i = 0; i < [_nodes count]; i++)
+        [ids setObject: [NSNumber numberWithUnsignedInteger: i] forKey: [_nodes objectAtIndex: i]];
+
+    NSMutableArray *nodeEntries = [NSMutableArray arrayWithCapacity: [_nodes count]];
+    for (PLDylibGraphNode *node in _nodes) {
+        NSMutableArray *deps = [NSMutableArray arrayWithCapacity: [node.dependencies count]];
+        for (PLDylibGraphNode *dep in node.dependencies)
+            [deps addObject: [[ids objectForKey: dep] stringValue]];
+
+        [nodeEntries addObject: [NSString stringWithFormat: @"{\"id\": %@, \"path\": \"%@\", \"resolved\": %@, \"size\": %llu, \"parse_time_ms\": %.3f, \"depth\": %lu, \"dependencies\": [%@]}",
+                                 [ids objectForKey: node], plsim_escape_string(node.path), node.resolved ? @"true" : @"false",
+                                 (unsigned long long) node.fileSize, node.parseTime * 1000.0, (unsigned long) node.depth,
+                                 [deps componentsJoinedByString: @", "]]];
+    }
+
+    NSMutableArray *criticalIds = [NSMutableArray array];
+    NSTimeInterval criticalTime = 0;
+    for (PLDylibGraphNode *node in [self criticalPathByCost: PLDylibGraphCostParseTime]) {
+        [criticalIds addObject: [[ids objectForKey: node] stringValue]];
+        criticalTime += node.parseTime;
+    }
+
+    NSMutableArray *sizeCriticalIds = [NSMutableArray array];
+    uint64_t criticalBytes = 0;
+    for (PLDylibGraphNode *node in [self criticalPathByCost: PLDylibGraphCostFileSize]) {
+        [sizeCriticalIds addObject: [[ids objectForKey: node] stringValue]];
+        criticalBytes += node.fileSize;
+    }
+
+    return [NSString stringWithFormat: @"{\"root\": \"%@\", \"nodes\": [\n  %@\n], \"critical_path\": [%@], \"critical_path_ms\": %.3f, "
+                                       "\"size_critical_path\": [%@], \"size_critical_path_bytes\": %llu}\n",
+            plsim_escape_string(_root.path), [nodeEntries componentsJoinedByString: @",\n  "],
+            [criticalIds componentsJoinedByString: @", "], criticalTime * 1000.0,
+            [sizeCriticalIds componentsJoinedByString: @", "], (unsigned long long) criticalBytes];
+}
+
+/**
+ * Write the DOT and JSON representations of the graph to @a directory, as baseName.dot and baseName.json.
+ *
+ * @param directory Destination directory. Will be created if it does not exist.
+ * @param baseName The base file name.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) writeToDirectory: (NSString *) directory baseName: (NSString *) baseName error: (NSError **) outError {
+    NSError *error;
+    NSFileManager *fm = [NSFileManager new];
+    NSString *base = [directory stringByAppendingPathComponent: baseName];
+
+    if (![fm createDirectoryAtPath: directory withIntermediateDirectories: YES attributes: nil error: &error] ||
+        ![[self DOTRepresentation] writeToFile: [base stringByAppendingPathExtension: @"dot"] atomically: YES encoding: NSUTF8StringEncoding error: &error] ||
+        ![[self JSONRepresentation] writeToFile: [base stringByAppendingPathExtension: @"json"] atomically: YES encoding: NSUTF8StringEncoding error: &error])
+    {
+        NSString *desc = NSLocalizedString(@"Could not write the dependency graph.", @"Write failure");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+        return NO;
+    }
+
+    return YES;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLDylibGraph (PrivateMethods)
+
+/**
+ * Compute the maximum cumulative @a costType of any chain starting at @a node, memoizing results in @a costs
+ * and the chosen successor of each node in @a nexts. Nodes in @a active are on the current search path;
+ * edges back to them (dependency cycles) are ignored.
+ */
+- (double) criticalPathFrom: (PLDylibGraphNode *) node
+                   costType: (PLDylibGraphCost) costType
+                      costs: (NSMapTable *) costs
+                      nexts: (NSMapTable *) nexts
+                     active: (NSMutableSet *) active
+{
+    NSNumber *memo = [costs objectForKey: node];
+    if (memo != nil)
+        return [memo doubleValue];
+
+    [active addObject: node];
+
+    double best = 0;
+    PLDylibGraphNode *bestNext = nil;
+    for (PLDylibGraphNode *dep in node.dependencies) {
+        if ([active containsObject: dep])
+            continue;
+
+        double cost = [self criticalPathFrom: dep costType: costType costs: costs nexts: nexts active: active];
+        if (bestNext == nil || cost > best) {
+            best = cost;
+            bestNext = dep;
+        }
+    }
+
+    [active removeObject: node];
+
+    if (bestNext != nil)
+        [nexts setObject: bestNext forKey: node];
+
+    double nodeCost = (costType == PLDylibGraphCostFileSize) ? (double) node.fileSize : node.parseTime;
+    double total = nodeCost + best;
+    [costs setObject: [NSNumber numberWithDouble: total] forKey: node];
+    return total;
+}
+
+/**
+ * Append a summary of @a path to @a report, headed by @a title.
+ */
+- (void) appendCriticalPath: (NSArray *) path title: (NSString *) title toReport: (NSMutableString *) report {
+    NSTimeInterval total = 0;
+    uint64_t bytes = 0;
+    for (PLDylibGraphNode *node in path) {
+        total += node.parseTime;
+        bytes += node.fileSize;
+    }
+
+    [report appendFormat: @"%@: %lu of %lu libraries, %.3f ms parse time, %.1f MB\n", title,
+                          (unsigned long) [path count], (unsigned long) [_nodes count], total * 1000.0, bytes / (1024.0 * 1024.0)];
+
+    for (PLDylibGraphNode *node in path) {
+        [report appendFormat: @"  %*s%@ (%.3f ms, %.1f MB)%@\n", (int) node.depth * 2, "", node.path, node.parseTime * 1000.0,
+                              node.fileSize / (1024.0 * 1024.0), node.resolved ? @"" : @" [unresolved]"];
+    }
+}
+
+@end
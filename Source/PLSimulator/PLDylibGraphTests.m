@@ -0,0 +1,89 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLDylibGraph.h"
+
+@interface PLDylibGraphTests : PLTestCase @end
+
+@implementation PLDylibGraphTests
+
+- (void) testGraph {
+    NSString *path = [[NSBundle bundleForClass: [self class]] executablePath];
+    NSError *error;
+    PLDylibGraph *graph = [PLDylibGraph graphWithBinaryPath: path rpaths: nil error: &error];
+    STAssertNotNil(graph, @"Failed to build graph: %@", error);
+
+    PLDylibGraphNode *root = graph.root;
+    STAssertTrue(root.resolved, @"Root should be resolved");
+    STAssertEquals(root.depth, (NSUInteger) 0, @"Incorrect root depth");
+    STAssertTrue(root.fileSize > 0, @"Missing root file size");
+    STAssertTrue([root.dependencies count] > 0, @"Test bundle should link at least one library");
+
+    /* Depths are shortest distances from the root: a dependency is at most one level deeper than any node linking it, and is never the root */
+    for (PLDylibGraphNode *node in graph.nodes) {
+        for (PLDylibGraphNode *dep in node.dependencies)
+            STAssertTrue(dep.depth <= node.depth + 1 && dep.depth > 0, @"Incorrect depth for %@", dep);
+    }
+
+    /* The critical path starts at the root, and follows dependency edges */
+    NSArray *critical = [graph criticalPath];
+    STAssertTrue([critical count] > 0, @"Empty critical path");
+    STAssertEqualObjects([critical objectAtIndex: 0], root, @"Critical path should start at the root");
+    for (NSUInteger i = 1; i < [critical count]; i++)
+        STAssertTrue([[[critical objectAtIndex: i - 1] dependencies] containsObject: [critical objectAtIndex: i]], @"Critical path is not connected");
+
+    /* The file size path is likewise rooted and connected */
+    NSArray *sizeCritical = [graph criticalPathByCost: PLDylibGraphCostFileSize];
+    STAssertEqualObjects([sizeCritical objectAtIndex: 0], root, @"Critical path should start at the root");
+    for (NSUInteger i = 1; i < [sizeCritical count]; i++)
+        STAssertTrue([[[sizeCritical objectAtIndex: i - 1] dependencies] containsObject: [sizeCritical objectAtIndex: i]], @"Critical path is not connected");
+
+    NSString *report = [graph criticalPathReport];
+    STAssertTrue([report rangeOfString: @"Critical path by parse time"].location != NSNotFound, @"Missing parse time path: %@", report);
+    STAssertTrue([report rangeOfString: @"Critical path by file size"].location != NSNotFound, @"Missing file size path: %@", report);
+
+    STAssertTrue([[graph DOTRepresentation] hasPrefix: @"digraph"], @"Invalid DOT output");
+
+    NSData *json = [[graph JSONRepresentation] dataUsingEncoding: NSUTF8StringEncoding];
+    Class serialization = NSClassFromString(@"NSJSONSerialization");
+    if (serialization != nil) {
+        NSDictionary *dict = [serialization JSONObjectWithData: json options: 0 error: &error];
+        STAssertNotNil(dict, @"Invalid JSON output: %@", error);
+        STAssertEquals([[dict objectForKey: @"nodes"] count], [graph.nodes count], @"Incorrect node count");
+    }
+}
+
+- (void) testMissingBinary {
+    NSError *error;
+    STAssertNil([PLDylibGraph graphWithBinaryPath: @"/nonexistent" rpaths: nil error: &error], @"Graph should not be created");
+    STAssertNotNil(error, @"Error was not populated");
+}
+
+@end
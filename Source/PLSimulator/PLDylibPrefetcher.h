@@ -0,0 +1,66 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+@interface PLDylibPrefetcher : NSObject {
+@private
+    /** Path to the persistent closure cache, or nil if closures should not be persisted. */
+    NSString *_cachePath;
+
+    /** Serial queue guarding all mutable state. */
+    dispatch_queue_t _queue;
+
+    /** Tracks all outstanding prefetch and discovery work. */
+    dispatch_group_t _group;
+
+    /** Map of root binary path to the array of paths in its dependency closure. */
+    NSMutableDictionary *_closures;
+
+    /** Map of root binary path to the identity (inode and modification time) of the root when its closure was computed. */
+    NSMutableDictionary *_rootIdentities;
+
+    /** The set of paths for which readahead has already been issued. */
+    NSMutableSet *_prefetched;
+}
+
++ (PLDylibPrefetcher *) sharedPrefetcher;
++ (BOOL) isEnabled;
++ (BOOL) adviseReadOfFileAtPath: (NSString *) path;
+
+- (id) initWithCachePath: (NSString *) cachePath;
+
+- (void) prefetchCachedClosures;
+- (void) prefetchClosureOfBinaryAtPath: (NSString *) path rpaths: (NSArray *) rpaths;
+- (void) prefetchPaths: (NSArray *) paths;
+
+- (NSArray *) cachedClosureOfBinaryAtPath: (NSString *) path;
+
+- (void) waitUntilFinished;
+
+@end
@@ -0,0 +1,361 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLDylibPrefetcher.h"
+
+#import "PLDylibGraph.h"
+#import "PLSimulatorStats.h"
+
+#import <limits.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/stat.h>
+
+/* If set, prefetching is disabled. Used to measure cold-start behavior without prefetch */
+#define PREFETCH_DISABLE_ENV "PLSIMULATOR_DISABLE_PREFETCH"
+
+/* Cache directory and file name, relative to the user's caches directory */
+#define CACHE_DIRECTORY @"coop.plausible.PLSimulator"
+#define CACHE_FILE @"DylibClosures.plist"
+
+/* Maximum length of a single readahead advisory; ra_count is an int. */
+#define READAHEAD_MAX_LENGTH (INT_MAX & ~4095)
+
+/* Cache entry keys */
+#define CACHE_KEY_CLOSURE @"Closure"
+#define CACHE_KEY_INODE @"Inode"
+#define CACHE_KEY_MTIME @"ModificationTime"
+#define CACHE_KEY_MTIME_NSEC @"ModificationTimeNanoseconds"
+
+@interface PLDylibPrefetcher (PrivateMethods)
+- (void) issueReadaheadForPaths: (NSArray *) paths;
+- (void) writeCache;
+@end
+
+/*
+ * Return the identity of the file at @a path -- its inode and modification time -- as recorded in the closure
+ * cache, or nil if the file can not be stat'd.
+ */
+static NSDictionary *prefetch_file_identity (NSString *path) {
+    struct stat sb;
+    if (stat([path fileSystemRepresentation], &sb) != 0)
+        return nil;
+
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithUnsignedLongLong: sb.st_ino], CACHE_KEY_INODE,
+            [NSNumber numberWithLongLong: sb.st_mtimespec.tv_sec], CACHE_KEY_MTIME,
+            [NSNumber numberWithLong: sb.st_mtimespec.tv_nsec], CACHE_KEY_MTIME_NSEC,
+            nil];
+}
+
+/**
+ * Issues asynchronous readahead for the dylib dependency closure of a binary, so that a subsequent
+ * dlopen() does not fault in each library serially from a cold disk.
+ *
+ * The closure of each binary is persisted in the user's caches directory. On later runs, readahead for
+ * the remembered closure may be issued immediately -- eg, before platform discovery has completed --
+ * while the actual closure is recomputed in the background and the cache updated. Remembered closures are
+ * discarded if their root binary has since been removed or replaced.
+ *
+ * @par Thread Safety
+ * Thread-safe. May be used from any thread.
+ */
+@implementation PLDylibPrefetcher
+
+/**
+ * Return the shared prefetcher, which persists closures in the user's caches directory.
+ */
++ (PLDylibPrefetcher *) sharedPrefetcher {
+    static PLDylibPrefetcher *shared;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSString *cachePath = nil;
+        NSArray *dirs = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+        if ([dirs count] > 0)
+            cachePath = [[[dirs objectAtIndex: 0] stringByAppendingPathComponent: CACHE_DIRECTORY] stringByAppendingPathComponent: CACHE_FILE];
+
+        shared = [[PLDylibPrefetcher alloc] initWithCachePath: cachePath];
+    });
+
+    return shared;
+}
+
+/**
+ * Return NO if prefetching has been disabled by setting the PLSIMULATOR_DISABLE_PREFETCH environment
+ * variable.
+ */
++ (BOOL) isEnabled {
+    return getenv(PREFETCH_DISABLE_ENV) == NULL;
+}
+
+/**
+ * Advise the kernel that the entire file at @a path will be read, initiating asynchronous readahead.
+ *
+ * @param path The file to prefetch.
+ * @return Returns YES if the advisory was issued, or NO if the file could not be opened.
+ */
++ (BOOL) adviseReadOfFileAtPath: (NSString *) path {
+    int fd = open([path fileSystemRepresentation], O_RDONLY);
+    if (fd < 0)
+        return NO;
+
+    BOOL result = YES;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) {
+        result = NO;
+    } else {
+        for (off_t offset = 0; offset < sb.st_size; offset += READAHEAD_MAX_LENGTH) {
+            struct radvisory advisory;
+            advisory.ra_offset = offset;
+            advisory.ra_count = (int) MIN(sb.st_size - offset, READAHEAD_MAX_LENGTH);
+
+            if (fcntl(fd, F_RDADVISE, &advisory) == -1) {
+                result = NO;
+                break;
+            }
+        }
+    }
+
+    close(fd);
+    return result;
+}
+
+/**
+ * Initialize a new prefetcher.
+ *
+ * @param cachePath Path at which discovered closures will be persisted, and from which they will be loaded. If nil,
+ * closures are only retained for the lifetime of the receiver.
+ */
+- (id) initWithCachePath: (NSString *) cachePath {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _cachePath = cachePath;
+    _queue = dispatch_queue_create("coop.plausible.PLDylibPrefetcher", NULL);
+    _group = dispatch_group_create();
+    _closures = [NSMutableDictionary dictionary];
+    _rootIdentities = [NSMutableDictionary dictionary];
+    _prefetched = [NSMutableSet set];
+
+    /* Load the persisted closures, discarding malformed entries, and those whose root binary no longer exists or
+     * has been replaced or modified since its closure was computed */
+    NSDictionary *cached = (_cachePath != nil) ? [NSDictionary dictionaryWithContentsOfFile: _cachePath] : nil;
+    BOOL pruned = NO;
+    for (NSString *root in cached) {
+        NSDictionary *entry = [cached objectForKey: root];
+        if (![root isKindOfClass: [NSString class]] || ![entry isKindOfClass: [NSDictionary class]]) {
+            pruned = YES;
+            continue;
+        }
+
+        NSArray *closure = [entry objectForKey: CACHE_KEY_CLOSURE];
+        NSDictionary *identity = prefetch_file_identity(root);
+        if (![closure isKindOfClass: [NSArray class]] || identity == nil ||
+            ![[entry objectForKey: CACHE_KEY_INODE] isEqual: [identity objectForKey: CACHE_KEY_INODE]] ||
+            ![[entry objectForKey: CACHE_KEY_MTIME] isEqual: [identity objectForKey: CACHE_KEY_MTIME]] ||
+            ![[entry objectForKey: CACHE_KEY_MTIME_NSEC] isEqual: [identity objectForKey: CACHE_KEY_MTIME_NSEC]])
+        {
+            pruned = YES;
+            continue;
+        }
+
+        [_closures setObject: closure forKey: root];
+        [_rootIdentities setObject: identity forKey: root];
+    }
+
+    /* Persist the pruned cache */
+    if (pruned) {
+        dispatch_group_async(_group, _queue, ^{
+            [self writeCache];
+        });
+    }
+
+    return self;
+}
+
+- (void) dealloc {
+    dispatch_release(_queue);
+    dispatch_release(_group);
+}
+
+/**
+ * Asynchronously issue readahead for every closure recalled from previous runs.
+ */
+- (void) prefetchCachedClosures {
+    dispatch_group_async(_group, _queue, ^{
+        for (NSArray *closure in [_closures allValues])
+            [self issueReadaheadForPaths: closure];
+    });
+}
+
+/**
+ * Asynchronously prefetch the dependency closure of the binary at @a path.
+ *
+ * If the closure is known from a previous run, readahead is issued for it immediately. The closure is then
+ * recomputed in the background; readahead is issued for any newly discovered libraries, and the cache is updated.
+ *
+ * @param path The root binary.
+ * @param rpaths Additional absolute @rpath search paths, as per PLDylibGraph::graphWithBinaryPath:rpaths:error:.
+ */
+- (void) prefetchClosureOfBinaryAtPath: (NSString *) path rpaths: (NSArray *) rpaths {
+    NSString *root = [path stringByResolvingSymlinksInPath];
+
+    dispatch_group_async(_group, _queue, ^{
+        NSArray *cached = [_closures objectForKey: root];
+        if (cached != nil) {
+            plsimulator_stats_add(PLSimulatorCounterPrefetchCacheHits, 1);
+            [self issueReadaheadForPaths: cached];
+        } else {
+            plsimulator_stats_add(PLSimulatorCounterPrefetchCacheMisses, 1);
+            [self issueReadaheadForPaths: [NSArray arrayWithObject: root]];
+        }
+
+        /* Recompute the closure off of the serial queue */
+        dispatch_group_async(_group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            NSError *error;
+            PLDylibGraph *graph = [PLDylibGraph graphWithBinaryPath: root rpaths: rpaths error: &error];
+            if (graph == nil) {
+                NSLog(@"Could not determine dependency closure of %@: %@", root, error);
+                return;
+            }
+
+            NSMutableArray *closure = [NSMutableArray arrayWithCapacity: [graph.nodes count]];
+            for (PLDylibGraphNode *node in graph.nodes) {
+                if (node.resolved)
+                    [closure addObject: node.path];
+            }
+
+            NSDictionary *identity = prefetch_file_identity(root);
+
+            dispatch_group_async(_group, _queue, ^{
+                [self issueReadaheadForPaths: closure];
+
+                /* The root may have been removed while its closure was computed */
+                if (identity == nil)
+                    return;
+
+                if (![closure isEqualToArray: [_closures objectForKey: root]] || ![identity isEqual: [_rootIdentities objectForKey: root]]) {
+                    [_closures setObject: closure forKey: root];
+                    [_rootIdentities setObject: identity forKey: root];
+                    [self writeCache];
+                }
+            });
+        });
+    });
+}
+
+/**
+ * Asynchronously issue readahead for all of @a paths. Paths for which readahead has already been issued by
+ * the receiver are skipped.
+ */
+- (void) prefetchPaths: (NSArray *) paths {
+    dispatch_group_async(_group, _queue, ^{
+        [self issueReadaheadForPaths: paths];
+    });
+}
+
+/**
+ * Return the closure of the binary at @a path recorded by the receiver, or nil if unknown.
+ */
+- (NSArray *) cachedClosureOfBinaryAtPath: (NSString *) path {
+    NSString *root = [path stringByResolvingSymlinksInPath];
+    __block NSArray *result;
+
+    dispatch_sync(_queue, ^{
+        result = [_closures objectForKey: root];
+    });
+
+    return result;
+}
+
+/**
+ * Block until all outstanding prefetch and closure discovery work has completed.
+ */
+- (void) waitUntilFinished {
+    dispatch_group_wait(_group, DISPATCH_TIME_FOREVER);
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLDylibPrefetcher (PrivateMethods)
+
+/**
+ * Issue readahead for all paths not yet prefetched, in parallel. Must be called on the receiver's queue.
+ */
+- (void) issueReadaheadForPaths: (NSArray *) paths {
+    NSMutableArray *pending = [NSMutableArray arrayWithCapacity: [paths count]];
+    for (NSString *path in paths) {
+        if ([_prefetched containsObject: path])
+            continue;
+
+        [_prefetched addObject: path];
+        [pending addObject: path];
+    }
+
+    if ([pending count] == 0)
+        return;
+
+    /* Each advisory requires an open() and a synchronous fetch of the file's metadata; issue them concurrently */
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+    dispatch_group_async(_group, queue, ^{
+        dispatch_apply([pending count], queue, ^(size_t i) {
+            [PLDylibPrefetcher adviseReadOfFileAtPath: [pending objectAtIndex: i]];
+        });
+    });
+}
+
+/**
+ * Persist the current closure set. Must be called on the receiver's queue.
+ */
+- (void) writeCache {
+    if (_cachePath == nil)
+        return;
+
+    NSError *error;
+    NSFileManager *fm = [NSFileManager new];
+    if (![fm createDirectoryAtPath: [_cachePath stringByDeletingLastPathComponent] withIntermediateDirectories: YES attributes: nil error: &error]) {
+        NSLog(@"Could not create dylib closure cache directory: %@", error);
+        return;
+    }
+
+    /* Each entry records the root's identity alongside its closure */
+    NSMutableDictionary *entries = [NSMutableDictionary dictionaryWithCapacity: [_closures count]];
+    for (NSString *root in _closures) {
+        NSMutableDictionary *entry = [NSMutableDictionary dictionaryWithDictionary: [_rootIdentities objectForKey: root]];
+        [entry setObject: [_closures objectForKey: root] forKey: CACHE_KEY_CLOSURE];
+        [entries setObject: entry forKey: root];
+    }
+
+    if (![entries writeToFile: _cachePath atomically: YES])
+        NSLog(@"Could not write dylib closure cache to %@", _cachePath);
+}
+
+@end
@@ -0,0 +1,95 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLDylibPrefetcher.h"
+
+@interface PLDylibPrefetcherTests : PLTestCase {
+@private
+    /** Temporary cache path */
+    NSString *_cachePath;
+}
+@end
+
+@implementation PLDylibPrefetcherTests
+
+- (void) setUp {
+    _cachePath = [[self temporaryDirectory] stringByAppendingPathComponent: @"closures.plist"];
+}
+
+- (void) testAdvise {
+    STAssertTrue([PLDylibPrefetcher adviseReadOfFileAtPath: [[NSBundle bundleForClass: [self class]] executablePath]], @"Advisory failed");
+    STAssertFalse([PLDylibPrefetcher adviseReadOfFileAtPath: @"/nonexistent"], @"Advisory should fail on a missing file");
+}
+
+/* The discovered closure must be persisted and recalled by a new prefetcher */
+- (void) testClosureCache {
+    NSString *path = [[NSBundle bundleForClass: [self class]] executablePath];
+
+    PLDylibPrefetcher *prefetcher = [[PLDylibPrefetcher alloc] initWithCachePath: _cachePath];
+    STAssertNil([prefetcher cachedClosureOfBinaryAtPath: path], @"Closure should not be known");
+
+    [prefetcher prefetchClosureOfBinaryAtPath: path rpaths: nil];
+    [prefetcher waitUntilFinished];
+
+    NSArray *closure = [prefetcher cachedClosureOfBinaryAtPath: path];
+    STAssertNotNil(closure, @"Closure was not recorded");
+    STAssertTrue([closure count] > 1, @"Closure should include the binary's dependencies");
+    STAssertEqualObjects([closure objectAtIndex: 0], [path stringByResolvingSymlinksInPath], @"Closure should start with the root binary");
+
+    PLDylibPrefetcher *recalled = [[PLDylibPrefetcher alloc] initWithCachePath: _cachePath];
+    STAssertEqualObjects([recalled cachedClosureOfBinaryAtPath: path], closure, @"Closure was not persisted");
+
+    [recalled prefetchCachedClosures];
+    [recalled waitUntilFinished];
+}
+
+/* Closures of binaries that have since been replaced or removed must be discarded */
+- (void) testStaleClosures {
+    NSString *root = [[self temporaryDirectory] stringByAppendingPathComponent: @"binary"];
+    NSString *source = [[NSBundle bundleForClass: [self class]] executablePath];
+    STAssertTrue([[NSFileManager defaultManager] copyItemAtPath: source toPath: root error: NULL], @"Could not copy binary");
+
+    PLDylibPrefetcher *prefetcher = [[PLDylibPrefetcher alloc] initWithCachePath: _cachePath];
+    [prefetcher prefetchClosureOfBinaryAtPath: root rpaths: nil];
+    [prefetcher waitUntilFinished];
+    STAssertNotNil([[[PLDylibPrefetcher alloc] initWithCachePath: _cachePath] cachedClosureOfBinaryAtPath: root], @"Closure was not persisted");
+
+    /* Replace the binary; the new file has a new inode */
+    [[NSFileManager defaultManager] removeItemAtPath: root error: NULL];
+    STAssertTrue([[NSFileManager defaultManager] copyItemAtPath: source toPath: root error: NULL], @"Could not copy binary");
+    PLDylibPrefetcher *recalled = [[PLDylibPrefetcher alloc] initWithCachePath: _cachePath];
+    STAssertNil([recalled cachedClosureOfBinaryAtPath: root], @"Replaced binary's closure was recalled");
+
+    /* The stale entry must also be pruned from the cache file */
+    [recalled waitUntilFinished];
+    STAssertEquals([[NSDictionary dictionaryWithContentsOfFile: _cachePath] count], (NSUInteger) 0, @"Stale entry was not pruned");
+}
+
+@end
@@ -44,6 +44,24 @@
     
     /** Library references. */
     NSArray *_dylibPaths;
+
+    /** The Mach-O data backing this binary. */
+    NSData *_data;
+
+    /** Offset of the LC_CODE_SIGNATURE data within the binary. */
+    uint32_t _codeSignatureOffset;
+
+    /** Size of the LC_CODE_SIGNATURE data, or 0 if the binary is not code signed. */
+    uint32_t _codeSignatureSize;
+
+    /** Target platform, or 0 if not declared. */
+    uint32_t _platform;
+
+    /** Minimum OS version, or nil if not declared. */
+    NSString *_minimumOSVersion;
+
+    /** SDK version the binary was linked against, or nil if not declared. */
+    NSString *_sdkVersion;
 }
 
 + (id) binaryWithPath: (NSString *) path data: (NSData *) data error: (NSError **) outError;
@@ -51,6 +69,8 @@
 
 - (NSArray *) absoluteRpaths;
 
+- (BOOL) verifyCodeSignature: (NSUInteger *) outInvalidPage error: (NSError **) outError;
+
 /** CPU type of this binary */
 @property(nonatomic, readonly) cpu_type_t cpu_type;
 
@@ -63,4 +83,28 @@
 /** LC_LOAD_DYLIB paths defined by this binary */
 @property(nonatomic, readonly) NSArray *dylibPaths;
 
+/** The Mach-O data backing this binary. */
+@property(nonatomic, readonly) NSData *data;
+
+/**
+ * Target platform declared by LC_BUILD_VERSION (eg, PLATFORM_IOSSIMULATOR), PLATFORM_IOS if the binary instead
+ * declares LC_VERSION_MIN_IPHONEOS, or 0 if neither is declared.
+ */
+@property(nonatomic, readonly) uint32_t platform;
+
+/**
+ * Minimum OS version (eg, 4.3) declared by LC_BUILD_VERSION or LC_VERSION_MIN_IPHONEOS, or nil if not declared.
+ * Versions declared by LC_BUILD_VERSION for a platform other than PLATFORM_IOS or PLATFORM_IOSSIMULATOR are ignored.
+ */
+@property(nonatomic, readonly) NSString *minimumOSVersion;
+
+/**
+ * SDK version (eg, 6.1) declared by LC_BUILD_VERSION or LC_VERSION_MIN_IPHONEOS, or nil if not declared. An SDK
+ * version of 0, as written by older linkers, is treated as undeclared.
+ */
+@property(nonatomic, readonly) NSString *sdkVersion;
+
+/** YES if the binary declares an LC_CODE_SIGNATURE load command. */
+@property(nonatomic, readonly, getter=isCodeSigned) BOOL codeSigned;
+
 @end
@@ -30,12 +30,19 @@
 
 #import "PLSimulator.h"
 #import "PLMachO.h"
-
+#import "PLSimulatorStats.h"
+#import "PLCodeSignature.h"
 
 #import <mach-o/arch.h>
 #import <mach-o/loader.h>
 #import <mach-o/fat.h>
 
+#import <CommonCrypto/CommonDigest.h>
+
+/* Number of code pages hashed by each code signature verification work item. Large enough to amortize
+ * dispatch overhead, small enough to balance load and allow an early exit once a bad page is found. */
+#define CODE_PAGES_PER_WORK_ITEM 32
+
 /**
  * @internal
  *
@@ -53,6 +60,10 @@
 @synthesize cpu_subtype = _cpu_subtype;
 @synthesize rpaths = _rpaths;
 @synthesize dylibPaths = _dylibPaths;
+@synthesize data = _data;
+@synthesize platform = _platform;
+@synthesize minimumOSVersion = _minimumOSVersion;
+@synthesize sdkVersion = _sdkVersion;
 
 /* Some byteswap wrappers */
 static uint32_t macho_swap32 (uint32_t input) {
@@ -63,6 +74,66 @@ static uint32_t macho_nswap32(uint32_t input) {
     return input;
 }
 
+/* Format a nibble-encoded (xxxx.yy.zz) Mach-O version, omitting a zero patch component. */
+static NSString *macho_version_string (uint32_t version) {
+    uint32_t major = version >> 16;
+    uint32_t minor = (version >> 8) & 0xFF;
+    uint32_t patch = version & 0xFF;
+
+    if (patch == 0)
+        return [NSString stringWithFormat: @"%u.%u", major, minor];
+
+    return [NSString stringWithFormat: @"%u.%u.%u", major, minor, patch];
+}
+
+/* Return the relative strength of a code directory hash type, or 0 if the type is unsupported. */
+static int cs_hash_rank (uint8_t type) {
+    switch (type) {
+        case PL_CS_HASHTYPE_SHA384:
+            return 4;
+        case PL_CS_HASHTYPE_SHA256:
+            return 3;
+        case PL_CS_HASHTYPE_SHA256_TRUNCATED:
+            return 2;
+        case PL_CS_HASHTYPE_SHA1:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Return the code directory hash size of a supported hash type. */
+static size_t cs_hash_size (uint8_t type) {
+    switch (type) {
+        case PL_CS_HASHTYPE_SHA384:
+            return CC_SHA384_DIGEST_LENGTH;
+        case PL_CS_HASHTYPE_SHA256:
+            return CC_SHA256_DIGEST_LENGTH;
+        default:
+            /* SHA-1, and truncated SHA-256 */
+            return CC_SHA1_DIGEST_LENGTH;
+    }
+}
+
+/*
+ * Hash @a length bytes at @a data using the supported hash @a type. The @a digest buffer must be at least
+ * CC_SHA384_DIGEST_LENGTH bytes. CommonCrypto's digest implementations are vectorized on all supported hosts.
+ */
+static void cs_hash (uint8_t type, const void *data, size_t length, uint8_t *digest) {
+    switch (type) {
+        case PL_CS_HASHTYPE_SHA384:
+            CC_SHA384(data, (CC_LONG) length, digest);
+            break;
+        case PL_CS_HASHTYPE_SHA256:
+        case PL_CS_HASHTYPE_SHA256_TRUNCATED:
+            CC_SHA256(data, (CC_LONG) length, digest);
+            break;
+        default:
+            CC_SHA1(data, (CC_LONG) length, digest);
+            break;
+    }
+}
+
 
 /**
  * Create and initialize a new instance with the provided Mach-O @a data.
@@ -92,7 +163,11 @@ static uint32_t macho_nswap32(uint32_t input) {
     if ((self = [super init]) == nil)
         return nil;
     
+    uint64_t start = mach_absolute_time();
+    plsimulator_stats_add(PLSimulatorCounterBinaryParseAttempts, 1);
+
     _path = path;
+    _data = data;
     
     /* Configure parser */
     macho_input_t input;
@@ -238,6 +313,66 @@ static uint32_t macho_nswap32(uint32_t input) {
 
                 break;
             }
+
+            case LC_VERSION_MIN_IPHONEOS: {
+                if (cmdsize < sizeof(struct version_min_command)) {
+                    NSString *desc = NSLocalizedString(@"LC_VERSION_MIN_IPHONEOS has invalid size", @"Invalid binary");
+                    plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+                    return nil;
+                }
+
+                /* LC_BUILD_VERSION takes precedence, if also declared */
+                if (_platform != 0)
+                    break;
+
+                const struct version_min_command *version_cmd = (const struct version_min_command *) cmd;
+                _platform = PLATFORM_IOS;
+                _minimumOSVersion = macho_version_string(swap32(version_cmd->version));
+
+                /* Older linkers leave the SDK version unset */
+                if (version_cmd->sdk != 0)
+                    _sdkVersion = macho_version_string(swap32(version_cmd->sdk));
+                break;
+            }
+
+            case LC_BUILD_VERSION: {
+                if (cmdsize < sizeof(struct build_version_command)) {
+                    NSString *desc = NSLocalizedString(@"LC_BUILD_VERSION has invalid size", @"Invalid binary");
+                    plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+                    return nil;
+                }
+
+                const struct build_version_command *build_cmd = (const struct build_version_command *) cmd;
+                _platform = swap32(build_cmd->platform);
+
+                /* Versions declared for any other platform do not describe iOS requirements */
+                if (_platform != PLATFORM_IOS && _platform != PLATFORM_IOSSIMULATOR) {
+                    _minimumOSVersion = nil;
+                    _sdkVersion = nil;
+                    break;
+                }
+
+                _minimumOSVersion = macho_version_string(swap32(build_cmd->minos));
+                if (build_cmd->sdk != 0)
+                    _sdkVersion = macho_version_string(swap32(build_cmd->sdk));
+                else
+                    _sdkVersion = nil;
+                break;
+            }
+
+            case LC_CODE_SIGNATURE: {
+                /* Record the signature location; the signature itself is only read on verification */
+                if (cmdsize < sizeof(struct linkedit_data_command)) {
+                    NSString *desc = NSLocalizedString(@"LC_CODE_SIGNATURE has invalid size", @"Invalid binary");
+                    plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+                    return nil;
+                }
+
+                const struct linkedit_data_command *sig_cmd = (const struct linkedit_data_command *) cmd;
+                _codeSignatureOffset = swap32(sig_cmd->dataoff);
+                _codeSignatureSize = swap32(sig_cmd->datasize);
+                break;
+            }
                 
             default:
                 break;
@@ -252,6 +387,9 @@ static uint32_t macho_nswap32(uint32_t input) {
         }
     }
 
+    plsimulator_stats_add(PLSimulatorCounterBinariesParsed, 1);
+    plsimulator_stats_record(PLSimulatorHistogramBinaryParseTime, plsimulator_stats_abs_to_ns(mach_absolute_time() - start));
+
     return self;
 }
 
@@ -306,5 +444,169 @@ static uint32_t macho_nswap32(uint32_t input) {
     return absolutePaths;
 }
 
+/**
+ * Validate the per-page hashes of the binary's embedded code signature against the binary's contents.
+ * Pages are hashed concurrently.
+ *
+ * If the signature contains multiple code directories, the code directory using the strongest supported hash
+ * is validated. Only the page hashes are checked; the code directory's CMS signature and special slots are not
+ * evaluated, and a valid result does not establish that the binary was signed by a trusted identity.
+ *
+ * @param outInvalidPage If the code signature does not match the binary's contents, upon return contains the
+ * index of the first invalid code page. May be NULL. The embedded signature follows the signed code, so a
+ * truncated binary loses (part of) its signature, and fails as malformed without reporting a page.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns YES if all page hashes match. Returns NO with a #PLSimulatorErrorInvalidCodeSignature error
+ * if the binary is not code signed, the signature is malformed, or any page does not match its hash.
+ */
+- (BOOL) verifyCodeSignature: (NSUInteger *) outInvalidPage error: (NSError **) outError {
+    if (_codeSignatureSize == 0) {
+        NSString *desc = NSLocalizedString(@"The binary is not code signed.", @"Missing code signature");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, desc, nil);
+        return NO;
+    }
+
+    NSString *malformed = NSLocalizedString(@"The code signature is truncated or malformed.", @"Invalid code signature");
+    const uint8_t *base = [_data bytes];
+    size_t length = [_data length];
+
+    /* Locate the embedded signature super blob */
+    if (_codeSignatureOffset > length || _codeSignatureSize > length - _codeSignatureOffset || _codeSignatureSize < sizeof(pl_cs_super_blob_t)) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+        return NO;
+    }
+
+    const uint8_t *blob = base + _codeSignatureOffset;
+    const pl_cs_super_blob_t *superBlob = (const pl_cs_super_blob_t *) blob;
+    uint32_t count = OSSwapBigToHostInt32(superBlob->count);
+    if (OSSwapBigToHostInt32(superBlob->magic) != PL_CSMAGIC_EMBEDDED_SIGNATURE || count > (_codeSignatureSize - sizeof(*superBlob)) / sizeof(pl_cs_blob_index_t)) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+        return NO;
+    }
+
+    /* Select the code directory using the strongest supported hash */
+    const pl_cs_blob_index_t *index = (const pl_cs_blob_index_t *) (blob + sizeof(*superBlob));
+    const pl_cs_code_directory_t *cd = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t type = OSSwapBigToHostInt32(index[i].type);
+        if (type != PL_CSSLOT_CODEDIRECTORY && (type < PL_CSSLOT_ALTERNATE_CODEDIRECTORIES || type >= PL_CSSLOT_ALTERNATE_CODEDIRECTORIES + PL_CSSLOT_ALTERNATE_CODEDIRECTORY_MAX))
+            continue;
+
+        uint32_t offset = OSSwapBigToHostInt32(index[i].offset);
+        if (offset > _codeSignatureSize || _codeSignatureSize - offset < sizeof(pl_cs_code_directory_t)) {
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+            return NO;
+        }
+
+        const pl_cs_code_directory_t *candidate = (const pl_cs_code_directory_t *) (blob + offset);
+        if (OSSwapBigToHostInt32(candidate->magic) != PL_CSMAGIC_CODEDIRECTORY || OSSwapBigToHostInt32(candidate->length) > _codeSignatureSize - offset) {
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+            return NO;
+        }
+
+        if (cd == NULL || cs_hash_rank(candidate->hashType) > cs_hash_rank(cd->hashType))
+            cd = candidate;
+    }
+
+    if (cd == NULL) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+        return NO;
+    }
+
+    if (cs_hash_rank(cd->hashType) == 0 || cd->hashSize != cs_hash_size(cd->hashType)) {
+        NSString *desc = NSLocalizedString(@"The code signature uses an unsupported hash type.", @"Invalid code signature");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, desc, nil);
+        return NO;
+    }
+
+    /* Determine the signed code length */
+    uint32_t cdLength = OSSwapBigToHostInt32(cd->length);
+    uint64_t codeLimit = OSSwapBigToHostInt32(cd->codeLimit);
+    if (OSSwapBigToHostInt32(cd->version) >= PL_CS_SUPPORTSCODELIMIT64) {
+        if (cdLength < sizeof(pl_cs_code_directory_64_t)) {
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+            return NO;
+        }
+
+        uint64_t codeLimit64 = OSSwapBigToHostInt64(((const pl_cs_code_directory_64_t *) cd)->codeLimit64);
+        if (codeLimit64 != 0)
+            codeLimit = codeLimit64;
+    }
+
+    /* Validate the page hash table. A page size of zero hashes the code as a single page. */
+    if (cd->pageSize >= 32) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+        return NO;
+    }
+
+    uint64_t pageSize = cd->pageSize != 0 ? (1ULL << cd->pageSize) : MAX(codeLimit, 1);
+    uint64_t pageCount = (codeLimit + pageSize - 1) / pageSize;
+    uint32_t hashOffset = OSSwapBigToHostInt32(cd->hashOffset);
+    uint32_t codeSlots = OSSwapBigToHostInt32(cd->nCodeSlots);
+    if (codeSlots < pageCount || hashOffset > cdLength || (uint64_t) codeSlots * cd->hashSize > cdLength - hashOffset) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, malformed, nil);
+        return NO;
+    }
+
+    const uint8_t *hashes = (const uint8_t *) cd + hashOffset;
+    uint8_t hashType = cd->hashType;
+    size_t hashSize = cd->hashSize;
+
+    /* Hash the pages concurrently. Work items stop early once an earlier invalid page has been found. */
+    __block int64_t firstInvalid = INT64_MAX;
+    size_t itemCount = (size_t) ((pageCount + CODE_PAGES_PER_WORK_ITEM - 1) / CODE_PAGES_PER_WORK_ITEM);
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_apply(itemCount, queue, ^(size_t item) {
+        uint64_t first = (uint64_t) item * CODE_PAGES_PER_WORK_ITEM;
+        uint64_t last = MIN(first + CODE_PAGES_PER_WORK_ITEM, pageCount);
+        uint64_t hashed = 0;
+
+        for (uint64_t page = first; page < last; page++) {
+            if ((int64_t) page > __atomic_load_n(&firstInvalid, __ATOMIC_SEQ_CST))
+                break;
+
+            /* Pages beyond the end of the data can not match. The signature bounds checks above reject truncated
+             * binaries, so this is only reachable if the code limit extends past the signature itself. */
+            uint64_t start = page * pageSize;
+            uint64_t end = MIN(start + pageSize, codeLimit);
+            BOOL valid = NO;
+            if (end <= length) {
+                uint8_t digest[CC_SHA384_DIGEST_LENGTH];
+                cs_hash(hashType, base + start, (size_t) (end - start), digest);
+                valid = (memcmp(digest, hashes + (page * hashSize), hashSize) == 0);
+                hashed++;
+            }
+
+            if (!valid) {
+                int64_t current = __atomic_load_n(&firstInvalid, __ATOMIC_SEQ_CST);
+                do {
+                    if ((int64_t) page >= current)
+                        break;
+                } while (!__atomic_compare_exchange_n(&firstInvalid, &current, (int64_t) page, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+                break;
+            }
+        }
+
+        plsimulator_stats_add(PLSimulatorCounterCodePagesHashed, hashed);
+    });
+
+    if (firstInvalid != INT64_MAX) {
+        if (outInvalidPage != NULL)
+            *outInvalidPage = (NSUInteger) firstInvalid;
+
+        NSString *desc = [NSString stringWithFormat: NSLocalizedString(@"Code page %llu does not match its code signature hash.", @"Invalid code page"),
+                          (unsigned long long) firstInvalid];
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidCodeSignature, desc, nil);
+        return NO;
+    }
+
+    return YES;
+}
+
+// property getter
+- (BOOL) isCodeSigned {
+    return _codeSignatureSize > 0;
+}
 
 @end
@@ -30,9 +30,125 @@
 
 #import "PLSimulator.h"
 #import "PLSimulatorApplication.h"
+#import "PLUniversalBinary.h"
+#import "PLMachO.h"
+
+#import "PLSyntheticMachO.h"
 
 @interface PLExecutableBinaryTests : PLTestCase @end
 
 @implementation PLExecutableBinaryTests
 
+/* The arena-backed parser must produce the same results as PLExecutableBinary */
+- (void) testArenaParseMatches {
+    NSString *path = [[NSBundle bundleForClass: [self class]] executablePath];
+    NSError *error;
+    PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: path error: &error];
+    STAssertNotNil(binary, @"Failed to load binary: %@", error);
+
+    PLExecutableBinary *exec = [binary executableMatchingCurrentArchitecture];
+    STAssertNotNil(exec, @"Executable matching current architecture was not found");
+
+    pl_arena_t arena;
+    pl_arena_init(&arena, 0);
+
+    pl_macho_image_t image;
+    STAssertEquals(pl_macho_parse_image(&arena, [exec.data bytes], [exec.data length], &image), PL_MACHO_SUCCESS, @"Failed to parse image");
+    STAssertEquals(image.cpu_type, exec.cpu_type, @"Incorrect CPU type");
+
+    STAssertEquals(image.dylib_count, [exec.dylibPaths count], @"Incorrect dylib count");
+    for (size_t i = 0; i < image.dylib_count && i < [exec.dylibPaths count]; i++)
+        STAssertEqualObjects([NSString stringWithUTF8String: image.dylib_paths[i]], [exec.dylibPaths objectAtIndex: i], @"Incorrect dylib path");
+
+    STAssertEquals(image.rpath_count, [exec.rpaths count], @"Incorrect rpath count");
+    for (size_t i = 0; i < image.rpath_count && i < [exec.rpaths count]; i++)
+        STAssertEqualObjects([NSString stringWithUTF8String: image.rpaths[i]], [exec.rpaths objectAtIndex: i], @"Incorrect rpath");
+
+    /* Truncated images must be rejected */
+    STAssertEquals(pl_macho_parse_image(&arena, [exec.data bytes], 16, &image), PL_MACHO_EINVAL, @"Truncated image should not parse");
+
+    pl_arena_free(&arena);
+}
+
+
+/* Page hashes must be validated, and the first invalid page reported */
+- (void) testCodeSignature {
+    NSError *error;
+    NSUInteger invalidPage = NSNotFound;
+
+    for (int i = 0; i < 2; i++) {
+        PLSyntheticMachOOptions options = PLSyntheticMachOCodeSigned | PLSyntheticMachO64Bit | (i == 0 ? 0 : PLSyntheticMachOByteSwapped);
+        NSData *image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86_64 cpuSubtype: CPU_SUBTYPE_X86_64_ALL options: options loadCommandCount: 4];
+        PLExecutableBinary *binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+        STAssertNotNil(binary, @"Failed to parse image: %@", error);
+        STAssertTrue(binary.codeSigned, @"Code signature was not found");
+        STAssertTrue([binary verifyCodeSignature: &invalidPage error: &error], @"Code signature should verify: %@", error);
+    }
+
+    NSMutableData *image = [[PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOCodeSigned loadCommandCount: 4] mutableCopy];
+
+    /* Corrupt two pages; the first must be reported */
+    ((uint8_t *) [image mutableBytes])[(PLSyntheticMachOSignedPageSize * 11) + 1] ^= 0xFF;
+    ((uint8_t *) [image mutableBytes])[(PLSyntheticMachOSignedPageSize * 5) + 1] ^= 0xFF;
+
+    PLExecutableBinary *binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertFalse([binary verifyCodeSignature: &invalidPage error: &error], @"Corrupted image should not verify");
+    STAssertEquals(invalidPage, (NSUInteger) 5, @"Incorrect invalid page");
+    STAssertEquals([error code], (NSInteger) PLSimulatorErrorInvalidCodeSignature, @"Incorrect error code");
+
+    /* A truncated image loses its signature */
+    NSData *truncated = [image subdataWithRange: NSMakeRange(0, PLSyntheticMachOSignedPageSize * 8)];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: truncated error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertFalse([binary verifyCodeSignature: NULL error: &error], @"Truncated image should not verify");
+
+    /* Unsigned images can not be verified */
+    NSData *unsignedImage = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: 0 loadCommandCount: 4];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: unsignedImage error: &error];
+    STAssertFalse(binary.codeSigned, @"Unsigned image reported as signed");
+    STAssertFalse([binary verifyCodeSignature: NULL error: &error], @"Unsigned image should not verify");
+}
+
+/* Deployment requirements must be read from LC_VERSION_MIN_IPHONEOS and LC_BUILD_VERSION */
+- (void) testVersionCommands {
+    NSError *error;
+
+    NSData *image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOVersionMin | PLSyntheticMachOByteSwapped loadCommandCount: 4];
+    PLExecutableBinary *binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertEquals(binary.platform, (uint32_t) PLATFORM_IOS, @"Incorrect platform");
+    STAssertEqualObjects(binary.minimumOSVersion, @"4.3", @"Incorrect minimum OS version");
+    STAssertEqualObjects(binary.sdkVersion, @"6.1", @"Incorrect SDK version");
+
+    /* LC_BUILD_VERSION takes precedence */
+    image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86_64 cpuSubtype: CPU_SUBTYPE_X86_64_ALL options: PLSyntheticMachOVersionMin | PLSyntheticMachOBuildVersion | PLSyntheticMachO64Bit loadCommandCount: 4];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertEquals(binary.platform, (uint32_t) PLATFORM_IOSSIMULATOR, @"Incorrect platform");
+    STAssertEqualObjects(binary.minimumOSVersion, @"4.3", @"Incorrect minimum OS version");
+
+    /* An unset SDK version is not declared */
+    image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOVersionMin | PLSyntheticMachOUnsetSDKVersion loadCommandCount: 4];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertEqualObjects(binary.minimumOSVersion, @"4.3", @"Incorrect minimum OS version");
+    STAssertNil(binary.sdkVersion, @"An unset SDK version should not be declared");
+
+    /* Versions declared for another platform are ignored */
+    image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86_64 cpuSubtype: CPU_SUBTYPE_X86_64_ALL options: PLSyntheticMachOVersionMin | PLSyntheticMachOBuildVersion | PLSyntheticMachOMacOSPlatform | PLSyntheticMachO64Bit loadCommandCount: 4];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertNotNil(binary, @"Failed to parse image: %@", error);
+    STAssertEquals(binary.platform, (uint32_t) PLATFORM_MACOS, @"Incorrect platform");
+    STAssertNil(binary.minimumOSVersion, @"Minimum OS version should not be declared");
+    STAssertNil(binary.sdkVersion, @"SDK version should not be declared");
+
+    /* Undeclared */
+    image = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: 0 loadCommandCount: 4];
+    binary = [PLExecutableBinary binaryWithPath: @"/tmp/Synthetic" data: image error: &error];
+    STAssertEquals(binary.platform, (uint32_t) 0, @"Platform should not be declared");
+    STAssertNil(binary.minimumOSVersion, @"Minimum OS version should not be declared");
+    STAssertNil(binary.sdkVersion, @"SDK version should not be declared");
+}
+
 @end
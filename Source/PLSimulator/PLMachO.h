@@ -29,6 +29,38 @@
 #import <sys/types.h>
 #import <stdint.h>
 #import <unistd.h>
+#import <stdbool.h>
+
+#import <mach/machine.h>
+#import <mach-o/loader.h>
+
+#import "PLArena.h"
+
+/* Load commands and platform identifiers not defined by older SDKs */
+#ifndef LC_BUILD_VERSION
+#define LC_BUILD_VERSION 0x32
+
+struct build_version_command {
+    uint32_t cmd;
+    uint32_t cmdsize;
+    uint32_t platform;
+    uint32_t minos;
+    uint32_t sdk;
+    uint32_t ntools;
+};
+#endif
+
+#ifndef PLATFORM_MACOS
+#define PLATFORM_MACOS 1
+#endif
+
+#ifndef PLATFORM_IOS
+#define PLATFORM_IOS 2
+#endif
+
+#ifndef PLATFORM_IOSSIMULATOR
+#define PLATFORM_IOSSIMULATOR 7
+#endif
 
 typedef struct macho_input {
     const void *data;
@@ -37,3 +69,46 @@ typedef struct macho_input {
 
 const void *pl_macho_read (macho_input_t *input, const void *address, size_t length);
 const void *pl_macho_offset (macho_input_t *input, const void *address, size_t offset, size_t length);
+
+/**
+ * Result codes returned by pl_macho_parse_image().
+ */
+typedef enum {
+    /** The image was parsed successfully. */
+    PL_MACHO_SUCCESS = 0,
+
+    /** The image is not a valid Mach-O image, or is truncated. */
+    PL_MACHO_EINVAL = 1,
+
+    /** Arena allocation failed. */
+    PL_MACHO_ENOMEM = 2
+} pl_macho_error_t;
+
+/**
+ * Arena-backed parse results for a non-universal Mach-O image. All strings and arrays are allocated from
+ * the arena supplied to pl_macho_parse_image(), and remain valid until that arena is freed.
+ */
+typedef struct pl_macho_image {
+    /** CPU type, in host byte order. */
+    cpu_type_t cpu_type;
+
+    /** CPU subtype, in host byte order. */
+    cpu_subtype_t cpu_subtype;
+
+    /** True if the image is 64-bit. */
+    bool m64;
+
+    /** LC_RPATH paths, in load command order. */
+    const char **rpaths;
+
+    /** Number of entries in rpaths. */
+    size_t rpath_count;
+
+    /** LC_LOAD_DYLIB install names, in load command order. */
+    const char **dylib_paths;
+
+    /** Number of entries in dylib_paths. */
+    size_t dylib_count;
+} pl_macho_image_t;
+
+pl_macho_error_t pl_macho_parse_image (pl_arena_t *arena, const void *data, size_t length, pl_macho_image_t *image);
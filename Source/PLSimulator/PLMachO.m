@@ -28,6 +28,11 @@
 
 #import "PLMachO.h"
 
+#import <string.h>
+
+#import <mach-o/loader.h>
+#import <libkern/OSByteOrder.h>
+
 /* Verify that the given range is within bounds. */
 const void *pl_macho_read (macho_input_t *input, const void *address, size_t length) {
     if ((((uint8_t *) address) - ((uint8_t *) input->data)) + length > input->length) {
@@ -41,4 +46,148 @@ const void *pl_macho_read (macho_input_t *input, const void *address, size_t len
 const void *pl_macho_offset (macho_input_t *input, const void *address, size_t offset, size_t length) {
     void *result = ((uint8_t *) address) + offset;
     return pl_macho_read(input, result, length);
-}
\ No newline at end of file
+}
+
+/*
+ * Walk the load commands of a Mach-O image. If @a image->rpaths and @a image->dylib_paths are non-NULL,
+ * the commands' strings are copied into @a arena; otherwise, they are only counted.
+ */
+static pl_macho_error_t pl_macho_walk_commands (macho_input_t *input, const void *first, uint32_t ncmds, bool swap,
+                                                pl_arena_t *arena, pl_macho_image_t *image)
+{
+    bool fill = (image->rpaths != NULL && image->dylib_paths != NULL);
+    size_t nrpaths = 0;
+    size_t ndylibs = 0;
+
+    const struct load_command *cmd = first;
+    for (uint32_t i = 0; i < ncmds; i++) {
+        /* Load the full command */
+        uint32_t cmdsize = swap ? OSSwapInt32(cmd->cmdsize) : cmd->cmdsize;
+        if (cmdsize < sizeof(struct load_command) || pl_macho_read(input, cmd, cmdsize) == NULL)
+            return PL_MACHO_EINVAL;
+
+        uint32_t cmd_type = swap ? OSSwapInt32(cmd->cmd) : cmd->cmd;
+        size_t prefix;
+        const char **target;
+        size_t *count;
+
+        switch (cmd_type) {
+            case LC_RPATH:
+                prefix = sizeof(struct rpath_command);
+                target = image->rpaths;
+                count = &nrpaths;
+                break;
+
+            case LC_LOAD_DYLIB:
+                prefix = sizeof(struct dylib_command);
+                target = image->dylib_paths;
+                count = &ndylibs;
+                break;
+
+            default:
+                prefix = 0;
+                target = NULL;
+                count = NULL;
+                break;
+        }
+
+        if (count != NULL) {
+            if (cmdsize < prefix)
+                return PL_MACHO_EINVAL;
+
+            if (fill) {
+                target[*count] = pl_arena_strndup(arena, ((const char *) cmd) + prefix, cmdsize - prefix);
+                if (target[*count] == NULL)
+                    return PL_MACHO_ENOMEM;
+            }
+
+            (*count)++;
+        }
+
+        /* Advance to the next command. The final command may abut the end of the image. */
+        if (i + 1 < ncmds) {
+            cmd = pl_macho_offset(input, cmd, cmdsize, sizeof(struct load_command));
+            if (cmd == NULL)
+                return PL_MACHO_EINVAL;
+        }
+    }
+
+    image->rpath_count = nrpaths;
+    image->dylib_count = ndylibs;
+    return PL_MACHO_SUCCESS;
+}
+
+/**
+ * Parse a non-universal Mach-O image, allocating all results from @a arena.
+ *
+ * This is a lower-level alternative to PLExecutableBinary, intended for bulk scans of many binaries;
+ * no Objective-C objects are allocated, and the results of any number of parses may be released with
+ * a single call to pl_arena_free().
+ *
+ * @param arena The arena from which results will be allocated.
+ * @param data The Mach-O image.
+ * @param length The length of @a data, in bytes.
+ * @param image On success, will be populated with the parse results.
+ *
+ * @return Returns PL_MACHO_SUCCESS on success, or an error code on failure. On failure, memory may have
+ * been allocated from @a arena, and will be released when the arena is freed.
+ */
+pl_macho_error_t pl_macho_parse_image (pl_arena_t *arena, const void *data, size_t length, pl_macho_image_t *image) {
+    macho_input_t input;
+    input.data = data;
+    input.length = length;
+
+    memset(image, 0, sizeof(*image));
+
+    /* Parse the header. The 64-bit header is a direct superset of the 32-bit header. */
+    const uint32_t *magic = pl_macho_read(&input, data, sizeof(uint32_t));
+    if (magic == NULL)
+        return PL_MACHO_EINVAL;
+
+    bool swap;
+    size_t header_size;
+    switch (*magic) {
+        case MH_MAGIC:
+        case MH_CIGAM:
+            swap = (*magic == MH_CIGAM);
+            header_size = sizeof(struct mach_header);
+            break;
+
+        case MH_MAGIC_64:
+        case MH_CIGAM_64:
+            swap = (*magic == MH_CIGAM_64);
+            header_size = sizeof(struct mach_header_64);
+            image->m64 = true;
+            break;
+
+        default:
+            return PL_MACHO_EINVAL;
+    }
+
+    const struct mach_header *header = pl_macho_read(&input, data, header_size);
+    if (header == NULL)
+        return PL_MACHO_EINVAL;
+
+    image->cpu_type = swap ? OSSwapInt32(header->cputype) : header->cputype;
+    image->cpu_subtype = swap ? OSSwapInt32(header->cpusubtype) : header->cpusubtype;
+
+    uint32_t ncmds = swap ? OSSwapInt32(header->ncmds) : header->ncmds;
+    if (ncmds == 0)
+        return PL_MACHO_SUCCESS;
+
+    const void *first = pl_macho_offset(&input, header, header_size, sizeof(struct load_command));
+    if (first == NULL)
+        return PL_MACHO_EINVAL;
+
+    /* Count the commands, so that the result arrays may be allocated at their final size */
+    pl_macho_error_t err = pl_macho_walk_commands(&input, first, ncmds, swap, arena, image);
+    if (err != PL_MACHO_SUCCESS)
+        return err;
+
+    image->rpaths = pl_arena_alloc(arena, sizeof(const char *) * image->rpath_count);
+    image->dylib_paths = pl_arena_alloc(arena, sizeof(const char *) * image->dylib_count);
+    if (image->rpaths == NULL || image->dylib_paths == NULL)
+        return PL_MACHO_ENOMEM;
+
+    return pl_macho_walk_commands(&input, first, ncmds, swap, arena, image);
+}
@@ -0,0 +1,191 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLMachOSliceWriter.h"
+
+#import "PLSimulator.h"
+
+#import <mach-o/fat.h>
+
+/**
+ * @internal
+ *
+ * Writes a subset of a PLUniversalBinary's executable slices to a new Mach-O file.
+ *
+ * If a single slice is retained, a non-universal Mach-O binary is written. Otherwise, a universal
+ * binary is written containing the retained slices, preserving each slice's original alignment.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLMachOSliceWriter
+
+/**
+ * Create and initialize a new writer.
+ *
+ * @param binary The source binary.
+ * @param executables The executables vended by @a binary that should be retained in the output.
+ */
++ (id) writerWithBinary: (PLUniversalBinary *) binary executables: (NSArray *) executables {
+    return [[self alloc] initWithBinary: binary executables: executables];
+}
+
+/**
+ * Initialize a new writer.
+ *
+ * @param binary The source binary.
+ * @param executables The executables vended by @a binary that should be retained in the output.
+ */
+- (id) initWithBinary: (PLUniversalBinary *) binary executables: (NSArray *) executables {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _binary = binary;
+    _executables = [executables copy];
+
+    return self;
+}
+
+/**
+ * Assemble the output binary.
+ *
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns the new binary's data, or nil on failure.
+ */
+- (NSData *) sliceData: (NSError **) outError {
+    if ([_executables count] == 0) {
+        NSString *desc = NSLocalizedString(@"At least one executable slice must be retained.", @"Invalid slice list");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+        return nil;
+    }
+
+    /* A single slice is written as a non-universal binary */
+    if ([_executables count] == 1)
+        return [[_executables objectAtIndex: 0] data];
+
+    /* Fetch the architecture records for all retained slices */
+    uint32_t nfat = (uint32_t) [_executables count];
+    struct fat_arch archs[nfat];
+    for (uint32_t i = 0; i < nfat; i++) {
+        if (![_binary fatArch: &archs[i] forExecutable: [_executables objectAtIndex: i]]) {
+            NSString *desc = NSLocalizedString(@"The executable slice is not a member of the universal binary.", @"Invalid slice list");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+            return nil;
+        }
+
+        /* The alignment is read from the file; an alignment that can not be represented by a 32-bit slice offset is malformed */
+        if (archs[i].align >= 32) {
+            NSString *desc = NSLocalizedString(@"The universal binary declares an invalid slice alignment.", @"Invalid binary");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+            return nil;
+        }
+    }
+
+    /* Compute the new slice offsets */
+    uint64_t offset = sizeof(struct fat_header) + (sizeof(struct fat_arch) * nfat);
+    for (uint32_t i = 0; i < nfat; i++) {
+        uint64_t alignment = 1ULL << archs[i].align;
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        if (offset > UINT32_MAX || offset + archs[i].size > UINT32_MAX) {
+            NSString *desc = NSLocalizedString(@"The thinned binary exceeds the maximum universal binary size.", @"Invalid binary");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidBinary, desc, nil);
+            return nil;
+        }
+
+        archs[i].offset = (uint32_t) offset;
+        offset += archs[i].size;
+    }
+
+    /* Write the header and architecture table. All fields are stored big-endian. */
+    NSMutableData *output = [NSMutableData dataWithLength: (NSUInteger) offset];
+    uint8_t *base = [output mutableBytes];
+
+    struct fat_header *header = (struct fat_header *) base;
+    header->magic = OSSwapHostToBigInt32(FAT_MAGIC);
+    header->nfat_arch = OSSwapHostToBigInt32(nfat);
+
+    struct fat_arch *outArchs = (struct fat_arch *) (base + sizeof(struct fat_header));
+    for (uint32_t i = 0; i < nfat; i++) {
+        outArchs[i].cputype = OSSwapHostToBigInt32(archs[i].cputype);
+        outArchs[i].cpusubtype = OSSwapHostToBigInt32(archs[i].cpusubtype);
+        outArchs[i].offset = OSSwapHostToBigInt32(archs[i].offset);
+        outArchs[i].size = OSSwapHostToBigInt32(archs[i].size);
+        outArchs[i].align = OSSwapHostToBigInt32(archs[i].align);
+
+        /* Copy in the slice; the padding between slices is left zero-filled */
+        NSData *data = [[_executables objectAtIndex: i] data];
+        memcpy(base + archs[i].offset, [data bytes], archs[i].size);
+    }
+
+    return output;
+}
+
+/**
+ * Atomically write the output binary to @a path, preserving the POSIX permissions of any existing file at @a path.
+ * The source binary may be safely overwritten.
+ *
+ * @param path The destination path.
+ * @param bytesSaved If non-NULL, on success will be set to the difference in size between the source binary and
+ * the written binary.
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ *
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) writeToPath: (NSString *) path bytesSaved: (int64_t *) bytesSaved error: (NSError **) outError {
+    NSData *data = [self sliceData: outError];
+    if (data == nil)
+        return NO;
+
+    /* Save the permissions of the file we're replacing; the atomic write will otherwise reset them */
+    NSFileManager *fm = [NSFileManager new];
+    NSNumber *permissions = [[fm attributesOfItemAtPath: path error: NULL] objectForKey: NSFilePosixPermissions];
+
+    NSError *error;
+    if (![data writeToFile: path options: NSDataWritingAtomic error: &error]) {
+        NSString *desc = NSLocalizedString(@"Could not write the thinned binary.", @"Write failure");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+        return NO;
+    }
+
+    if (permissions != nil) {
+        NSDictionary *attrs = [NSDictionary dictionaryWithObject: permissions forKey: NSFilePosixPermissions];
+        if (![fm setAttributes: attrs ofItemAtPath: path error: &error]) {
+            NSString *desc = NSLocalizedString(@"Could not restore the thinned binary's permissions.", @"Write failure");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, desc, error);
+            return NO;
+        }
+    }
+
+    if (bytesSaved != NULL)
+        *bytesSaved = (int64_t) _binary.fileSize - (int64_t) [data length];
+
+    return YES;
+}
+
+@end
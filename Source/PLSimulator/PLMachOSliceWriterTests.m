@@ -0,0 +1,83 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulator.h"
+#import "PLMachOSliceWriter.h"
+
+@interface PLMachOSliceWriterTests : PLTestCase {
+@private
+    /** Temporary output path */
+    NSString *_outputPath;
+}
+@end
+
+@implementation PLMachOSliceWriterTests
+
+- (void) setUp {
+    _outputPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"binary"];
+}
+
+- (void) testWriteSingleSlice {
+    NSError *error;
+    PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: [self pathForResource: @"test-universal" ofTestClass: NSClassFromString(@"PLUniversalBinaryTests")] error: &error];
+    STAssertNotNil(binary, @"Failed to load binary: %@", error);
+
+    PLExecutableBinary *exec = [binary executableMatchingCurrentArchitecture];
+    STAssertNotNil(exec, @"Executable matching current architecture was not found");
+
+    int64_t saved = 0;
+    PLMachOSliceWriter *writer = [PLMachOSliceWriter writerWithBinary: binary executables: [NSArray arrayWithObject: exec]];
+    STAssertTrue([writer writeToPath: _outputPath bytesSaved: &saved error: &error], @"Failed to write binary: %@", error);
+    STAssertTrue(saved > 0, @"Thinning should have reduced the binary size");
+
+    PLUniversalBinary *thinned = [PLUniversalBinary binaryWithPath: _outputPath error: &error];
+    STAssertNotNil(thinned, @"Failed to load thinned binary: %@", error);
+    STAssertFalse(thinned.universal, @"A single slice should be written as a non-universal binary");
+    STAssertEquals([[thinned executables] count], (NSUInteger) 1, @"One executable should have been found");
+    STAssertEquals([[[thinned executables] objectAtIndex: 0] cpu_type], exec.cpu_type, @"Incorrect slice retained");
+}
+
+- (void) testWriteUniversal {
+    NSError *error;
+    PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: [self pathForResource: @"test-universal" ofTestClass: NSClassFromString(@"PLUniversalBinaryTests")] error: &error];
+    STAssertNotNil(binary, @"Failed to load binary: %@", error);
+
+    int64_t saved = -1;
+    PLMachOSliceWriter *writer = [PLMachOSliceWriter writerWithBinary: binary executables: binary.executables];
+    STAssertTrue([writer writeToPath: _outputPath bytesSaved: &saved error: &error], @"Failed to write binary: %@", error);
+    STAssertEquals(saved, (int64_t) 0, @"Retaining all slices should not change the binary size");
+
+    PLUniversalBinary *rewritten = [PLUniversalBinary binaryWithPath: _outputPath error: &error];
+    STAssertNotNil(rewritten, @"Failed to load rewritten binary: %@", error);
+    STAssertTrue(rewritten.universal, @"Multiple slices should be written as a universal binary");
+    STAssertEquals([[rewritten executables] count], (NSUInteger) 2, @"Two executables should have been found");
+}
+
+@end
@@ -0,0 +1,162 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/**
+ * A point-in-time sample of the current task's memory usage.
+ */
+typedef struct plsimulator_memory_sample {
+    /** YES if the task's memory usage was sampled. If NO, all other fields are zero and must not be used. */
+    BOOL valid;
+
+    /** Resident set size, in bytes. */
+    uint64_t resident_bytes;
+
+    /** Peak resident set size of the task's lifetime, in bytes. */
+    uint64_t peak_resident_bytes;
+
+    /** Task virtual size (all mapped regions, including the shared cache), in bytes. */
+    uint64_t mapped_bytes;
+
+    /** Bytes currently allocated across all malloc zones. */
+    uint64_t allocated_bytes;
+
+    /** Number of live allocations across all malloc zones. */
+    uint64_t allocation_count;
+} plsimulator_memory_sample_t;
+
+BOOL plsimulator_memory_sample (plsimulator_memory_sample_t *sample);
+
+/**
+ * The memory usage growth attributed to a single profiled phase. Growth values are signed; a phase that
+ * releases more memory than it allocates reports negative growth.
+ */
+@interface PLMemoryPhase : NSObject {
+@private
+    /** Phase name. */
+    NSString *_name;
+
+    /** Sample taken when the phase began. */
+    plsimulator_memory_sample_t _startSample;
+
+    /** Sample taken when the phase ended. */
+    plsimulator_memory_sample_t _endSample;
+
+    /** Resident size growth during periods in which no other phase was active, in bytes. */
+    int64_t _exclusiveResidentGrowth;
+
+    /** YES if another phase was active at any point during this phase. */
+    BOOL _overlapped;
+
+    /** Resident size growth budget, in bytes, or 0 if none. */
+    uint64_t _residentBudget;
+}
+
+/** Phase name. */
+@property(nonatomic, readonly) NSString *name;
+
+/** Sample taken when the phase began. */
+@property(nonatomic, readonly) plsimulator_memory_sample_t startSample;
+
+/** Sample taken when the phase ended. */
+@property(nonatomic, readonly) plsimulator_memory_sample_t endSample;
+
+/** Resident size growth between the start and end of the phase, in bytes. */
+@property(nonatomic, readonly) int64_t residentGrowth;
+
+/** Growth of the task's peak resident size during the phase, in bytes. */
+@property(nonatomic, readonly) int64_t peakResidentGrowth;
+
+/** Mapped size growth between the start and end of the phase, in bytes. */
+@property(nonatomic, readonly) int64_t mappedGrowth;
+
+/** Allocated byte growth between the start and end of the phase. */
+@property(nonatomic, readonly) int64_t allocatedGrowth;
+
+/** Live allocation count growth between the start and end of the phase. */
+@property(nonatomic, readonly) int64_t allocationCountGrowth;
+
+/**
+ * Resident size growth during the periods in which this was the only active phase, in bytes. If the phase
+ * never overlapped another phase, this is equal to residentGrowth.
+ */
+@property(nonatomic, readonly) int64_t exclusiveResidentGrowth;
+
+/** YES if another phase was active at any point during this phase. */
+@property(nonatomic, readonly, getter=isOverlapped) BOOL overlapped;
+
+/** Resident size growth budget, in bytes, or 0 if none. */
+@property(nonatomic, readonly) uint64_t residentBudget;
+
+/** YES if the phase's resident growth exceeded its budget. Always NO if the phase is not valid. */
+@property(nonatomic, readonly, getter=isOverBudget) BOOL overBudget;
+
+/** YES if both the start and end samples are valid. If NO, the phase's growth values are zero and must not be used. */
+@property(nonatomic, readonly, getter=isValid) BOOL valid;
+
+@end
+
+@interface PLMemoryProfiler : NSObject {
+@private
+    /** Profiler name, used in the report. */
+    NSString *_name;
+
+    /** Phase name -> NSNumber resident growth budget, in bytes. */
+    NSMutableDictionary *_budgets;
+
+    /** Completed PLMemoryPhase instances, in order of completion. */
+    NSMutableArray *_completedPhases;
+
+    /** Phase name -> PLMemoryPhase for all active phases. Guards all mutable state. */
+    NSMutableDictionary *_activePhases;
+
+    /** The most recent boundary sample. */
+    plsimulator_memory_sample_t _lastSample;
+
+    /** Sample taken when the profiler was created. */
+    plsimulator_memory_sample_t _initialSample;
+}
+
++ (id) profilerFromEnvironmentWithName: (NSString *) name;
+
+- (id) initWithName: (NSString *) name;
+
+- (void) setResidentBudget: (uint64_t) bytes forPhase: (NSString *) phase;
+
+- (void) beginPhase: (NSString *) phase;
+- (void) endPhase: (NSString *) phase;
+
+- (NSArray *) phases;
+- (NSArray *) phasesOverBudget;
+- (NSString *) report;
+
+/** Profiler name, used in the report. */
+@property(nonatomic, readonly) NSString *name;
+
+@end
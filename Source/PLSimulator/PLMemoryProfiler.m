@@ -0,0 +1,449 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLMemoryProfiler.h"
+
+#import <mach/mach.h>
+#import <malloc/malloc.h>
+#import <sys/resource.h>
+
+/* Environment variable enabling profiling in the launcher and bundler */
+#define PROFILE_ENV "PLSIMULATOR_MEMORY_PROFILE"
+
+/* Environment variable defining per-phase resident growth budgets, as a comma-separated list of <phase>=<megabytes> pairs */
+#define BUDGETS_ENV "PLSIMULATOR_MEMORY_BUDGETS"
+
+/**
+ * Sample the current task's memory usage.
+ *
+ * Resident and mapped sizes are fetched via task_info(); peak resident size via getrusage(); and allocation
+ * totals from the malloc zone statistics of all registered zones. Sampling walks the malloc zones, and
+ * should not be performed on a hot path.
+ *
+ * @param sample The sample to populate. If the task information can not be fetched, the sample is marked as
+ * invalid.
+ * @return Returns YES on success, or NO if the task information could not be fetched.
+ */
+BOOL plsimulator_memory_sample (plsimulator_memory_sample_t *sample) {
+    memset(sample, 0, sizeof(*sample));
+
+    /* TASK_BASIC_INFO truncates its sizes to natural_t in 32-bit processes; MACH_TASK_BASIC_INFO reports 64-bit sizes,
+     * but is only supported by 10.8 and later kernels. Fall back to TASK_BASIC_INFO_64 on earlier releases. */
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    kern_return_t kr = task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count);
+    if (kr == KERN_SUCCESS) {
+        sample->resident_bytes = info.resident_size;
+        sample->mapped_bytes = info.virtual_size;
+    } else if (kr == KERN_INVALID_ARGUMENT) {
+        task_basic_info_64_data_t info64;
+        count = TASK_BASIC_INFO_64_COUNT;
+        if (task_info(mach_task_self(), TASK_BASIC_INFO_64, (task_info_t) &info64, &count) != KERN_SUCCESS)
+            return NO;
+
+        sample->resident_bytes = info64.resident_size;
+        sample->mapped_bytes = info64.virtual_size;
+    } else {
+        return NO;
+    }
+
+    /* ru_maxrss is reported in bytes on Mac OS X */
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        sample->peak_resident_bytes = MAX((uint64_t) usage.ru_maxrss, sample->resident_bytes);
+    else
+        sample->peak_resident_bytes = sample->resident_bytes;
+
+    /* A NULL zone returns the statistics of all zones */
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    sample->allocated_bytes = stats.size_in_use;
+    sample->allocation_count = stats.blocks_in_use;
+
+    sample->valid = YES;
+    return YES;
+}
+
+/* Format @a bytes as a signed megabyte value */
+static NSString *profiler_format_growth (int64_t bytes) {
+    return [NSString stringWithFormat: @"%+.1fMB", (double) bytes / (1024.0 * 1024.0)];
+}
+
+/* Format @a bytes as an unsigned megabyte value */
+static NSString *profiler_format_size (uint64_t bytes) {
+    return [NSString stringWithFormat: @"%.1fMB", (double) bytes / (1024.0 * 1024.0)];
+}
+
+@interface PLMemoryPhase (PrivateMethods)
+- (id) initWithName: (NSString *) name startSample: (plsimulator_memory_sample_t) sample residentBudget: (uint64_t) budget;
+- (void) finishWithSample: (plsimulator_memory_sample_t) sample;
+- (void) addExclusiveResidentGrowth: (int64_t) growth;
+- (void) markOverlapped;
+@end
+
+/**
+ * The memory usage growth attributed to a single profiled phase.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe once returned by PLMemoryProfiler.
+ */
+@implementation PLMemoryPhase
+
+@synthesize name = _name;
+@synthesize startSample = _startSample;
+@synthesize endSample = _endSample;
+@synthesize exclusiveResidentGrowth = _exclusiveResidentGrowth;
+@synthesize overlapped = _overlapped;
+@synthesize residentBudget = _residentBudget;
+
+// property getter
+- (int64_t) residentGrowth {
+    if (!self.valid)
+        return 0;
+
+    return (int64_t) (_endSample.resident_bytes - _startSample.resident_bytes);
+}
+
+// property getter
+- (int64_t) peakResidentGrowth {
+    if (!self.valid)
+        return 0;
+
+    return (int64_t) (_endSample.peak_resident_bytes - _startSample.peak_resident_bytes);
+}
+
+// property getter
+- (int64_t) mappedGrowth {
+    if (!self.valid)
+        return 0;
+
+    return (int64_t) (_endSample.mapped_bytes - _startSample.mapped_bytes);
+}
+
+// property getter
+- (int64_t) allocatedGrowth {
+    if (!self.valid)
+        return 0;
+
+    return (int64_t) (_endSample.allocated_bytes - _startSample.allocated_bytes);
+}
+
+// property getter
+- (int64_t) allocationCountGrowth {
+    if (!self.valid)
+        return 0;
+
+    return (int64_t) (_endSample.allocation_count - _startSample.allocation_count);
+}
+
+// property getter
+- (BOOL) isValid {
+    return _startSample.valid && _endSample.valid;
+}
+
+// property getter
+- (BOOL) isOverBudget {
+    return self.valid && _residentBudget > 0 && self.residentGrowth > (int64_t) _residentBudget;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    if (!self.valid)
+        return [NSString stringWithFormat: @"%@: memory usage could not be sampled", _name];
+
+    NSMutableString *desc = [NSMutableString stringWithFormat: @"%@: resident %@", _name, profiler_format_growth(self.residentGrowth)];
+    if (_overlapped)
+        [desc appendFormat: @" (exclusive %@)", profiler_format_growth(_exclusiveResidentGrowth)];
+
+    [desc appendFormat: @", peak %@, mapped %@, allocated %@ in %+lld allocations",
+        profiler_format_growth(self.peakResidentGrowth), profiler_format_growth(self.mappedGrowth),
+        profiler_format_growth(self.allocatedGrowth), (long long) self.allocationCountGrowth];
+
+    if (self.overBudget)
+        [desc appendFormat: @" [OVER BUDGET of %@]", profiler_format_size(_residentBudget)];
+
+    return desc;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLMemoryPhase (PrivateMethods)
+
+/* Initialize a new active phase */
+- (id) initWithName: (NSString *) name startSample: (plsimulator_memory_sample_t) sample residentBudget: (uint64_t) budget {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _name = name;
+    _startSample = sample;
+    _endSample = sample;
+    _residentBudget = budget;
+
+    return self;
+}
+
+/* Record the phase's end sample */
+- (void) finishWithSample: (plsimulator_memory_sample_t) sample {
+    _endSample = sample;
+}
+
+/* Attribute @a growth to this phase alone */
+- (void) addExclusiveResidentGrowth: (int64_t) growth {
+    _exclusiveResidentGrowth += growth;
+}
+
+/* Note that another phase was active during this phase */
+- (void) markOverlapped {
+    _overlapped = YES;
+}
+
+@end
+
+@interface PLMemoryProfiler (PrivateMethods)
+- (void) attributeSample: (plsimulator_memory_sample_t) sample;
+@end
+
+/**
+ * Samples the task's memory usage at phase boundaries, attributing growth to the phase responsible.
+ *
+ * Each phase records the growth between its start and end. Phases may run concurrently (eg, the launcher's
+ * application and discovery phases), in which case their inclusive growth overlaps; growth sampled while a
+ * phase was the only active phase is additionally reported as that phase's exclusive growth.
+ *
+ * Samples are only taken at phase boundaries, and so transient peaks within a phase are only visible via
+ * the peak resident growth.
+ *
+ * @par Thread Safety
+ * Thread-safe. Phases may be begun and ended from any thread.
+ */
+@implementation PLMemoryProfiler
+
+@synthesize name = _name;
+
+/**
+ * If memory profiling has been enabled via the PLSIMULATOR_MEMORY_PROFILE environment variable, return a new
+ * profiler, with any budgets defined by the PLSIMULATOR_MEMORY_BUDGETS environment variable applied. Budgets are
+ * specified as a comma-separated list of <phase>=<megabytes> pairs, eg, "discovery=16,resolve=64".
+ *
+ * @param name The profiler name, used in the report.
+ * @return Returns a new profiler, or nil if profiling is not enabled.
+ */
++ (id) profilerFromEnvironmentWithName: (NSString *) name {
+    const char *enabled = getenv(PROFILE_ENV);
+    if (enabled == NULL || *enabled == '\0' || strcmp(enabled, "0") == 0)
+        return nil;
+
+    PLMemoryProfiler *profiler = [[self alloc] initWithName: name];
+
+    const char *budgets = getenv(BUDGETS_ENV);
+    if (budgets == NULL)
+        return profiler;
+
+    for (NSString *pair in [[NSString stringWithUTF8String: budgets] componentsSeparatedByString: @","]) {
+        NSArray *components = [pair componentsSeparatedByString: @"="];
+        long long megabytes = ([components count] == 2) ? [[components objectAtIndex: 1] longLongValue] : 0;
+        if (megabytes <= 0) {
+            NSLog(@"Ignoring invalid memory budget '%@'", pair);
+            continue;
+        }
+
+        NSString *phase = [[components objectAtIndex: 0] stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceCharacterSet]];
+        [profiler setResidentBudget: (uint64_t) megabytes * 1024 * 1024 forPhase: phase];
+    }
+
+    return profiler;
+}
+
+/**
+ * Initialize a new profiler.
+ *
+ * @param name The profiler name, used in the report (eg, "launcher").
+ */
+- (id) initWithName: (NSString *) name {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _name = [name copy];
+    _budgets = [NSMutableDictionary dictionary];
+    _completedPhases = [NSMutableArray array];
+    _activePhases = [NSMutableDictionary dictionary];
+
+    if (!plsimulator_memory_sample(&_initialSample))
+        NSLog(@"Memory profiler '%@' could not sample the task's memory usage", _name);
+    _lastSample = _initialSample;
+
+    return self;
+}
+
+/**
+ * Set the resident growth budget of @a phase. Phases begun after the budget is set whose resident growth
+ * exceeds the budget are reported by phasesOverBudget.
+ *
+ * @param bytes The budget, in bytes, or 0 to remove the budget.
+ * @param phase The phase name.
+ */
+- (void) setResidentBudget: (uint64_t) bytes forPhase: (NSString *) phase {
+    @synchronized (_activePhases) {
+        if (bytes == 0)
+            [_budgets removeObjectForKey: phase];
+        else
+            [_budgets setObject: [NSNumber numberWithUnsignedLongLong: bytes] forKey: phase];
+    }
+}
+
+/**
+ * Begin @a phase. If a phase of the same name is already active, the call is ignored.
+ *
+ * @param phase The phase name.
+ */
+- (void) beginPhase: (NSString *) phase {
+    plsimulator_memory_sample_t sample;
+    if (!plsimulator_memory_sample(&sample))
+        NSLog(@"Memory profiler could not sample the start of phase '%@'", phase);
+
+    @synchronized (_activePhases) {
+        if ([_activePhases objectForKey: phase] != nil) {
+            NSLog(@"Memory profiler phase '%@' is already active", phase);
+            return;
+        }
+
+        [self attributeSample: sample];
+
+        uint64_t budget = [[_budgets objectForKey: phase] unsignedLongLongValue];
+        PLMemoryPhase *record = [[PLMemoryPhase alloc] initWithName: phase startSample: sample residentBudget: budget];
+
+        if ([_activePhases count] > 0) {
+            [record markOverlapped];
+            for (PLMemoryPhase *active in [_activePhases allValues])
+                [active markOverlapped];
+        }
+
+        [_activePhases setObject: record forKey: phase];
+    }
+}
+
+/**
+ * End @a phase. If no phase of the given name is active, the call is ignored.
+ *
+ * @param phase The phase name.
+ */
+- (void) endPhase: (NSString *) phase {
+    plsimulator_memory_sample_t sample;
+    if (!plsimulator_memory_sample(&sample))
+        NSLog(@"Memory profiler could not sample the end of phase '%@'", phase);
+
+    @synchronized (_activePhases) {
+        PLMemoryPhase *record = [_activePhases objectForKey: phase];
+        if (record == nil) {
+            NSLog(@"Memory profiler phase '%@' is not active", phase);
+            return;
+        }
+
+        [self attributeSample: sample];
+        [record finishWithSample: sample];
+
+        [_activePhases removeObjectForKey: phase];
+        [_completedPhases addObject: record];
+    }
+}
+
+/**
+ * Return all completed phases, as PLMemoryPhase instances, in order of completion.
+ */
+- (NSArray *) phases {
+    @synchronized (_activePhases) {
+        return [_completedPhases copy];
+    }
+}
+
+/**
+ * Return all completed phases whose resident growth exceeded their budget, in order of completion.
+ */
+- (NSArray *) phasesOverBudget {
+    NSMutableArray *result = [NSMutableArray array];
+    for (PLMemoryPhase *phase in [self phases]) {
+        if (phase.overBudget)
+            [result addObject: phase];
+    }
+
+    return result;
+}
+
+/**
+ * Return a human-readable report of the task's current and peak memory usage, and the growth attributed
+ * to each completed phase.
+ */
+- (NSString *) report {
+    plsimulator_memory_sample_t current;
+    plsimulator_memory_sample(&current);
+
+    NSMutableString *report;
+    if (!current.valid || !_initialSample.valid) {
+        report = [NSMutableString stringWithFormat: @"Memory profile (%@): task memory usage could not be sampled", _name];
+    } else {
+        report = [NSMutableString stringWithFormat: @"Memory profile (%@): resident %@ -> %@, peak %@, mapped %@, allocated %@ in %llu allocations",
+            _name, profiler_format_size(_initialSample.resident_bytes), profiler_format_size(current.resident_bytes),
+            profiler_format_size(current.peak_resident_bytes), profiler_format_size(current.mapped_bytes),
+            profiler_format_size(current.allocated_bytes), (unsigned long long) current.allocation_count];
+    }
+
+    NSArray *phases = [self phases];
+    for (PLMemoryPhase *phase in phases)
+        [report appendFormat: @"\n  %@", phase];
+
+    NSUInteger overBudget = [[self phasesOverBudget] count];
+    if (overBudget > 0)
+        [report appendFormat: @"\n  %lu phase(s) exceeded their memory budget", (unsigned long) overBudget];
+
+    return report;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLMemoryProfiler (PrivateMethods)
+
+/**
+ * Attribute the resident growth since the previous boundary sample to the sole active phase, if any. Growth
+ * is only attributed between two valid samples. Must be called with the profiler lock held.
+ */
+- (void) attributeSample: (plsimulator_memory_sample_t) sample {
+    if ([_activePhases count] == 1 && sample.valid && _lastSample.valid) {
+        PLMemoryPhase *phase = [[_activePhases allValues] lastObject];
+        [phase addExclusiveResidentGrowth: (int64_t) (sample.resident_bytes - _lastSample.resident_bytes)];
+    }
+
+    _lastSample = sample;
+}
+
+@end
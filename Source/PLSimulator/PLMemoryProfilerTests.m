@@ -0,0 +1,93 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLMemoryProfiler.h"
+
+@interface PLMemoryProfilerTests : PLTestCase @end
+
+@implementation PLMemoryProfilerTests
+
+- (void) testSample {
+    plsimulator_memory_sample_t sample;
+    STAssertTrue(plsimulator_memory_sample(&sample), @"Could not sample memory usage");
+    STAssertTrue(sample.valid, @"Sample was not marked as valid");
+    STAssertTrue(sample.resident_bytes > 0, @"Missing resident size");
+    STAssertTrue(sample.peak_resident_bytes >= sample.resident_bytes, @"Peak is less than current resident size");
+    STAssertTrue(sample.mapped_bytes >= sample.resident_bytes, @"Mapped size is less than resident size");
+    STAssertTrue(sample.allocated_bytes > 0 && sample.allocation_count > 0, @"Missing allocation totals");
+}
+
+- (void) testPhaseGrowth {
+    const size_t size = 32 * 1024 * 1024;
+    PLMemoryProfiler *profiler = [[PLMemoryProfiler alloc] initWithName: @"test"];
+    [profiler setResidentBudget: 1024 * 1024 forPhase: @"allocate"];
+
+    [profiler beginPhase: @"allocate"];
+    void *buffer = malloc(size);
+    memset(buffer, 0xAB, size);
+    [profiler endPhase: @"allocate"];
+
+    [profiler beginPhase: @"idle"];
+    [profiler endPhase: @"idle"];
+    free(buffer);
+
+    NSArray *phases = [profiler phases];
+    STAssertEquals([phases count], (NSUInteger) 2, @"Incorrect number of phases");
+
+    PLMemoryPhase *phase = [phases objectAtIndex: 0];
+    STAssertEqualObjects(phase.name, @"allocate", @"Incorrect phase order");
+    STAssertTrue(phase.valid, @"Phase samples were not valid");
+    STAssertTrue(phase.residentGrowth >= (int64_t) size / 2, @"Resident growth was not attributed: %@", phase);
+    STAssertTrue(phase.allocatedGrowth >= (int64_t) size, @"Allocation growth was not attributed: %@", phase);
+    STAssertFalse(phase.overlapped, @"Phase should not be overlapped");
+    STAssertEquals(phase.exclusiveResidentGrowth, phase.residentGrowth, @"Exclusive growth should equal inclusive growth");
+
+    STAssertEqualObjects([[profiler phasesOverBudget] valueForKey: @"name"], [NSArray arrayWithObject: @"allocate"], @"Budget was not enforced");
+    STAssertTrue([[profiler report] rangeOfString: @"OVER BUDGET"].location != NSNotFound, @"Report does not flag the budget");
+}
+
+- (void) testOverlap {
+    PLMemoryProfiler *profiler = [[PLMemoryProfiler alloc] initWithName: @"test"];
+
+    [profiler beginPhase: @"outer"];
+    [profiler beginPhase: @"inner"];
+    [profiler endPhase: @"inner"];
+    [profiler endPhase: @"outer"];
+
+    /* Unbalanced calls are ignored */
+    [profiler endPhase: @"outer"];
+
+    NSArray *phases = [profiler phases];
+    STAssertEquals([phases count], (NSUInteger) 2, @"Incorrect number of phases");
+    for (PLMemoryPhase *phase in phases)
+        STAssertTrue(phase.overlapped, @"Phase %@ should be overlapped", phase.name);
+}
+
+@end
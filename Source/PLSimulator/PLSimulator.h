@@ -89,7 +89,13 @@ typedef enum {
     PLSimulatorErrorInvalidApplication = 4,
     
     /** The provided path is not a valid Mach-O binary */
-    PLSimulatorErrorInvalidBinary = 5
+    PLSimulatorErrorInvalidBinary = 5,
+
+    /** A different version of the simulator private frameworks has already been loaded into the process. */
+    PLSimulatorErrorFrameworkConflict = 6,
+
+    /** The binary's code signature is missing, malformed, or does not match the binary's contents. */
+    PLSimulatorErrorInvalidCodeSignature = 7
 } PLSimulatorError;
 
 
@@ -102,6 +108,7 @@ void plsimulator_populate_nserror (NSError **error, PLSimulatorError code, NSStr
 #import "PLSimulatorDiscovery.h"
 #import "PLSimulatorApplication.h"
 #import "PLSimulatorDeviceFamily.h"
+#import "PLSimulatorStats.h"
 
 /**
  * @mainpage Plausible Simulator Client
@@ -28,6 +28,8 @@
 
 #import <Cocoa/Cocoa.h>
 
+@class PLSimulatorPlatform;
+@class PLSimulatorSDK;
 
 @interface PLSimulatorApplication : NSObject {
 @private
@@ -42,10 +44,27 @@
 
     /** Set of PLSimulatorDeviceFamily types supported by this application. */
     NSSet *_deviceFamilies;
+
+    /** Path to the application's executable, or nil if not declared. */
+    NSString *_executablePath;
+
+    /** Guards the lazy parsing of the executable's deployment requirements. */
+    dispatch_once_t _requirementsOnce;
+
+    /** Minimum OS version declared by the application's executable, or nil if not declared. Populated lazily. */
+    NSString *_minimumOSVersion;
+
+    /** SDK version declared by the application's executable, or nil if not declared. Populated lazily. */
+    NSString *_sdkVersion;
+
+    /** Minimum SDK version required to run this application, or nil if unknown. Populated lazily. */
+    NSString *_minimumSDKVersion;
 }
 
 - (id) initWithPath: (NSString *) path error: (NSError **) outError;
 
+- (PLSimulatorSDK *) preferredSDKFromPlatform: (PLSimulatorPlatform *) platform;
+
 /** The application display name (as shown on the device) */
 @property(readonly) NSString *displayName;
 
@@ -60,4 +79,31 @@
  */
 @property(readonly) NSSet *deviceFamilies;
 
+/**
+ * Return the path to the application's executable, as declared by the Info.plist CFBundleExecutable key, or nil
+ * if the application does not declare an executable.
+ */
+@property(readonly) NSString *executablePath;
+
+/**
+ * Return the minimum OS version declared by the application executable's LC_BUILD_VERSION or
+ * LC_VERSION_MIN_IPHONEOS load command, or nil if the executable could not be read or declares neither.
+ *
+ * If the Info.plist declares the application's SDK, the executable is not parsed until one of its deployment
+ * requirements is first requested.
+ */
+@property(readonly) NSString *minimumOSVersion;
+
+/**
+ * Return the SDK version declared by the application executable's LC_BUILD_VERSION or LC_VERSION_MIN_IPHONEOS
+ * load command, or nil if the executable could not be read or declares neither.
+ */
+@property(readonly) NSString *sdkVersion;
+
+/**
+ * Return the minimum SDK version required to run this application: the executable's minimum OS version if
+ * declared, otherwise the version of the SDK used to build the application. Returns nil if neither is known.
+ */
+@property(readonly) NSString *minimumSDKVersion;
+
 @end
@@ -30,6 +30,10 @@
 
 #import "PLSimulatorApplication.h"
 #import "PLSimulatorUtils.h"
+#import "PLSimulatorStats.h"
+#import "PLSimulatorPlatform.h"
+#import "PLSimulatorPlatformMatcher.h"
+#import "PLUniversalBinary.h"
 
 /* Device Families */
 #define DevicesKey @"UIDeviceFamily"
@@ -37,9 +41,20 @@
 /* Canonical SDK Name */
 #define SDKNameKey @"DTSDKName"
 
+/* Executable name key */
+#define CFBundleExecutable @"CFBundleExecutable"
+
 /* Display name key */
 #define CFBundleDisplayName @"CFBundleDisplayName"
 
+/* Canonical name prefix of simulator SDKs */
+#define SDKNamePrefix @"iphonesimulator"
+
+@interface PLSimulatorApplication (PrivateMethods)
+- (PLSimulatorSDK *) oldestSDKFromPlatform: (PLSimulatorPlatform *) platform minimumVersion: (NSString *) minimumVersion;
+- (void) loadRequirements;
+@end
+
 /**
  * Provides access to a Simulator application's meta-data.
  *
@@ -52,6 +67,16 @@
 @synthesize displayName = _displayName;
 @synthesize canonicalSDKName = _canonicalSDKName;
 @synthesize deviceFamilies = _deviceFamilies;
+@synthesize executablePath = _executablePath;
+
+/* Return the version suffix of a canonical SDK name (eg, 6.1 for iphonesimulator6.1), or nil if none. */
+static NSString *application_sdk_name_version (NSString *canonicalSDKName) {
+    NSRange range = [canonicalSDKName rangeOfCharacterFromSet: [NSCharacterSet decimalDigitCharacterSet]];
+    if (range.location == NSNotFound)
+        return nil;
+
+    return [canonicalSDKName substringFromIndex: range.location];
+}
 
 /**
  * Initialize with the provided application path.
@@ -76,6 +101,7 @@
     NSFileManager *fm = [NSFileManager new];
     {
         BOOL isDir;
+        plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
         if (![fm fileExistsAtPath: _path isDirectory: &isDir] || isDir == NO) {
             NSString *desc = NSLocalizedString(@"The provided application path does exist or is not a directory.",
                                                @"Missing/non-directory application path");
@@ -152,12 +178,27 @@
     }
     _displayName = displayName;
 
+    /* Get the executable path, if any */
+    NSString *executable = nil;
+    if (Get(CFBundleExecutable, &executable, [NSString class], NO))
+        _executablePath = [_path stringByAppendingPathComponent: executable];
+
     NSString *canonicalSDKName = nil;
-    /* Get the canonical name of the SDK that this app was built with. */
-    if (!Get(SDKNameKey, &canonicalSDKName, [NSString class], YES))
-        return nil;
+    /* Get the canonical name of the SDK that this app was built with. If declared, the executable is only parsed
+     * once its deployment requirements are requested; otherwise, the name must be derived from the executable's
+     * SDK version. */
+    if (Get(SDKNameKey, &canonicalSDKName, [NSString class], NO)) {
+        _canonicalSDKName = canonicalSDKName;
+    } else {
+        [self loadRequirements];
+        if (_sdkVersion == nil) {
+            NSString *desc = NSLocalizedString(@"The application's Info.plist is missing required %@ key.", @"Unsupported application plist");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidApplication, [NSString stringWithFormat: desc, SDKNameKey], nil);
+            return nil;
+        }
 
-    _canonicalSDKName = canonicalSDKName;
+        _canonicalSDKName = [SDKNamePrefix stringByAppendingString: _sdkVersion];
+    }
 
     /* Get the list of supported devices */
     {
@@ -174,5 +215,118 @@
     return self;
 }
 
+/**
+ * Return the SDK from @a platform best suited to run this application, or nil if none is compatible.
+ *
+ * The SDK used to build the application is preferred. If it is not available, the oldest SDK at least as new as
+ * the application's sdkVersion is returned, and failing that, the oldest SDK that meets the application's
+ * minimumSDKVersion. In each case, the SDK must support at least one of the application's device families.
+ *
+ * @param platform The platform to search.
+ */
+- (PLSimulatorSDK *) preferredSDKFromPlatform: (PLSimulatorPlatform *) platform {
+    /* Prefer an exact match */
+    for (PLSimulatorSDK *sdk in [platform sdksMatchingCanonicalName: _canonicalSDKName minimumVersion: nil]) {
+        if ([sdk.deviceFamilies intersectsSet: _deviceFamilies])
+            return sdk;
+    }
+
+    /* Otherwise, prefer the oldest SDK at least as new as the one used to build the application, and only then the
+     * oldest SDK that meets the application's minimum version */
+    PLSimulatorSDK *result = nil;
+    NSString *sdkVersion = self.sdkVersion;
+    if (sdkVersion != nil)
+        result = [self oldestSDKFromPlatform: platform minimumVersion: sdkVersion];
+
+    /* Without a known minimum version, no other SDK can be considered compatible */
+    NSString *minimumSDKVersion = self.minimumSDKVersion;
+    if (result == nil && minimumSDKVersion != nil)
+        result = [self oldestSDKFromPlatform: platform minimumVersion: minimumSDKVersion];
+
+    return result;
+}
+
+// property getter
+- (NSString *) minimumOSVersion {
+    [self loadRequirements];
+    return _minimumOSVersion;
+}
+
+// property getter
+- (NSString *) sdkVersion {
+    [self loadRequirements];
+    return _sdkVersion;
+}
+
+// property getter
+- (NSString *) minimumSDKVersion {
+    [self loadRequirements];
+    return _minimumSDKVersion;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLSimulatorApplication (PrivateMethods)
+
+/**
+ * Return the oldest SDK from @a platform that is at least @a minimumVersion and supports at least one of the
+ * application's device families, or nil if none is found.
+ *
+ * @param platform The platform to search.
+ * @param minimumVersion The minimum SDK version.
+ */
+- (PLSimulatorSDK *) oldestSDKFromPlatform: (PLSimulatorPlatform *) platform minimumVersion: (NSString *) minimumVersion {
+    PLSimulatorSDK *result = nil;
+    plsimulator_version_key_t resultKey;
+    for (PLSimulatorSDK *sdk in [platform sdksMatchingCanonicalName: nil minimumVersion: minimumVersion]) {
+        if (![sdk.deviceFamilies intersectsSet: _deviceFamilies])
+            continue;
+
+        plsimulator_version_key_t key;
+        plsimulator_version_key_init(&key, [sdk.version UTF8String]);
+        if (result == nil || plsimulator_version_key_compare(&key, &resultKey) < 0) {
+            result = sdk;
+            resultKey = key;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Parse the deployment requirements declared by the application's executable, and determine the minimum SDK
+ * version, if not already done. The executable is optional; if it can not be parsed, the failure is logged and the
+ * requirements are derived from the Info.plist alone.
+ */
+- (void) loadRequirements {
+    dispatch_once(&_requirementsOnce, ^{
+        if (_executablePath != nil) {
+            NSError *error;
+            PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: _executablePath error: &error];
+            if (binary == nil)
+                NSLog(@"Could not read the deployment requirements of '%@': %@", _executablePath, error);
+
+            for (PLExecutableBinary *exec in binary.executables) {
+                if (exec.minimumOSVersion == nil && exec.sdkVersion == nil)
+                    continue;
+
+                _minimumOSVersion = exec.minimumOSVersion;
+                _sdkVersion = exec.sdkVersion;
+                break;
+            }
+        }
+
+        /* Determine the oldest SDK that may run this application. The canonical SDK name is only consulted if
+         * already known; it is derived from the requirements parsed here otherwise. */
+        _minimumSDKVersion = _minimumOSVersion;
+        if (_minimumSDKVersion == nil)
+            _minimumSDKVersion = _sdkVersion;
+        if (_minimumSDKVersion == nil && _canonicalSDKName != nil)
+            _minimumSDKVersion = application_sdk_name_version(_canonicalSDKName);
+    });
+}
 
 @end
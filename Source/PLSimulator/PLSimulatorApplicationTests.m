@@ -27,12 +27,16 @@
  */
 
 #import "PLTestCase.h"
+#import "PLSyntheticFixtures.h"
 
 #import "PLSimulator.h"
 #import "PLSimulatorApplication.h"
+#import "PLSimulatorDiscovery.h"
 
-@interface PLSimulatorApplicationTests : PLTestCase {
-}
+#import "PLSyntheticApplication.h"
+#import "PLSyntheticMachO.h"
+
+@interface PLSimulatorApplicationTests : PLTestCase
 @end
 
 @implementation PLSimulatorApplicationTests
@@ -46,6 +50,80 @@
     STAssertEqualObjects(@"iPadHelloWorld", app.displayName, @"Incorrect display name");
     STAssertEqualObjects([NSSet setWithObject: [PLSimulatorDeviceFamily ipadFamily]], app.deviceFamilies, @"Incorrect device family setting");
     STAssertEqualObjects(@"iphonesimulator3.2", app.canonicalSDKName, @"Incorrect SDK name");
+    STAssertNotNil(app.minimumSDKVersion, @"Minimum SDK version was not determined");
+}
+
+/* SDK requirements must be derived from the executable, and compatible newer SDKs accepted */
+- (void) testSDKRequirements {
+    NSError *error;
+
+    /* An application that declares its SDK only via LC_VERSION_MIN_IPHONEOS (4.3, built with 6.1) */
+    NSMutableDictionary *info = [[PLSyntheticApplication infoWithName: @"Test" canonicalSDKName: @"" deviceFamilies: [NSArray arrayWithObject: [NSNumber numberWithInt: 1]]] mutableCopy];
+    [info removeObjectForKey: @"DTSDKName"];
+
+    NSData *executable = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOVersionMin loadCommandCount: 4];
+    NSString *appPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"Test.app"];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: appPath info: info executable: executable error: &error], @"Could not write application: %@", error);
+
+    PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: appPath error: &error];
+    STAssertNotNil(app, @"Could not load application: %@", error);
+    STAssertEqualObjects(app.canonicalSDKName, @"iphonesimulator6.1", @"Incorrect SDK name");
+    STAssertEqualObjects(app.sdkVersion, @"6.1", @"Incorrect SDK version");
+    STAssertEqualObjects(app.minimumOSVersion, @"4.3", @"Incorrect minimum OS version");
+    STAssertEqualObjects(app.minimumSDKVersion, @"4.3", @"Incorrect minimum SDK version");
+
+    /* The exact SDK is preferred; otherwise, the oldest compatible SDK */
+    PLSimulatorPlatform *exact = [self platformWithName: @"Exact" sdkVersions: [NSArray arrayWithObjects: @"5.0", @"6.1", nil]];
+    PLSimulatorPlatform *newer = [self platformWithName: @"Newer" sdkVersions: [NSArray arrayWithObjects: @"6.0", @"5.0", nil]];
+    PLSimulatorPlatform *older = [self platformWithName: @"Older" sdkVersions: [NSArray arrayWithObject: @"4.2"]];
+    PLSimulatorPlatform *built = [self platformWithName: @"Built" sdkVersions: [NSArray arrayWithObjects: @"5.0", @"8.0", @"7.0", nil]];
+
+    STAssertEqualObjects([app preferredSDKFromPlatform: exact].version, @"6.1", @"Exact SDK was not preferred");
+    STAssertEqualObjects([app preferredSDKFromPlatform: newer].version, @"5.0", @"Oldest compatible SDK was not selected");
+    STAssertNil([app preferredSDKFromPlatform: older], @"Incompatible SDK was selected");
+    STAssertEqualObjects([app preferredSDKFromPlatform: built].version, @"7.0", @"Oldest SDK newer than the build SDK was not preferred");
+
+    NSArray *platforms = [NSArray arrayWithObjects: older, newer, exact, nil];
+    NSArray *expected = [NSArray arrayWithObjects: exact, newer, nil];
+    STAssertEqualObjects([PLSimulatorDiscovery platformsCompatibleWithApplication: app fromPlatforms: platforms], expected, @"Incorrect platform ordering");
+
+    /* An unset LC_VERSION_MIN_IPHONEOS SDK version defers to DTSDKName */
+    executable = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOVersionMin | PLSyntheticMachOUnsetSDKVersion loadCommandCount: 4];
+    NSMutableDictionary *namedInfo = [info mutableCopy];
+    [namedInfo setObject: @"iphonesimulator5.0" forKey: @"DTSDKName"];
+    appPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"UnsetSDK.app"];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: appPath info: namedInfo executable: executable error: &error], @"Could not write application: %@", error);
+
+    app = [[PLSimulatorApplication alloc] initWithPath: appPath error: &error];
+    STAssertNotNil(app, @"Could not load application: %@", error);
+    STAssertNil(app.sdkVersion, @"An unset SDK version should not be declared");
+    STAssertEqualObjects(app.canonicalSDKName, @"iphonesimulator5.0", @"Incorrect SDK name");
+    STAssertEqualObjects([app preferredSDKFromPlatform: built].version, @"5.0", @"DTSDKName was not preferred");
+
+    /* Without version commands or DTSDKName, the application can not be loaded */
+    executable = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: 0 loadCommandCount: 4];
+    appPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"Undeclared.app"];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: appPath info: info executable: executable error: &error], @"Could not write application: %@", error);
+    STAssertNil([[PLSimulatorApplication alloc] initWithPath: appPath error: &error], @"Application without an SDK should not load");
+}
+
+/* The executable must only be parsed once its deployment requirements are requested */
+- (void) testLazyRequirements {
+    NSError *error;
+    NSDictionary *info = [PLSyntheticApplication infoWithName: @"Test" canonicalSDKName: @"iphonesimulator6.1" deviceFamilies: [NSArray arrayWithObject: [NSNumber numberWithInt: 1]]];
+    NSData *executable = [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: PLSyntheticMachOVersionMin loadCommandCount: 4];
+    NSString *appPath = [[self temporaryDirectory] stringByAppendingPathComponent: @"Test.app"];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: appPath info: info executable: executable error: &error], @"Could not write application: %@", error);
+
+    [PLSimulatorStats reset];
+    PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: appPath error: &error];
+    STAssertNotNil(app, @"Could not load application: %@", error);
+    STAssertEqualObjects(app.canonicalSDKName, @"iphonesimulator6.1", @"Incorrect SDK name");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterBinariesMapped], (uint64_t) 0, @"Executable was parsed eagerly");
+
+    STAssertEqualObjects(app.minimumOSVersion, @"4.3", @"Incorrect minimum OS version");
+    STAssertEqualObjects(app.minimumSDKVersion, @"4.3", @"Incorrect minimum SDK version");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterBinariesMapped], (uint64_t) 1, @"Executable was not parsed exactly once");
 }
 
 @end
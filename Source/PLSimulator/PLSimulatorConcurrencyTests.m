@@ -0,0 +1,152 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulator.h"
+#import "PLSimulatorPlatformMatcher.h"
+#import "PLUniversalBinary.h"
+
+#import "PLSyntheticSDK.h"
+#import "PLSyntheticMachO.h"
+
+/* Number of concurrent iterations run by each stress test */
+#define STRESS_ITERATIONS 256
+
+/**
+ * Exercises the core classes concurrently. These tests are most useful when run with the Thread Sanitizer
+ * enabled.
+ */
+@interface PLSimulatorConcurrencyTests : PLTestCase {
+@private
+    /** Temporary directory */
+    NSString *_root;
+
+    /** Synthetic platform path */
+    NSString *_platformPath;
+
+    /** Synthetic i386/x86_64 universal binary path */
+    NSString *_binaryPath;
+}
+@end
+
+@implementation PLSimulatorConcurrencyTests
+
+- (void) setUp {
+    NSError *error;
+    _root = [self temporaryDirectory];
+
+    _platformPath = [_root stringByAppendingPathComponent: @"iPhoneSimulator.platform"];
+    NSArray *versions = [NSArray arrayWithObjects: @"5.0", @"5.1", @"6.0", @"6.1", nil];
+    STAssertTrue([PLSyntheticSDK writePlatformAtPath: _platformPath sdkVersions: versions error: &error], @"Could not write platform: %@", error);
+
+    NSArray *images = [NSArray arrayWithObjects:
+                       [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86 cpuSubtype: CPU_SUBTYPE_X86_ALL options: 0 loadCommandCount: 4],
+                       [PLSyntheticMachO imageWithCPUType: CPU_TYPE_X86_64 cpuSubtype: CPU_SUBTYPE_X86_64_ALL options: PLSyntheticMachO64Bit loadCommandCount: 4],
+                       nil];
+    _binaryPath = [_root stringByAppendingPathComponent: @"binary"];
+    STAssertTrue([[PLSyntheticMachO universalBinaryWithImages: images] writeToFile: _binaryPath options: NSDataWritingAtomic error: &error], @"Could not write binary: %@", error);
+}
+
+/* Shared platforms, matchers and binaries must be usable from any thread, and SDKs materialized exactly once */
+- (void) testSharedInstances {
+    NSError *error;
+    PLSimulatorPlatform *shared = [[PLSimulatorPlatform alloc] initWithPath: _platformPath xcodePath: nil error: &error];
+    STAssertNotNil(shared, @"Could not load platform: %@", error);
+
+    PLSimulatorPlatformMatcher *matcher = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: @"5.1"
+                                                                                  canonicalSDKName: @"iphonesimulator6.0"
+                                                                                    deviceFamilies: [NSSet setWithObject: [PLSimulatorDeviceFamily ipadFamily]]];
+
+    __block int32_t failures = 0;
+    NSMutableArray *failureMessages = [NSMutableArray array];
+    void (^Fail)(NSString *) = ^(NSString *message) {
+        __atomic_add_fetch(&failures, 1, __ATOMIC_RELAXED);
+        @synchronized (failureMessages) {
+            [failureMessages addObject: message];
+        }
+    };
+
+    [PLSimulatorStats reset];
+    dispatch_apply(STRESS_ITERATIONS, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSError *error;
+
+        /* Alternate between the lazy filter and full materialization of the shared instance */
+        if (i % 2 == 0) {
+            if ([[shared sdksMatchingCanonicalName: @"iphonesimulator6.1" minimumVersion: nil] count] != 1)
+                Fail(@"Incorrect filtered SDKs");
+        } else if ([shared.sdks count] != 4) {
+            Fail(@"Incorrect SDK count");
+        }
+
+        if (![matcher matchesPlatform: shared])
+            Fail(@"Shared platform did not match");
+
+        PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: _platformPath xcodePath: nil error: &error];
+        if (platform == nil || [[matcher rankedPlatformsMatchingPlatforms: [NSArray arrayWithObjects: platform, shared, nil]] count] != 2)
+            Fail([NSString stringWithFormat: @"Could not rank platforms: %@", error]);
+
+        PLUniversalBinary *binary = [PLUniversalBinary binaryWithPath: _binaryPath error: &error];
+        if (binary == nil || [binary.executables count] != 2) {
+            Fail([NSString stringWithFormat: @"Could not parse binary: %@", error]);
+        } else {
+            for (PLExecutableBinary *exec in binary.executables) {
+                if ([exec.dylibPaths count] != 2)
+                    Fail(@"Incorrect dylib count");
+            }
+        }
+
+        plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
+    });
+
+    STAssertEquals(failures, (int32_t) 0, @"Concurrent failures: %@", failureMessages);
+
+    PLSimulatorStats *stats = [PLSimulatorStats snapshot];
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterBinariesParsed], (uint64_t) STRESS_ITERATIONS * 2, @"Lost binary parse counts");
+
+    /* The shared platform's 4 SDKs are parsed once; each new platform parses all 4 SDKs while ranking */
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) (STRESS_ITERATIONS + 1) * 4, @"SDKs were parsed more than once");
+}
+
+/* Concurrent framework loads must be serialized, and must fail cleanly for a platform without frameworks */
+- (void) testConcurrentFrameworkLoads {
+    NSError *error;
+    PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: _platformPath xcodePath: nil error: &error];
+    STAssertNotNil(platform, @"Could not load platform: %@", error);
+
+    __block int32_t loaded = 0;
+    dispatch_apply(16, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSError *error;
+        if ([platform loadPrivateFrameworks: &error])
+            __atomic_add_fetch(&loaded, 1, __ATOMIC_RELAXED);
+    });
+
+    STAssertEquals(loaded, (int32_t) 0, @"Frameworks should not have loaded");
+}
+
+@end
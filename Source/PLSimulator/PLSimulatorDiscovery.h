@@ -29,9 +29,11 @@
 #import <Cocoa/Cocoa.h>
 
 #import "PLSimulatorPlatform.h"
+#import "PLSimulatorPlatformMatcher.h"
 #import "rpm-vercomp.h"
 
 @class PLSimulatorDiscovery;
+@class PLSimulatorApplication;
 
 /**
  * The PLSimulatorDiscoveryDelegate defines the methods used to receive provides simulator discovery
@@ -49,25 +51,75 @@
  */
 - (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindMatchingSimulatorPlatforms: (NSArray *) platforms;
 
+@optional
+
+/**
+ * Called by the PLSimulatorDiscovery instance as each matching platform is found, prior to query completion.
+ * Platforms are delivered in the order they are found, rather than in order of preference.
+ *
+ * @param discovery The sender.
+ * @param platform A PLSimulatorPlatform instance that matched the query.
+ */
+- (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindSimulatorPlatform: (PLSimulatorPlatform *) platform;
+
 @end
 
 @interface PLSimulatorDiscovery : NSObject<NSMetadataQueryDelegate> {
 @private
-    /** Requested minimum version. If nil, no minimum version is requested. */
-    NSString *_version;
-    
-    /** Requested canonical SDK name. If nil, no specific named SDK is requested. */
-    NSString *_canonicalSDKName;
-
-    /** Requested device families as a set of PLSimulatorDeviceFamily instances. */
-    NSSet *_deviceFamilies;
+    /** Compiled query requirements. */
+    PLSimulatorPlatformMatcher *_matcher;
 
     /** Spotlight query used to find the SDK(s) */
     NSMetadataQuery *_query;
 
-    /** Set to YES if the query is running */
+    /** Set to YES if the query is running. Only accessed from the query thread. */
     BOOL _running;
 
+    /** The thread on which the query was started, and on which all query state is accessed, or nil if never started. */
+    NSThread *_queryThread;
+
+    /** If YES, well-known developer directory locations are checked before performing a volume-wide search. */
+    BOOL _probesKnownLocations;
+
+    /** If YES, the query requires a minimum SDK version or canonical SDK name. */
+    BOOL _requiresSDK;
+
+    /** If YES, the query is finished as soon as the first matching platform is found. */
+    BOOL _stopsAtFirstMatch;
+
+    /** Resolved platform paths of all probe and query results that have been processed. Only accessed from the query thread. */
+    NSMutableSet *_seenPaths;
+
+    /** Unresolved paths of all query results that have been submitted for processing. Only accessed from the query thread. */
+    NSMutableSet *_submittedPaths;
+
+    /** Serial queue on which candidate batches are processed, in submission order. */
+    dispatch_queue_t _workQueue;
+
+    /** Incremented each time the query is started; batches submitted by an earlier run are discarded. */
+    NSUInteger _generation;
+
+    /** Number of submitted batches that have not yet been delivered to the query thread. */
+    NSUInteger _pendingBatches;
+
+    /** Set to YES once the Spotlight query has finished gathering results. */
+    BOOL _gatheringFinished;
+
+    /** Set to YES if a volume-wide Spotlight search was started. */
+    BOOL _searchedVolume;
+
+    /** Matching PLSimulatorPlatform instances, in the order they were found. */
+    NSMutableArray *_matches;
+
+    /** Absolute time at which the query was started. */
+    CFAbsoluteTime _startTime;
+
+    /** Time from query start to the first match, or 0 if none. */
+    NSTimeInterval _timeToFirstResult;
+
+    /** Time from query start to completion, or 0 if not complete. */
+    NSTimeInterval _timeToFullResult;
+
     /** Delegate */
     id<PLSimulatorDiscoveryDelegate> __weak _delegate;
 }
@@ -75,6 +127,35 @@
 - (id) initWithMinimumVersion: (NSString *) version canonicalSDKName: (NSString *) sdkName deviceFamilies: (NSSet *) deviceFamilies;
 
 - (void) startQuery;
+- (void) stopQuery;
+
++ (NSArray *) platformsMatchingMinimumVersion: (NSString *) version
+                             canonicalSDKName: (NSString *) sdkName
+                               deviceFamilies: (NSSet *) deviceFamilies
+                                fromPlatforms: (NSArray *) platforms;
+
++ (NSArray *) platformsCompatibleWithApplication: (PLSimulatorApplication *) application fromPlatforms: (NSArray *) platforms;
+
+/**
+ * If YES, the query is finished as soon as the first platform matching all requirements is found, rather than
+ * searching the entire volume. Defaults to NO.
+ */
+@property(nonatomic, assign) BOOL stopsAtFirstAcceptableMatch;
+
+/**
+ * If YES, the developer directory named by DEVELOPER_DIR, the active developer directory selected via xcode-select,
+ * /Applications/Xcode*.app, and /Developer are checked before performing a Spotlight search of the root volume.
+ * If the query requires a minimum SDK version or canonical SDK name and any matching platforms are found in these
+ * locations, no search is performed. Queries without an SDK requirement always search the volume, as any platform
+ * would satisfy them. Defaults to YES.
+ */
+@property(nonatomic, assign) BOOL probesKnownLocations;
+
+/** Time from query start to the first matching platform, in seconds, or 0 if none has been found. */
+@property(nonatomic, readonly) NSTimeInterval timeToFirstResult;
+
+/** Time from query start to completion, in seconds, or 0 if the query has not completed. */
+@property(nonatomic, readonly) NSTimeInterval timeToFullResult;
 
 /** Search delegate. */
 @property(weak) id<PLSimulatorDiscoveryDelegate> delegate;
@@ -27,6 +27,8 @@
  */
 
 #import "PLSimulatorDiscovery.h"
+#import "PLSimulatorStats.h"
+#import "PLSimulatorApplication.h"
 
 /* The Xcode.app bundle identifier */
 #define XCODE_BUNDLE_ID @"com.apple.dt.Xcode"
@@ -34,19 +36,144 @@
 /* The path to the iPhoneSimulator platform bundle within the Xcode.app bundle */
 #define XCODE_BUNDLE_PLATFORM_PATH @"Contents/Developer/Platforms/iPhoneSimulator.platform"
 
+/* The path to the developer directory within the Xcode.app bundle */
+#define XCODE_BUNDLE_DEVELOPER_PATH @"Contents/Developer"
+
+/* The path to the iPhoneSimulator platform bundle within a developer directory */
+#define DEVELOPER_PLATFORM_PATH @"Platforms/iPhoneSimulator.platform"
+
+/* Environment variable naming the developer directory, as used by xcrun and xcode-select */
+#define DEVELOPER_DIR_ENV @"DEVELOPER_DIR"
+
+/* Symlink to the active developer directory, as set by xcode-select */
+#define XCODE_SELECT_LINK @"/var/db/xcode_select_link"
+
+/* File containing the path of the active developer directory, as set by earlier releases of xcode-select */
+#define XCODE_SELECT_DIR_PATH_FILE @"/usr/share/xcode-select/xcode_dir_path"
+
+/**
+ * @internal
+ *
+ * A probe or query result, loaded and matched against the query requirements on a worker thread.
+ *
+ * @par Thread Safety
+ * Mutable. A candidate is evaluated by a single worker, and is only read once its batch has been delivered to
+ * the query thread.
+ */
+@interface PLSimulatorDiscoveryCandidate : NSObject {
+@private
+    /** The unresolved platform path. */
+    NSString *_path;
+
+    /** The path of the enclosing Xcode.app bundle, or nil. */
+    NSString *_xcodePath;
+
+    /** The resolved platform path, or nil if the platform does not exist. */
+    NSString *_platformPath;
+
+    /** The loaded platform, or nil if it could not be loaded. */
+    PLSimulatorPlatform *_platform;
+
+    /** If the platform could not be loaded, the error that occured. */
+    NSError *_error;
+
+    /** YES if the platform satisfies the query requirements. */
+    BOOL _matches;
+
+    /** YES if the candidate was not evaluated, as an earlier candidate in its batch was an acceptable match. */
+    BOOL _skipped;
+}
+
+- (id) initWithPath: (NSString *) path xcodePath: (NSString *) xcodePath;
+
+- (void) evaluateWithMatcher: (PLSimulatorPlatformMatcher *) matcher;
+
+@property(nonatomic, readonly) NSString *platformPath;
+@property(nonatomic, readonly) PLSimulatorPlatform *platform;
+@property(nonatomic, readonly) NSError *error;
+@property(nonatomic, readonly) BOOL matches;
+@property(nonatomic, assign) BOOL skipped;
+
+@end
+
+@implementation PLSimulatorDiscoveryCandidate
+
+@synthesize platformPath = _platformPath;
+@synthesize platform = _platform;
+@synthesize error = _error;
+@synthesize matches = _matches;
+@synthesize skipped = _skipped;
+
+/**
+ * Initialize a new candidate.
+ *
+ * @param path The path to the iPhoneSimulator.platform directory. Symlinks will be resolved on evaluation.
+ * @param xcodePath The path to the enclosing Xcode.app bundle, or nil.
+ */
+- (id) initWithPath: (NSString *) path xcodePath: (NSString *) xcodePath {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _path = path;
+    _xcodePath = xcodePath;
+
+    return self;
+}
+
+/**
+ * Resolve the platform path, load the platform SDK meta-data, and check it against @a matcher.
+ */
+- (void) evaluateWithMatcher: (PLSimulatorPlatformMatcher *) matcher {
+    NSString *path = [_path stringByResolvingSymlinksInPath];
+
+    plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
+    if (![[NSFileManager defaultManager] fileExistsAtPath: path])
+        return;
+    _platformPath = path;
+
+    NSError *error;
+    _platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: [_xcodePath stringByResolvingSymlinksInPath] error: &error];
+    if (_platform == nil) {
+        _error = error;
+        return;
+    }
+
+    _matches = [matcher matchesPlatform: _platform];
+}
+
+@end
+
 @interface PLSimulatorDiscovery (PrivateMethods)
+- (void) queryGatheringProgress: (NSNotification *) notification;
 - (void) queryFinished: (NSNotification *) notification;
+- (void) runProbes;
+- (void) processResults;
+- (void) submitBatch: (NSArray *(^)(void)) candidatesBlock probe: (BOOL) probe;
+- (void) batchFinished: (NSArray *) candidates generation: (NSUInteger) generation probe: (BOOL) probe;
+- (void) considerPlatform: (PLSimulatorPlatform *) platform matches: (BOOL) matches;
+- (void) finish;
 @end
 
 /**
  * Implements automatic discovery of local Simulator Platform SDKs.
  *
+ * Probe and query results are loaded and matched concurrently on a worker pool, in batches; batches are
+ * delivered back to the query thread in the order they were submitted, where duplicates are discarded and the
+ * delegate is informed.
+ *
  * @par Thread Safety
- * Mutable and may not be shared across threads.
+ * Mutable. A query is bound to the thread on which it was started, which must run its run loop; the query state
+ * is only accessed from that thread, and all delegate messages are delivered on it. The query may be stopped from
+ * any thread, in which case the stop is performed asynchronously on the query thread. All other methods must be
+ * called from the query thread.
  */
 @implementation PLSimulatorDiscovery
 
 @synthesize delegate = _delegate;
+@synthesize stopsAtFirstAcceptableMatch = _stopsAtFirstMatch;
+@synthesize probesKnownLocations = _probesKnownLocations;
+@synthesize timeToFirstResult = _timeToFirstResult;
+@synthesize timeToFullResult = _timeToFullResult;
 
 /**
  * Initialize a new query with the requested minumum simulator SDK version.
@@ -56,7 +183,7 @@
  * @param sdkName Specify a canonical name for an SDK that must be included with the platform SDK (iphonesimulator3.1, etc).
  * If nil, no verification of the canonical name will be done on SDKs contained in the platform SDK. 
  * @param deviceFamilies The set of requested PLSimulatorDeviceFamily types. Platform SDKs that match any of these device
- * families will be returned.
+ * families will be returned. If nil, no matching will be done on the device family.
  */
 - (id) initWithMinimumVersion: (NSString *) version 
              canonicalSDKName: (NSString *) canonicalSDKName
@@ -65,10 +192,10 @@
     if ((self = [super init]) == nil)
         return nil;
 
-    _version = [version copy];
-    _canonicalSDKName = canonicalSDKName;
-    _deviceFamilies = deviceFamilies;
+    _matcher = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: version canonicalSDKName: canonicalSDKName deviceFamilies: deviceFamilies];
+    _requiresSDK = (version != nil || canonicalSDKName != nil);
     _query = [NSMetadataQuery new];
+    _workQueue = dispatch_queue_create("coop.plausible.simulator.discovery", DISPATCH_QUEUE_SERIAL);
 
     /* Predicate for all iPhoneSimulator platform directories. We use kMDItemDisplayName rather than
      * the more correct kMDItemFSName for performance reasons -- */
@@ -102,19 +229,134 @@
                name: NSMetadataQueryDidFinishGatheringNotification 
              object: _query];
 
+    [nf addObserver: self
+           selector: @selector(queryGatheringProgress:)
+               name: NSMetadataQueryGatheringProgressNotification
+             object: _query];
+
     [_query setDelegate: self];
 
+    _probesKnownLocations = YES;
+
     return self;
 }
 
+- (void) dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver: self];
+    [_query stopQuery];
+    dispatch_release(_workQueue);
+}
+
 /**
  * Start the query. A query can't be started if one is already running.
  */
 - (void) startQuery {
+    assert(_queryThread == nil || _queryThread == [NSThread currentThread]);
     assert(_running == NO);
     _running = YES;
+    _queryThread = [NSThread currentThread];
+
+    _generation++;
+    _pendingBatches = 0;
+    _gatheringFinished = NO;
+    _searchedVolume = NO;
+
+    _seenPaths = [NSMutableSet set];
+    _submittedPaths = [NSMutableSet set];
+    _matches = [NSMutableArray array];
+    _timeToFirstResult = 0;
+    _timeToFullResult = 0;
+    _startTime = CFAbsoluteTimeGetCurrent();
+
+    /* Check the well-known locations before falling back on a volume-wide search. The probe results are
+     * delivered via the run loop, so that the delegate is never called from within this method. */
+    if (_probesKnownLocations) {
+        [self runProbes];
+    } else {
+        _searchedVolume = YES;
+        [_query startQuery];
+    }
+}
+
+/**
+ * Stop a running query, informing the delegate of the matching platforms found so far. Results that are
+ * still being processed are discarded. If the query is not running, this method does nothing.
+ *
+ * If called from a thread other than the query thread, the query is stopped asynchronously on the
+ * query thread.
+ */
+- (void) stopQuery {
+    NSThread *queryThread = _queryThread;
+    if (queryThread == nil)
+        return;
+
+    if (queryThread != [NSThread currentThread]) {
+        [self performSelector: @selector(stopQuery) onThread: queryThread withObject: nil waitUntilDone: NO];
+        return;
+    }
+
+    [self finish];
+}
+
+/**
+ * Filter @a platforms to those that match the given requirements, ordered according to preference, as
+ * reported by PLSimulatorDiscoveryDelegate::simulatorDiscovery:didFindMatchingSimulatorPlatforms:.
+ *
+ * This may be used to apply an application's requirements to the results of an unfiltered query,
+ * once those requirements are known.
+ *
+ * @param version The required minumum simulator SDK version, or nil.
+ * @param sdkName A canonical name for an SDK that must be included with the platform SDK, or nil.
+ * @param deviceFamilies The set of requested PLSimulatorDeviceFamily types, or nil to accept any device family.
+ * @param platforms The PLSimulatorPlatform instances to be filtered.
+ */
++ (NSArray *) platformsMatchingMinimumVersion: (NSString *) version
+                             canonicalSDKName: (NSString *) canonicalSDKName
+                               deviceFamilies: (NSSet *) deviceFamilies
+                                fromPlatforms: (NSArray *) platforms
+{
+    PLSimulatorPlatformMatcher *matcher = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: version
+                                                                                  canonicalSDKName: canonicalSDKName
+                                                                                    deviceFamilies: deviceFamilies];
+    return [matcher rankedPlatformsMatchingPlatforms: platforms];
+}
+
+/**
+ * Filter @a platforms to those that can run @a application, ordered according to preference.
+ *
+ * Platforms that include the SDK used to build the application are returned first, ordered as per
+ * platformsMatchingMinimumVersion:canonicalSDKName:deviceFamilies:fromPlatforms:. These are followed by platforms
+ * that only include newer SDKs that meet the application's PLSimulatorApplication::minimumSDKVersion.
+ *
+ * @param application The application to be run.
+ * @param platforms The PLSimulatorPlatform instances to be filtered.
+ */
++ (NSArray *) platformsCompatibleWithApplication: (PLSimulatorApplication *) application fromPlatforms: (NSArray *) platforms {
+    NSArray *exact = [self platformsMatchingMinimumVersion: nil
+                                          canonicalSDKName: application.canonicalSDKName
+                                            deviceFamilies: application.deviceFamilies
+                                             fromPlatforms: platforms];
+    if (application.minimumSDKVersion == nil)
+        return exact;
+
+    NSArray *compatible = [self platformsMatchingMinimumVersion: application.minimumSDKVersion
+                                               canonicalSDKName: nil
+                                                 deviceFamilies: application.deviceFamilies
+                                                  fromPlatforms: platforms];
+
+    NSMutableArray *result = [exact mutableCopy];
+    for (PLSimulatorPlatform *platform in compatible) {
+        if ([exact containsObject: platform])
+            continue;
+
+        /* The version and device family requirements must be met by a single SDK */
+        if ([application preferredSDKFromPlatform: platform] == nil)
+            continue;
+
+        [result addObject: platform];
+    }
 
-    [_query startQuery];
+    return result;
 }
 
 @end
@@ -125,124 +367,306 @@
 @implementation PLSimulatorDiscovery (PrivateMethods)
 
 /**
- * Comparison function. Compared two platforms by the latest version of their sub-SDKs.
- * Used to determine which platform is likely the most stable, as most users will only
- * have two SDKs installed -- the current, and a beta SDK.
+ * Return the developer directories to be probed prior to a volume-wide search, in order of preference:
+ * DEVELOPER_DIR, the xcode-select active developer directory, /Applications/Xcode*.app, and /Developer.
+ * Directories that do not exist are omitted.
  */
-static NSInteger platform_compare_by_version (id obj1, id obj2, void *context) {
-    PLSimulatorPlatform *platform1 = obj1;
-    PLSimulatorPlatform *platform2 = obj2;
-    
-    /* Fetch the highest SDK version for each platform */
-    NSString *(^Version)(PLSimulatorPlatform *) = ^(PLSimulatorPlatform *p) {
-        NSString *last = nil;
-        for (PLSimulatorSDK *sdk in p.sdks) {
-            if (last == nil || rpm_vercomp([sdk.version UTF8String], [last UTF8String]) > 0)
-                last = sdk.version;
-        }
+static NSArray *discovery_probe_developer_dirs (void) {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSMutableArray *candidates = [NSMutableArray array];
+
+    /* Explicitly configured developer directory. Like xcrun, accept the path to Xcode.app itself. */
+    NSString *developerDir = [[[NSProcessInfo processInfo] environment] objectForKey: DEVELOPER_DIR_ENV];
+    if ([developerDir length] > 0) {
+        if ([[developerDir pathExtension] isEqualToString: @"app"])
+            developerDir = [developerDir stringByAppendingPathComponent: XCODE_BUNDLE_DEVELOPER_PATH];
+        [candidates addObject: developerDir];
+    }
 
-        return last;
-    };
-    
-    NSString *ver1 = Version(platform1);
-    NSString *ver2 = Version(platform2);
+    /* Active developer directory */
+    NSString *selected = [fm destinationOfSymbolicLinkAtPath: XCODE_SELECT_LINK error: NULL];
+    if (selected != nil)
+        [candidates addObject: selected];
+
+    selected = [NSString stringWithContentsOfFile: XCODE_SELECT_DIR_PATH_FILE encoding: NSUTF8StringEncoding error: NULL];
+    selected = [selected stringByTrimmingCharactersInSet: [NSCharacterSet whitespaceAndNewlineCharacterSet]];
+    if ([selected length] > 0)
+        [candidates addObject: selected];
+
+    /* Xcode releases installed in /Applications */
+    NSArray *applications = [[fm contentsOfDirectoryAtPath: @"/Applications" error: NULL] sortedArrayUsingSelector: @selector(compare:)];
+    for (NSString *name in applications) {
+        if ([name hasPrefix: @"Xcode"] && [[name pathExtension] isEqualToString: @"app"])
+            [candidates addObject: [[@"/Applications" stringByAppendingPathComponent: name] stringByAppendingPathComponent: XCODE_BUNDLE_DEVELOPER_PATH]];
+    }
 
-    /* Neither should be nil as we shouldn't be called on Platform SDKs that do not
-     * contain sub-SDKs, but if that occurs, provide a reasonable answer */
-    if (ver1 == nil && ver2 == nil)
-        return NSOrderedSame;
-    else if (ver1 == nil)
-        return NSOrderedAscending;
-    else if (ver2 == nil)
-        return NSOrderedDescending;
+    /* Pre-4.3 Xcode installations */
+    [candidates addObject: @"/Developer"];
 
-    int res = rpm_vercomp([ver1 UTF8String], [ver2 UTF8String]);
+    /* Resolve and de-duplicate */
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity: [candidates count]];
+    for (NSString *candidate in candidates) {
+        NSString *path = [candidate stringByResolvingSymlinksInPath];
+        if ([result containsObject: path])
+            continue;
 
-    if (res > 0)
-        return NSOrderedDescending;
-    if (res < 0)
-        return NSOrderedAscending;
-    else
-        return NSOrderedSame;
+        plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
+        if ([fm fileExistsAtPath: path])
+            [result addObject: path];
+    }
+
+    return result;
 }
 
-// NSMetadataQueryDidFinishGatheringNotification
-- (void) queryFinished: (NSNotification *) note {
-    /* Received the full spotlight query result set. No longer running */
-    _running = NO;
-    
+/**
+ * Check the well-known developer directory locations for matching platforms. If any are found and the query has
+ * an SDK requirement, the query finishes without a volume-wide search; otherwise, the Spotlight query is started.
+ */
+- (void) runProbes {
+    assert(_queryThread == [NSThread currentThread]);
+
+    /* The developer directories are resolved on the work queue, along with the platforms themselves */
+    [self submitBatch: ^{
+        NSMutableArray *candidates = [NSMutableArray array];
+        for (NSString *developerDir in discovery_probe_developer_dirs()) {
+            /* Determine the enclosing Xcode.app bundle, if any */
+            NSString *xcodePath = nil;
+            if ([developerDir hasSuffix: @".app/" XCODE_BUNDLE_DEVELOPER_PATH])
+                xcodePath = [[developerDir stringByDeletingLastPathComponent] stringByDeletingLastPathComponent];
+
+            NSString *path = [developerDir stringByAppendingPathComponent: DEVELOPER_PLATFORM_PATH];
+            [candidates addObject: [[PLSimulatorDiscoveryCandidate alloc] initWithPath: path xcodePath: xcodePath]];
+        }
+        return (NSArray *) candidates;
+    } probe: YES];
+}
 
-    /* Convert the items into PLSimulatorPlatform instances, filtering out results that don't match the minimum version
-     * and supported device families. */
-    NSArray *results = [_query results];
-    NSMutableArray *platformSDKs = [NSMutableArray arrayWithCapacity: [results count]];
+/**
+ * Submit all query results that have not yet been submitted for processing. The results are validated and
+ * delivered to the query thread asynchronously; see batchFinished:generation:probe:.
+ */
+- (void) processResults {
+    assert(_queryThread == [NSThread currentThread]);
+    if (!_running)
+        return;
+
+    /* Prevent the result set from changing while we iterate it */
+    [_query disableUpdates];
+
+    NSMutableArray *candidates = [NSMutableArray array];
+    NSUInteger count = [_query resultCount];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSMetadataItem *item = [_query resultAtIndex: i];
+
+        /* Skip results that have already been submitted. Symlinks are resolved by the workers; results that only
+         * differ once resolved are discarded on delivery. */
+        NSString *path = [item valueForAttribute: (NSString *) kMDItemPath];
+        if (path == nil)
+            continue;
 
-    for (NSMetadataItem *item in results) {
-        PLSimulatorPlatform *platform;
-        NSString *path;
-        NSError *error;
+        if ([_submittedPaths containsObject: path]) {
+            plsimulator_stats_add(PLSimulatorCounterDiscoveryDuplicates, 1);
+            continue;
+        }
+        [_submittedPaths addObject: path];
 
-        path = [[item valueForAttribute: (NSString *) kMDItemPath] stringByResolvingSymlinksInPath];
-        
         /* Extract the simulator path from within the Xcode.app bundle, if appropriate */
         NSString *xcodePath = nil;
         if ([[item valueForAttribute: (NSString *) kMDItemCFBundleIdentifier] isEqual: XCODE_BUNDLE_ID]) {
-            /* Save the Xcode path */
             xcodePath = path;
-            
-            /* Derive the .platform path */
             path = [path stringByAppendingPathComponent: XCODE_BUNDLE_PLATFORM_PATH];
         }
-        
-        platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: xcodePath error: &error];
-        if (platform == nil) {
-            NSLog(@"Skipping platform discovery result '%@', failed to load platform SDK meta-data: %@", path, error);
-            continue;
-        }
 
-        /* Check the minimum version and device families */
-        BOOL hasMinVersion = NO;
-        BOOL hasDeviceFamily = NO;
-        BOOL hasExpectedSDK = NO;
+        [candidates addObject: [[PLSimulatorDiscoveryCandidate alloc] initWithPath: path xcodePath: xcodePath]];
+    }
 
-        /* Skip filters that are not required */
-        if (_version == nil)
-            hasMinVersion = YES;
-    
-        if (_canonicalSDKName == nil)
-            hasExpectedSDK = YES;
-
-        for (PLSimulatorSDK *sdk in platform.sdks) {
-            /* If greater than or equal to the minimum version, this platform SDK meets the requirements */
-            if (_version != nil && rpm_vercomp([sdk.version UTF8String], [_version UTF8String]) >= 0)
-                hasMinVersion = YES;
-            
-            /* Also check for the canonical SDK name */
-            if (_canonicalSDKName != nil && [_canonicalSDKName isEqualToString: sdk.canonicalName])
-                hasExpectedSDK = YES;
-
-            /* If any our requested families are included, this platform SDK meets the requirements. */
-            for (NSString *family in _deviceFamilies) {
-                if ([sdk.deviceFamilies containsObject: family]) {
-                    hasDeviceFamily = YES;
-                    continue;
+    [_query enableUpdates];
+
+    if ([candidates count] > 0)
+        [self submitBatch: ^{ return (NSArray *) candidates; } probe: NO];
+}
+
+// Trampoline used to deliver batches to the query thread.
+- (void) performBlock: (dispatch_block_t) block {
+    block();
+}
+
+/**
+ * Evaluate the candidates returned by @a candidatesBlock concurrently, and deliver them to the query thread via
+ * batchFinished:generation:probe:. Batches are evaluated one at a time, and so are delivered in the order
+ * they were submitted.
+ *
+ * @param candidatesBlock Block returning the PLSimulatorDiscoveryCandidate instances to be evaluated. Called on the work queue.
+ * @param probe YES if the candidates are the results of the well-known location probes.
+ */
+- (void) submitBatch: (NSArray *(^)(void)) candidatesBlock probe: (BOOL) probe {
+    assert(_queryThread == [NSThread currentThread]);
+
+    NSUInteger generation = _generation;
+    NSThread *queryThread = _queryThread;
+    PLSimulatorPlatformMatcher *matcher = _matcher;
+    BOOL stopsAtFirstMatch = _stopsAtFirstMatch;
+    _pendingBatches++;
+
+    dispatch_async(_workQueue, ^{
+        @autoreleasepool {
+            NSArray *candidates = candidatesBlock();
+
+            /* Index of the first acceptable match. If stopping at the first match, later candidates are never
+             * considered, and need not be evaluated. */
+            __block volatile int64_t firstMatch = INT64_MAX;
+
+            dispatch_apply([candidates count], dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+                @autoreleasepool {
+                    PLSimulatorDiscoveryCandidate *candidate = [candidates objectAtIndex: i];
+                    if (stopsAtFirstMatch && (int64_t) i > __atomic_load_n(&firstMatch, __ATOMIC_SEQ_CST)) {
+                        candidate.skipped = YES;
+                        return;
+                    }
+
+                    [candidate evaluateWithMatcher: matcher];
+                    if (!stopsAtFirstMatch || !candidate.matches)
+                        return;
+
+                    int64_t current = __atomic_load_n(&firstMatch, __ATOMIC_SEQ_CST);
+                    do {
+                        if ((int64_t) i >= current)
+                            break;
+                    } while (!__atomic_compare_exchange_n(&firstMatch, &current, (int64_t) i, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
                 }
-            }
+            });
+
+            dispatch_block_t deliver = ^{
+                [self batchFinished: candidates generation: generation probe: probe];
+            };
+            [self performSelector: @selector(performBlock:) onThread: queryThread withObject: [deliver copy] waitUntilDone: NO];
         }
+    });
+}
 
-        if (!hasMinVersion || !hasDeviceFamily || !hasExpectedSDK) {
-            NSLog(@"Skipping platform discovery result '%@', does not match requirements (mv=%hhu, df=%hhu, es=%hhu)", path, hasMinVersion, hasDeviceFamily, hasExpectedSDK);
+/**
+ * Consider the evaluated @a candidates in order, informing the delegate of each match. Batches submitted by an
+ * earlier run of the query, or delivered after the query was stopped, are discarded.
+ */
+- (void) batchFinished: (NSArray *) candidates generation: (NSUInteger) generation probe: (BOOL) probe {
+    assert(_queryThread == [NSThread currentThread]);
+    if (generation != _generation || !_running)
+        return;
+
+    _pendingBatches--;
+
+    for (PLSimulatorDiscoveryCandidate *candidate in candidates) {
+        /* Skipped candidates follow an acceptable match, which finishes the query before they are reached */
+        if (candidate.skipped)
+            continue;
+
+        /* Platforms that do not exist are not candidates */
+        NSString *path = candidate.platformPath;
+        if (path == nil)
+            continue;
+
+        if ([_seenPaths containsObject: path]) {
+            plsimulator_stats_add(PLSimulatorCounterDiscoveryDuplicates, 1);
             continue;
         }
+        [_seenPaths addObject: path];
+        plsimulator_stats_add(PLSimulatorCounterDiscoveryCandidates, 1);
 
-        [platformSDKs addObject: platform];
+        if (candidate.platform == nil) {
+            NSLog(@"Skipping platform discovery result '%@', failed to load platform SDK meta-data: %@", path, candidate.error);
+            plsimulator_stats_add(PLSimulatorCounterDiscoveryRejectedInvalid, 1);
+            continue;
+        }
+
+        [self considerPlatform: candidate.platform matches: candidate.matches];
+        if (!_running)
+            return;
+    }
+
+    if (probe) {
+        /* Fall back on a volume-wide search. Without an SDK requirement every platform matches, and the probed
+         * platforms need not include the SDK the caller will ultimately require. */
+        if ([_matches count] > 0 && _requiresSDK) {
+            [self finish];
+        } else {
+            _searchedVolume = YES;
+            [_query startQuery];
+        }
+    } else if (_gatheringFinished && _pendingBatches == 0) {
+        [self finish];
+    }
+}
+
+/**
+ * Consider @a platform, as checked against the query requirements. If it matches, the delegate is informed, and if stopping at the
+ * first acceptable match, the query is finished.
+ */
+- (void) considerPlatform: (PLSimulatorPlatform *) platform matches: (BOOL) matches {
+    if (!matches) {
+        NSLog(@"Skipping platform discovery result '%@', does not match requirements", platform.path);
+        plsimulator_stats_add(PLSimulatorCounterDiscoveryRejectedRequirements, 1);
+        return;
+    }
+
+    plsimulator_stats_add(PLSimulatorCounterDiscoveryMatches, 1);
+
+    if ([_matches count] == 0)
+        _timeToFirstResult = CFAbsoluteTimeGetCurrent() - _startTime;
+    [_matches addObject: platform];
+
+    if ([_delegate respondsToSelector: @selector(simulatorDiscovery:didFindSimulatorPlatform:)])
+        [_delegate simulatorDiscovery: self didFindSimulatorPlatform: platform];
+
+    /* The delegate may have stopped the query */
+    if (_running && _stopsAtFirstMatch)
+        [self finish];
+}
+
+/**
+ * Stop the query, and inform the delegate of all matching platforms, in order of preference.
+ */
+- (void) finish {
+    assert(_queryThread == [NSThread currentThread]);
+    if (!_running)
+        return;
+
+    _running = NO;
+    [_query stopQuery];
+    _timeToFullResult = CFAbsoluteTimeGetCurrent() - _startTime;
+
+    NSLog(@"Simulator discovery found %lu platform(s); first result after %.1fms, complete after %.1fms",
+          (unsigned long) [_matches count], _timeToFirstResult * 1000.0, _timeToFullResult * 1000.0);
+
+    /* Spotlight results are delivered in no particular order; order them by path, so that platforms with equal
+     * versions are ranked deterministically. Probe results retain their order of preference. */
+    NSArray *candidates = _matches;
+    if (_searchedVolume) {
+        candidates = [_matches sortedArrayUsingComparator: ^(PLSimulatorPlatform *platform1, PLSimulatorPlatform *platform2) {
+            return [platform1.path compare: platform2.path];
+        }];
     }
 
     /* Sort by version, try to choose the most stable SDK of the available set. */
-    NSArray *sorted = [platformSDKs sortedArrayUsingFunction: platform_compare_by_version context: nil];
-    
+    NSArray *sorted = [_matcher rankedPlatformsMatchingPlatforms: candidates];
+
     /* Inform the delegate */
     [_delegate simulatorDiscovery: self didFindMatchingSimulatorPlatforms: sorted];
 }
 
+// NSMetadataQueryGatheringProgressNotification
+- (void) queryGatheringProgress: (NSNotification *) note {
+    /* Validate the new results as they arrive, rather than waiting for the full result set */
+    [self processResults];
+}
+
+// NSMetadataQueryDidFinishGatheringNotification
+- (void) queryFinished: (NSNotification *) note {
+    /* Received the full spotlight query result set; finish once all submitted results have been delivered */
+    [self processResults];
+    _gatheringFinished = YES;
+
+    if (_running && _pendingBatches == 0)
+        [self finish];
+}
+
 @end
\ No newline at end of file
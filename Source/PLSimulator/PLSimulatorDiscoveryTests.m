@@ -31,9 +31,20 @@
 #import "PLSimulator.h"
 #import "PLSimulatorDiscovery.h"
 
+#import "PLSyntheticSDK.h"
+
 @interface PLSimulatorDiscoveryTests : PLTestCase <PLSimulatorDiscoveryDelegate> {
 @private
     NSArray *_foundSDKs;
+
+    /** Platforms delivered incrementally */
+    NSMutableArray *_streamedSDKs;
+
+    /** The thread on which the final results were delivered */
+    NSThread *_resultThread;
+
+    /** The thread on which the last incremental result was delivered */
+    NSThread *_streamedThread;
 }
 @end
 
@@ -52,9 +63,100 @@
     STAssertNotNil(_foundSDKs, @"Timed out waiting for query results");
 }
 
+- (void) testStreaming {
+    _foundSDKs = nil;
+    _streamedSDKs = [NSMutableArray array];
+
+    NSSet *families = [NSSet setWithObject: [PLSimulatorDeviceFamily iphoneFamily]];
+    PLSimulatorDiscovery *query = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: @"3.0"
+                                                                      canonicalSDKName: nil
+                                                                        deviceFamilies: families];
+    query.delegate = self;
+    query.stopsAtFirstAcceptableMatch = YES;
+    [query startQuery];
+
+    [self spinRunloopWithTimeout: 60.0 predicate: ^{ return (BOOL) (_foundSDKs != nil); }];
+    STAssertNotNil(_foundSDKs, @"Timed out waiting for query results");
+
+    /* Every reported platform must have been streamed first, and the query must stop at the first match */
+    STAssertEqualObjects([NSSet setWithArray: _foundSDKs], [NSSet setWithArray: _streamedSDKs], @"Final results do not match streamed results");
+    STAssertTrue([_foundSDKs count] <= 1, @"Query did not stop at the first match");
+
+    /* Results are processed on a worker pool, but must be delivered on the query thread */
+    STAssertEquals(_resultThread, [NSThread currentThread], @"Results were not delivered on the query thread");
+    if ([_streamedSDKs count] > 0)
+        STAssertEquals(_streamedThread, [NSThread currentThread], @"Streamed results were not delivered on the query thread");
+
+    STAssertTrue(query.timeToFullResult > 0, @"Completion time was not recorded");
+    if ([_foundSDKs count] > 0)
+        STAssertTrue(query.timeToFirstResult <= query.timeToFullResult, @"First result cannot follow completion");
+}
+
+- (void) testProbeDeveloperDir {
+    NSError *error;
+
+    /* Write a platform with an SDK version that no real installation will provide */
+    NSString *developerDir = [[self temporaryDirectory] stringByAppendingPathComponent: @"Developer"];
+    NSString *platformPath = [developerDir stringByAppendingPathComponent: @"Platforms/iPhoneSimulator.platform"];
+    STAssertTrue([PLSyntheticSDK writePlatformAtPath: platformPath sdkVersions: [NSArray arrayWithObject: @"99.0"] error: &error], @"Could not write platform: %@", error);
+
+    /* Point DEVELOPER_DIR at the platform */
+    const char *saved = getenv("DEVELOPER_DIR");
+    NSString *savedDir = saved != NULL ? [NSString stringWithUTF8String: saved] : nil;
+    setenv("DEVELOPER_DIR", [developerDir fileSystemRepresentation], 1);
+
+    _foundSDKs = nil;
+    NSSet *families = [NSSet setWithObject: [PLSimulatorDeviceFamily iphoneFamily]];
+    PLSimulatorDiscovery *query = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: nil
+                                                                      canonicalSDKName: @"iphonesimulator99.0"
+                                                                        deviceFamilies: families];
+    query.delegate = self;
+    [query startQuery];
+
+    [self spinRunloopWithTimeout: 60.0 predicate: ^{ return (BOOL) (_foundSDKs != nil); }];
+
+    if (savedDir != nil)
+        setenv("DEVELOPER_DIR", [savedDir fileSystemRepresentation], 1);
+    else
+        unsetenv("DEVELOPER_DIR");
+
+    /* The platform must be found via the DEVELOPER_DIR probe */
+    STAssertNotNil(_foundSDKs, @"Timed out waiting for query results");
+    STAssertEquals([_foundSDKs count], (NSUInteger) 1, @"Expected a single matching platform");
+    STAssertEqualObjects([[[_foundSDKs lastObject] path] stringByResolvingSymlinksInPath], [platformPath stringByResolvingSymlinksInPath], @"Incorrect platform");
+}
+
+/* A query stopped from another thread must finish on the thread that started it */
+- (void) testStopFromBackgroundThread {
+    _foundSDKs = nil;
+    _resultThread = nil;
+
+    PLSimulatorDiscovery *query = [[PLSimulatorDiscovery alloc] initWithMinimumVersion: nil
+                                                                      canonicalSDKName: @"iphonesimulator98.0"
+                                                                        deviceFamilies: nil];
+    query.delegate = self;
+    query.probesKnownLocations = NO;
+    [query startQuery];
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [query stopQuery];
+    });
+
+    [self spinRunloopWithTimeout: 60.0 predicate: ^{ return (BOOL) (_foundSDKs != nil); }];
+    STAssertNotNil(_foundSDKs, @"Timed out waiting for query results");
+    STAssertEquals(_resultThread, [NSThread currentThread], @"Results were not delivered on the query thread");
+}
+
+// from PLSimulatorDiscoveryDelegate protocol
+- (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindSimulatorPlatform: (PLSimulatorPlatform *) platform {
+    [_streamedSDKs addObject: platform];
+    _streamedThread = [NSThread currentThread];
+}
+
 // from PLSimulatorDiscoveryDelegate protocol
 - (void) simulatorDiscovery: (PLSimulatorDiscovery *) discovery didFindMatchingSimulatorPlatforms: (NSArray *) sdks {
     _foundSDKs = sdks;
+    _resultThread = [NSThread currentThread];
 }
 
 @end
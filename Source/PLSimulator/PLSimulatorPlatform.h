@@ -38,16 +38,29 @@
     /** Platform SDK path. */
     NSString *_path;
 
-    /** The list of PLSimulatorSDKs included with the platform SDK. */
+    /** Absolute paths of all SDK directories included with the platform SDK, in directory order. */
+    NSArray *_sdkPaths;
+
+    /** SDK path -> materialized PLSimulatorSDK, or NSNull if the SDK could not be parsed. Guards _sdks. */
+    NSMutableDictionary *_loadedSDKs;
+
+    /** The list of all valid PLSimulatorSDKs included with the platform SDK, or nil if not yet materialized. */
     NSArray *_sdks;
 
     /** The loaded iPhoneSimulatorRemoteClient bundle, or nil if not loaded. */
     NSBundle *_remoteClient;
+
+    /** YES if the private frameworks have been successfully loaded by this instance. */
+    BOOL _frameworksLoaded;
 }
 
 - (id) initWithPath: (NSString *) path xcodePath: (NSString *) xcodePath error: (NSError **) outError;
 
+- (NSArray *) sdksMatchingCanonicalName: (NSString *) canonicalName minimumVersion: (NSString *) minimumVersion;
+
+- (void) prefetchPrivateFrameworks;
 - (BOOL) loadPrivateFrameworks: (NSError **) outError;
+- (NSArray *) privateFrameworkDependencyGraphs: (NSError **) outError;
 
 /** The path to the enclosing Xcode.app bundle, or nil if this platform was not found within an application bundle. */
 @property(readonly) NSString *xcodePath;
@@ -55,7 +68,10 @@
 /** The full path to the platform SDK. */
 @property(readonly) NSString *path;
 
-/** The list of PLSimulatorSDKs included with the platform SDK. */
+/** Absolute paths of all SDK directories included with the platform SDK. Listing the paths does not parse the SDKs. */
+@property(readonly) NSArray *sdkPaths;
+
+/** The list of PLSimulatorSDKs included with the platform SDK. All SDKs are parsed on first access; unparsable SDKs are skipped. */
 @property(readonly) NSArray *sdks;
 
 @end
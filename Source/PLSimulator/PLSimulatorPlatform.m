@@ -30,6 +30,10 @@
 
 #import "PLSimulator.h"
 #import "PLUniversalBinary.h"
+#import "PLDylibGraph.h"
+#import "PLDylibPrefetcher.h"
+#import "PLSimulatorStats.h"
+#import "rpm-vercomp.h"
 
 /* Relative path to the set of platform sub-SDKs */
 #define PLATFORM_SUBSDK_PATH @"Developer/SDKs/"
@@ -40,26 +44,71 @@
 /* Relative path to the SimulatorHost framework */
 #define SIMULATOR_HOST_FRAMEWORK @"Developer/Library/PrivateFrameworks/SimulatorHost.framework"
 
+/* If set, the directory to which private framework dependency graphs are written at load time */
+#define DYLIB_GRAPH_DIR_ENV @"PLSIMULATOR_DYLIB_GRAPH_DIR"
+
+/**
+ * @internal
+ *
+ * Derive the canonical name and version implied by an SDK directory name. Xcode names SDK directories after
+ * their canonical name (eg, iPhoneSimulator6.1.sdk contains the iphonesimulator6.1 SDK), which allows SDKs to be
+ * filtered without parsing their SDKSettings property lists.
+ *
+ * @param dirName The SDK directory name.
+ * @param canonicalName On return, the implied canonical name.
+ * @param version On return, the implied version.
+ * @return Returns NO if the directory name does not follow the Xcode naming convention, in which case the SDK must
+ * be parsed to determine its name and version.
+ */
+static BOOL platform_sdk_name_hint (NSString *dirName, NSString **canonicalName, NSString **version) {
+    if (![[dirName pathExtension] isEqualToString: @"sdk"])
+        return NO;
+
+    NSString *stem = [dirName stringByDeletingPathExtension];
+    NSUInteger length = [stem length];
+
+    /* <letters><digits and periods> */
+    NSUInteger split = 0;
+    while (split < length && isalpha([stem characterAtIndex: split]))
+        split++;
+
+    if (split == 0 || split == length || !isdigit([stem characterAtIndex: split]))
+        return NO;
+
+    for (NSUInteger i = split; i < length; i++) {
+        unichar c = [stem characterAtIndex: i];
+        if (!isdigit(c) && c != '.')
+            return NO;
+    }
+
+    *canonicalName = [stem lowercaseString];
+    *version = [stem substringFromIndex: split];
+    return YES;
+}
+
 /**
  * Manages a Simulator Platform SDK, allows querying of the bundled PLSimulatorSDK meta-data.
  *
- * @par Thread Safety
- * Immutable and thread-safe. May be used from any thread.
+ * The platform's SDK directories are listed at initialization, but their meta-data is only parsed on demand;
+ * sdksMatchingCanonicalName:minimumVersion: parses only the SDKs that may satisfy the given filters.
  *
- * As an exception to the above, the bundle loading API is not thread-safe and should only be
- * accessed from the main thread.
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread. SDKs are materialized under a per-instance lock,
+ * and framework loading is serialized across all instances via the process-wide loaded framework registry.
  */
 @implementation PLSimulatorPlatform
 
 @synthesize path = _path;
 @synthesize xcodePath = _xcodePath;
-@synthesize sdks = _sdks;
+@synthesize sdkPaths = _sdkPaths;
 
 /**
  * Global variable used to track if a given framework has already been loaded by any instance of this class.
- * Frameworks must not be loaded multiple times.
+ * Frameworks must not be loaded multiple times, and only one version of each framework may be loaded.
  *
- * This maps the frameworks' LC_ID_DYLIB name to the framework's NSBundle.
+ * This maps the frameworks' bundle names (eg, DVTiPhoneSimulatorRemoteClient.framework) to the absolute path
+ * of the loaded framework. All access, and all framework loading, must be performed while synchronized on
+ * the dictionary.
  */
 static NSMutableDictionary *loadedFrameworks;
 
@@ -89,12 +138,16 @@ static NSMutableDictionary *loadedFrameworks;
         return nil;
     }
 
+    uint64_t start = mach_absolute_time();
+    plsimulator_stats_add(PLSimulatorCounterPlatformLoadAttempts, 1);
+
     _path = path;
     _xcodePath = xcodePath;
 
     /* Verify that the path exists */
     NSFileManager *fm = [NSFileManager new];
     BOOL isDir;
+    plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
     if (![fm fileExistsAtPath: _path isDirectory: &isDir] || isDir == NO) {
         NSString *desc = NSLocalizedString(@"The provided Platform SDK path does exist or is not a directory.",
                                            @"Missing/non-directory SDK path");
@@ -103,51 +156,128 @@ static NSMutableDictionary *loadedFrameworks;
     }
 
 
-    /* Load all SDKs */
+    /* List the SDKs; they're parsed on demand */
     NSError *error;
     NSString *sdkDir = [_path stringByAppendingPathComponent: PLATFORM_SUBSDK_PATH];
-    NSArray *sdkPaths = [fm contentsOfDirectoryAtPath: sdkDir error: &error];
+    NSArray *sdkNames = [fm contentsOfDirectoryAtPath: sdkDir error: &error];
     
-    if (sdkPaths == nil) {
+    if (sdkNames == nil) {
         NSString *desc = NSLocalizedString(@"The provided Platform SDK does not contain any SDKs",
                                            @"Missing/non-directory SDK sub-path");
         plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidSDK, desc, error);
         return nil;
     }
 
-    /* Iterate and load the SDK subdirectories */
-    NSMutableArray *sdks = [NSMutableArray arrayWithCapacity: [sdkPaths count]];
-    _sdks = sdks;
+    NSMutableArray *sdkPaths = [NSMutableArray arrayWithCapacity: [sdkNames count]];
+    for (NSString *name in sdkNames)
+        [sdkPaths addObject: [sdkDir stringByAppendingPathComponent: name]];
 
-    for (NSString *sdkPath in sdkPaths) {
-        NSString *absolutePath = [sdkDir stringByAppendingPathComponent: sdkPath];
+    _sdkPaths = sdkPaths;
+    _loadedSDKs = [NSMutableDictionary dictionaryWithCapacity: [sdkPaths count]];
 
-        PLSimulatorSDK *sdk = [[PLSimulatorSDK alloc] initWithPath: absolutePath error: &error];
+    plsimulator_stats_add(PLSimulatorCounterPlatformsLoaded, 1);
+    plsimulator_stats_record(PLSimulatorHistogramPlatformLoadTime, plsimulator_stats_abs_to_ns(mach_absolute_time() - start));
+
+    return self;
+}
+
+/**
+ * @internal
+ *
+ * Return the SDK at @a path, parsing it if it has not already been loaded. Returns nil if the SDK can not be
+ * parsed. Must be called with _loadedSDKs locked.
+ */
+- (PLSimulatorSDK *) loadSDKAtPath: (NSString *) path {
+    id sdk = [_loadedSDKs objectForKey: path];
+    if (sdk == nil) {
+        NSError *error;
+        sdk = [[PLSimulatorSDK alloc] initWithPath: path error: &error];
 
         /* Simply skip unparsable SDKs */
         if (sdk == nil) {
-            NSLog(@"Skipping bad SDK %@: %@", absolutePath, error);
-            continue;
+            NSLog(@"Skipping bad SDK %@: %@", path, error);
+            sdk = [NSNull null];
         }
 
-        [sdks addObject: sdk];
+        [_loadedSDKs setObject: sdk forKey: path];
     }
 
-    return self;
+    if (sdk == [NSNull null])
+        return nil;
+
+    return sdk;
+}
+
+// property getter
+- (NSArray *) sdks {
+    @synchronized (_loadedSDKs) {
+        if (_sdks == nil) {
+            NSMutableArray *sdks = [NSMutableArray arrayWithCapacity: [_sdkPaths count]];
+            for (NSString *path in _sdkPaths) {
+                PLSimulatorSDK *sdk = [self loadSDKAtPath: path];
+                if (sdk != nil)
+                    [sdks addObject: sdk];
+            }
+
+            _sdks = sdks;
+        }
+
+        return _sdks;
+    }
 }
 
 /**
- * @internal
+ * Return the platform's SDKs matching the given canonical name and minimum version, in directory order.
  *
- * Attempt to load a private framework from this platform SDK.
+ * The filters are applied to the SDK directory names before any SDK is parsed; only the SDKs whose directory
+ * names may match are parsed, and the parsed meta-data is then checked against the filters. SDK directories whose
+ * names do not follow Xcode's naming convention (eg, iPhoneSimulator6.1.sdk) are always parsed. Parsed SDKs are
+ * retained for later use.
  *
- * @param relativePath The path to the private framework, relative to the platform SDK.
- * @param error If an error occurs, upon return contains an NSError object that describes the problem.
- * @return Returns YES on success, or NO on failure.
+ * @param canonicalName The required canonical SDK name (eg, iphonesimulator6.1), or nil.
+ * @param minimumVersion The minimum required SDK version, or nil.
  */
-- (BOOL) loadPrivateFrameworkAtPath: (NSString *) relativePath error: (NSError **) outError {
-    /* Attempt to load absolute LC_RPATH values from the Xcode binary corresponding to this platform instance, if
-     * available. */
+- (NSArray *) sdksMatchingCanonicalName: (NSString *) canonicalName minimumVersion: (NSString *) minimumVersion {
+    NSMutableArray *result = [NSMutableArray array];
+
+    @synchronized (_loadedSDKs) {
+        for (NSString *path in _sdkPaths) {
+            /* Skip SDKs that can not match, without parsing them */
+            NSString *hintName;
+            NSString *hintVersion;
+            if (platform_sdk_name_hint([path lastPathComponent], &hintName, &hintVersion)) {
+                if (canonicalName != nil && ![canonicalName isEqualToString: hintName])
+                    continue;
+
+                if (minimumVersion != nil && rpm_vercomp([hintVersion UTF8String], [minimumVersion UTF8String]) < 0)
+                    continue;
+            }
+
+            PLSimulatorSDK *sdk = [self loadSDKAtPath: path];
+            if (sdk == nil)
+                continue;
+
+            if (canonicalName != nil && ![canonicalName isEqualToString: sdk.canonicalName])
+                continue;
+
+            if (minimumVersion != nil && rpm_vercomp([sdk.version UTF8String], [minimumVersion UTF8String]) < 0)
+                continue;
+
+            [result addObject: sdk];
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @internal
+ *
+ * Return the absolute @rpath search paths to be used when loading private frameworks from this platform SDK.
+ * This includes the absolute LC_RPATH values of the Xcode binary corresponding to this platform instance, if
+ * available.
+ */
+- (NSArray *) privateFrameworkRPaths {
     NSArray *rpaths = nil;
     if (_xcodePath != nil) {
         NSBundle *xcodeBundle = [NSBundle bundleWithPath: _xcodePath];
@@ -169,9 +299,58 @@ static NSMutableDictionary *loadedFrameworks;
             rpaths = [rpaths arrayByAddingObject: [_xcodePath stringByAppendingPathComponent: @"Contents/OtherFrameworks"]];
         }
     }
+
+    return rpaths;
+}
+
+/**
+ * @internal
+ *
+ * Return a short name for the enclosing Xcode version, suitable for use in file names.
+ */
+- (NSString *) xcodeVersionName {
+    NSString *version = nil;
+    if (_xcodePath != nil)
+        version = [[[NSBundle bundleWithPath: _xcodePath] infoDictionary] objectForKey: @"CFBundleShortVersionString"];
+
+    if (version == nil)
+        return @"unknown";
+
+    return version;
+}
+
+/**
+ * @internal
+ *
+ * Attempt to load a private framework from this platform SDK.
+ *
+ * If the PLSIMULATOR_DYLIB_GRAPH_DIR environment variable is set, the framework's dependency graph will be
+ * written to the named directory prior to loading, and its critical path logged.
+ *
+ * Must be called while synchronized on loadedFrameworks.
+ *
+ * @param relativePath The path to the private framework, relative to the platform SDK.
+ * @param error If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO on failure.
+ */
+- (BOOL) loadPrivateFrameworkAtPath: (NSString *) relativePath error: (NSError **) outError {
+    NSArray *rpaths = [self privateFrameworkRPaths];
     
     /* Determine the framework path */
-    NSString *path = [_path stringByAppendingPathComponent: relativePath];
+    NSString *path = [[_path stringByAppendingPathComponent: relativePath] stringByStandardizingPath];
+    NSString *name = [relativePath lastPathComponent];
+
+    /* Only one version of the framework may be loaded into the process */
+    NSString *loadedPath = [loadedFrameworks objectForKey: name];
+    if (loadedPath != nil) {
+        if ([loadedPath isEqualToString: path])
+            return YES;
+
+        NSString *fmt = NSLocalizedString(@"The simulator framework %@ has already been loaded from %@.", @"Framework conflict");
+        plsimulator_populate_nserror(outError, PLSimulatorErrorFrameworkConflict, [NSString stringWithFormat: fmt, name, loadedPath], nil);
+        return NO;
+    }
+
     _remoteClient = [NSBundle bundleWithPath: path];
     
     /* Load the bundle */
@@ -179,28 +358,109 @@ static NSMutableDictionary *loadedFrameworks;
     PLUniversalBinary *ub = [PLUniversalBinary binaryWithPath: libraryPath error: outError];
     if (ub == nil)
         return false;
+
+    /* Export the dependency graph, if requested */
+    NSString *graphDir = [[[NSProcessInfo processInfo] environment] objectForKey: DYLIB_GRAPH_DIR_ENV];
+    if (graphDir != nil) {
+        NSError *error;
+        PLDylibGraph *graph = [PLDylibGraph graphWithBinaryPath: libraryPath rpaths: rpaths error: &error];
+        NSString *baseName = [NSString stringWithFormat: @"%@-%@", [[relativePath lastPathComponent] stringByDeletingPathExtension], [self xcodeVersionName]];
+
+        if (graph == nil || ![graph writeToDirectory: graphDir baseName: baseName error: &error]) {
+            NSLog(@"Failed to export dependency graph for %@: %@", relativePath, error);
+        } else {
+            NSLog(@"%@ (Xcode %@) %@", [relativePath lastPathComponent], [self xcodeVersionName], [graph criticalPathReport]);
+        }
+    }
     
-    return [ub loadLibraryWithRPaths: rpaths error: outError];
+    if (![ub loadLibraryWithRPaths: rpaths error: outError])
+        return NO;
+
+    [loadedFrameworks setObject: path forKey: name];
+    return YES;
+}
+
+/**
+ * Build the dylib dependency graphs of the private simulator frameworks loaded by
+ * PLSimulatorPlatform::loadPrivateFrameworks:, without loading them.
+ *
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns an array of PLDylibGraph instances, in load order, or nil on failure.
+ */
+- (NSArray *) privateFrameworkDependencyGraphs: (NSError **) outError {
+    NSArray *rpaths = [self privateFrameworkRPaths];
+    NSMutableArray *graphs = [NSMutableArray arrayWithCapacity: 2];
+
+    for (NSString *relativePath in [NSArray arrayWithObjects: REMOTE_CLIENT_FRAMEWORK, SIMULATOR_HOST_FRAMEWORK, nil]) {
+        NSString *libraryPath = [[NSBundle bundleWithPath: [_path stringByAppendingPathComponent: relativePath]] executablePath];
+        if (libraryPath == nil) {
+            NSString *desc = NSLocalizedString(@"The private simulator framework could not be found.", @"Missing framework");
+            plsimulator_populate_nserror(outError, PLSimulatorErrorInvalidSDK, desc, nil);
+            return nil;
+        }
+
+        PLDylibGraph *graph = [PLDylibGraph graphWithBinaryPath: libraryPath rpaths: rpaths error: outError];
+        if (graph == nil)
+            return nil;
+
+        [graphs addObject: graph];
+    }
+
+    return graphs;
 }
 
 /**
- * Attempt to load the private simulator frameworks from this platform SDK.
+ * Issue asynchronous readahead for the dependency closures of the private simulator frameworks loaded by
+ * PLSimulatorPlatform::loadPrivateFrameworks:, without loading them. This may be used to begin resolving
+ * a candidate platform's frameworks before it is known whether that platform will be used.
+ *
+ * If prefetching has been disabled (see PLDylibPrefetcher::isEnabled), this method does nothing.
+ */
+- (void) prefetchPrivateFrameworks {
+    if (![PLDylibPrefetcher isEnabled])
+        return;
+
+    NSArray *rpaths = [self privateFrameworkRPaths];
+    for (NSString *relativePath in [NSArray arrayWithObjects: REMOTE_CLIENT_FRAMEWORK, SIMULATOR_HOST_FRAMEWORK, nil]) {
+        NSString *libraryPath = [[NSBundle bundleWithPath: [_path stringByAppendingPathComponent: relativePath]] executablePath];
+        if (libraryPath != nil)
+            [[PLDylibPrefetcher sharedPrefetcher] prefetchClosureOfBinaryAtPath: libraryPath rpaths: rpaths];
+    }
+}
+
+/**
+ * Attempt to load the private simulator frameworks from this platform SDK. Once the frameworks have been
+ * loaded, subsequent calls return YES immediately.
  *
  * @param error If an error occurs, upon return contains an NSError object that describes the problem.
  * @return Returns YES on success, or NO on failure.
  *
- * @warning Only one instance of the iPhoneSimulatorRemoteClient framework may be loaded across the entire lifetime
- * of the process. Attempting to load the framework -- or a different version of the framework -- will result in
- * undefined behavior.ß
+ * Loading is serialized across all instances, and may be performed from any thread. If the frameworks have
+ * already been loaded from this platform SDK by another instance, this method returns YES without reloading them.
+ *
+ * @warning Only one version of the iPhoneSimulatorRemoteClient framework may be loaded across the entire lifetime
+ * of the process. If a different platform SDK's frameworks have already been loaded, this method fails with
+ * PLSimulatorErrorFrameworkConflict.
  */
 - (BOOL) loadPrivateFrameworks: (NSError **) outError {
-    /* Load the iPhoneSimulatorRemoteClient framework */
-    if (![self loadPrivateFrameworkAtPath: REMOTE_CLIENT_FRAMEWORK error: outError])
-        return NO;
+    /* Issue readahead for both frameworks' dependency closures up-front, so that the second framework's
+     * libraries are read in while the first is loading */
+    [self prefetchPrivateFrameworks];
 
-    /* Load the SimulatorHost framework */
-    if (![self loadPrivateFrameworkAtPath: SIMULATOR_HOST_FRAMEWORK error: outError])
-        return NO;
+    @synchronized (loadedFrameworks) {
+        if (_frameworksLoaded)
+            return YES;
+
+        /* Load the iPhoneSimulatorRemoteClient framework */
+        if (![self loadPrivateFrameworkAtPath: REMOTE_CLIENT_FRAMEWORK error: outError])
+            return NO;
+
+        /* Load the SimulatorHost framework */
+        if (![self loadPrivateFrameworkAtPath: SIMULATOR_HOST_FRAMEWORK error: outError])
+            return NO;
+
+        _frameworksLoaded = YES;
+    }
 
     return YES;
 }
@@ -0,0 +1,82 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+
+#import "PLSimulator.h"
+#import "PLSimulatorPlatform.h"
+
+/**
+ * @internal
+ *
+ * A precomputed, totally ordered SDK version key. Purely numeric versions of up to four components are
+ * packed into @a packed, and compared as integers; all other versions fall back to rpm_vercomp().
+ */
+typedef struct plsimulator_version_key {
+    /** Packed version components and component count; valid only if @a numeric is true. */
+    uint64_t packed;
+
+    /** If true, @a packed is valid. */
+    bool numeric;
+
+    /** The version string, used for non-numeric comparisons. Not owned by the key; the caller must keep it valid for the key's lifetime. */
+    const char *string;
+} plsimulator_version_key_t;
+
+void plsimulator_version_key_init (plsimulator_version_key_t *key, const char *version) PLSIM_HIDDEN;
+int plsimulator_version_key_compare (const plsimulator_version_key_t *key1, const plsimulator_version_key_t *key2) PLSIM_HIDDEN;
+
+@interface PLSimulatorPlatformMatcher : NSObject {
+@private
+    /** Requested minimum version. If nil, no minimum version is requested. */
+    NSString *_version;
+
+    /** UTF-8 copy of the requested minimum version, owned by the matcher and referenced by _versionKey. NULL if _version is nil. */
+    char *_versionString;
+
+    /** Precomputed key for the requested minimum version. Valid only if _version is non-nil. */
+    plsimulator_version_key_t _versionKey;
+
+    /** Requested canonical SDK name. If nil, no specific named SDK is requested. */
+    NSString *_canonicalSDKName;
+
+    /** If YES, a device family filter was requested. */
+    BOOL _filtersDeviceFamilies;
+
+    /** Requested device families, as a bitmask of PL_SDK_FAMILY_BIT() values. */
+    uint32_t _deviceFamilyMask;
+}
+
++ (uint32_t) maskForDeviceFamilies: (id<NSFastEnumeration>) deviceFamilies;
+
+- (id) initWithMinimumVersion: (NSString *) version canonicalSDKName: (NSString *) canonicalSDKName deviceFamilies: (NSSet *) deviceFamilies;
+
+- (BOOL) matchesPlatform: (PLSimulatorPlatform *) platform;
+- (NSArray *) rankedPlatformsMatchingPlatforms: (NSArray *) platforms;
+
+@end
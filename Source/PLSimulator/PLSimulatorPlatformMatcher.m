@@ -0,0 +1,320 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSimulatorPlatformMatcher.h"
+
+#import "PLSimulatorSDK.h"
+#import "PLSimulatorDeviceFamily.h"
+#import "rpm-vercomp.h"
+
+/* Number of version components that may be packed into a key, and the width of each component */
+#define VERSION_KEY_COMPONENTS 4
+#define VERSION_KEY_COMPONENT_BITS 15
+
+/* The component count is packed into the low bits, below the components */
+#define VERSION_KEY_COUNT_BITS 3
+
+/**
+ * @internal
+ *
+ * Initialize @a key for @a version. The key references, but does not copy, @a version.
+ *
+ * Versions are packed only if they consist of at most VERSION_KEY_COMPONENTS dot-separated decimal
+ * components, each of which fits in VERSION_KEY_COMPONENT_BITS. The component count is packed below the
+ * components so that, as with rpm_vercomp(), "5.1.0" orders after "5.1".
+ */
+void plsimulator_version_key_init (plsimulator_version_key_t *key, const char *version) {
+    key->packed = 0;
+    key->numeric = false;
+    key->string = version;
+
+    uint64_t components[VERSION_KEY_COMPONENTS] = { 0 };
+    unsigned int count = 0;
+    const char *p = version;
+
+    while (true) {
+        /* Each component must be a non-empty run of digits */
+        if (*p < '0' || *p > '9')
+            return;
+
+        uint64_t value = 0;
+        while (*p >= '0' && *p <= '9') {
+            value = (value * 10) + (*p - '0');
+            if (value >= (1ULL << VERSION_KEY_COMPONENT_BITS))
+                return;
+            p++;
+        }
+
+        if (count == VERSION_KEY_COMPONENTS)
+            return;
+        components[count++] = value;
+
+        if (*p == '\0')
+            break;
+        if (*p != '.')
+            return;
+        p++;
+    }
+
+    for (unsigned int i = 0; i < VERSION_KEY_COMPONENTS; i++) {
+        unsigned int shift = VERSION_KEY_COUNT_BITS + (VERSION_KEY_COMPONENTS - 1 - i) * VERSION_KEY_COMPONENT_BITS;
+        key->packed |= components[i] << shift;
+    }
+    key->packed |= count;
+    key->numeric = true;
+}
+
+/**
+ * @internal
+ *
+ * Compare two version keys, returning a value less than, equal to, or greater than zero if @a key1
+ * is respectively older than, equal to, or newer than @a key2.
+ */
+int plsimulator_version_key_compare (const plsimulator_version_key_t *key1, const plsimulator_version_key_t *key2) {
+    if (key1->numeric && key2->numeric) {
+        if (key1->packed < key2->packed)
+            return -1;
+        else if (key1->packed > key2->packed)
+            return 1;
+        return 0;
+    }
+
+    return rpm_vercomp(key1->string, key2->string);
+}
+
+/* A platform ranking entry */
+typedef struct platform_rank {
+    /** The platform; retained by the input array. */
+    __unsafe_unretained PLSimulatorPlatform *platform;
+
+    /** Index in the input array, used to keep the ranking stable. */
+    NSUInteger index;
+
+    /** If true, @a latest is valid. */
+    bool hasVersion;
+
+    /** Key of the platform's highest SDK version. */
+    plsimulator_version_key_t latest;
+
+    /** Copy of the highest SDK version string, referenced by @a latest. Owned by the rank; NULL if @a hasVersion is false. */
+    char *latestString;
+} platform_rank_t;
+
+/* Order platforms by their highest SDK version, oldest first; platforms without SDKs sort first. */
+static int platform_rank_compare (const void *a, const void *b) {
+    const platform_rank_t *rank1 = a;
+    const platform_rank_t *rank2 = b;
+
+    int res = 0;
+    if (rank1->hasVersion && rank2->hasVersion)
+        res = plsimulator_version_key_compare(&rank1->latest, &rank2->latest);
+    else if (rank1->hasVersion != rank2->hasVersion)
+        res = rank1->hasVersion ? 1 : -1;
+
+    if (res != 0)
+        return res;
+
+    if (rank1->index < rank2->index)
+        return -1;
+    return rank1->index > rank2->index;
+}
+
+@interface PLSimulatorPlatformMatcher (PrivateMethods)
+- (BOOL) evaluatePlatform: (PLSimulatorPlatform *) platform rank: (platform_rank_t *) rank;
+@end
+
+/**
+ * Matches simulator platforms against a set of SDK requirements.
+ *
+ * The requirements are compiled once, on initialization: the minimum version is converted to a
+ * precomputed version key, and the requested device families to a bitmask. Each platform's SDKs are
+ * then checked in a single pass, which also computes the key used to rank the matching platforms.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLSimulatorPlatformMatcher
+
+/**
+ * Return the PL_SDK_FAMILY_BIT() mask for the given PLSimulatorDeviceFamily instances.
+ *
+ * @param deviceFamilies PLSimulatorDeviceFamily instances.
+ */
++ (uint32_t) maskForDeviceFamilies: (id<NSFastEnumeration>) deviceFamilies {
+    uint32_t mask = 0;
+    for (PLSimulatorDeviceFamily *family in deviceFamilies) {
+        NSInteger code = family.deviceFamilyCode;
+        if (code >= 0 && code < 32)
+            mask |= PL_SDK_FAMILY_BIT(code);
+    }
+
+    return mask;
+}
+
+/**
+ * Initialize a new matcher.
+ *
+ * @param version The minimum required SDK version (inclusive). If nil, no minimum version is required.
+ * @param canonicalSDKName The required canonical SDK name. If nil, no specific SDK is required.
+ * @param deviceFamilies The required device families, as PLSimulatorDeviceFamily instances; a platform must
+ * support at least one. If nil, no device families are required.
+ */
+- (id) initWithMinimumVersion: (NSString *) version canonicalSDKName: (NSString *) canonicalSDKName deviceFamilies: (NSSet *) deviceFamilies {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    /* The key references its string; it must not point into the autoreleased -UTF8String buffer */
+    _version = [version copy];
+    if (_version != nil) {
+        _versionString = strdup([_version UTF8String]);
+        plsimulator_version_key_init(&_versionKey, _versionString);
+    }
+
+    _canonicalSDKName = [canonicalSDKName copy];
+
+    _filtersDeviceFamilies = (deviceFamilies != nil);
+    _deviceFamilyMask = [[self class] maskForDeviceFamilies: deviceFamilies];
+
+    return self;
+}
+
+- (void) dealloc {
+    free(_versionString);
+}
+
+/**
+ * Return YES if @a platform provides SDKs satisfying all requirements.
+ *
+ * @param platform The platform to be checked.
+ */
+- (BOOL) matchesPlatform: (PLSimulatorPlatform *) platform {
+    platform_rank_t rank;
+    BOOL matches = [self evaluatePlatform: platform rank: &rank];
+    free(rank.latestString);
+    return matches;
+}
+
+/**
+ * Return the platforms in @a platforms that satisfy all requirements, in order of preference.
+ *
+ * Platforms are ordered by the version of their newest SDK, oldest first, to prefer the most stable of
+ * the available set. Platforms with equal versions retain their relative order from @a platforms.
+ *
+ * @param platforms PLSimulatorPlatform instances to be filtered.
+ */
+- (NSArray *) rankedPlatformsMatchingPlatforms: (NSArray *) platforms {
+    NSUInteger count = [platforms count];
+    if (count == 0)
+        return [NSArray array];
+
+    platform_rank_t *ranks = malloc(sizeof(platform_rank_t) * count);
+    NSUInteger matched = 0;
+
+    NSUInteger index = 0;
+    for (PLSimulatorPlatform *platform in platforms) {
+        platform_rank_t *rank = &ranks[matched];
+        rank->index = index++;
+        if ([self evaluatePlatform: platform rank: rank])
+            matched++;
+        else
+            free(rank->latestString);
+    }
+
+    qsort(ranks, matched, sizeof(platform_rank_t), platform_rank_compare);
+
+    NSMutableArray *result = [NSMutableArray arrayWithCapacity: matched];
+    for (NSUInteger i = 0; i < matched; i++) {
+        [result addObject: ranks[i].platform];
+        free(ranks[i].latestString);
+    }
+
+    free(ranks);
+    return result;
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLSimulatorPlatformMatcher (PrivateMethods)
+
+/**
+ * Check @a platform against all requirements in a single pass over its SDKs, populating @a rank with
+ * the platform and the key of its newest SDK.
+ *
+ * The rank's key references a copy of the newest SDK version string, rather than the autoreleased -UTF8String
+ * buffer; the caller must free the rank's latestString.
+ */
+- (BOOL) evaluatePlatform: (PLSimulatorPlatform *) platform rank: (platform_rank_t *) rank {
+    BOOL hasMinVersion = (_version == nil);
+    BOOL hasExpectedSDK = (_canonicalSDKName == nil);
+    uint32_t families = 0;
+
+    rank->platform = platform;
+    rank->hasVersion = false;
+    rank->latestString = NULL;
+
+    /* Push the name and version requirements down to the platform; a platform that can not satisfy them is
+     * rejected without parsing all of its SDKs */
+    if (_canonicalSDKName != nil && [[platform sdksMatchingCanonicalName: _canonicalSDKName minimumVersion: nil] count] == 0)
+        return NO;
+
+    if (_version != nil && [[platform sdksMatchingCanonicalName: nil minimumVersion: _version] count] == 0)
+        return NO;
+
+    for (PLSimulatorSDK *sdk in platform.sdks) {
+        /* The SDK's key is only used within this iteration; only the newest SDK's string is copied */
+        plsimulator_version_key_t key;
+        plsimulator_version_key_init(&key, [sdk.version UTF8String]);
+
+        if (!rank->hasVersion || plsimulator_version_key_compare(&key, &rank->latest) > 0) {
+            free(rank->latestString);
+            rank->latestString = strdup(key.string);
+            plsimulator_version_key_init(&rank->latest, rank->latestString);
+            rank->hasVersion = true;
+        }
+
+        /* If greater than or equal to the minimum version, this platform SDK meets the requirements */
+        if (!hasMinVersion && plsimulator_version_key_compare(&key, &_versionKey) >= 0)
+            hasMinVersion = YES;
+
+        if (!hasExpectedSDK && [_canonicalSDKName isEqualToString: sdk.canonicalName])
+            hasExpectedSDK = YES;
+
+        if (_filtersDeviceFamilies && (families & _deviceFamilyMask) == 0)
+            families |= [[self class] maskForDeviceFamilies: sdk.deviceFamilies];
+    }
+
+    /* If any of our requested families are included, the platform meets the requirements */
+    BOOL hasDeviceFamily = !_filtersDeviceFamilies || (families & _deviceFamilyMask) != 0;
+
+    return hasMinVersion && hasExpectedSDK && hasDeviceFamily;
+}
+
+@end
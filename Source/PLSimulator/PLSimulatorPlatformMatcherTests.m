@@ -0,0 +1,105 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+#import "PLSyntheticFixtures.h"
+
+#import "PLSimulatorPlatformMatcher.h"
+#import "PLSimulatorDeviceFamily.h"
+#import "PLSimulatorSDK.h"
+#import "rpm-vercomp.h"
+
+@interface PLSimulatorPlatformMatcherTests : PLTestCase
+@end
+
+@implementation PLSimulatorPlatformMatcherTests
+
+/* Version keys must order identically to rpm_vercomp() */
+- (void) testVersionKeys {
+    const char *versions[] = { "3.2", "4.0", "4.3.2", "5", "5.0", "5.1", "5.1.0", "05.1", "6.0", "10.0", "9.3", "6.0b1", "6.0.1.2.3", "70000.1" };
+    size_t count = sizeof(versions) / sizeof(versions[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < count; j++) {
+            plsimulator_version_key_t key1, key2;
+            plsimulator_version_key_init(&key1, versions[i]);
+            plsimulator_version_key_init(&key2, versions[j]);
+
+            int expected = rpm_vercomp(versions[i], versions[j]);
+            int actual = plsimulator_version_key_compare(&key1, &key2);
+            STAssertEquals(expected < 0 ? -1 : (expected > 0), actual < 0 ? -1 : (actual > 0), @"Incorrect ordering of %s and %s", versions[i], versions[j]);
+        }
+    }
+
+    /* Only simple numeric versions are packed */
+    plsimulator_version_key_t key;
+    plsimulator_version_key_init(&key, "5.1.2");
+    STAssertTrue(key.numeric, @"Numeric version was not packed");
+    plsimulator_version_key_init(&key, "6.0b1");
+    STAssertFalse(key.numeric, @"Non-numeric version was packed");
+}
+
+- (void) testFamilyMask {
+    NSSet *families = [NSSet setWithObjects: [PLSimulatorDeviceFamily iphoneFamily], [PLSimulatorDeviceFamily ipadFamily], nil];
+    uint32_t mask = [PLSimulatorPlatformMatcher maskForDeviceFamilies: families];
+    STAssertEquals(mask, PL_SDK_FAMILY_BIT([PLSimulatorDeviceFamily iphoneFamily].deviceFamilyCode) | PL_SDK_FAMILY_BIT([PLSimulatorDeviceFamily ipadFamily].deviceFamilyCode),
+                   @"Incorrect family mask");
+}
+
+- (void) testRanking {
+    PLSimulatorPlatform *p60 = [self platformWithName: @"Xcode-6.0" sdkVersions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    PLSimulatorPlatform *p51 = [self platformWithName: @"Xcode-5.1" sdkVersions: [NSArray arrayWithObject: @"5.1"]];
+    PLSimulatorPlatform *p100 = [self platformWithName: @"Xcode-10.0" sdkVersions: [NSArray arrayWithObject: @"10.0"]];
+    PLSimulatorPlatform *p60b = [self platformWithName: @"Xcode-6.0-b" sdkVersions: [NSArray arrayWithObject: @"6.0"]];
+    NSArray *platforms = [NSArray arrayWithObjects: p100, p60, p51, p60b, nil];
+
+    /* No requirements; ordered by newest SDK, oldest first, with ties retaining their input order */
+    PLSimulatorPlatformMatcher *any = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: nil canonicalSDKName: nil deviceFamilies: nil];
+    NSArray *expected = [NSArray arrayWithObjects: p51, p60, p60b, p100, nil];
+    STAssertEqualObjects([any rankedPlatformsMatchingPlatforms: platforms], expected, @"Incorrect ranking");
+
+    /* Minimum version */
+    PLSimulatorPlatformMatcher *min = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: @"6.0" canonicalSDKName: nil deviceFamilies: nil];
+    expected = [NSArray arrayWithObjects: p60, p60b, p100, nil];
+    STAssertEqualObjects([min rankedPlatformsMatchingPlatforms: platforms], expected, @"Incorrect minimum version filtering");
+
+    /* Canonical SDK name, which need not be the newest SDK */
+    PLSimulatorPlatformMatcher *named = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: nil canonicalSDKName: @"iphonesimulator5.1" deviceFamilies: nil];
+    expected = [NSArray arrayWithObjects: p51, p60, nil];
+    STAssertEqualObjects([named rankedPlatformsMatchingPlatforms: platforms], expected, @"Incorrect canonical name filtering");
+
+    /* Device families; an empty set matches nothing, as with the discovery query */
+    NSSet *ipad = [NSSet setWithObject: [PLSimulatorDeviceFamily ipadFamily]];
+    PLSimulatorPlatformMatcher *family = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: @"5.1" canonicalSDKName: nil deviceFamilies: ipad];
+    STAssertTrue([family matchesPlatform: p51], @"iPad family should match");
+
+    PLSimulatorPlatformMatcher *none = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: nil canonicalSDKName: nil deviceFamilies: [NSSet set]];
+    STAssertFalse([none matchesPlatform: p51], @"Empty family set should not match");
+}
+
+@end
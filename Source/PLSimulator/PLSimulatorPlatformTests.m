@@ -28,6 +28,10 @@
 
 #import "PLTestCase.h"
 #import "PLSimulatorPlatform.h"
+#import "PLSimulatorPlatformMatcher.h"
+#import "PLSimulatorStats.h"
+
+#import "PLSyntheticSDK.h"
 
 @interface PLSimulatorPlatformTests : PLTestCase
 @end
@@ -44,4 +48,36 @@
     STAssertEquals((NSUInteger)1, [platform.sdks count], @"Did not load platform's SDKs");
 }
 
+/* SDKs must only be parsed when required by a filter */
+- (void) testLazySDKs {
+    NSError *error;
+    NSString *path = [[self temporaryDirectory] stringByAppendingPathComponent: @"iPhoneSimulator.platform"];
+    NSArray *versions = [NSArray arrayWithObjects: @"5.0", @"5.1", @"6.0", @"6.1", nil];
+    STAssertTrue([PLSyntheticSDK writePlatformAtPath: path sdkVersions: versions error: &error], @"Could not write platform: %@", error);
+
+    [PLSimulatorStats reset];
+    PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: nil error: &error];
+    STAssertNotNil(platform, @"Could not read platform SDK meta-data: %@", error);
+    STAssertEquals([platform.sdkPaths count], (NSUInteger) 4, @"Did not list platform's SDKs");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 0, @"SDKs were parsed eagerly");
+
+    /* A non-matching requirement must be rejected without parsing any SDKs */
+    PLSimulatorPlatformMatcher *matcher = [[PLSimulatorPlatformMatcher alloc] initWithMinimumVersion: nil canonicalSDKName: @"iphonesimulator7.0" deviceFamilies: nil];
+    STAssertFalse([matcher matchesPlatform: platform], @"Platform should not match");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 0, @"SDKs were parsed to reject the platform");
+
+    NSArray *named = [platform sdksMatchingCanonicalName: @"iphonesimulator6.1" minimumVersion: nil];
+    STAssertEquals([named count], (NSUInteger) 1, @"Incorrect number of named SDKs");
+    STAssertEqualObjects([[named lastObject] version], @"6.1", @"Incorrect SDK");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 1, @"Non-matching SDKs were parsed");
+
+    /* Previously parsed SDKs must be reused */
+    NSArray *newer = [platform sdksMatchingCanonicalName: nil minimumVersion: @"6.0"];
+    STAssertEquals([newer count], (NSUInteger) 2, @"Incorrect number of SDKs matching the minimum version");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 2, @"SDKs were not reused");
+
+    STAssertEquals([platform.sdks count], (NSUInteger) 4, @"Did not load platform's SDKs");
+    STAssertEquals([[PLSimulatorStats snapshot] valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 4, @"SDKs were not reused");
+}
+
 @end
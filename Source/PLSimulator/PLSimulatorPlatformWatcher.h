@@ -0,0 +1,131 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <CoreServices/CoreServices.h>
+
+#import "PLSimulatorPlatform.h"
+
+@class PLSimulatorPlatformWatcher;
+
+/**
+ * Describes a change to the set of platforms known to a PLSimulatorPlatformWatcher.
+ */
+@interface PLSimulatorPlatformDiff : NSObject {
+@private
+    /** Newly found platforms. */
+    NSArray *_addedPlatforms;
+
+    /** Platforms that were removed, as previously reported. */
+    NSArray *_removedPlatforms;
+
+    /** Rebuilt platforms whose SDKs changed, replacing the previously reported instances at the same paths. */
+    NSArray *_updatedPlatforms;
+
+    /** SDKs added to the updated platforms. */
+    NSArray *_addedSDKs;
+
+    /** SDKs removed from the updated platforms. */
+    NSArray *_removedSDKs;
+}
+
+/** Newly found platforms. */
+@property(nonatomic, readonly) NSArray *addedPlatforms;
+
+/** Platforms that were removed, as previously reported. */
+@property(nonatomic, readonly) NSArray *removedPlatforms;
+
+/** Rebuilt platforms whose SDKs changed, replacing the previously reported instances at the same paths. */
+@property(nonatomic, readonly) NSArray *updatedPlatforms;
+
+/** PLSimulatorSDK instances added to the updated platforms. */
+@property(nonatomic, readonly) NSArray *addedSDKs;
+
+/** PLSimulatorSDK instances removed from the updated platforms. */
+@property(nonatomic, readonly) NSArray *removedSDKs;
+
+/** YES if the diff contains no changes. */
+@property(nonatomic, readonly, getter=isEmpty) BOOL empty;
+
+@end
+
+/**
+ * The PLSimulatorPlatformWatcherDelegate defines the methods used to receive platform changes from a
+ * PLSimulatorPlatformWatcher.
+ */
+@protocol PLSimulatorPlatformWatcherDelegate <NSObject>
+
+/**
+ * Called on the watcher's run loop when watched platforms are added, removed, or updated.
+ *
+ * @param watcher The sender.
+ * @param diff The changes. Will never be empty.
+ */
+- (void) platformWatcher: (PLSimulatorPlatformWatcher *) watcher didChangePlatforms: (PLSimulatorPlatformDiff *) diff;
+
+@end
+
+@interface PLSimulatorPlatformWatcher : NSObject {
+@private
+    /** Known platforms, keyed by path. */
+    NSMutableDictionary *_platforms;
+
+    /** The SDKs of each known platform as of its registration, keyed by path. Platform SDKs are parsed lazily, so
+     * changes are detected against this snapshot rather than the platform's own (possibly not yet loaded) SDKs. */
+    NSMutableDictionary *_sdkSnapshots;
+
+    /** Directories below which new platforms are detected. */
+    NSArray *_searchRoots;
+
+    /** Event coalescing latency, in seconds. */
+    NSTimeInterval _latency;
+
+    /** The running event stream, or NULL. */
+    FSEventStreamRef _stream;
+
+    /** Delegate */
+    id<PLSimulatorPlatformWatcherDelegate> __weak _delegate;
+}
+
+- (id) initWithPlatforms: (NSArray *) platforms searchRoots: (NSArray *) searchRoots;
+
+- (BOOL) startWatching: (NSError **) outError;
+- (void) stopWatching;
+
+- (PLSimulatorPlatformDiff *) rescanPaths: (NSArray *) paths;
+
+/** The known platforms, ordered by path. */
+@property(nonatomic, readonly) NSArray *platforms;
+
+/** Event coalescing latency, in seconds. Must be set prior to startWatching:. Defaults to 1 second. */
+@property(nonatomic) NSTimeInterval latency;
+
+/** Delegate. */
+@property(weak) id<PLSimulatorPlatformWatcherDelegate> delegate;
+
+@end
@@ -0,0 +1,441 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSimulatorPlatformWatcher.h"
+
+#import "PLSimulator.h"
+#import "PLSimulatorDeviceFamily.h"
+
+/* Name of the iPhoneSimulator platform bundle */
+#define PLATFORM_NAME @"iPhoneSimulator.platform"
+
+/* The path to the iPhoneSimulator platform bundle within a developer directory */
+#define DEVELOPER_PLATFORM_PATH @"Platforms/" PLATFORM_NAME
+
+/* The path to the developer directory within an Xcode.app bundle */
+#define XCODE_BUNDLE_DEVELOPER_PATH @"Contents/Developer"
+
+/* Default event coalescing latency, in seconds */
+#define DEFAULT_LATENCY 1.0
+
+@interface PLSimulatorPlatformDiff ()
+- (id) initWithAddedPlatforms: (NSArray *) added
+             removedPlatforms: (NSArray *) removed
+             updatedPlatforms: (NSArray *) updated
+                    addedSDKs: (NSArray *) addedSDKs
+                  removedSDKs: (NSArray *) removedSDKs;
+@end
+
+@interface PLSimulatorPlatformWatcher (PrivateMethods)
+- (void) registerPlatform: (PLSimulatorPlatform *) platform atPath: (NSString *) path;
+- (void) handleEventPaths: (NSArray *) paths;
+@end
+
+/**
+ * Describes a change to the set of platforms known to a PLSimulatorPlatformWatcher.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. May be used from any thread.
+ */
+@implementation PLSimulatorPlatformDiff
+
+@synthesize addedPlatforms = _addedPlatforms;
+@synthesize removedPlatforms = _removedPlatforms;
+@synthesize updatedPlatforms = _updatedPlatforms;
+@synthesize addedSDKs = _addedSDKs;
+@synthesize removedSDKs = _removedSDKs;
+
+- (id) initWithAddedPlatforms: (NSArray *) added
+             removedPlatforms: (NSArray *) removed
+             updatedPlatforms: (NSArray *) updated
+                    addedSDKs: (NSArray *) addedSDKs
+                  removedSDKs: (NSArray *) removedSDKs
+{
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _addedPlatforms = added;
+    _removedPlatforms = removed;
+    _updatedPlatforms = updated;
+    _addedSDKs = addedSDKs;
+    _removedSDKs = removedSDKs;
+
+    return self;
+}
+
+// property getter
+- (BOOL) isEmpty {
+    return [_addedPlatforms count] == 0 && [_removedPlatforms count] == 0 && [_updatedPlatforms count] == 0;
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [NSString stringWithFormat: @"<%@: added=%@ removed=%@ updated=%@>", [self class],
+            [_addedPlatforms valueForKey: @"path"], [_removedPlatforms valueForKey: @"path"], [_updatedPlatforms valueForKey: @"path"]];
+}
+
+@end
+
+/* Return a key identifying @a sdk's meta-data, used to detect SDK changes */
+static NSString *watcher_sdk_key (PLSimulatorSDK *sdk) {
+    NSArray *codes = [[sdk.deviceFamilies valueForKey: @"deviceFamilyCode"] allObjects];
+    codes = [codes sortedArrayUsingSelector: @selector(compare:)];
+    return [NSString stringWithFormat: @"%@ %@ %@", sdk.canonicalName, sdk.version, [codes componentsJoinedByString: @","]];
+}
+
+/* Return @a platform's SDKs, keyed by watcher_sdk_key() */
+static NSDictionary *watcher_sdks_by_key (PLSimulatorPlatform *platform) {
+    NSMutableDictionary *sdks = [NSMutableDictionary dictionaryWithCapacity: [platform.sdks count]];
+    for (PLSimulatorSDK *sdk in platform.sdks)
+        [sdks setObject: sdk forKey: watcher_sdk_key(sdk)];
+    return sdks;
+}
+
+/*
+ * Return the canonical path for @a path, resolving all symlinks, as reported by FSEvents. Unlike
+ * -[NSString stringByResolvingSymlinksInPath], this does not strip a leading /private. If @a path does
+ * not exist, its nearest existing ancestor is resolved.
+ */
+static NSString *watcher_real_path (NSString *path) {
+    char resolved[PATH_MAX];
+    if (realpath([path fileSystemRepresentation], resolved) != NULL)
+        return [[NSFileManager defaultManager] stringWithFileSystemRepresentation: resolved length: strlen(resolved)];
+
+    NSString *parent = [path stringByDeletingLastPathComponent];
+    if ([parent isEqualToString: path] || [parent length] == 0)
+        return path;
+
+    return [watcher_real_path(parent) stringByAppendingPathComponent: [path lastPathComponent]];
+}
+
+/* Return YES if @a path is @a ancestor, or lies below it. Paths are compared by whole path components. */
+static BOOL watcher_path_contains (NSString *ancestor, NSString *path) {
+    if (![path hasPrefix: ancestor])
+        return NO;
+
+    if ([path length] == [ancestor length] || [ancestor hasSuffix: @"/"])
+        return YES;
+
+    return [path characterAtIndex: [ancestor length]] == '/';
+}
+
+/* Return the enclosing Xcode.app path for the platform at @a path, or nil if the platform is not within an Xcode.app bundle */
+static NSString *watcher_xcode_path (NSString *path) {
+    NSString *developerDir = [[path stringByDeletingLastPathComponent] stringByDeletingLastPathComponent];
+    if (![developerDir hasSuffix: @".app/" XCODE_BUNDLE_DEVELOPER_PATH])
+        return nil;
+
+    return [[developerDir stringByDeletingLastPathComponent] stringByDeletingLastPathComponent];
+}
+
+/*
+ * Return the paths at which a platform may have appeared, given a change at @a path: the enclosing platform bundle,
+ * if any, and any platform bundle within a developer directory or Xcode.app bundle at or directly below @a path.
+ */
+static NSSet *watcher_candidate_platform_paths (NSString *path) {
+    NSMutableSet *candidates = [NSMutableSet set];
+
+    /* Enclosing platform bundle */
+    NSArray *components = [path pathComponents];
+    NSUInteger idx = [components indexOfObject: PLATFORM_NAME];
+    if (idx != NSNotFound) {
+        [candidates addObject: [NSString pathWithComponents: [components subarrayWithRange: NSMakeRange(0, idx + 1)]]];
+        return candidates;
+    }
+
+    /* Enclosing developer directory */
+    for (NSUInteger i = [components count]; i > 0; i--) {
+        if ([[components objectAtIndex: i - 1] isEqualToString: @"Developer"]) {
+            NSString *developerDir = [NSString pathWithComponents: [components subarrayWithRange: NSMakeRange(0, i)]];
+            [candidates addObject: [developerDir stringByAppendingPathComponent: DEVELOPER_PLATFORM_PATH]];
+            break;
+        }
+    }
+
+    /* Developer directories and Xcode.app bundles at, or directly below, the changed path */
+    NSMutableArray *dirs = [NSMutableArray arrayWithObject: path];
+    for (NSString *name in [[NSFileManager defaultManager] contentsOfDirectoryAtPath: path error: NULL])
+        [dirs addObject: [path stringByAppendingPathComponent: name]];
+
+    for (NSString *dir in dirs) {
+        [candidates addObject: [dir stringByAppendingPathComponent: DEVELOPER_PLATFORM_PATH]];
+        [candidates addObject: [[dir stringByAppendingPathComponent: XCODE_BUNDLE_DEVELOPER_PATH] stringByAppendingPathComponent: DEVELOPER_PLATFORM_PATH]];
+    }
+
+    return candidates;
+}
+
+/* FSEvents callback */
+static void watcher_fsevents_callback (ConstFSEventStreamRef stream, void *info, size_t numEvents, void *eventPaths,
+                                       const FSEventStreamEventFlags eventFlags[], const FSEventStreamEventId eventIds[])
+{
+    PLSimulatorPlatformWatcher *watcher = (__bridge PLSimulatorPlatformWatcher *) info;
+    [watcher handleEventPaths: (__bridge NSArray *) eventPaths];
+}
+
+/**
+ * Watches known simulator platforms, and the directories in which new platforms may be installed, for changes.
+ *
+ * File system events are delivered via FSEvents, and coalesced over the configured latency. Only the platforms
+ * affected by a change are reloaded; a platform whose SDK meta-data is unchanged is not reported, and retains its
+ * existing PLSimulatorPlatform instance.
+ *
+ * @par Thread Safety
+ * Mutable and may not be shared across threads. The delegate is called on the run loop from which
+ * startWatching: was called.
+ */
+@implementation PLSimulatorPlatformWatcher
+
+@synthesize latency = _latency;
+@synthesize delegate = _delegate;
+
+/**
+ * Initialize a new watcher.
+ *
+ * @param platforms The initially known PLSimulatorPlatform instances, such as those returned by PLSimulatorDiscovery.
+ * @param searchRoots Directories below which newly installed platforms should be detected (eg, /Applications). May
+ * be nil, in which case only changes to the known platforms are reported.
+ */
+- (id) initWithPlatforms: (NSArray *) platforms searchRoots: (NSArray *) searchRoots {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    _platforms = [NSMutableDictionary dictionaryWithCapacity: [platforms count]];
+    _sdkSnapshots = [NSMutableDictionary dictionaryWithCapacity: [platforms count]];
+    for (PLSimulatorPlatform *platform in platforms)
+        [self registerPlatform: platform atPath: watcher_real_path(platform.path)];
+
+    NSMutableArray *roots = [NSMutableArray arrayWithCapacity: [searchRoots count]];
+    for (NSString *root in searchRoots)
+        [roots addObject: watcher_real_path(root)];
+    _searchRoots = roots;
+
+    _latency = DEFAULT_LATENCY;
+
+    return self;
+}
+
+- (void) dealloc {
+    [self stopWatching];
+}
+
+/**
+ * Start watching for changes on the current run loop. If already watching, this method does nothing.
+ *
+ * @param outError If an error occurs, upon return contains an NSError object that describes the problem.
+ * @return Returns YES on success, or NO if the event stream could not be started.
+ */
+- (BOOL) startWatching: (NSError **) outError {
+    if (_stream != NULL)
+        return YES;
+
+    /* Watch each platform's parent, so that removal of the platform itself is observed, and each search root */
+    NSMutableSet *paths = [NSMutableSet setWithArray: _searchRoots];
+    for (NSString *path in _platforms)
+        [paths addObject: [path stringByDeletingLastPathComponent]];
+
+    FSEventStreamContext context = { 0, (__bridge void *) self, NULL, NULL, NULL };
+    _stream = FSEventStreamCreate(NULL, watcher_fsevents_callback, &context, (__bridge CFArrayRef) [paths allObjects],
+                                  kFSEventStreamEventIdSinceNow, _latency,
+                                  kFSEventStreamCreateFlagUseCFTypes | kFSEventStreamCreateFlagWatchRoot);
+    if (_stream == NULL) {
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, @"Could not create the file system event stream", nil);
+        return NO;
+    }
+
+    FSEventStreamScheduleWithRunLoop(_stream, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
+    if (!FSEventStreamStart(_stream)) {
+        [self stopWatching];
+        plsimulator_populate_nserror(outError, PLSimulatorErrorOperatingSystem, @"Could not start the file system event stream", nil);
+        return NO;
+    }
+
+    return YES;
+}
+
+/**
+ * Stop watching for changes. If not watching, this method does nothing.
+ */
+- (void) stopWatching {
+    if (_stream == NULL)
+        return;
+
+    FSEventStreamStop(_stream);
+    FSEventStreamInvalidate(_stream);
+    FSEventStreamRelease(_stream);
+    _stream = NULL;
+}
+
+/**
+ * Reload the platforms affected by changes at @a paths, and detect any platforms newly installed at or directly
+ * below those paths. The delegate is not informed; this is called automatically for file system events, and may
+ * also be used to force a rescan.
+ *
+ * @param paths The changed paths.
+ * @return Returns the resulting changes, which may be empty.
+ */
+- (PLSimulatorPlatformDiff *) rescanPaths: (NSArray *) paths {
+    NSMutableSet *affected = [NSMutableSet set];
+    NSMutableSet *candidates = [NSMutableSet set];
+
+    for (NSString *rawPath in paths) {
+        NSString *path = watcher_real_path(rawPath);
+
+        /* A change within a platform affects only the platform containing it; a change above any platforms
+         * (eg, an Xcode.app bundle being removed) affects all of them */
+        NSString *container = nil;
+        for (NSString *platformPath in _platforms) {
+            if (watcher_path_contains(platformPath, path)) {
+                if (container == nil || [platformPath length] > [container length])
+                    container = platformPath;
+            } else if (watcher_path_contains(path, platformPath)) {
+                [affected addObject: platformPath];
+            }
+        }
+
+        if (container != nil)
+            [affected addObject: container];
+
+        [candidates unionSet: watcher_candidate_platform_paths(path)];
+    }
+
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSMutableArray *added = [NSMutableArray array];
+    NSMutableArray *removed = [NSMutableArray array];
+    NSMutableArray *updated = [NSMutableArray array];
+    NSMutableArray *addedSDKs = [NSMutableArray array];
+    NSMutableArray *removedSDKs = [NSMutableArray array];
+
+    /* Rebuild affected platforms */
+    for (NSString *path in affected) {
+        PLSimulatorPlatform *old = [_platforms objectForKey: path];
+        PLSimulatorPlatform *platform = nil;
+
+        NSError *error;
+        if ([fm fileExistsAtPath: path]) {
+            platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: old.xcodePath error: &error];
+            if (platform == nil)
+                NSLog(@"Dropping platform '%@', failed to reload platform SDK meta-data: %@", path, error);
+        }
+
+        if (platform == nil) {
+            [_platforms removeObjectForKey: path];
+            [_sdkSnapshots removeObjectForKey: path];
+            [removed addObject: old];
+            continue;
+        }
+
+        NSDictionary *oldSDKs = [_sdkSnapshots objectForKey: path];
+        NSDictionary *newSDKs = watcher_sdks_by_key(platform);
+        if ([[NSSet setWithArray: [oldSDKs allKeys]] isEqualToSet: [NSSet setWithArray: [newSDKs allKeys]]])
+            continue;
+
+        for (NSString *key in newSDKs) {
+            if ([oldSDKs objectForKey: key] == nil)
+                [addedSDKs addObject: [newSDKs objectForKey: key]];
+        }
+        for (NSString *key in oldSDKs) {
+            if ([newSDKs objectForKey: key] == nil)
+                [removedSDKs addObject: [oldSDKs objectForKey: key]];
+        }
+
+        [self registerPlatform: platform atPath: path];
+        [updated addObject: platform];
+    }
+
+    /* Detect newly installed platforms below the search roots */
+    for (NSString *path in candidates) {
+        if ([_platforms objectForKey: path] != nil || [affected containsObject: path] || ![fm fileExistsAtPath: path])
+            continue;
+
+        BOOL searched = NO;
+        for (NSString *root in _searchRoots) {
+            if ([path hasPrefix: [root stringByAppendingString: @"/"]])
+                searched = YES;
+        }
+        if (!searched)
+            continue;
+
+        NSError *error;
+        PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: watcher_xcode_path(path) error: &error];
+        if (platform == nil) {
+            NSLog(@"Skipping new platform '%@', failed to load platform SDK meta-data: %@", path, error);
+            continue;
+        }
+
+        [self registerPlatform: platform atPath: path];
+        [added addObject: platform];
+    }
+
+    return [[PLSimulatorPlatformDiff alloc] initWithAddedPlatforms: added
+                                                  removedPlatforms: removed
+                                                  updatedPlatforms: updated
+                                                         addedSDKs: addedSDKs
+                                                       removedSDKs: removedSDKs];
+}
+
+// property getter
+- (NSArray *) platforms {
+    NSArray *paths = [[_platforms allKeys] sortedArrayUsingSelector: @selector(compare:)];
+    return [_platforms objectsForKeys: paths notFoundMarker: [NSNull null]];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLSimulatorPlatformWatcher (PrivateMethods)
+
+/*
+ * Record @a platform as the known platform at @a path, along with a snapshot of its current SDKs. This parses
+ * the platform's SDKs, so that later changes on disk are compared against the SDKs as they were when the
+ * platform was registered.
+ */
+- (void) registerPlatform: (PLSimulatorPlatform *) platform atPath: (NSString *) path {
+    [_platforms setObject: platform forKey: path];
+    [_sdkSnapshots setObject: watcher_sdks_by_key(platform) forKey: path];
+}
+
+/* Rescan the paths reported by FSEvents, and inform the delegate of any changes */
+- (void) handleEventPaths: (NSArray *) paths {
+    PLSimulatorPlatformDiff *diff = [self rescanPaths: paths];
+    if (diff.empty)
+        return;
+
+    /* Newly found platforms must also be watched */
+    if ([diff.addedPlatforms count] > 0 && _stream != NULL) {
+        [self stopWatching];
+        if (![self startWatching: NULL])
+            NSLog(@"Could not restart platform watcher after adding %lu platform(s)", (unsigned long) [diff.addedPlatforms count]);
+    }
+
+    [_delegate platformWatcher: self didChangePlatforms: diff];
+}
+
+@end
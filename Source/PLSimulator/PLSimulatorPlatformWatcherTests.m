@@ -0,0 +1,164 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulatorPlatformWatcher.h"
+
+#import "PLSyntheticSDK.h"
+
+@interface PLSimulatorPlatformWatcherTests : PLTestCase <PLSimulatorPlatformWatcherDelegate> {
+@private
+    /** Temporary search root */
+    NSString *_root;
+
+    /** Diffs reported to the delegate */
+    NSMutableArray *_diffs;
+}
+@end
+
+@implementation PLSimulatorPlatformWatcherTests
+
+/* Return the platform path within the synthetic Xcode.app bundle named @a name */
+- (NSString *) platformPathForXcode: (NSString *) name {
+    return [[_root stringByAppendingPathComponent: name] stringByAppendingPathComponent: @"Contents/Developer/Platforms/iPhoneSimulator.platform"];
+}
+
+/* Write a synthetic platform within the Xcode.app bundle named @a name, providing @a versions */
+- (NSString *) writeXcode: (NSString *) name versions: (NSArray *) versions {
+    NSError *error;
+    NSString *path = [self platformPathForXcode: name];
+    STAssertTrue([PLSyntheticSDK writePlatformAtPath: path sdkVersions: versions error: &error], @"Could not write platform: %@", error);
+    return path;
+}
+
+- (void) setUp {
+    _root = [self temporaryDirectory];
+    _diffs = [NSMutableArray array];
+}
+
+/* Return a watcher for the platform in Xcode-A.app, providing the 5.1 SDK */
+- (PLSimulatorPlatformWatcher *) watcher {
+    NSError *error;
+    NSString *path = [self writeXcode: @"Xcode-A.app" versions: [NSArray arrayWithObject: @"5.1"]];
+    PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: [_root stringByAppendingPathComponent: @"Xcode-A.app"] error: &error];
+    STAssertNotNil(platform, @"Could not load platform: %@", error);
+
+    return [[PLSimulatorPlatformWatcher alloc] initWithPlatforms: [NSArray arrayWithObject: platform] searchRoots: [NSArray arrayWithObject: _root]];
+}
+
+- (void) testRescan {
+    PLSimulatorPlatformWatcher *watcher = [self watcher];
+    NSString *pathA = [self platformPathForXcode: @"Xcode-A.app"];
+
+    /* Platforms with unchanged SDKs are not reported */
+    STAssertTrue([watcher rescanPaths: [NSArray arrayWithObject: pathA]].empty, @"Unchanged platform was reported");
+
+    /* SDK installed */
+    [self writeXcode: @"Xcode-A.app" versions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    PLSimulatorPlatformDiff *diff = [watcher rescanPaths: [NSArray arrayWithObject: [pathA stringByAppendingPathComponent: @"Developer/SDKs"]]];
+    STAssertEquals([diff.updatedPlatforms count], (NSUInteger) 1, @"Platform update not reported: %@", diff);
+    STAssertEquals([diff.addedSDKs count], (NSUInteger) 1, @"Added SDK not reported");
+    STAssertEqualObjects([[diff.addedSDKs lastObject] version], @"6.0", @"Incorrect SDK reported");
+    STAssertEquals([diff.removedSDKs count], (NSUInteger) 0, @"Unexpected removed SDKs");
+    STAssertEqualObjects([[watcher.platforms lastObject] xcodePath], [[diff.updatedPlatforms lastObject] xcodePath], @"Xcode path was not preserved");
+
+    /* Xcode installed */
+    NSString *pathB = [self writeXcode: @"Xcode-B.app" versions: [NSArray arrayWithObject: @"7.0"]];
+    diff = [watcher rescanPaths: [NSArray arrayWithObject: _root]];
+    STAssertEquals([diff.addedPlatforms count], (NSUInteger) 1, @"Added platform not reported: %@", diff);
+    STAssertEquals([diff.updatedPlatforms count], (NSUInteger) 0, @"Unchanged platform was reported as updated");
+    STAssertTrue([[[diff.addedPlatforms lastObject] xcodePath] hasSuffix: @"Xcode-B.app"], @"Incorrect Xcode path");
+    STAssertEquals([watcher.platforms count], (NSUInteger) 2, @"Incorrect platform count");
+
+    /* Xcode removed */
+    STAssertTrue([[NSFileManager defaultManager] removeItemAtPath: [_root stringByAppendingPathComponent: @"Xcode-A.app"] error: NULL], @"Could not remove Xcode");
+    diff = [watcher rescanPaths: [NSArray arrayWithObject: _root]];
+    STAssertEquals([diff.removedPlatforms count], (NSUInteger) 1, @"Removed platform not reported: %@", diff);
+    STAssertEquals([watcher.platforms count], (NSUInteger) 1, @"Incorrect platform count");
+    STAssertTrue([[[watcher.platforms lastObject] path] hasSuffix: [pathB substringFromIndex: [_root length]]], @"Incorrect platform retained");
+}
+
+/* SDKs removed from disk must be reported, even though platform SDKs are parsed lazily */
+- (void) testRemovedSDK {
+    NSError *error;
+    NSString *pathA = [self writeXcode: @"Xcode-A.app" versions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: pathA xcodePath: [_root stringByAppendingPathComponent: @"Xcode-A.app"] error: &error];
+    STAssertNotNil(platform, @"Could not load platform: %@", error);
+
+    /* The platform's SDKs are not parsed prior to the removal */
+    PLSimulatorPlatformWatcher *watcher = [[PLSimulatorPlatformWatcher alloc] initWithPlatforms: [NSArray arrayWithObject: platform] searchRoots: nil];
+
+    NSString *sdksPath = [pathA stringByAppendingPathComponent: @"Developer/SDKs"];
+    STAssertTrue([[NSFileManager defaultManager] removeItemAtPath: [sdksPath stringByAppendingPathComponent: @"iPhoneSimulator6.0.sdk"] error: &error],
+                 @"Could not remove SDK: %@", error);
+
+    PLSimulatorPlatformDiff *diff = [watcher rescanPaths: [NSArray arrayWithObject: sdksPath]];
+    STAssertEquals([diff.updatedPlatforms count], (NSUInteger) 1, @"Platform update not reported: %@", diff);
+    STAssertEquals([diff.removedSDKs count], (NSUInteger) 1, @"Removed SDK not reported");
+    STAssertEqualObjects([[diff.removedSDKs lastObject] version], @"6.0", @"Incorrect SDK reported");
+    STAssertEquals([diff.addedSDKs count], (NSUInteger) 0, @"Unexpected added SDKs");
+}
+
+/* Paths that merely share a string prefix with a platform must not be attributed to it */
+- (void) testPathBoundaries {
+    PLSimulatorPlatformWatcher *watcher = [self watcher];
+    NSString *pathA = [self platformPathForXcode: @"Xcode-A.app"];
+    [self writeXcode: @"Xcode-A.app" versions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+
+    NSArray *unrelated = [NSArray arrayWithObjects:
+                          [pathA substringToIndex: [pathA length] - 1],
+                          [[pathA stringByAppendingString: @"-old"] stringByAppendingPathComponent: @"Developer/SDKs"],
+                          nil];
+    STAssertTrue([watcher rescanPaths: unrelated].empty, @"Unrelated paths were attributed to the platform");
+
+    PLSimulatorPlatformDiff *diff = [watcher rescanPaths: [NSArray arrayWithObject: [pathA stringByAppendingPathComponent: @"Developer/SDKs"]]];
+    STAssertEquals([diff.updatedPlatforms count], (NSUInteger) 1, @"Platform update not reported: %@", diff);
+}
+
+- (void) testEvents {
+    NSError *error;
+    PLSimulatorPlatformWatcher *watcher = [self watcher];
+    watcher.latency = 0.1;
+    watcher.delegate = self;
+    STAssertTrue([watcher startWatching: &error], @"Could not start watcher: %@", error);
+
+    [self writeXcode: @"Xcode-A.app" versions: [NSArray arrayWithObjects: @"5.1", @"6.0", nil]];
+    [self spinRunloopWithTimeout: 10.0 predicate: ^BOOL{ return [_diffs count] > 0; }];
+    [watcher stopWatching];
+
+    STAssertTrue([_diffs count] > 0, @"No change reported");
+    STAssertEquals([[[_diffs objectAtIndex: 0] updatedPlatforms] count], (NSUInteger) 1, @"Platform update not reported");
+}
+
+// from PLSimulatorPlatformWatcherDelegate protocol
+- (void) platformWatcher: (PLSimulatorPlatformWatcher *) watcher didChangePlatforms: (PLSimulatorPlatformDiff *) diff {
+    [_diffs addObject: diff];
+}
+
+@end
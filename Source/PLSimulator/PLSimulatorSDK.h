@@ -28,6 +28,8 @@
 
 #import <Cocoa/Cocoa.h>
 
+#import "PLArena.h"
+
 @interface PLSimulatorSDK : NSObject {
 @private
     /** SDK path */
@@ -55,3 +57,23 @@
 @property(readonly) NSSet *deviceFamilies;
 
 @end
+
+/** Return the pl_sdk_settings_t::device_families bit for the given UIDeviceFamily @a code. */
+#define PL_SDK_FAMILY_BIT(code) (1U << (code))
+
+/**
+ * Arena-backed SDKSettings meta-data, as returned by pl_sdk_settings_parse(). All strings are allocated
+ * from the arena supplied to pl_sdk_settings_parse(), and remain valid until that arena is freed.
+ */
+typedef struct pl_sdk_settings {
+    /** SDK version. */
+    const char *version;
+
+    /** SDK's canonical name. */
+    const char *canonical_name;
+
+    /** Supported device families, as a bitmask of PL_SDK_FAMILY_BIT() values. */
+    uint32_t device_families;
+} pl_sdk_settings_t;
+
+bool pl_sdk_settings_parse (pl_arena_t *arena, const char *sdk_path, pl_sdk_settings_t *settings);
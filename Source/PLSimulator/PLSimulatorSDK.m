@@ -30,6 +30,11 @@
 
 #import "PLSimulator.h"
 #import "PLSimulatorUtils.h"
+#import "PLSimulatorStats.h"
+
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/stat.h>
 
 /* Relative path to the setting plist */
 #define SDK_SETTINGS_PLIST @"SDKSettings.plist"
@@ -94,6 +99,7 @@ enum {
     NSFileManager *fm = [NSFileManager new];
     {
         BOOL isDir;
+        plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
         if (![fm fileExistsAtPath: _path isDirectory: &isDir] || isDir == NO) {
             NSString *desc = NSLocalizedString(@"The provided SDK path does exist or is not a directory.",
                                                @"Missing/non-directory SDK path");
@@ -187,8 +193,152 @@ enum {
         }
     }
 
+    plsimulator_stats_add(PLSimulatorCounterSDKsLoaded, 1);
     return self;
 }
 
 
 @end
+
+/*
+ * Arena-backed SDKSettings parsing.
+ */
+
+/* Copy @a string into @a arena as a NUL-terminated UTF-8 string. Returns NULL on failure. */
+static const char *pl_sdk_copy_string (pl_arena_t *arena, CFStringRef string) {
+    const char *fast = CFStringGetCStringPtr(string, kCFStringEncodingUTF8);
+    if (fast != NULL)
+        return pl_arena_strndup(arena, fast, strlen(fast));
+
+    CFIndex size = CFStringGetMaximumSizeForEncoding(CFStringGetLength(string), kCFStringEncodingUTF8) + 1;
+    char *buffer = pl_arena_alloc(arena, size);
+    if (buffer == NULL || !CFStringGetCString(string, buffer, size, kCFStringEncodingUTF8))
+        return NULL;
+
+    return buffer;
+}
+
+/* Return the value of @a key in @a dict if it is of @a type, or NULL. */
+static CFTypeRef pl_sdk_get_typed (CFDictionaryRef dict, const char *key, CFTypeID type) {
+    CFStringRef cfkey = CFStringCreateWithCStringNoCopy(NULL, key, kCFStringEncodingASCII, kCFAllocatorNull);
+    CFTypeRef value = CFDictionaryGetValue(dict, cfkey);
+    CFRelease(cfkey);
+
+    if (value == NULL || CFGetTypeID(value) != type)
+        return NULL;
+
+    return value;
+}
+
+/* Map an array of UIDeviceFamily codes (as strings or numbers) to a PL_SDK_FAMILY_BIT() mask. */
+static uint32_t pl_sdk_family_mask (CFArrayRef codes) {
+    uint32_t mask = 0;
+    for (CFIndex i = 0; i < CFArrayGetCount(codes); i++) {
+        CFTypeRef code = CFArrayGetValueAtIndex(codes, i);
+        SInt32 value;
+
+        /* As with PLSimulatorUtils, accept either strings or numbers */
+        if (CFGetTypeID(code) == CFStringGetTypeID()) {
+            value = CFStringGetIntValue(code);
+        } else if (CFGetTypeID(code) == CFNumberGetTypeID()) {
+            if (!CFNumberGetValue(code, kCFNumberSInt32Type, &value))
+                continue;
+        } else {
+            continue;
+        }
+
+        if (value == iPhoneFamily || value == iPadFamily)
+            mask |= PL_SDK_FAMILY_BIT(value);
+    }
+
+    return mask;
+}
+
+/**
+ * Parse the SDKSettings meta-data of the SDK at @a sdk_path, allocating all results from @a arena.
+ *
+ * This is a lower-level alternative to PLSimulatorSDK, intended for bulk scans of many SDKs; the results
+ * of any number of parses may be released with a single call to pl_arena_free(). The file contents are
+ * also read into the arena. The same defaults are applied as by PLSimulatorSDK::initWithPath:error:.
+ *
+ * @param arena The arena from which results will be allocated.
+ * @param sdk_path Simulator SDK path.
+ * @param settings On success, will be populated with the parsed meta-data.
+ *
+ * @return Returns true on success, or false if the SDK meta-data could not be read or is invalid.
+ */
+bool pl_sdk_settings_parse (pl_arena_t *arena, const char *sdk_path, pl_sdk_settings_t *settings) {
+    memset(settings, 0, sizeof(*settings));
+
+    /* Read the settings file into the arena */
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/SDKSettings.plist", sdk_path) >= (int) sizeof(path))
+        return false;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t length = (size_t) sb.st_size;
+    uint8_t *bytes = pl_arena_alloc(arena, length);
+    size_t nread = 0;
+    while (bytes != NULL && nread < length) {
+        ssize_t ret = read(fd, bytes + nread, length - nread);
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            break;
+
+        nread += ret;
+    }
+    close(fd);
+
+    if (bytes == NULL || nread != length)
+        return false;
+
+    /* Parse the property list */
+    CFDataRef data = CFDataCreateWithBytesNoCopy(NULL, bytes, length, kCFAllocatorNull);
+    CFPropertyListRef plist = CFPropertyListCreateWithData(NULL, data, kCFPropertyListImmutable, NULL, NULL);
+    CFRelease(data);
+
+    if (plist == NULL)
+        return false;
+
+    bool result = false;
+    if (CFGetTypeID(plist) == CFDictionaryGetTypeID()) {
+        CFStringRef version = pl_sdk_get_typed(plist, "Version", CFStringGetTypeID());
+        CFStringRef canonicalName = pl_sdk_get_typed(plist, "CanonicalName", CFStringGetTypeID());
+
+        if (version != NULL && canonicalName != NULL) {
+            settings->version = pl_sdk_copy_string(arena, version);
+            settings->canonical_name = pl_sdk_copy_string(arena, canonicalName);
+
+            /* Fetch the supported device families, using the same precedence as PLSimulatorSDK */
+            CFArrayRef devices = pl_sdk_get_typed(plist, "UIDeviceFamily", CFArrayGetTypeID());
+            if (devices == NULL) {
+                CFDictionaryRef defaults = pl_sdk_get_typed(plist, "DefaultProperties", CFDictionaryGetTypeID());
+                if (defaults != NULL)
+                    devices = pl_sdk_get_typed(defaults, "SUPPORTED_DEVICE_FAMILIES", CFArrayGetTypeID());
+            }
+
+            if (devices != NULL)
+                settings->device_families = pl_sdk_family_mask(devices);
+
+            /* If no valid settings, assume that this is a <3.2 SDK and it supports the iPhone family */
+            if (settings->device_families == 0)
+                settings->device_families = PL_SDK_FAMILY_BIT(iPhoneFamily);
+
+            result = (settings->version != NULL && settings->canonical_name != NULL);
+        }
+    }
+
+    CFRelease(plist);
+    return result;
+}
@@ -31,6 +31,8 @@
 #import "PLSimulator.h"
 #import "PLSimulatorSDK.h"
 
+#import "iPhoneSimulatorRemoteClient.h"
+
 @interface PLSimulatorSDKTests : PLTestCase
 @end
 
@@ -57,5 +59,26 @@
 
 }
 
+- (void) testArenaParse {
+    pl_arena_t arena;
+    pl_arena_init(&arena, 0);
+
+    pl_sdk_settings_t legacy;
+    STAssertTrue(pl_sdk_settings_parse(&arena, [[self pathForResource: @"3.1.sdk"] fileSystemRepresentation], &legacy), @"Could not read SDK meta-data");
+    STAssertEquals(strcmp(legacy.version, "3.1"), 0, @"Incorrect version");
+    STAssertEquals(strcmp(legacy.canonical_name, "iphonesimulator3.1"), 0, @"Incorrect canonical name");
+    STAssertEquals(legacy.device_families, PL_SDK_FAMILY_BIT(DTiPhoneSimulatoriPhoneFamily), @"Legacy SDK should default to iPhone support");
+
+    pl_sdk_settings_t families;
+    STAssertTrue(pl_sdk_settings_parse(&arena, [[self pathForResource: @"3.2.sdk"] fileSystemRepresentation], &families), @"Could not read SDK meta-data");
+    STAssertEquals(families.device_families, PL_SDK_FAMILY_BIT(DTiPhoneSimulatoriPhoneFamily) | PL_SDK_FAMILY_BIT(DTiPhoneSimulatoriPadFamily),
+                   @"SDK does not include iPhone and iPad support");
+
+    pl_sdk_settings_t missing;
+    STAssertFalse(pl_sdk_settings_parse(&arena, "/nonexistent.sdk", &missing), @"Parsing a missing SDK should fail");
+
+    pl_arena_free(&arena);
+}
+
 
 @end
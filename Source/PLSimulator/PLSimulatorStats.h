@@ -0,0 +1,155 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <mach/mach_time.h>
+
+/**
+ * Runtime counters maintained by the PLSimulator library.
+ * @ingroup enums
+ */
+typedef enum {
+    /** PLExecutableBinary parse attempts. */
+    PLSimulatorCounterBinaryParseAttempts = 0,
+
+    /** PLExecutableBinary instances successfully parsed. */
+    PLSimulatorCounterBinariesParsed,
+
+    /** Binary files mapped by PLUniversalBinary. */
+    PLSimulatorCounterBinariesMapped,
+
+    /** Total size of the binary files mapped by PLUniversalBinary, in bytes. */
+    PLSimulatorCounterBytesMapped,
+
+    /** Code pages hashed during PLExecutableBinary code signature verification. */
+    PLSimulatorCounterCodePagesHashed,
+
+    /** File system existence probes (fileExistsAtPath:) made by the library. */
+    PLSimulatorCounterFileProbes,
+
+    /** PLSimulatorPlatform load attempts. */
+    PLSimulatorCounterPlatformLoadAttempts,
+
+    /** PLSimulatorPlatform instances successfully loaded. */
+    PLSimulatorCounterPlatformsLoaded,
+
+    /** PLSimulatorSDK instances successfully loaded. */
+    PLSimulatorCounterSDKsLoaded,
+
+    /** Probe and query results considered by PLSimulatorDiscovery. */
+    PLSimulatorCounterDiscoveryCandidates,
+
+    /** Discovery results skipped as having already been processed. */
+    PLSimulatorCounterDiscoveryDuplicates,
+
+    /** Discovery results rejected as their platform meta-data could not be loaded. */
+    PLSimulatorCounterDiscoveryRejectedInvalid,
+
+    /** Discovery results rejected as not matching the query requirements. */
+    PLSimulatorCounterDiscoveryRejectedRequirements,
+
+    /** Discovery results matching the query requirements. */
+    PLSimulatorCounterDiscoveryMatches,
+
+    /** PLDylibPrefetcher closures found in the closure cache. */
+    PLSimulatorCounterPrefetchCacheHits,
+
+    /** PLDylibPrefetcher closures not found in the closure cache. */
+    PLSimulatorCounterPrefetchCacheMisses,
+
+    /** Files digested by PLBundleManifest. */
+    PLSimulatorCounterManifestFilesDigested,
+
+    /** Total size of the files digested by PLBundleManifest, in bytes. */
+    PLSimulatorCounterManifestBytesDigested,
+
+    /** Binaries thinned by the bundler. */
+    PLSimulatorCounterBundlerBinariesThinned,
+
+    /** Bytes saved by the bundler's architecture thinning. */
+    PLSimulatorCounterBundlerBytesSaved,
+
+    /** The number of counters. Not a valid counter. */
+    PLSimulatorCounterCount
+} PLSimulatorCounter;
+
+/**
+ * Runtime histograms maintained by the PLSimulator library. Values are recorded into power-of-two buckets.
+ * @ingroup enums
+ */
+typedef enum {
+    /** PLExecutableBinary parse time, in nanoseconds. */
+    PLSimulatorHistogramBinaryParseTime = 0,
+
+    /** Size of the binary files mapped by PLUniversalBinary, in bytes. */
+    PLSimulatorHistogramMappedFileSize,
+
+    /** PLSimulatorPlatform load time, including all SDKs, in nanoseconds. */
+    PLSimulatorHistogramPlatformLoadTime,
+
+    /** Size of the files digested by PLBundleManifest, in bytes. */
+    PLSimulatorHistogramManifestFileSize,
+
+    /** The number of histograms. Not a valid histogram. */
+    PLSimulatorHistogramCount
+} PLSimulatorHistogram;
+
+/** Number of buckets in each histogram. Bucket 0 holds the value 0; bucket n holds values in [2^(n-1), 2^n). */
+#define PLSIMULATOR_HISTOGRAM_BUCKETS 65
+
+void plsimulator_stats_add (PLSimulatorCounter counter, uint64_t value);
+void plsimulator_stats_record (PLSimulatorHistogram histogram, uint64_t value);
+uint64_t plsimulator_stats_abs_to_ns (uint64_t abs);
+
+@interface PLSimulatorStats : NSObject {
+@private
+    /** Counter values. */
+    uint64_t _counters[PLSimulatorCounterCount];
+
+    /** Histogram bucket counts. */
+    uint64_t _buckets[PLSimulatorHistogramCount][PLSIMULATOR_HISTOGRAM_BUCKETS];
+
+    /** Histogram value totals. */
+    uint64_t _sums[PLSimulatorHistogramCount];
+}
+
++ (PLSimulatorStats *) snapshot;
++ (PLSimulatorStats *) snapshotAndReset;
++ (void) reset;
+
++ (NSString *) nameForCounter: (PLSimulatorCounter) counter;
++ (NSString *) nameForHistogram: (PLSimulatorHistogram) histogram;
+
+- (uint64_t) valueForCounter: (PLSimulatorCounter) counter;
+- (uint64_t) countForHistogram: (PLSimulatorHistogram) histogram;
+- (uint64_t) sumForHistogram: (PLSimulatorHistogram) histogram;
+- (uint64_t) countForHistogram: (PLSimulatorHistogram) histogram bucket: (NSUInteger) bucket;
+
+- (NSString *) JSONRepresentation;
+
+@end
@@ -0,0 +1,377 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSimulatorStats.h"
+
+#import <pthread.h>
+
+/*
+ * Per-thread statistics. Each thread increments only its own block, and snapshots sum all blocks under
+ * stats_lock. Because a snapshot may read a block while its thread is writing it, all accesses to a live
+ * block's values are relaxed atomics. These impose no ordering, and as each block has a single writer, updates
+ * are a plain load and store rather than a locked read-modify-write.
+ */
+typedef struct stats_block {
+    /** Counter values. */
+    uint64_t counters[PLSimulatorCounterCount];
+
+    /** Histogram bucket counts. */
+    uint64_t buckets[PLSimulatorHistogramCount][PLSIMULATOR_HISTOGRAM_BUCKETS];
+
+    /** Histogram value totals. */
+    uint64_t sums[PLSimulatorHistogramCount];
+
+    /** Live block list linkage. */
+    struct stats_block *prev;
+    struct stats_block *next;
+} stats_block_t;
+
+/* Counter names, as used in the JSON representation. Must be kept in sync with PLSimulatorCounter. */
+static const char *counter_names[PLSimulatorCounterCount] = {
+    "binary_parse_attempts",
+    "binaries_parsed",
+    "binaries_mapped",
+    "bytes_mapped",
+    "code_pages_hashed",
+    "file_probes",
+    "platform_load_attempts",
+    "platforms_loaded",
+    "sdks_loaded",
+    "discovery_candidates",
+    "discovery_duplicates",
+    "discovery_rejected_invalid",
+    "discovery_rejected_requirements",
+    "discovery_matches",
+    "prefetch_cache_hits",
+    "prefetch_cache_misses",
+    "manifest_files_digested",
+    "manifest_bytes_digested",
+    "bundler_binaries_thinned",
+    "bundler_bytes_saved",
+};
+
+/* Histogram names, as used in the JSON representation. Must be kept in sync with PLSimulatorHistogram. */
+static const char *histogram_names[PLSimulatorHistogramCount] = {
+    "binary_parse_ns",
+    "mapped_file_bytes",
+    "platform_load_ns",
+    "manifest_file_bytes",
+};
+
+/* Protects the live block list, the retired totals, and the reset baseline */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Thread-local block key */
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+
+/* Blocks of all running threads that have recorded statistics */
+static stats_block_t *stats_live = NULL;
+
+/* Totals of all exited threads */
+static stats_block_t stats_retired;
+
+/* Totals as of the last reset */
+static stats_block_t stats_baseline;
+
+/* Add @a delta to the live block value at @a value. Must only be called by the block's owning thread. */
+static inline void stats_value_add (uint64_t *value, uint64_t delta) {
+    __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+}
+
+/*
+ * Add the values of @a src to @a dest. The list linkage is not modified. @a src may be a live block that is
+ * concurrently updated by its thread; @a dest must be protected by stats_lock.
+ */
+static void stats_block_merge (stats_block_t *dest, const stats_block_t *src) {
+    for (int i = 0; i < PLSimulatorCounterCount; i++)
+        dest->counters[i] += __atomic_load_n(&src->counters[i], __ATOMIC_RELAXED);
+
+    for (int h = 0; h < PLSimulatorHistogramCount; h++) {
+        dest->sums[h] += __atomic_load_n(&src->sums[h], __ATOMIC_RELAXED);
+        for (int b = 0; b < PLSIMULATOR_HISTOGRAM_BUCKETS; b++)
+            dest->buckets[h][b] += __atomic_load_n(&src->buckets[h][b], __ATOMIC_RELAXED);
+    }
+}
+
+/* Thread exit handler; folds the exiting thread's block into the retired totals */
+static void stats_thread_exit (void *value) {
+    stats_block_t *block = value;
+
+    pthread_mutex_lock(&stats_lock);
+    stats_block_merge(&stats_retired, block);
+
+    if (block->prev != NULL)
+        block->prev->next = block->next;
+    else
+        stats_live = block->next;
+
+    if (block->next != NULL)
+        block->next->prev = block->prev;
+    pthread_mutex_unlock(&stats_lock);
+
+    free(block);
+}
+
+static void stats_key_init (void) {
+    pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+/* Return the calling thread's block, allocating and registering it if necessary. Returns NULL on allocation failure. */
+static stats_block_t *stats_thread_block (void) {
+    pthread_once(&stats_key_once, stats_key_init);
+
+    stats_block_t *block = pthread_getspecific(stats_key);
+    if (block != NULL)
+        return block;
+
+    block = calloc(1, sizeof(stats_block_t));
+    if (block == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&stats_lock);
+    block->next = stats_live;
+    if (stats_live != NULL)
+        stats_live->prev = block;
+    stats_live = block;
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_setspecific(stats_key, block);
+    return block;
+}
+
+/* Populate @a totals with the totals across all threads. Must be called with stats_lock held. */
+static void stats_totals (stats_block_t *totals) {
+    memset(totals, 0, sizeof(*totals));
+    stats_block_merge(totals, &stats_retired);
+    for (stats_block_t *block = stats_live; block != NULL; block = block->next)
+        stats_block_merge(totals, block);
+}
+
+/**
+ * Add @a value to @a counter.
+ *
+ * Counters are maintained per-thread, and this function does not acquire any locks once the calling
+ * thread has recorded its first value.
+ *
+ * @param counter The counter to increment.
+ * @param value The value to add.
+ */
+void plsimulator_stats_add (PLSimulatorCounter counter, uint64_t value) {
+    stats_block_t *block = stats_thread_block();
+    if (block != NULL)
+        stats_value_add(&block->counters[counter], value);
+}
+
+/**
+ * Record @a value in @a histogram.
+ *
+ * @param histogram The histogram to update.
+ * @param value The value to record.
+ */
+void plsimulator_stats_record (PLSimulatorHistogram histogram, uint64_t value) {
+    stats_block_t *block = stats_thread_block();
+    if (block == NULL)
+        return;
+
+    NSUInteger bucket = (value == 0) ? 0 : 64 - __builtin_clzll(value);
+    stats_value_add(&block->buckets[histogram][bucket], 1);
+    stats_value_add(&block->sums[histogram], value);
+}
+
+/**
+ * Convert a mach_absolute_time() interval to nanoseconds. This is the single timebase conversion used by the
+ * timing histograms, the catalog scanner, dylib graphs and the benchmarks.
+ */
+uint64_t plsimulator_stats_abs_to_ns (uint64_t abs) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+
+    return abs * timebase.numer / timebase.denom;
+}
+
+@interface PLSimulatorStats (PrivateMethods)
+- (id) initWithTotals: (const stats_block_t *) totals baseline: (const stats_block_t *) baseline;
+@end
+
+/**
+ * An immutable snapshot of the PLSimulator library's runtime counters and histograms.
+ *
+ * Statistics are recorded per-thread, and summed when a snapshot is taken. Values recorded concurrently
+ * with a snapshot may or may not be included in it. Reset does not modify the per-thread values; instead,
+ * later snapshots report values relative to the totals at the time of the reset.
+ *
+ * @par Thread Safety
+ * Immutable and thread-safe. The class methods may be called from any thread.
+ */
+@implementation PLSimulatorStats
+
+/**
+ * Return a snapshot of all statistics recorded since the last reset.
+ */
++ (PLSimulatorStats *) snapshot {
+    stats_block_t totals;
+
+    pthread_mutex_lock(&stats_lock);
+    stats_totals(&totals);
+    PLSimulatorStats *result = [[self alloc] initWithTotals: &totals baseline: &stats_baseline];
+    pthread_mutex_unlock(&stats_lock);
+
+    return result;
+}
+
+/**
+ * Return a snapshot of all statistics recorded since the last reset, and reset all statistics. No values are
+ * lost between the snapshot and the reset.
+ */
++ (PLSimulatorStats *) snapshotAndReset {
+    stats_block_t totals;
+
+    pthread_mutex_lock(&stats_lock);
+    stats_totals(&totals);
+    PLSimulatorStats *result = [[self alloc] initWithTotals: &totals baseline: &stats_baseline];
+    stats_baseline = totals;
+    pthread_mutex_unlock(&stats_lock);
+
+    return result;
+}
+
+/**
+ * Reset all statistics.
+ */
++ (void) reset {
+    [self snapshotAndReset];
+}
+
+/**
+ * Return the JSON name of @a counter.
+ */
++ (NSString *) nameForCounter: (PLSimulatorCounter) counter {
+    return [NSString stringWithUTF8String: counter_names[counter]];
+}
+
+/**
+ * Return the JSON name of @a histogram.
+ */
++ (NSString *) nameForHistogram: (PLSimulatorHistogram) histogram {
+    return [NSString stringWithUTF8String: histogram_names[histogram]];
+}
+
+/**
+ * Return the value of @a counter.
+ */
+- (uint64_t) valueForCounter: (PLSimulatorCounter) counter {
+    return _counters[counter];
+}
+
+/**
+ * Return the number of values recorded in @a histogram.
+ */
+- (uint64_t) countForHistogram: (PLSimulatorHistogram) histogram {
+    uint64_t count = 0;
+    for (NSUInteger b = 0; b < PLSIMULATOR_HISTOGRAM_BUCKETS; b++)
+        count += _buckets[histogram][b];
+    return count;
+}
+
+/**
+ * Return the sum of all values recorded in @a histogram.
+ */
+- (uint64_t) sumForHistogram: (PLSimulatorHistogram) histogram {
+    return _sums[histogram];
+}
+
+/**
+ * Return the number of values recorded in @a bucket of @a histogram. Bucket 0 holds the value 0, and
+ * bucket n holds values in [2^(n-1), 2^n).
+ */
+- (uint64_t) countForHistogram: (PLSimulatorHistogram) histogram bucket: (NSUInteger) bucket {
+    return _buckets[histogram][bucket];
+}
+
+/**
+ * Return a single-line JSON object containing all counters, and the count, sum, and non-empty buckets of
+ * each histogram. Buckets are keyed by their lower bound.
+ */
+- (NSString *) JSONRepresentation {
+    NSMutableArray *counters = [NSMutableArray arrayWithCapacity: PLSimulatorCounterCount];
+    for (int i = 0; i < PLSimulatorCounterCount; i++)
+        [counters addObject: [NSString stringWithFormat: @"\"%s\": %llu", counter_names[i], (unsigned long long) _counters[i]]];
+
+    NSMutableArray *histograms = [NSMutableArray arrayWithCapacity: PLSimulatorHistogramCount];
+    for (int h = 0; h < PLSimulatorHistogramCount; h++) {
+        NSMutableArray *buckets = [NSMutableArray array];
+        for (int b = 0; b < PLSIMULATOR_HISTOGRAM_BUCKETS; b++) {
+            if (_buckets[h][b] == 0)
+                continue;
+
+            uint64_t lower = (b == 0) ? 0 : (1ULL << (b - 1));
+            [buckets addObject: [NSString stringWithFormat: @"\"%llu\": %llu", (unsigned long long) lower, (unsigned long long) _buckets[h][b]]];
+        }
+
+        [histograms addObject: [NSString stringWithFormat: @"\"%s\": {\"count\": %llu, \"sum\": %llu, \"buckets\": {%@}}", histogram_names[h],
+                                (unsigned long long) [self countForHistogram: h], (unsigned long long) _sums[h], [buckets componentsJoinedByString: @", "]]];
+    }
+
+    return [NSString stringWithFormat: @"{\"counters\": {%@}, \"histograms\": {%@}}",
+            [counters componentsJoinedByString: @", "], [histograms componentsJoinedByString: @", "]];
+}
+
+// from NSObject protocol
+- (NSString *) description {
+    return [self JSONRepresentation];
+}
+
+@end
+
+/**
+ * @internal
+ */
+@implementation PLSimulatorStats (PrivateMethods)
+
+/* Initialize with the difference between @a totals and @a baseline */
+- (id) initWithTotals: (const stats_block_t *) totals baseline: (const stats_block_t *) baseline {
+    if ((self = [super init]) == nil)
+        return nil;
+
+    for (int i = 0; i < PLSimulatorCounterCount; i++)
+        _counters[i] = totals->counters[i] - baseline->counters[i];
+
+    for (int h = 0; h < PLSimulatorHistogramCount; h++) {
+        _sums[h] = totals->sums[h] - baseline->sums[h];
+        for (int b = 0; b < PLSIMULATOR_HISTOGRAM_BUCKETS; b++)
+            _buckets[h][b] = totals->buckets[h][b] - baseline->buckets[h][b];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,121 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLTestCase.h"
+
+#import "PLSimulatorStats.h"
+
+@interface PLSimulatorStatsTests : PLTestCase @end
+
+@implementation PLSimulatorStatsTests
+
+- (void) setUp {
+    [PLSimulatorStats reset];
+}
+
+/* Values recorded on exited and live threads must both be included */
+- (void) testThreadedCounters {
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    for (int i = 0; i < 8; i++) {
+        dispatch_group_async(group, queue, ^{
+            for (int j = 0; j < 1000; j++)
+                plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
+        });
+    }
+
+    [NSThread detachNewThreadSelector: @selector(recordOnThread) toTarget: self withObject: nil];
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    dispatch_release(group);
+
+    __block PLSimulatorStats *stats = nil;
+    [self spinRunloopWithTimeout: 5.0 predicate: ^BOOL{
+        stats = [PLSimulatorStats snapshot];
+        return [stats valueForCounter: PLSimulatorCounterFileProbes] == 8000 && [stats valueForCounter: PLSimulatorCounterBytesMapped] == 42;
+    }];
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterFileProbes], (uint64_t) 8000, @"Incorrect counter value");
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterBytesMapped], (uint64_t) 42, @"Exited thread's values were lost");
+}
+
+- (void) recordOnThread {
+    plsimulator_stats_add(PLSimulatorCounterBytesMapped, 42);
+}
+
+- (void) testHistogram {
+    plsimulator_stats_record(PLSimulatorHistogramMappedFileSize, 0);
+    plsimulator_stats_record(PLSimulatorHistogramMappedFileSize, 1);
+    plsimulator_stats_record(PLSimulatorHistogramMappedFileSize, 3);
+    plsimulator_stats_record(PLSimulatorHistogramMappedFileSize, 4096);
+
+    PLSimulatorStats *stats = [PLSimulatorStats snapshot];
+    STAssertEquals([stats countForHistogram: PLSimulatorHistogramMappedFileSize], (uint64_t) 4, @"Incorrect count");
+    STAssertEquals([stats sumForHistogram: PLSimulatorHistogramMappedFileSize], (uint64_t) 4100, @"Incorrect sum");
+    STAssertEquals([stats countForHistogram: PLSimulatorHistogramMappedFileSize bucket: 0], (uint64_t) 1, @"Incorrect zero bucket");
+    STAssertEquals([stats countForHistogram: PLSimulatorHistogramMappedFileSize bucket: 1], (uint64_t) 1, @"Incorrect [1, 2) bucket");
+    STAssertEquals([stats countForHistogram: PLSimulatorHistogramMappedFileSize bucket: 2], (uint64_t) 1, @"Incorrect [2, 4) bucket");
+    STAssertEquals([stats countForHistogram: PLSimulatorHistogramMappedFileSize bucket: 13], (uint64_t) 1, @"Incorrect [4096, 8192) bucket");
+}
+
+- (void) testReset {
+    plsimulator_stats_add(PLSimulatorCounterSDKsLoaded, 3);
+
+    PLSimulatorStats *stats = [PLSimulatorStats snapshotAndReset];
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 3, @"Incorrect value");
+
+    stats = [PLSimulatorStats snapshot];
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 0, @"Counter was not reset");
+
+    plsimulator_stats_add(PLSimulatorCounterSDKsLoaded, 1);
+    stats = [PLSimulatorStats snapshot];
+    STAssertEquals([stats valueForCounter: PLSimulatorCounterSDKsLoaded], (uint64_t) 1, @"Incorrect value after reset");
+}
+
+- (void) testJSON {
+    plsimulator_stats_add(PLSimulatorCounterPlatformsLoaded, 2);
+    plsimulator_stats_record(PLSimulatorHistogramPlatformLoadTime, 1000);
+
+    NSError *error;
+    NSData *json = [[[PLSimulatorStats snapshot] JSONRepresentation] dataUsingEncoding: NSUTF8StringEncoding];
+    Class serialization = NSClassFromString(@"NSJSONSerialization");
+    if (serialization == nil)
+        return;
+
+    NSDictionary *dict = [serialization JSONObjectWithData: json options: 0 error: &error];
+    STAssertNotNil(dict, @"Invalid JSON output: %@", error);
+
+    NSDictionary *counters = [dict objectForKey: @"counters"];
+    STAssertEquals([counters count], (NSUInteger) PLSimulatorCounterCount, @"Missing counters");
+    STAssertEqualObjects([counters objectForKey: [PLSimulatorStats nameForCounter: PLSimulatorCounterPlatformsLoaded]], [NSNumber numberWithInt: 2], @"Incorrect value");
+
+    NSDictionary *histogram = [[dict objectForKey: @"histograms"] objectForKey: [PLSimulatorStats nameForHistogram: PLSimulatorHistogramPlatformLoadTime]];
+    STAssertEqualObjects([histogram objectForKey: @"count"], [NSNumber numberWithInt: 1], @"Incorrect count");
+    STAssertEqualObjects([[histogram objectForKey: @"buckets"] objectForKey: @"512"], [NSNumber numberWithInt: 1], @"Incorrect bucket");
+}
+
+@end
@@ -30,6 +30,8 @@
 
 #import "PLExecutableBinary.h"
 
+#import <mach-o/fat.h>
+
 @interface PLUniversalBinary : NSObject {
 @private
     /** Path to binary */
@@ -37,6 +39,15 @@
 
     /** All Mach-O executables found within the binary */
     NSArray *_executables;
+
+    /** The fat_arch records (in file byte order) for each entry in _executables, or NSNull if the binary is not universal */
+    NSArray *_fatArchs;
+
+    /** The mapped binary data */
+    NSData *_mapped;
+
+    /** YES if the binary is a universal binary */
+    BOOL _universal;
 }
 
 + (id) binaryWithPath: (NSString *) path error: (NSError **) outError;
@@ -45,6 +56,17 @@
 
 - (PLExecutableBinary *) executableMatchingCurrentArchitecture;
 
+- (BOOL) fatArch: (struct fat_arch *) fatArch forExecutable: (PLExecutableBinary *) executable;
+
+/** Path to the binary. */
+@property(nonatomic, readonly) NSString *path;
+
+/** YES if the binary is a universal (fat) binary, NO if it is a non-universal Mach-O file. */
+@property(nonatomic, readonly, getter=isUniversal) BOOL universal;
+
+/** The total size of the binary file, in bytes. */
+@property(nonatomic, readonly) uint64_t fileSize;
+
 /** All valid Mach-O executables found within the binary, as an ordered array of PLExecutableBinary instances. The array
  * will be ordered to match the in-file ordering. */
 @property(nonatomic, readonly) NSArray *executables;
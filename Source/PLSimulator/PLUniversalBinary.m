@@ -32,6 +32,7 @@
 #import "PLUniversalBinary.h"
 #import "PLSimulator.h"
 #import "PLMachO.h"
+#import "PLSimulatorStats.h"
 
 #import <dlfcn.h>
 
@@ -46,6 +47,13 @@
 #import <mach-o/loader.h>
 #import <mach-o/fat.h>
 
+/**
+ * Associated object key under which zero-copy architecture slices retain their backing mapped file. Only the key's
+ * address is used; associations are per-object and synchronized by the runtime, so slices created concurrently
+ * on different threads do not interfere.
+ */
+static char slice_mapping_key;
+
 /**
  * @internal
  *
@@ -57,6 +65,8 @@
 @implementation PLUniversalBinary
 
 @synthesize executables = _executables;
+@synthesize path = _path;
+@synthesize universal = _universal;
 
 /**
  * Create and initialize a new instance with the provided binary path.
@@ -94,6 +104,7 @@
     /* Verify that the path exists */
     NSFileManager *fm = [NSFileManager new];
     BOOL isDir;
+    plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
     if (![fm fileExistsAtPath: _path isDirectory: &isDir] || isDir == YES) {
         NSString *descFmt = NSLocalizedString(@"The provided library path '%@' does not exist or is a directory.",
                                            @"Missing/non-directory library path");
@@ -112,6 +123,11 @@
         
         return nil;
     }
+    _mapped = mapped;
+
+    plsimulator_stats_add(PLSimulatorCounterBinariesMapped, 1);
+    plsimulator_stats_add(PLSimulatorCounterBytesMapped, [mapped length]);
+    plsimulator_stats_record(PLSimulatorHistogramMappedFileSize, [mapped length]);
 
     /* Configure parser */
     macho_input_t input;
@@ -153,6 +169,7 @@
     
     /* Parse out executables available in the universal file. */
     NSMutableArray *executableData = [NSMutableArray array];
+    NSMutableArray *fatArchData = [NSMutableArray array];
     if (universal) {
         uint32_t nfat = OSSwapBigToHostInt32(fat_header->nfat_arch);
         const struct fat_arch *archs = pl_macho_offset(&input, fat_header, sizeof(struct fat_header), sizeof(struct fat_arch));
@@ -184,21 +201,24 @@
              * data from being deallocated out from underneath us. In theory there is a private API internal
              * to NSData that will do exactly this, but there are no guarantees regarding when it will be used */
             NSData *data = [NSData dataWithBytesNoCopy: (void *) arch_input.data length: arch_input.length freeWhenDone: NO];
-            static const char *key = "key";
-            objc_setAssociatedObject(data, &key, mapped, OBJC_ASSOCIATION_RETAIN);
+            objc_setAssociatedObject(data, &slice_mapping_key, mapped, OBJC_ASSOCIATION_RETAIN);
         
             [executableData addObject: data];
+            [fatArchData addObject: [NSData dataWithBytes: arch length: sizeof(*arch)]];
         }        
     } else {
         /* Only one executable */
         [executableData addObject: mapped];
+        [fatArchData addObject: [NSNull null]];
     }
     
     /* Parse out the executable data */
     NSMutableArray *executables = [NSMutableArray arrayWithCapacity: [executableData count]];
+    NSMutableArray *fatArchs = [NSMutableArray arrayWithCapacity: [executableData count]];
     
-    for (NSData *data in executableData) {
+    for (NSUInteger i = 0; i < [executableData count]; i++) {
         NSError *error;
+        NSData *data = [executableData objectAtIndex: i];
         PLExecutableBinary *binary = [PLExecutableBinary binaryWithPath: _path data: data error: &error];
         if (binary == nil) {
             NSLog(@"Skipping invalid member of universal binary: %@", error);
@@ -206,9 +226,12 @@
         }
 
         [executables addObject: binary];
+        [fatArchs addObject: [fatArchData objectAtIndex: i]];
     }
     
     _executables = executables;
+    _fatArchs = fatArchs;
+    _universal = universal;
 
     return self;
 }
@@ -253,6 +276,39 @@
     return matchedExec;
 }
 
+/**
+ * Fetch the universal binary architecture record for @a executable.
+ *
+ * @param fatArch On success, will be populated with the host byte order fat_arch record describing @a executable.
+ * @param executable An executable vended by the receiver.
+ *
+ * @return Returns YES on success, or NO if the receiver is not a universal binary or @a executable was not vended
+ * by the receiver.
+ */
+- (BOOL) fatArch: (struct fat_arch *) fatArch forExecutable: (PLExecutableBinary *) executable {
+    NSUInteger idx = [_executables indexOfObjectIdenticalTo: executable];
+    if (idx == NSNotFound)
+        return NO;
+
+    id archData = [_fatArchs objectAtIndex: idx];
+    if (archData == [NSNull null])
+        return NO;
+
+    const struct fat_arch *arch = [archData bytes];
+    fatArch->cputype = OSSwapBigToHostInt32(arch->cputype);
+    fatArch->cpusubtype = OSSwapBigToHostInt32(arch->cpusubtype);
+    fatArch->offset = OSSwapBigToHostInt32(arch->offset);
+    fatArch->size = OSSwapBigToHostInt32(arch->size);
+    fatArch->align = OSSwapBigToHostInt32(arch->align);
+
+    return YES;
+}
+
+// property getter
+- (uint64_t) fileSize {
+    return [_mapped length];
+}
+
 /**
  * Load the binary represented by the receiver using dlopen().
  *
@@ -280,6 +336,7 @@
                 for (NSString *rpath in rpaths) {
                     NSString *newPath = [dylib stringByReplacingOccurrencesOfString: @"@rpath" 
                                                                          withString: rpath];
+                    plsimulator_stats_add(PLSimulatorCounterFileProbes, 1);
                     if ([fm fileExistsAtPath: newPath]) {
                         dylib = newPath;
                         break;
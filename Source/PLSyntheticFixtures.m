@@ -0,0 +1,109 @@
+/*
+ * Author: Landon Fuller <landonf@plausible.coop>
+ *
+ * Copyright (c) 2010-2012 Plausible Labs Cooperative, Inc.
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#import "PLSyntheticFixtures.h"
+
+#import "PLSimulatorPlatform.h"
+#import "PLSimulatorApplication.h"
+
+#import "PLSyntheticSDK.h"
+#import "PLSyntheticApplication.h"
+
+@implementation PLTestCase (PLSyntheticFixtures)
+
+/**
+ * Write and load a synthetic platform providing the given SDK versions. The platform is written to
+ * name/iPhoneSimulator.platform within the test's temporary directory.
+ *
+ * @param name Name of the directory containing the platform.
+ * @param versions SDK versions to be provided by the platform.
+ */
+- (PLSimulatorPlatform *) platformWithName: (NSString *) name sdkVersions: (NSArray *) versions {
+    NSError *error;
+    NSString *path = [[[self temporaryDirectory] stringByAppendingPathComponent: name] stringByAppendingPathComponent: @"iPhoneSimulator.platform"];
+    STAssertTrue([PLSyntheticSDK writePlatformAtPath: path sdkVersions: versions error: &error], @"Could not write platform: %@", error);
+
+    PLSimulatorPlatform *platform = [[PLSimulatorPlatform alloc] initWithPath: path xcodePath: nil error: &error];
+    STAssertNotNil(platform, @"Could not load platform: %@", error);
+    return platform;
+}
+
+/**
+ * Write and load a synthetic application. The application is written to name.app within the test's
+ * temporary directory.
+ *
+ * @param name Application name.
+ * @param canonicalSDKName The canonical name of the SDK the application was built with.
+ * @param deviceFamilies UIDeviceFamily values supported by the application.
+ */
+- (PLSimulatorApplication *) applicationWithName: (NSString *) name canonicalSDKName: (NSString *) canonicalSDKName deviceFamilies: (NSArray *) deviceFamilies {
+    NSError *error;
+    NSString *path = [[self temporaryDirectory] stringByAppendingPathComponent: [name stringByAppendingPathExtension: @"app"]];
+    NSDictionary *info = [PLSyntheticApplication infoWithName: name canonicalSDKName: canonicalSDKName deviceFamilies: deviceFamilies];
+    STAssertTrue([PLSyntheticApplication writeApplicationAtPath: path info: info error: &error], @"Could not write application: %@", error);
+
+    PLSimulatorApplication *app = [[PLSimulatorApplication alloc] initWithPath: path error: &error];
+    STAssertNotNil(app, @"Could not load application: %@", error);
+    return app;
+}
+
+/**
+ * Write a versioned framework at @a path. The framework's executable and resources are written to
+ * Versions/version, and are referenced via the Versions/Current link and top-level links, as produced by Xcode.
+ *
+ * @param path Framework path (eg, Contents/Frameworks/Test.framework).
+ * @param version The framework version (eg, A).
+ */
+- (void) writeVersionedFrameworkAtPath: (NSString *) path version: (NSString *) version {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSString *name = [[path lastPathComponent] stringByDeletingPathExtension];
+    NSString *versionPath = [[path stringByAppendingPathComponent: @"Versions"] stringByAppendingPathComponent: version];
+    NSError *error;
+
+    NSString *resources = [versionPath stringByAppendingPathComponent: @"Resources"];
+    STAssertTrue([fm createDirectoryAtPath: resources withIntermediateDirectories: YES attributes: nil error: &error], @"Could not create framework: %@", error);
+
+    NSData *executable = [[NSString stringWithFormat: @"%@ executable, version %@", name, version] dataUsingEncoding: NSUTF8StringEncoding];
+    STAssertTrue([executable writeToFile: [versionPath stringByAppendingPathComponent: name] atomically: NO], @"Could not write framework executable");
+
+    NSDictionary *info = [NSDictionary dictionaryWithObject: version forKey: @"CFBundleVersion"];
+    STAssertTrue([info writeToFile: [resources stringByAppendingPathComponent: @"Info.plist"] atomically: NO], @"Could not write framework Info.plist");
+
+    /* Link the current version, and the top-level entries via the current version */
+    NSDictionary *links = [NSDictionary dictionaryWithObjectsAndKeys:
+                           version, @"Versions/Current",
+                           [@"Versions/Current" stringByAppendingPathComponent: name], name,
+                           @"Versions/Current/Resources", @"Resources",
+                           nil];
+    for (NSString *link in links) {
+        STAssertTrue([fm createSymbolicLinkAtPath: [path stringByAppendingPathComponent: link] withDestinationPath: [links objectForKey: link] error: &error],
+                     @"Could not create link: %@", error);
+    }
+}
+
+@end
@@ -28,10 +28,17 @@
 
 #import <SenTestingKit/SenTestingKit.h>
 
-@interface PLTestCase : SenTestCase
+@interface PLTestCase : SenTestCase {
+@private
+    /** Per-test temporary directory, or nil if not yet created. */
+    NSString *_temporaryDirectory;
+}
 
 - (void) spinRunloopWithTimeout: (NSTimeInterval) timeout predicate: (BOOL (^)()) predicate;
 
 - (NSString *) pathForResource: (NSString *) resource;
+- (NSString *) pathForResource: (NSString *) resource ofTestClass: (Class) testClass;
+
+- (NSString *) temporaryDirectory;
 
 @end
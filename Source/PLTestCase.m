@@ -33,6 +33,32 @@
  */
 @implementation PLTestCase
 
+- (void) tearDown {
+    if (_temporaryDirectory != nil) {
+        [[NSFileManager defaultManager] removeItemAtPath: _temporaryDirectory error: NULL];
+        _temporaryDirectory = nil;
+    }
+
+    [super tearDown];
+}
+
+/**
+ * Return the path to a uniquely named temporary directory, creating it on first use. The directory
+ * and its contents are removed when the test completes.
+ */
+- (NSString *) temporaryDirectory {
+    if (_temporaryDirectory != nil)
+        return _temporaryDirectory;
+
+    NSError *error;
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent: [[NSProcessInfo processInfo] globallyUniqueString]];
+    STAssertTrue([[NSFileManager defaultManager] createDirectoryAtPath: path withIntermediateDirectories: YES attributes: nil error: &error],
+                 @"Could not create temporary directory: %@", error);
+
+    _temporaryDirectory = path;
+    return _temporaryDirectory;
+}
+
 /**
  * Return the full path to the given test resource. Test resources are located in
  * TestBundle/Resources/Tests/TestName/ResourceName
@@ -40,7 +66,18 @@
  * @param resource Relative resource path.
  */
 - (NSString *) pathForResource: (NSString *) resource {
-    NSString *className = NSStringFromClass([self class]);
+    return [self pathForResource: resource ofTestClass: [self class]];
+}
+
+/**
+ * Return the full path to a test resource belonging to @a testClass, allowing tests to share resources without
+ * duplicating them. Test resources are located in TestBundle/Resources/Tests/TestName/ResourceName
+ *
+ * @param resource Relative resource path.
+ * @param testClass The test class owning the resource.
+ */
+- (NSString *) pathForResource: (NSString *) resource ofTestClass: (Class) testClass {
+    NSString *className = NSStringFromClass(testClass);
     NSString *resources = [[NSBundle bundleForClass: [self class]] resourcePath];
     NSString *testResources = [resources stringByAppendingPathComponent: @"Tests"];
     NSString *root = [testResources stringByAppendingPathComponent: className];